@@ -51,6 +51,25 @@ IF (WALRUS_JIT)
     SET (WALRUS_DEFINITIONS ${WALRUS_DEFINITIONS} -DWALRUS_ENABLE_JIT)
 ENDIF()
 
+# Serialized modules are only loaded by the build which created them.
+# The id is derived from the source revision, so rebuilding the same
+# sources keeps the module cache valid.
+IF (NOT DEFINED WALRUS_BUILD_ID)
+    FIND_PACKAGE (Git QUIET)
+    IF (GIT_FOUND)
+        EXECUTE_PROCESS (COMMAND ${GIT_EXECUTABLE} rev-parse HEAD
+                         WORKING_DIRECTORY ${WALRUS_ROOT}
+                         OUTPUT_VARIABLE WALRUS_BUILD_ID
+                         OUTPUT_STRIP_TRAILING_WHITESPACE
+                         ERROR_QUIET)
+    ENDIF()
+    IF (NOT WALRUS_BUILD_ID)
+        SET (WALRUS_BUILD_ID "unknown")
+    ENDIF()
+    SET (WALRUS_BUILD_ID "${WALRUS_BUILD_ID}-${WALRUS_HOST}-${WALRUS_ARCH}-${WALRUS_MODE}-jit-${WALRUS_JIT}")
+ENDIF()
+SET (WALRUS_DEFINITIONS ${WALRUS_DEFINITIONS} -DWALRUS_BUILD_ID=\"${WALRUS_BUILD_ID}\")
+
 #######################################################
 # FLAGS FOR TEST
 #######################################################
@@ -64,3 +83,7 @@ SET (PROFILER_FLAGS)
 IF (WALRUS_VALGRIND)
     SET (PROFILER_FLAGS ${PROFILER_FLAGS} -DWALRUS_VALGRIND)
 ENDIF()
+
+IF (WALRUS_PROFILE_BYTECODE_PAIRS)
+    SET (PROFILER_FLAGS ${PROFILER_FLAGS} -DWALRUS_PROFILE_BYTECODE_PAIRS)
+ENDIF()
@@ -217,6 +217,7 @@ if (f.type == Type::B) { puts("failed in msvc."); }
 #include <cstdlib>
 #include <cstring>
 #include <cwchar>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <list>
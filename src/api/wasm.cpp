@@ -32,6 +32,8 @@
 #include "runtime/Trap.h"
 #include "runtime/TypeStore.h"
 #include "parser/WASMParser.h"
+#include "wabt/common.h"
+#include "wabt/walrus/binary-reader-walrus.h"
 
 using namespace Walrus;
 
@@ -89,6 +91,7 @@ struct wasm_exporttype_t {
 };
 
 struct wasm_config_t {
+    EngineConfig config;
 };
 
 struct wasm_engine_t {
@@ -313,8 +316,10 @@ struct wasm_extern_t : wasm_ref_t {
 };
 
 struct wasm_module_t : wasm_ref_t {
-    wasm_module_t(own const Module* module)
+    wasm_module_t(own const Module* module, const uint8_t* data, size_t size, bool serialized)
         : wasm_ref_t(module)
+        , data(data, data + size)
+        , isSerialized(serialized)
     {
     }
 
@@ -323,6 +328,11 @@ struct wasm_module_t : wasm_ref_t {
         ASSERT(obj && obj->isModule());
         return const_cast<Module*>(static_cast<const Module*>(obj));
     }
+
+    // Either the binary, or the serialized module when
+    // the module is created by wasm_module_deserialize.
+    std::vector<uint8_t> data;
+    bool isSerialized;
 };
 
 struct wasm_func_t : wasm_extern_t {
@@ -637,9 +647,91 @@ const wasm_externtype_t* wasm_exporttype_type(const wasm_exporttype_t* exportTyp
 // Configuration
 own wasm_config_t* wasm_config_new()
 {
-    // TODO
-    RELEASE_ASSERT_NOT_REACHED();
-    return nullptr;
+    return new wasm_config_t();
+}
+
+static void setFlag(uint32_t& flags, uint32_t flag, bool enable)
+{
+    if (enable) {
+        flags |= flag;
+    } else {
+        flags &= ~flag;
+    }
+}
+
+void walrus_config_jit_set(wasm_config_t* config, bool enable)
+{
+#if defined(WALRUS_ENABLE_JIT)
+    setFlag(config->config.JITFlags, JITFlagValue::useJIT, enable);
+#endif
+}
+
+void walrus_config_jit_tiering_set(wasm_config_t* config, bool enable)
+{
+#if defined(WALRUS_ENABLE_JIT)
+    // Tiering requires the JIT compiler.
+    setFlag(config->config.JITFlags, JITFlagValue::useTiering, enable);
+    if (enable) {
+        config->config.JITFlags |= JITFlagValue::useJIT;
+    }
+#endif
+}
+
+void walrus_config_jit_tier_up_threshold_set(wasm_config_t* config, uint32_t calls)
+{
+    config->config.tierUpThreshold = calls;
+}
+
+void walrus_config_jit_reg_alloc_set(wasm_config_t* config, bool enable)
+{
+    setFlag(config->config.JITFlags, JITFlagValue::disableRegAlloc, !enable);
+}
+
+void walrus_config_jit_inline_set(wasm_config_t* config, bool enable)
+{
+    setFlag(config->config.JITFlags, JITFlagValue::disableInline, !enable);
+}
+
+void walrus_config_jit_threads_set(wasm_config_t* config, uint32_t count)
+{
+    config->config.JITThreadCount = count;
+}
+
+void walrus_config_jit_guard_pages_set(wasm_config_t* config, bool enable)
+{
+#if defined(WALRUS_ENABLE_JIT)
+    config->config.guardPages = enable;
+#endif
+}
+
+void walrus_config_parser_threads_set(wasm_config_t* config, uint32_t count)
+{
+    config->config.parserThreadCount = count;
+}
+
+void walrus_config_lazy_compile_set(wasm_config_t* config, bool enable)
+{
+    setFlag(config->config.JITFlags, JITFlagValue::lazyCompile, enable);
+}
+
+void walrus_config_web_assembly3_set(wasm_config_t* config, bool enable)
+{
+    setFlag(config->config.featureFlags, wabt::FeatureFlagValue::enableWebAssembly3, enable);
+}
+
+void walrus_config_memory_pool_set(wasm_config_t* config, size_t slots)
+{
+    config->config.memoryPoolSlots = slots;
+}
+
+void walrus_config_reserve_memory_maximum_set(wasm_config_t* config, bool enable)
+{
+    config->config.reserveMemoryMaximum = enable;
+}
+
+void walrus_config_cache_dir_set(wasm_config_t* config, const char* path)
+{
+    config->config.cacheDir = path ? path : "";
 }
 
 // Engine
@@ -648,11 +740,11 @@ own wasm_engine_t* wasm_engine_new()
     return new wasm_engine_t(new Engine());
 }
 
-own wasm_engine_t* wasm_engine_new_with_config(own wasm_config_t*)
+own wasm_engine_t* wasm_engine_new_with_config(own wasm_config_t* config)
 {
-    // TODO
-    RELEASE_ASSERT_NOT_REACHED();
-    return nullptr;
+    wasm_engine_t* engine = new wasm_engine_t(new Engine(config->config));
+    wasm_config_delete(config);
+    return engine;
 }
 
 // Store
@@ -809,16 +901,26 @@ void wasm_trap_trigger(const char* message, size_t length)
 // Modules
 own wasm_module_t* wasm_module_new(wasm_store_t* store, const wasm_byte_vec_t* binary)
 {
-    auto parseResult = WASMParser::parseBinary(store->get(), std::string(), reinterpret_cast<uint8_t*>(binary->data), binary->size);
+    const EngineConfig& config = store->get()->engine()->config();
+    const uint8_t* data = reinterpret_cast<uint8_t*>(binary->data);
+    std::pair<Optional<Module*>, std::string> parseResult;
+
+    if (config.cacheDir.empty()) {
+        parseResult = WASMParser::parseBinary(store->get(), std::string(), data, binary->size, config.JITFlags, config.featureFlags);
+    } else {
+        parseResult = WASMParser::parseBinaryWithCache(store->get(), config.cacheDir, std::string(), data, binary->size, config.JITFlags, config.featureFlags);
+    }
     if (!parseResult.first.hasValue()) {
         return nullptr;
     }
-    return new wasm_module_t(parseResult.first.unwrap());
+    return new wasm_module_t(parseResult.first.unwrap(), reinterpret_cast<uint8_t*>(binary->data), binary->size, false);
 }
 
 bool wasm_module_validate(wasm_store_t* store, const wasm_byte_vec_t* binary)
 {
-    auto parseResult = WASMParser::parseBinary(store->get(), std::string(), reinterpret_cast<uint8_t*>(binary->data), binary->size);
+    // The module is not executed, so it is not compiled.
+    uint32_t featureFlags = store->get()->engine()->config().featureFlags;
+    auto parseResult = WASMParser::parseBinary(store->get(), std::string(), reinterpret_cast<uint8_t*>(binary->data), binary->size, 0, featureFlags);
     if (!parseResult.first.hasValue()) {
         return false;
     }
@@ -887,23 +989,36 @@ void wasm_module_exports(const wasm_module_t* module, own wasm_exporttype_vec_t*
     }
 }
 
-void wasm_module_serialize(const wasm_module_t*, own wasm_byte_vec_t* out)
+void wasm_module_serialize(const wasm_module_t* module, own wasm_byte_vec_t* out)
 {
-    // TODO
-    RELEASE_ASSERT_NOT_REACHED();
+    if (module->isSerialized) {
+        wasm_byte_vec_new(out, module->data.size(), reinterpret_cast<const wasm_byte_t*>(module->data.data()));
+        return;
+    }
+
+    std::vector<uint8_t> data;
+    WASMParser::serialize(module->get(), module->data.data(), module->data.size(), module->get()->store()->engine()->config().featureFlags, data);
+    wasm_byte_vec_new(out, data.size(), reinterpret_cast<const wasm_byte_t*>(data.data()));
 }
 
-own wasm_module_t* wasm_module_deserialize(wasm_store_t*, const wasm_byte_vec_t*)
+// The data must be created by wasm_module_serialize of the same build. It is
+// checked for corruption, but the byte code is not validated, so untrusted
+// data must not be passed to this function.
+own wasm_module_t* wasm_module_deserialize(wasm_store_t* store, const wasm_byte_vec_t* data)
 {
-    // TODO
-    RELEASE_ASSERT_NOT_REACHED();
-    return nullptr;
+    auto parseResult = WASMParser::deserialize(store->get(), std::string(), reinterpret_cast<uint8_t*>(data->data), data->size, store->get()->engine()->config().JITFlags);
+    if (!parseResult.first.hasValue()) {
+        return nullptr;
+    }
+
+    return new wasm_module_t(parseResult.first.unwrap(), reinterpret_cast<uint8_t*>(data->data), data->size, true);
 }
 
 // Function Instances
-static FunctionType* ToWalrusFunctionType(const wasm_functype_t* ft)
+static FunctionType* ToWalrusFunctionType(Store* store, const wasm_functype_t* ft)
 {
-    FunctionType* functionType = new FunctionType(ft->params.size, 0, ft->results.size, 0);
+    FunctionType* functionType = new FunctionType(ft->params.size, 0, ft->results.size, 0, true,
+                                                  reinterpret_cast<const CompositeType**>(TypeStore::NoIndex));
     TypeVector* params = functionType->initParam();
     TypeVector* results = functionType->initResult();
 
@@ -915,7 +1030,8 @@ static FunctionType* ToWalrusFunctionType(const wasm_functype_t* ft)
     }
 
     functionType->initDone();
-    return functionType;
+    // Canonical types are compared by address in indirect calls.
+    return store->getTypeStore().updateFunctionType(functionType);
 }
 
 own wasm_func_t* wasm_func_new(
@@ -923,7 +1039,7 @@ own wasm_func_t* wasm_func_new(
 {
     ImportedFunction* func = ImportedFunction::createImportedFunction(
         store->get(),
-        ToWalrusFunctionType(ft),
+        ToWalrusFunctionType(store->get(), ft),
         [=](ExecutionState& state, Value* argv, Value* result, void* d) {
             auto argc = state.currentFunction()->functionType()->param().size();
             wasm_val_vec_t params, results;
@@ -957,7 +1073,7 @@ own wasm_func_t* wasm_func_new_with_env(
     // TODO: finalizer
     ImportedFunction* func = ImportedFunction::createImportedFunction(
         store->get(),
-        ToWalrusFunctionType(ft),
+        ToWalrusFunctionType(store->get(), ft),
         [=](ExecutionState& state, Value* argv, Value* result, void* d) {
             auto argc = state.currentFunction()->functionType()->param().size();
             wasm_val_vec_t params, results;
@@ -999,47 +1115,93 @@ size_t wasm_func_result_arity(const wasm_func_t* func)
     return func->get()->functionType()->result().size();
 }
 
+static own wasm_trap_t* CreateTrap(std::unique_ptr<Exception>& exception)
+{
+    // FIXME
+    own wasm_message_t msg;
+    if (exception->message().length()) {
+        std::string& exceptionMsg = exception->message();
+        wasm_byte_vec_new(&msg, exceptionMsg.length(), exceptionMsg.data());
+    } else {
+        wasm_byte_vec_new_empty(&msg);
+    }
+
+    wasm_trap_t* trap = new wasm_trap_t(new Trap(), &msg);
+    wasm_byte_vec_delete(&msg);
+    return trap;
+}
+
 own wasm_trap_t* wasm_func_call(
     const wasm_func_t* func, const wasm_val_vec_t* args, wasm_val_vec_t* results)
 {
     size_t paramNum = wasm_func_param_arity(func);
     size_t resultNum = wasm_func_result_arity(func);
 
-    ValueVector walrusArgs, walrusResults;
-    walrusArgs.resize(paramNum);
-    walrusResults.resize(resultNum);
+    // The values are kept on the stack, so short calls do not allocate memory.
+    ALLOCA(Value, walrusArgs, paramNum * sizeof(Value));
+    ALLOCA(Value, walrusResults, resultNum * sizeof(Value));
 
-    ToWalrusValues(walrusArgs.data(), args->data, paramNum);
+    ToWalrusValues(walrusArgs, args->data, paramNum);
 
     struct RunData {
         Function* fn;
-        Walrus::ValueVector& args;
-        Walrus::ValueVector& results;
+        Value* args;
+        Value* results;
     } data = { func->get(), walrusArgs, walrusResults };
     Trap trap;
     auto trapResult = trap.run([](ExecutionState& state, void* d) {
         RunData* data = reinterpret_cast<RunData*>(d);
 
-        data->fn->call(state, data->args.data(), data->results.data());
+        data->fn->call(state, data->args, data->results);
     },
                                &data);
 
     if (trapResult.exception) {
-        // FIXME
-        own wasm_message_t msg;
-        if (trapResult.exception->message().length()) {
-            std::string& exceptionMsg = trapResult.exception->message();
-            wasm_byte_vec_new(&msg, exceptionMsg.length(), exceptionMsg.data());
-        } else {
-            wasm_byte_vec_new_empty(&msg);
-        }
+        return CreateTrap(trapResult.exception);
+    }
+
+    FromWalrusValues(results->data, walrusResults, resultNum);
+    return nullptr;
+}
 
-        wasm_trap_t* trap = new wasm_trap_t(new Trap(), &msg);
-        wasm_byte_vec_delete(&msg);
-        return trap;
+struct walrus_prepared_call_t {
+    explicit walrus_prepared_call_t(PreparedCall* call)
+        : call(call)
+    {
     }
 
-    FromWalrusValues(results->data, walrusResults.data(), resultNum);
+    std::unique_ptr<PreparedCall> call;
+};
+
+own walrus_prepared_call_t* walrus_func_prepare_call(const wasm_func_t* func)
+{
+    Function* fn = func->get();
+    if (fn->kind() != Function::DefinedFunctionKind) {
+        return nullptr;
+    }
+
+    PreparedCall* call = PreparedCall::create(fn->asDefinedFunction());
+    if (!call) {
+        return nullptr;
+    }
+
+    static_assert(sizeof(walrus_val_raw_t) == PreparedCall::s_slotSize, "raw values must fill the slots");
+    return new walrus_prepared_call_t(call);
+}
+
+void walrus_prepared_call_delete(own walrus_prepared_call_t* call)
+{
+    delete call;
+}
+
+own wasm_trap_t* walrus_prepared_call_invoke(
+    const walrus_prepared_call_t* call, walrus_val_raw_t* args_and_results)
+{
+    auto trapResult = call->call->call(reinterpret_cast<uint8_t*>(args_and_results));
+
+    if (UNLIKELY(trapResult.exception != nullptr)) {
+        return CreateTrap(trapResult.exception);
+    }
     return nullptr;
 }
 
@@ -1325,7 +1487,7 @@ uint32_t wasm_instance_func_index(const wasm_instance_t* ins, const wasm_func_t*
     }
 
 //WASM_IMPL_OWN(frame);
-//WASM_IMPL_OWN(config);
+WASM_IMPL_OWN(config);
 WASM_IMPL_OWN(engine);
 WASM_IMPL_OWN(store);
 
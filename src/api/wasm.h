@@ -129,6 +129,28 @@ WASM_API_EXTERN own wasm_config_t* wasm_config_new(void);
 
 // Embedders may provide custom functions for manipulating configs.
 
+// Walrus specific options. The JIT options are ignored
+// when walrus is built without the JIT compiler.
+WASM_API_EXTERN void walrus_config_jit_set(wasm_config_t*, bool enable);
+WASM_API_EXTERN void walrus_config_jit_tiering_set(wasm_config_t*, bool enable);
+// Passing 0 or 1 compiles the functions after their first call.
+WASM_API_EXTERN void walrus_config_jit_tier_up_threshold_set(wasm_config_t*, uint32_t calls);
+WASM_API_EXTERN void walrus_config_jit_reg_alloc_set(wasm_config_t*, bool enable);
+WASM_API_EXTERN void walrus_config_jit_inline_set(wasm_config_t*, bool enable);
+// Passing 0 selects the number of hardware threads.
+WASM_API_EXTERN void walrus_config_jit_threads_set(wasm_config_t*, uint32_t count);
+// Guard pages are process wide: once an engine enables
+// them, they are used by all engines of the process.
+WASM_API_EXTERN void walrus_config_jit_guard_pages_set(wasm_config_t*, bool enable);
+WASM_API_EXTERN void walrus_config_parser_threads_set(wasm_config_t*, uint32_t count);
+WASM_API_EXTERN void walrus_config_lazy_compile_set(wasm_config_t*, bool enable);
+WASM_API_EXTERN void walrus_config_web_assembly3_set(wasm_config_t*, bool enable);
+// Passing 0 disables the memory pool.
+WASM_API_EXTERN void walrus_config_memory_pool_set(wasm_config_t*, size_t slots);
+WASM_API_EXTERN void walrus_config_reserve_memory_maximum_set(wasm_config_t*, bool enable);
+// Passing NULL disables the cache.
+WASM_API_EXTERN void walrus_config_cache_dir_set(wasm_config_t*, const char* path);
+
 
 // Engine
 
@@ -433,6 +455,28 @@ WASM_API_EXTERN size_t wasm_func_result_arity(const wasm_func_t*);
 WASM_API_EXTERN own wasm_trap_t* wasm_func_call(
   const wasm_func_t*, const wasm_val_vec_t* args, wasm_val_vec_t* results);
 
+// Walrus specific prepared calls. The function and its signature are
+// resolved once, and each invocation reads the arguments from the slots
+// of a caller provided buffer, and writes the results into the same slots.
+// The buffer must have max(param arity, result arity) slots. Invocations
+// do not allocate memory. Preparing fails (returns NULL) for imported
+// functions, and for functions with reference or v128 values.
+
+typedef union walrus_val_raw_t {
+  int32_t i32;
+  int64_t i64;
+  float32_t f32;
+  float64_t f64;
+} walrus_val_raw_t;
+
+typedef struct walrus_prepared_call_t walrus_prepared_call_t;
+
+WASM_API_EXTERN own walrus_prepared_call_t* walrus_func_prepare_call(const wasm_func_t*);
+WASM_API_EXTERN void walrus_prepared_call_delete(own walrus_prepared_call_t*);
+
+WASM_API_EXTERN own wasm_trap_t* walrus_prepared_call_invoke(
+  const walrus_prepared_call_t*, walrus_val_raw_t* args_and_results);
+
 
 // Global Instances
 
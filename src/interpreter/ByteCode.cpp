@@ -37,6 +37,15 @@ ByteCode::ByteCode(ByteCode::Opcode opcode)
 {
 }
 
+void ByteCode::setOpcode(ByteCode::Opcode opcode)
+{
+#if defined(WALRUS_ENABLE_COMPUTED_GOTO)
+    m_opcodeInAddress = g_byteCodeTable.m_addressTable[opcode];
+#else
+    m_opcode = opcode;
+#endif
+}
+
 #if defined(WALRUS_ENABLE_COMPUTED_GOTO)
 ByteCode::Opcode ByteCode::opcode() const
 {
@@ -107,5 +116,19 @@ size_t ByteCode::getSize() const
     RELEASE_ASSERT_NOT_REACHED();
 }
 
+ByteCode::Opcode ByteCode::baseOpcode(ByteCode::Opcode opcode)
+{
+    switch (opcode) {
+#define SUPER_INSTRUCTION_BASE(name, base, ...) \
+    case name##Opcode:                          \
+        return base##Opcode;
+        FOR_EACH_BYTECODE_COMPARE_JUMP_OP(SUPER_INSTRUCTION_BASE)
+        FOR_EACH_BYTECODE_LOAD_BINARY_OP(SUPER_INSTRUCTION_BASE)
+#undef SUPER_INSTRUCTION_BASE
+    default:
+        return opcode;
+    }
+}
+
 
 } // namespace Walrus
@@ -1380,9 +1380,101 @@ class FunctionType;
     F(I32X4RelaxedLaneSelect, (simdBitSelectOperation)) \
     F(I64X2RelaxedLaneSelect, (simdBitSelectOperation))
 
+// Superinstructions execute two adjacent byte codes with a single dispatch.
+// They replace the opcode of the first byte code, and the second byte code
+// is kept, so the layout of the byte code and the jump targets do not change.
+// The pairs are selected by the WALRUS_PROFILE_BYTECODE_PAIRS build.
+// F(name, first byte code, operation, operand type, second byte code)
+#define FOR_EACH_BYTECODE_COMPARE_JUMP_OP(F)                \
+    F(I32EqJumpIfTrue, I32Eq, eq, int32_t, JumpIfTrue)      \
+    F(I32EqJumpIfFalse, I32Eq, eq, int32_t, JumpIfFalse)    \
+    F(I32NeJumpIfTrue, I32Ne, ne, int32_t, JumpIfTrue)      \
+    F(I32NeJumpIfFalse, I32Ne, ne, int32_t, JumpIfFalse)    \
+    F(I32LtSJumpIfTrue, I32LtS, lt, int32_t, JumpIfTrue)    \
+    F(I32LtSJumpIfFalse, I32LtS, lt, int32_t, JumpIfFalse)  \
+    F(I32LtUJumpIfTrue, I32LtU, lt, uint32_t, JumpIfTrue)   \
+    F(I32LtUJumpIfFalse, I32LtU, lt, uint32_t, JumpIfFalse) \
+    F(I32LeSJumpIfTrue, I32LeS, le, int32_t, JumpIfTrue)    \
+    F(I32LeSJumpIfFalse, I32LeS, le, int32_t, JumpIfFalse)  \
+    F(I32LeUJumpIfTrue, I32LeU, le, uint32_t, JumpIfTrue)   \
+    F(I32LeUJumpIfFalse, I32LeU, le, uint32_t, JumpIfFalse) \
+    F(I32GtSJumpIfTrue, I32GtS, gt, int32_t, JumpIfTrue)    \
+    F(I32GtSJumpIfFalse, I32GtS, gt, int32_t, JumpIfFalse)  \
+    F(I32GtUJumpIfTrue, I32GtU, gt, uint32_t, JumpIfTrue)   \
+    F(I32GtUJumpIfFalse, I32GtU, gt, uint32_t, JumpIfFalse) \
+    F(I32GeSJumpIfTrue, I32GeS, ge, int32_t, JumpIfTrue)    \
+    F(I32GeSJumpIfFalse, I32GeS, ge, int32_t, JumpIfFalse)  \
+    F(I32GeUJumpIfTrue, I32GeU, ge, uint32_t, JumpIfTrue)   \
+    F(I32GeUJumpIfFalse, I32GeU, ge, uint32_t, JumpIfFalse) \
+    F(I64EqJumpIfTrue, I64Eq, eq, int64_t, JumpIfTrue)      \
+    F(I64EqJumpIfFalse, I64Eq, eq, int64_t, JumpIfFalse)    \
+    F(I64NeJumpIfTrue, I64Ne, ne, int64_t, JumpIfTrue)      \
+    F(I64NeJumpIfFalse, I64Ne, ne, int64_t, JumpIfFalse)    \
+    F(I64LtSJumpIfTrue, I64LtS, lt, int64_t, JumpIfTrue)    \
+    F(I64LtSJumpIfFalse, I64LtS, lt, int64_t, JumpIfFalse)  \
+    F(I64LtUJumpIfTrue, I64LtU, lt, uint64_t, JumpIfTrue)   \
+    F(I64LtUJumpIfFalse, I64LtU, lt, uint64_t, JumpIfFalse) \
+    F(I64LeSJumpIfTrue, I64LeS, le, int64_t, JumpIfTrue)    \
+    F(I64LeSJumpIfFalse, I64LeS, le, int64_t, JumpIfFalse)  \
+    F(I64LeUJumpIfTrue, I64LeU, le, uint64_t, JumpIfTrue)   \
+    F(I64LeUJumpIfFalse, I64LeU, le, uint64_t, JumpIfFalse) \
+    F(I64GtSJumpIfTrue, I64GtS, gt, int64_t, JumpIfTrue)    \
+    F(I64GtSJumpIfFalse, I64GtS, gt, int64_t, JumpIfFalse)  \
+    F(I64GtUJumpIfTrue, I64GtU, gt, uint64_t, JumpIfTrue)   \
+    F(I64GtUJumpIfFalse, I64GtU, gt, uint64_t, JumpIfFalse) \
+    F(I64GeSJumpIfTrue, I64GeS, ge, int64_t, JumpIfTrue)    \
+    F(I64GeSJumpIfFalse, I64GeS, ge, int64_t, JumpIfFalse)  \
+    F(I64GeUJumpIfTrue, I64GeU, ge, uint64_t, JumpIfTrue)   \
+    F(I64GeUJumpIfFalse, I64GeU, ge, uint64_t, JumpIfFalse) \
+    F(F32EqJumpIfTrue, F32Eq, eq, float, JumpIfTrue)        \
+    F(F32EqJumpIfFalse, F32Eq, eq, float, JumpIfFalse)      \
+    F(F32NeJumpIfTrue, F32Ne, ne, float, JumpIfTrue)        \
+    F(F32NeJumpIfFalse, F32Ne, ne, float, JumpIfFalse)      \
+    F(F32LtJumpIfTrue, F32Lt, lt, float, JumpIfTrue)        \
+    F(F32LtJumpIfFalse, F32Lt, lt, float, JumpIfFalse)      \
+    F(F32LeJumpIfTrue, F32Le, le, float, JumpIfTrue)        \
+    F(F32LeJumpIfFalse, F32Le, le, float, JumpIfFalse)      \
+    F(F32GtJumpIfTrue, F32Gt, gt, float, JumpIfTrue)        \
+    F(F32GtJumpIfFalse, F32Gt, gt, float, JumpIfFalse)      \
+    F(F32GeJumpIfTrue, F32Ge, ge, float, JumpIfTrue)        \
+    F(F32GeJumpIfFalse, F32Ge, ge, float, JumpIfFalse)      \
+    F(F64EqJumpIfTrue, F64Eq, eq, double, JumpIfTrue)       \
+    F(F64EqJumpIfFalse, F64Eq, eq, double, JumpIfFalse)     \
+    F(F64NeJumpIfTrue, F64Ne, ne, double, JumpIfTrue)       \
+    F(F64NeJumpIfFalse, F64Ne, ne, double, JumpIfFalse)     \
+    F(F64LtJumpIfTrue, F64Lt, lt, double, JumpIfTrue)       \
+    F(F64LtJumpIfFalse, F64Lt, lt, double, JumpIfFalse)     \
+    F(F64LeJumpIfTrue, F64Le, le, double, JumpIfTrue)       \
+    F(F64LeJumpIfFalse, F64Le, le, double, JumpIfFalse)     \
+    F(F64GtJumpIfTrue, F64Gt, gt, double, JumpIfTrue)       \
+    F(F64GtJumpIfFalse, F64Gt, gt, double, JumpIfFalse)     \
+    F(F64GeJumpIfTrue, F64Ge, ge, double, JumpIfTrue)       \
+    F(F64GeJumpIfFalse, F64Ge, ge, double, JumpIfFalse)
+
+// A load of memory 0 without offset, followed by a binary operation
+// which uses the loaded value. Binary operations with an immediate
+// operand need no superinstruction: constants are preallocated in
+// stack slots, so they are already executed by one byte code.
+// F(name, load byte code, load type, binary byte code, operation, operand type)
+#define FOR_EACH_BYTECODE_LOAD_BINARY_OP(F)                    \
+    F(Load32I32Add, Load32, uint32_t, I32Add, add, int32_t)    \
+    F(Load32I32Sub, Load32, uint32_t, I32Sub, sub, int32_t)    \
+    F(Load32I32Mul, Load32, uint32_t, I32Mul, mul, int32_t)    \
+    F(Load32I32And, Load32, uint32_t, I32And, intAnd, int32_t) \
+    F(Load32I32Or, Load32, uint32_t, I32Or, intOr, int32_t)    \
+    F(Load32I32Xor, Load32, uint32_t, I32Xor, intXor, int32_t) \
+    F(Load64I64Add, Load64, uint64_t, I64Add, add, int64_t)    \
+    F(Load64I64Sub, Load64, uint64_t, I64Sub, sub, int64_t)    \
+    F(Load64I64Mul, Load64, uint64_t, I64Mul, mul, int64_t)    \
+    F(Load64I64And, Load64, uint64_t, I64And, intAnd, int64_t) \
+    F(Load64I64Or, Load64, uint64_t, I64Or, intOr, int64_t)    \
+    F(Load64I64Xor, Load64, uint64_t, I64Xor, intXor, int64_t)
+
 #define FOR_EACH_BYTECODE(F)                        \
     FOR_EACH_BYTECODE_OP(F)                         \
     FOR_EACH_BYTECODE_BINARY_OP(F)                  \
+    FOR_EACH_BYTECODE_COMPARE_JUMP_OP(F)            \
+    FOR_EACH_BYTECODE_LOAD_BINARY_OP(F)             \
     FOR_EACH_BYTECODE_UNARY_OP(F)                   \
     FOR_EACH_BYTECODE_UNARY_OP_2(F)                 \
     FOR_EACH_BYTECODE_MEMIDX_OP(F)                  \
@@ -1444,6 +1536,14 @@ public:
     Opcode opcode() const;
     size_t getSize() const;
 
+    // Returns the opcode replaced by a superinstruction,
+    // or the opcode itself for other byte codes.
+    static Opcode baseOpcode(Opcode opcode);
+
+    // Serialized modules store the opcodes, since
+    // their addresses differ between processes.
+    void setOpcode(Opcode opcode);
+
 protected:
     friend class Interpreter;
     friend class ByteCodeTable;
@@ -1864,6 +1964,7 @@ public:
 
 
 FOR_EACH_BYTECODE_BINARY_OP(DEFINE_BINARY_BYTECODE)
+FOR_EACH_BYTECODE_COMPARE_JUMP_OP(DEFINE_BINARY_BYTECODE)
 FOR_EACH_BYTECODE_UNARY_OP(DEFINE_UNARY_BYTECODE)
 FOR_EACH_BYTECODE_UNARY_OP_2(DEFINE_UNARY_BYTECODE)
 FOR_EACH_BYTECODE_SIMD_BINARY_OP(DEFINE_BINARY_BYTECODE)
@@ -2009,6 +2110,7 @@ public:
     ByteCodeStackOffset calleeOffset() const { return m_calleeOffset; }
     uint32_t tableIndex() const { return m_tableIndex; }
     FunctionType* functionType() const { return m_functionType; }
+    void setFunctionType(FunctionType* functionType) { m_functionType = functionType; }
     uint16_t parameterOffsetsSize() const { return m_parameterOffsetsSize; }
     uint16_t resultOffsetsSize() const { return m_resultOffsetsSize; }
 
@@ -2071,6 +2173,7 @@ public:
 
     ByteCodeStackOffset calleeOffset() const { return m_calleeOffset; }
     FunctionType* functionType() const { return m_functionType; }
+    void setFunctionType(FunctionType* functionType) { m_functionType = functionType; }
     ByteCodeStackOffset* stackOffsets() const
     {
         return reinterpret_cast<ByteCodeStackOffset*>(reinterpret_cast<size_t>(this) + sizeof(CallRef));
@@ -2182,6 +2285,7 @@ public:
 
     ByteCodeStackOffset calleeOffset() const { return m_calleeOffset; }
     FunctionType* functionType() const { return m_functionType; }
+    void setFunctionType(FunctionType* functionType) { m_functionType = functionType; }
     ByteCodeStackOffset* stackOffsets() const
     {
         return reinterpret_cast<ByteCodeStackOffset*>(reinterpret_cast<size_t>(this) + sizeof(ReturnCallRef));
@@ -2245,6 +2349,21 @@ DEFINE_LOAD_OP(Load32M64, Load32M64Opcode, "32M64");
 DEFINE_LOAD_OP(Load64, Load64Opcode, "64");
 DEFINE_LOAD_OP(Load64M64, Load64M64Opcode, "64M64");
 
+// Only the opcode of the load is replaced, so the layout is the same.
+#define DEFINE_LOAD_BINARY_BYTECODE(name, load, ...)      \
+    class name : public load {                            \
+    public:                                               \
+        IF_DEBUG_ENABLED(                                 \
+            void dump(size_t pos) {                       \
+                printf(#name " ");                        \
+                DUMP_BYTECODE_OFFSET(stackOffset1);       \
+                DUMP_BYTECODE_OFFSET(stackOffset2);       \
+            });                                           \
+    };
+
+FOR_EACH_BYTECODE_LOAD_BINARY_OP(DEFINE_LOAD_BINARY_BYTECODE)
+#undef DEFINE_LOAD_BINARY_BYTECODE
+
 #define DEFINE_STORE_OP(className, opcodeType, opStr)                             \
     class className : public ByteCodeOffset2 {                                    \
     public:                                                                       \
@@ -2448,6 +2567,7 @@ public:
     ByteCodeStackOffset srcOffset() const { return stackOffset(); }
     int32_t offset() const { return int32Value(); }
     const CompositeType** typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const CompositeType** typeInfo) { m_typeInfo = typeInfo; }
     uint8_t srcInfo() const { return m_srcInfo; }
 
     void setOffset(int32_t offset)
@@ -4489,6 +4609,7 @@ public:
 
     ByteCodeStackOffset srcOffset() const { return m_srcOffset; }
     const CompositeType** typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const CompositeType** typeInfo) { m_typeInfo = typeInfo; }
     uint8_t srcInfo() const { return m_srcInfo; }
 
 #if !defined(NDEBUG)
@@ -4553,6 +4674,7 @@ public:
     ByteCodeStackOffset srcOffset() const { return m_srcOffset; }
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     const CompositeType** typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const CompositeType** typeInfo) { m_typeInfo = typeInfo; }
     uint8_t srcInfo() const { return m_srcInfo; }
 
 #if !defined(NDEBUG)
@@ -4626,6 +4748,7 @@ public:
     ByteCodeStackOffset src1Offset() const { return m_src1Offset; }
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     const ArrayType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const ArrayType* typeInfo) { m_typeInfo = typeInfo; }
 
 #if !defined(NDEBUG)
     void dump(size_t pos)
@@ -4657,6 +4780,7 @@ public:
     ByteCodeStackOffset srcOffset() const { return m_srcOffset; }
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     const ArrayType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const ArrayType* typeInfo) { m_typeInfo = typeInfo; }
 
 #if !defined(NDEBUG)
     void dump(size_t pos)
@@ -4686,6 +4810,7 @@ public:
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     void setDstOffset(ByteCodeStackOffset o) { m_dstOffset = o; }
     const ArrayType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const ArrayType* typeInfo) { m_typeInfo = typeInfo; }
     uint32_t length() const { return m_length; }
 
     ByteCodeStackOffset* dataOffsets() const
@@ -4736,6 +4861,7 @@ public:
     ByteCodeStackOffset src1Offset() const { return m_src1Offset; }
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     const ArrayType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const ArrayType* typeInfo) { m_typeInfo = typeInfo; }
     uint32_t index() { return m_index; }
 
 #if !defined(NDEBUG)
@@ -5046,6 +5172,7 @@ public:
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     void setDstOffset(ByteCodeStackOffset o) { m_dstOffset = o; }
     const StructType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const StructType* typeInfo) { m_typeInfo = typeInfo; }
 
     ByteCodeStackOffset* dataOffsets() const
     {
@@ -5087,6 +5214,7 @@ public:
 
     ByteCodeStackOffset dstOffset() const { return m_dstOffset; }
     const StructType* typeInfo() const { return m_typeInfo; }
+    void setTypeInfo(const StructType* typeInfo) { m_typeInfo = typeInfo; }
 
 #if !defined(NDEBUG)
     void dump(size_t pos)
@@ -42,6 +42,54 @@ namespace Walrus {
 
 ByteCodeTable g_byteCodeTable;
 
+#if defined(WALRUS_PROFILE_BYTECODE_PAIRS)
+// Counts the adjacent byte codes executed by the interpreter, and prints the
+// most frequent pairs when the process exits. Superinstructions are not
+// generated by this build, so the counts can be used to choose them.
+class ByteCodePairProfile {
+public:
+    ~ByteCodePairProfile()
+    {
+        static const char* names[ByteCode::OpcodeKindEnd] = {
+#define BYTECODE_NAME(name, ...) #name,
+            FOR_EACH_BYTECODE(BYTECODE_NAME)
+#undef BYTECODE_NAME
+        };
+        static const size_t maxPairCount = 64;
+
+        std::vector<std::pair<uint64_t, size_t>> pairs;
+        for (size_t i = 0; i < s_pairCount; i++) {
+            uint64_t count = m_counts[i].load(std::memory_order_relaxed);
+            if (count > 0) {
+                pairs.push_back(std::make_pair(count, i));
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end(), std::greater<std::pair<uint64_t, size_t>>());
+        for (size_t i = 0; i < pairs.size() && i < maxPairCount; i++) {
+            fprintf(stderr, "%" PRIu64 " %s %s\n", pairs[i].first,
+                    names[pairs[i].second / ByteCode::OpcodeKindEnd], names[pairs[i].second % ByteCode::OpcodeKindEnd]);
+        }
+    }
+
+    static ByteCode::Opcode record(ByteCode::Opcode previous, ByteCode::Opcode current)
+    {
+        if (previous != ByteCode::OpcodeKindEnd) {
+            s_profile.m_counts[previous * ByteCode::OpcodeKindEnd + current].fetch_add(1, std::memory_order_relaxed);
+        }
+        return current;
+    }
+
+private:
+    static const size_t s_pairCount = static_cast<size_t>(ByteCode::OpcodeKindEnd) * ByteCode::OpcodeKindEnd;
+    static ByteCodePairProfile s_profile;
+
+    std::atomic<uint64_t> m_counts[s_pairCount];
+};
+
+ByteCodePairProfile ByteCodePairProfile::s_profile;
+#endif
+
 
 // SIMD Structures
 template <typename T, uint8_t L>
@@ -506,6 +554,40 @@ ByteCodeStackOffset* Interpreter::interpret(ExecutionState& state,
         NEXT_INSTRUCTION();                                                 \
     }
 
+// The jump offset is relative to the second byte code.
+#define COMPARE_JUMP_OPERATION(name, base, op, paramType, jumpType)                        \
+    DEFINE_OPCODE(name)                                                                    \
+    {                                                                                      \
+        name* code = (name*)programCounter;                                                \
+        auto lhs = readValue<paramType>(bp, code->srcOffset()[0]);                         \
+        auto rhs = readValue<paramType>(bp, code->srcOffset()[1]);                         \
+        int32_t result = op(state, lhs, rhs);                                              \
+        writeValue<int32_t>(bp, code->dstOffset(), result);                                \
+        ADD_PROGRAM_COUNTER(name);                                                         \
+        if ((result != 0) == (ByteCode::jumpType##Opcode == ByteCode::JumpIfTrueOpcode)) { \
+            programCounter += ((jumpType*)programCounter)->offset();                       \
+        } else {                                                                           \
+            ADD_PROGRAM_COUNTER(jumpType);                                                 \
+        }                                                                                  \
+        NEXT_INSTRUCTION();                                                                \
+    }
+
+// The binary operation is the second byte code.
+#define LOAD_BINARY_OPERATION(name, loadOp, loadType, binaryOp, op, paramType)                  \
+    DEFINE_OPCODE(name)                                                                         \
+    {                                                                                           \
+        name* code = (name*)programCounter;                                                     \
+        uint32_t offset = readValue<uint32_t>(bp, code->srcOffset());                           \
+        memories[0]->load(state, offset, reinterpret_cast<loadType*>(bp + code->dstOffset()));  \
+        ADD_PROGRAM_COUNTER(name);                                                              \
+        binaryOp* binaryCode = (binaryOp*)programCounter;                                       \
+        auto lhs = readValue<paramType>(bp, binaryCode->srcOffset()[0]);                        \
+        auto rhs = readValue<paramType>(bp, binaryCode->srcOffset()[1]);                        \
+        writeValue<paramType>(bp, binaryCode->dstOffset(), op(state, lhs, rhs));                \
+        ADD_PROGRAM_COUNTER(binaryOp);                                                          \
+        NEXT_INSTRUCTION();                                                                     \
+    }
+
 #define UNARY_OPERATION(name, op, type)                                                      \
     DEFINE_OPCODE(name)                                                                      \
     {                                                                                        \
@@ -1353,6 +1435,14 @@ ByteCodeStackOffset* Interpreter::interpret(ExecutionState& state,
         NEXT_INSTRUCTION();                                                                                        \
     }
 
+#if defined(WALRUS_PROFILE_BYTECODE_PAIRS)
+    ByteCode::Opcode previousOpcode = ByteCode::OpcodeKindEnd;
+#define PROFILE_BYTECODE_PAIR() \
+    previousOpcode = ByteCodePairProfile::record(previousOpcode, ((ByteCode*)programCounter)->opcode());
+#else
+#define PROFILE_BYTECODE_PAIR()
+#endif
+
 #if defined(WALRUS_ENABLE_COMPUTED_GOTO)
 #if defined(WALRUS_COMPUTED_GOTO_INTERPRETER_INIT_WITH_NULL)
     if (UNLIKELY((((ByteCode*)programCounter)->m_opcodeInAddress) == NULL)) {
@@ -1366,6 +1456,7 @@ ByteCodeStackOffset* Interpreter::interpret(ExecutionState& state,
 #define NEXT_INSTRUCTION() goto NextInstruction;
 
 NextInstruction:
+    PROFILE_BYTECODE_PAIR();
     /* Execute first instruction. */
     goto*(((ByteCode*)programCounter)->m_opcodeInAddress);
 #else
@@ -1378,6 +1469,7 @@ NextInstruction:
 #define NEXT_INSTRUCTION() \
     goto NextInstruction;
 NextInstruction:
+    PROFILE_BYTECODE_PAIR();
     auto currentOpcode = ((ByteCode*)programCounter)->m_opcode;
 
     switch (currentOpcode) {
@@ -1497,6 +1589,8 @@ NextInstruction:
     }
 
     FOR_EACH_BYTECODE_BINARY_OP(BINARY_OPERATION)
+    FOR_EACH_BYTECODE_COMPARE_JUMP_OP(COMPARE_JUMP_OPERATION)
+    FOR_EACH_BYTECODE_LOAD_BINARY_OP(LOAD_BINARY_OPERATION)
     FOR_EACH_BYTECODE_UNARY_OP(UNARY_OPERATION)
     FOR_EACH_BYTECODE_UNARY_OP_2(UNARY_OPERATION_2)
     FOR_EACH_BYTECODE_SIMD_BINARY_OP(SIMD_BINARY_OPERATION)
@@ -1511,9 +1605,28 @@ NextInstruction:
     FOR_EACH_BYTECODE_RELAXED_SIMD_TERNARY_OP(SIMD_TERNARY_OPERATION)
     FOR_EACH_BYTECODE_RELAXED_SIMD_TERNARY_OTHER(SIMD_TERNARY_OTHER_OPERATION)
 
+#if defined(WALRUS_ENABLE_JIT)
+#define COUNT_BACK_EDGE(code)                                                                                \
+    if (UNLIKELY(code->offset() < 0)) {                                                                      \
+        DefinedFunction* function = state.m_currentFunction.value()->asDefinedFunction();                    \
+        if (UNLIKELY(function->moduleFunction()->countTierUp())) {                                           \
+            tierUp(function);                                                                                \
+        } else if (UNLIKELY(function->moduleFunction()->jitFunction() != nullptr)) {                         \
+            ByteCodeStackOffset* resultOffsets = onStackReplacement(state, function,                         \
+                                                                    programCounter + code->offset(), frame); \
+            if (resultOffsets != nullptr) {                                                                  \
+                return resultOffsets;                                                                        \
+            }                                                                                                \
+        }                                                                                                    \
+    }
+#else
+#define COUNT_BACK_EDGE(code)
+#endif
+
     DEFINE_OPCODE(Jump)
     {
         Jump* code = (Jump*)programCounter;
+        COUNT_BACK_EDGE(code);
         programCounter += code->offset();
         NEXT_INSTRUCTION();
     }
@@ -1522,6 +1635,7 @@ NextInstruction:
     {
         JumpIfTrue* code = (JumpIfTrue*)programCounter;
         if (readValue<int32_t>(bp, code->srcOffset())) {
+            COUNT_BACK_EDGE(code);
             programCounter += code->offset();
         } else {
             ADD_PROGRAM_COUNTER(JumpIfTrue);
@@ -1535,6 +1649,7 @@ NextInstruction:
         if (readValue<int32_t>(bp, code->srcOffset())) {
             ADD_PROGRAM_COUNTER(JumpIfFalse);
         } else {
+            COUNT_BACK_EDGE(code);
             programCounter += code->offset();
         }
         NEXT_INSTRUCTION();
@@ -1612,27 +1727,48 @@ NextInstruction:
         NEXT_INSTRUCTION();
     }
 
+// The exception is passed to a handler of the current function, or it
+// is returned to the caller of the interpreter through the frame.
+#define HANDLE_EXCEPTION(exception)                                     \
+    if (UNLIKELY(exception != nullptr)) {                               \
+        if (!catchException(state, programCounter, frame, exception)) { \
+            frame.setException(exception);                              \
+            return nullptr;                                             \
+        }                                                               \
+    }
+
+// Traps cannot be caught by wasm handlers, so they are always returned.
+#define TRAP(message)                                                    \
+    {                                                                    \
+        frame.setException(Exception::create(state, message).release()); \
+        return nullptr;                                                  \
+    }
+
     DEFINE_OPCODE(Call)
     {
-        callOperation(state, programCounter, bp, instance);
+        Exception* exception = callOperation(state, programCounter, bp, instance);
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
     DEFINE_OPCODE(CallIndirect)
     {
-        callIndirectOperation(state, programCounter, bp, instance, false);
+        Exception* exception = callIndirectOperation(state, programCounter, bp, instance, false);
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
     DEFINE_OPCODE(CallIndirectM64)
     {
-        callIndirectOperation(state, programCounter, bp, instance, true);
+        Exception* exception = callIndirectOperation(state, programCounter, bp, instance, true);
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
     DEFINE_OPCODE(CallRef)
     {
-        callRefOperation(state, programCounter, bp, instance);
+        Exception* exception = callRefOperation(state, programCounter, bp, instance);
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
@@ -1657,15 +1793,15 @@ NextInstruction:
 
         uint32_t idx = readValue<uint32_t>(bp, code->calleeOffset());
         if (UNLIKELY(idx >= table->size())) {
-            Trap::throwException(state, "undefined element");
+            TRAP("undefined element");
         }
         auto target = reinterpret_cast<Function*>(table->uncheckedGetElement(idx));
         if (UNLIKELY(Value::isNull(target))) {
-            Trap::throwException(state, "uninitialized element " + std::to_string(idx));
+            TRAP("uninitialized element " + std::to_string(idx));
         }
         const FunctionType* ft = target->functionType();
-        if (UNLIKELY(!ft->equals(code->functionType()))) {
-            Trap::throwException(state, "indirect call type mismatch");
+        if (UNLIKELY(!ft->equals(code->functionType(), true))) {
+            TRAP("indirect call type mismatch");
         }
 
         if (tailCallOperation(state, programCounter, frame, instance, target, code->stackOffsets(),
@@ -1684,15 +1820,15 @@ NextInstruction:
 
         uint64_t idx = readValue<uint64_t>(bp, code->calleeOffset());
         if (UNLIKELY(idx >= table->size())) {
-            Trap::throwException(state, "undefined element");
+            TRAP("undefined element");
         }
         auto target = reinterpret_cast<Function*>(table->uncheckedGetElementM64(idx));
         if (UNLIKELY(Value::isNull(target))) {
-            Trap::throwException(state, "uninitialized element " + std::to_string(idx));
+            TRAP("uninitialized element " + std::to_string(idx));
         }
         const FunctionType* ft = target->functionType();
-        if (UNLIKELY(!ft->equals(code->functionType()))) {
-            Trap::throwException(state, "indirect call type mismatch");
+        if (UNLIKELY(!ft->equals(code->functionType(), true))) {
+            TRAP("indirect call type mismatch");
         }
 
         if (tailCallOperation(state, programCounter, frame, instance, target, code->stackOffsets(),
@@ -1710,11 +1846,11 @@ NextInstruction:
 
         auto target = readValue<Function*>(bp, code->calleeOffset());
         if (UNLIKELY(Value::isNull(target))) {
-            Trap::throwException(state, "null function reference");
+            TRAP("null function reference");
         }
         const FunctionType* ft = target->functionType();
-        if (UNLIKELY(!ft->equals(code->functionType()))) {
-            Trap::throwException(state, "call by reference type mismatch");
+        if (UNLIKELY(!ft->equals(code->functionType(), true))) {
+            TRAP("call by reference type mismatch");
         }
 
         if (tailCallOperation(state, programCounter, frame, instance, target, code->stackOffsets(),
@@ -2617,7 +2753,7 @@ NextInstruction:
 
         void* ptr = readValue<void*>(bp, code->stackOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null reference");
+            TRAP("null reference");
         }
 
         ADD_PROGRAM_COUNTER(RefAsNonNull);
@@ -2631,10 +2767,10 @@ NextInstruction:
         void* ptr = readValue<void*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
             if (!(code->srcInfo() & JumpIfCastGeneric::IsNullable)) {
-                Trap::throwException(state, "cast failure");
+                TRAP("cast failure");
             }
         } else if (!testRefGeneric(ptr, code->typeInfo())) {
-            Trap::throwException(state, "cast failure");
+            TRAP("cast failure");
         }
 
         ADD_PROGRAM_COUNTER(RefCastGeneric);
@@ -2648,10 +2784,10 @@ NextInstruction:
         void* ptr = readValue<void*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
             if (!(code->srcInfo() & JumpIfCastGeneric::IsNullable)) {
-                Trap::throwException(state, "cast failure");
+                TRAP("cast failure");
             }
         } else if (!testRefDefined(ptr, code->typeInfo())) {
-            Trap::throwException(state, "cast failure");
+            TRAP("cast failure");
         }
 
         ADD_PROGRAM_COUNTER(RefCastDefined);
@@ -2709,7 +2845,7 @@ NextInstruction:
 
         void* ptr = readValue<void*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null i31 reference");
+            TRAP("null i31 reference");
         }
         writeValue<int32_t>(bp, code->dstOffset(), Value::getI31SValue(ptr));
 
@@ -2723,7 +2859,7 @@ NextInstruction:
 
         void* ptr = readValue<void*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null i31 reference");
+            TRAP("null i31 reference");
         }
         writeValue<int32_t>(bp, code->dstOffset(), Value::getI31UValue(ptr));
 
@@ -2738,7 +2874,7 @@ NextInstruction:
         uint32_t length = readValue<uint32_t>(bp, code->src1Offset());
         GCArray* result = GCArray::arrayNew(length, code->typeInfo(), bp + code->src0Offset());
         if (UNLIKELY(result == nullptr)) {
-            Trap::throwException(state, "memory allocation failed");
+            TRAP("memory allocation failed");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -2753,7 +2889,7 @@ NextInstruction:
         uint32_t length = readValue<uint32_t>(bp, code->srcOffset());
         GCArray* result = GCArray::arrayNewDefault(length, code->typeInfo());
         if (UNLIKELY(result == nullptr)) {
-            Trap::throwException(state, "memory allocation failed");
+            TRAP("memory allocation failed");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -2767,7 +2903,7 @@ NextInstruction:
 
         GCArray* result = GCArray::arrayNewFixed(code->length(), code->typeInfo(), code->dataOffsets(), bp);
         if (UNLIKELY(result == nullptr)) {
-            Trap::throwException(state, "memory allocation failed");
+            TRAP("memory allocation failed");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -2784,9 +2920,9 @@ NextInstruction:
         GCArray* result = GCArray::arrayNewData(offset, size, code->typeInfo(), instance->dataSegment(code->index()));
         if (UNLIKELY(reinterpret_cast<uintptr_t>(result) <= GCArray::OutOfBoundsMaxAccess)) {
             if (UNLIKELY(result == nullptr)) {
-                Trap::throwException(state, "memory allocation failed");
+                TRAP("memory allocation failed");
             }
-            Trap::throwException(state, "out of bounds memory access");
+            TRAP("out of bounds memory access");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -2803,9 +2939,9 @@ NextInstruction:
         GCArray* result = GCArray::arrayNewElem(offset, size, code->typeInfo(), instance->elementSegment(code->index()));
         if (UNLIKELY(reinterpret_cast<uintptr_t>(result) <= GCArray::OutOfBoundsMaxAccess)) {
             if (UNLIKELY(result == nullptr)) {
-                Trap::throwException(state, "memory allocation failed");
+                TRAP("memory allocation failed");
             }
-            Trap::throwException(state, "out of bounds table access");
+            TRAP("out of bounds table access");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -2819,7 +2955,7 @@ NextInstruction:
 
         GCArray* array = readValue<GCArray*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(array))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
         uint32_t log2Size = GCArray::getLog2Size(code->type());
         uint32_t offset = readValue<uint32_t>(bp, code->src1Offset());
@@ -2827,7 +2963,7 @@ NextInstruction:
         void* value_p = bp + code->src2Offset();
 
         if (array->length() < offset || (array->length() - offset) < fillSize) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         if (!(array->length() == offset || fillSize == 0)) {
@@ -2860,7 +2996,7 @@ NextInstruction:
         GCArray* dstArray = readValue<GCArray*>(bp, code->src0Offset());
         GCArray* srcArray = readValue<GCArray*>(bp, code->src2Offset());
         if (UNLIKELY(Value::isNull(dstArray) || Value::isNull(srcArray))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
         uint32_t dst_offset = readValue<uint32_t>(bp, code->src1Offset());
         uint32_t src_offset = readValue<uint32_t>(bp, code->src3Offset());
@@ -2868,7 +3004,7 @@ NextInstruction:
 
         if (dstArray->length() < dst_offset || (dstArray->length() - dst_offset) < size
             || srcArray->length() < src_offset || (srcArray->length() - src_offset) < size) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         const uint8_t log2Size = code->log2Size();
@@ -2888,7 +3024,7 @@ NextInstruction:
 
         GCArray* array = readValue<GCArray*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(array))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
 
         uint32_t dst_offset = readValue<uint32_t>(bp, code->src1Offset());
@@ -2900,11 +3036,11 @@ NextInstruction:
         size_t dataSize = data->sizeInByte();
 
         if (arraySize < dst_offset || (arraySize - dst_offset) < size) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         if (dataSize < src_offset || ((dataSize - src_offset) >> log2Size) < size) {
-            Trap::throwException(state, "out of bounds memory access");
+            TRAP("out of bounds memory access");
         }
 
         uintptr_t mask = (static_cast<uintptr_t>(1) << log2Size) - 1;
@@ -2921,7 +3057,7 @@ NextInstruction:
 
         GCArray* array = readValue<GCArray*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(array))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
 
         uint32_t dst_offset = readValue<uint32_t>(bp, code->src1Offset());
@@ -2932,11 +3068,11 @@ NextInstruction:
         size_t elemSize = elements->size();
 
         if (arraySize < dst_offset || (arraySize - dst_offset) < size) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         if (elemSize < src_offset || (elemSize - src_offset) < size) {
-            Trap::throwException(state, "out of bounds table access");
+            TRAP("out of bounds table access");
         }
 
         uintptr_t mask = static_cast<uintptr_t>(sizeof(void*)) - 1;
@@ -2953,12 +3089,12 @@ NextInstruction:
 
         GCArray* ptr = readValue<GCArray*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
 
         uint32_t pos = readValue<uint32_t>(bp, code->src1Offset());
         if (UNLIKELY(pos >= ptr->length())) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         GCArray::get(bp + code->dstOffset(), reinterpret_cast<uint8_t*>(ptr),
@@ -2974,12 +3110,12 @@ NextInstruction:
 
         GCArray* ptr = readValue<GCArray*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
 
         uint32_t pos = readValue<uint32_t>(bp, code->src1Offset());
         if (UNLIKELY(pos >= ptr->length())) {
-            Trap::throwException(state, "out of bounds array access");
+            TRAP("out of bounds array access");
         }
 
         GCArray::set(reinterpret_cast<uint8_t*>(ptr), bp + code->src2Offset(),
@@ -2995,7 +3131,7 @@ NextInstruction:
 
         GCArray* ptr = readValue<GCArray*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null array reference");
+            TRAP("null array reference");
         }
 
         writeValue<uint32_t>(bp, code->dstOffset(), ptr->length());
@@ -3009,7 +3145,7 @@ NextInstruction:
 
         GCStruct* result = GCStruct::structNew(code->typeInfo(), code->dataOffsets(), bp);
         if (UNLIKELY(result == nullptr)) {
-            Trap::throwException(state, "memory allocation failed");
+            TRAP("memory allocation failed");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -3023,7 +3159,7 @@ NextInstruction:
 
         GCStruct* result = GCStruct::structNewDefault(code->typeInfo());
         if (UNLIKELY(result == nullptr)) {
-            Trap::throwException(state, "memory allocation failed");
+            TRAP("memory allocation failed");
         }
         writeValue<void*>(bp, code->dstOffset(), result);
 
@@ -3037,7 +3173,7 @@ NextInstruction:
 
         GCStruct* ptr = readValue<GCStruct*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null structure reference");
+            TRAP("null structure reference");
         }
 
         GCStruct::get(bp + code->dstOffset(),
@@ -3054,7 +3190,7 @@ NextInstruction:
 
         GCStruct* ptr = readValue<GCStruct*>(bp, code->src0Offset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null structure reference");
+            TRAP("null structure reference");
         }
 
         GCStruct::set(reinterpret_cast<uint8_t*>(ptr) + code->memberOffset(),
@@ -3066,23 +3202,8 @@ NextInstruction:
 
     DEFINE_OPCODE(Throw)
     {
-        Throw* code = (Throw*)programCounter;
-        Tag* tag = instance->tag(code->tagIndex());
-        Vector<uint8_t> userExceptionData;
-        size_t sz = tag->functionType()->paramStackSize();
-        userExceptionData.resizeWithUninitializedValues(sz);
-
-        uint8_t* ptr = userExceptionData.data();
-        auto& param = tag->functionType()->param().types();
-
-        for (size_t i = 0; i < param.size(); i++) {
-            auto sz = valueStackAllocatedSize(param[i]);
-            memcpy(ptr, bp + code->dataOffsets()[i], sz);
-            ptr += sz;
-        }
-
-        Trap::throwException(state, tag, std::move(userExceptionData));
-        ASSERT_NOT_REACHED();
+        Exception* exception = throwOperation(state, programCounter, bp, instance);
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
@@ -3092,19 +3213,17 @@ NextInstruction:
 
         GCException* ptr = readValue<GCException*>(bp, code->srcOffset());
         if (UNLIKELY(Value::isNull(ptr))) {
-            Trap::throwException(state, "null structure reference");
+            TRAP("null structure reference");
         }
 
-        ptr->throwException();
-        ASSERT_NOT_REACHED();
+        Exception* exception = ptr->takeException().release();
+        HANDLE_EXCEPTION(exception);
         NEXT_INSTRUCTION();
     }
 
     DEFINE_OPCODE(Unreachable)
     {
-        Trap::throwException(state, "unreachable executed");
-        ASSERT_NOT_REACHED();
-        NEXT_INSTRUCTION();
+        TRAP("unreachable executed");
     }
 
 #if !defined(NDEBUG)
@@ -3143,7 +3262,18 @@ NextInstruction:
     return nullptr;
 }
 
-NEVER_INLINE void Interpreter::callOperation(
+ALWAYS_INLINE Exception* Interpreter::callFunction(ExecutionState& state, Function* target, uint8_t* bp, ByteCodeStackOffset* offsets,
+                                                 uint16_t parameterOffsetCount, uint16_t resultOffsetCount)
+{
+    if (LIKELY(target->kind() == Function::DefinedFunctionKind)) {
+        return callInterpreter(state, target->asDefinedFunction(), bp, offsets, parameterOffsetCount, resultOffsetCount);
+    }
+
+    target->interpreterCall(state, bp, offsets, parameterOffsetCount, resultOffsetCount);
+    return nullptr;
+}
+
+NEVER_INLINE Exception* Interpreter::callOperation(
     ExecutionState& state,
     size_t& programCounter,
     uint8_t* bp,
@@ -3151,13 +3281,17 @@ NEVER_INLINE void Interpreter::callOperation(
 {
     Call* code = (Call*)programCounter;
     Function* target = instance->function(code->index());
-    target->interpreterCall(state, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    Exception* exception = callFunction(state, target, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    if (UNLIKELY(exception != nullptr)) {
+        return exception;
+    }
 
     programCounter += ByteCode::pointerAlignedSize(sizeof(Call) + sizeof(ByteCodeStackOffset) * code->parameterOffsetsSize()
                                                    + sizeof(ByteCodeStackOffset) * code->resultOffsetsSize());
+    return nullptr;
 }
 
-NEVER_INLINE void Interpreter::callIndirectOperation(
+NEVER_INLINE Exception* Interpreter::callIndirectOperation(
     ExecutionState& state,
     size_t& programCounter,
     uint8_t* bp,
@@ -3168,38 +3302,45 @@ NEVER_INLINE void Interpreter::callIndirectOperation(
     Table* table = instance->table(code->tableIndex());
 
     Function* target;
+    const FunctionType* ft;
     if (!is64) {
         uint32_t idx = readValue<uint32_t>(bp, code->calleeOffset());
         if (idx >= table->size()) {
-            Trap::throwException(state, "undefined element");
+            return Exception::create(state, "undefined element").release();
         }
         target = reinterpret_cast<Function*>(table->uncheckedGetElement(idx));
         if (UNLIKELY(Value::isNull(target))) {
-            Trap::throwException(state, "uninitialized element " + std::to_string(idx));
+            return Exception::create(state, "uninitialized element " + std::to_string(idx)).release();
         }
+        ft = table->uncheckedGetTypeId(idx);
     } else {
         uint64_t idx = readValue<uint64_t>(bp, code->calleeOffset());
         if (idx >= table->size()) {
-            Trap::throwException(state, "undefined element");
+            return Exception::create(state, "undefined element").release();
         }
         target = reinterpret_cast<Function*>(table->uncheckedGetElementM64(idx));
         if (UNLIKELY(Value::isNull(target))) {
-            Trap::throwException(state, "uninitialized element " + std::to_string(idx));
+            return Exception::create(state, "uninitialized element " + std::to_string(idx)).release();
         }
+        ft = table->uncheckedGetTypeId(idx);
     }
 
-    const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
-        Trap::throwException(state, "indirect call type mismatch");
+    ASSERT(ft == target->functionType());
+    if (UNLIKELY(!ft->equals(code->functionType(), true))) {
+        return Exception::create(state, "indirect call type mismatch").release();
     }
 
-    target->interpreterCall(state, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    Exception* exception = callFunction(state, target, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    if (UNLIKELY(exception != nullptr)) {
+        return exception;
+    }
 
     programCounter += ByteCode::pointerAlignedSize(sizeof(CallIndirect) + sizeof(ByteCodeStackOffset) * code->parameterOffsetsSize()
                                                    + sizeof(ByteCodeStackOffset) * code->resultOffsetsSize());
+    return nullptr;
 }
 
-NEVER_INLINE void Interpreter::callRefOperation(
+NEVER_INLINE Exception* Interpreter::callRefOperation(
     ExecutionState& state,
     size_t& programCounter,
     uint8_t* bp,
@@ -3209,17 +3350,80 @@ NEVER_INLINE void Interpreter::callRefOperation(
 
     auto target = readValue<Function*>(bp, code->calleeOffset());
     if (UNLIKELY(Value::isNull(target))) {
-        Trap::throwException(state, "null function reference");
+        return Exception::create(state, "null function reference").release();
     }
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
-        Trap::throwException(state, "call by reference type mismatch");
+    if (UNLIKELY(!ft->equals(code->functionType(), true))) {
+        return Exception::create(state, "call by reference type mismatch").release();
     }
 
-    target->interpreterCall(state, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    Exception* exception = callFunction(state, target, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    if (UNLIKELY(exception != nullptr)) {
+        return exception;
+    }
 
     programCounter += ByteCode::pointerAlignedSize(sizeof(CallRef) + sizeof(ByteCodeStackOffset) * code->parameterOffsetsSize()
                                                    + sizeof(ByteCodeStackOffset) * code->resultOffsetsSize());
+    return nullptr;
+}
+
+NEVER_INLINE Exception* Interpreter::throwOperation(
+    ExecutionState& state,
+    size_t programCounter,
+    uint8_t* bp,
+    Instance* instance)
+{
+    Throw* code = (Throw*)programCounter;
+    Tag* tag = instance->tag(code->tagIndex());
+    Vector<uint8_t> userExceptionData;
+    size_t sz = tag->functionType()->paramStackSize();
+    userExceptionData.resizeWithUninitializedValues(sz);
+
+    uint8_t* ptr = userExceptionData.data();
+    auto& param = tag->functionType()->param().types();
+
+    for (size_t i = 0; i < param.size(); i++) {
+        auto sz = valueStackAllocatedSize(param[i]);
+        memcpy(ptr, bp + code->dataOffsets()[i], sz);
+        ptr += sz;
+    }
+
+    return Exception::create(state, tag, std::move(userExceptionData)).release();
+}
+
+NEVER_INLINE bool Interpreter::catchException(ExecutionState& state, size_t& programCounter, StackFrame& frame, Exception* exception)
+{
+    if (!exception->isUserException()) {
+        return false;
+    }
+
+    DefinedFunction* function = state.m_currentFunction.value()->asDefinedFunction();
+    ModuleFunction* moduleFunction = function->moduleFunction();
+    Tag* tag = exception->tag().value();
+    size_t offset = programCounter - reinterpret_cast<size_t>(moduleFunction->byteCode());
+
+    for (auto range = moduleFunction->findCatchRange(offset); range != nullptr; range = moduleFunction->parentCatchRange(range)) {
+        for (uint32_t i = 0; i < range->m_catchCount; i++) {
+            const ModuleFunction::CatchInfo& item = moduleFunction->catchInfo()[range->m_firstCatch + i];
+
+            if (item.m_tagIndex != std::numeric_limits<uint32_t>::max() && function->instance()->tag(item.m_tagIndex) != tag) {
+                continue;
+            }
+
+            std::unique_ptr<Exception> e(exception);
+            programCounter = item.m_catchStartPosition + reinterpret_cast<size_t>(moduleFunction->byteCode());
+            uint8_t* sp = frame.bp() + item.m_stackSizeToBe;
+            size_t paramStackSize = tag->functionType()->paramStackSize();
+            if (item.m_tagIndex != std::numeric_limits<uint32_t>::max() && paramStackSize) {
+                memcpy(sp, e->userExceptionData().data(), paramStackSize);
+            }
+            if (item.m_pushExnRef) {
+                *reinterpret_cast<GCException**>(sp + paramStackSize) = GCException::exceptionNew(e);
+            }
+            return true;
+        }
+    }
+    return false;
 }
 
 NEVER_INLINE bool Interpreter::tailCallOperation(
@@ -3235,8 +3439,13 @@ NEVER_INLINE bool Interpreter::tailCallOperation(
     if (LIKELY(target->kind() == Function::DefinedFunctionKind)) {
         DefinedFunction* definedTarget = target->asDefinedFunction();
         ModuleFunction* targetModuleFunction = definedTarget->moduleFunction();
+        if (UNLIKELY(!targetModuleFunction->hasByteCode())) {
+            generateByteCode(state, definedTarget);
+        }
 #if defined(WALRUS_ENABLE_JIT)
-        if (LIKELY(targetModuleFunction->jitFunction() == nullptr))
+        JITFunction* targetJitFunction = targetModuleFunction->jitFunction();
+
+        if (LIKELY(targetJitFunction == nullptr || !targetJitFunction->isCompiled()))
 #endif
         {
             size_t requiredStackSize = targetModuleFunction->requiredStackSize();
@@ -3266,6 +3475,58 @@ NEVER_INLINE bool Interpreter::tailCallOperation(
     return false;
 }
 
+NEVER_INLINE void Interpreter::generateByteCode(ExecutionState& state, DefinedFunction* function)
+{
+    std::string error = function->instance()->module()->generateByteCode(function->moduleFunction());
+
+    if (UNLIKELY(!error.empty())) {
+        Trap::throwException(state, error);
+    }
+}
+
+#if defined(WALRUS_ENABLE_JIT)
+NEVER_INLINE void Interpreter::tierUp(DefinedFunction* function)
+{
+    function->instance()->module()->tierUp(function->moduleFunction());
+}
+
+NEVER_INLINE ByteCodeStackOffset* Interpreter::onStackReplacement(ExecutionState& state, DefinedFunction* function, size_t programCounter, StackFrame& frame)
+{
+    ModuleFunction* moduleFunction = function->moduleFunction();
+    const JITFunction* jitFunc = moduleFunction->jitFunction();
+
+    if (!jitFunc->isCompiled()) {
+        return nullptr;
+    }
+
+    void* entry = jitFunc->osrEntry(programCounter - reinterpret_cast<size_t>(moduleFunction->byteCode()));
+
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    if (UNLIKELY(frame.capacity() < jitFunc->frameSize())) {
+        // The compiled code uses the area after the interpreter frame for inlined functions.
+        uint8_t* newBuffer = StackFrame::allocateBuffer(jitFunc->frameSize());
+        memcpy(newBuffer, frame.bp(), frame.capacity());
+        frame.replaceBuffer(newBuffer, jitFunc->frameSize());
+    }
+
+    // The frame layout is the same, so the compiled code continues the loop.
+    ExecutionContext context(jitFunc->instanceConstData(), state, function->instance());
+    context.frameCapacity = frame.capacity();
+    state.m_programCounterPointer = nullptr;
+
+    ByteCodeStackOffset* resultOffsets = jitFunc->call(context, frame.bp(), entry);
+
+    if (UNLIKELY(context.ownedFrame != nullptr)) {
+        frame.replaceBuffer(context.ownedFrame, context.frameCapacity);
+    }
+
+    return resultOffsets;
+}
+#endif
+
 NEVER_INLINE bool Interpreter::testRefGeneric(void* refPtr, Value::Type type)
 {
     ASSERT(!Value::isNull(refPtr));
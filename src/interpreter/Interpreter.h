@@ -42,6 +42,7 @@ class Interpreter {
 private:
     friend class ByteCodeTable;
     friend class DefinedFunction;
+    friend class PreparedCall;
 
     class StackFrame {
         MAKE_STACK_ALLOCATED();
@@ -51,6 +52,7 @@ private:
             : m_bp(bp)
             , m_capacity(capacity)
             , m_owned(nullptr)
+            , m_exception(nullptr)
         {
         }
 
@@ -59,6 +61,7 @@ private:
             if (m_owned != nullptr) {
                 deallocateBuffer(m_owned);
             }
+            ASSERT(m_exception == nullptr);
         }
 
         uint8_t* bp() const { return m_bp; }
@@ -83,6 +86,21 @@ private:
             m_capacity = capacity;
         }
 
+        // The uncaught exception of the frame, when interpret() returns nullptr.
+        void setException(Exception* exception)
+        {
+            ASSERT(m_exception == nullptr);
+            m_exception = exception;
+        }
+
+        Exception* releaseException()
+        {
+            Exception* exception = m_exception;
+            ASSERT(exception != nullptr);
+            m_exception = nullptr;
+            return exception;
+        }
+
     private:
         static void deallocateBuffer(uint8_t* buffer)
         {
@@ -96,28 +114,48 @@ private:
         uint8_t* m_bp;
         size_t m_capacity;
         uint8_t* m_owned;
+        Exception* m_exception;
     };
 
-    ALWAYS_INLINE static void callInterpreter(ExecutionState& state, DefinedFunction* function, uint8_t* bp, ByteCodeStackOffset* offsets,
-                                              uint16_t parameterOffsetCount, uint16_t resultOffsetCount)
+    // Exceptions which are not caught by the interpreted function are returned to
+    // the caller instead of being thrown, so they can be passed to the handlers
+    // of the interpreted callers without unwinding the native stack. Traps raised
+    // by the interpreter are returned the same way. Traps raised by the runtime,
+    // such as out of bounds memory accesses, and exceptions thrown by native or
+    // compiled code still arrive as C++ exceptions.
+    ALWAYS_INLINE static Exception* callInterpreter(ExecutionState& state, DefinedFunction* function, uint8_t* bp, ByteCodeStackOffset* offsets,
+                                                    uint16_t parameterOffsetCount, uint16_t resultOffsetCount)
     {
         ExecutionState newState(state, function);
         CHECK_STACK_LIMIT(newState);
 
         auto moduleFunction = function->moduleFunction();
-        ALLOCA(uint8_t, functionStackBase, moduleFunction->requiredStackSize());
+        if (UNLIKELY(!moduleFunction->hasByteCode())) {
+            generateByteCode(newState, function);
+        }
+
+        size_t frameSize = moduleFunction->requiredStackSize();
+#if defined(WALRUS_ENABLE_JIT)
+        const JITFunction* jitFunc = moduleFunction->jitFunction();
+        bool isCompiled = jitFunc != nullptr && jitFunc->isCompiled();
+
+        if (isCompiled) {
+            frameSize = jitFunc->frameSize();
+        }
+#endif
+
+        ALLOCA(uint8_t, functionStackBase, frameSize);
 
         for (size_t i = 0; i < parameterOffsetCount; i++) {
             ((size_t*)functionStackBase)[i] = *((size_t*)(bp + offsets[i]));
         }
 
         size_t programCounter = reinterpret_cast<size_t>(moduleFunction->byteCode());
-        StackFrame frame(functionStackBase, moduleFunction->requiredStackSize());
+        StackFrame frame(functionStackBase, frameSize);
         ByteCodeStackOffset* resultOffsets;
 
 #if defined(WALRUS_ENABLE_JIT)
-        if (moduleFunction->jitFunction() != nullptr) {
-            const JITFunction* jitFunc = moduleFunction->jitFunction();
+        if (isCompiled) {
             ExecutionContext context(jitFunc->instanceConstData(), newState, function->instance());
             context.frameCapacity = frame.capacity();
             resultOffsets = jitFunc->call(context, frame.bp());
@@ -128,48 +166,40 @@ private:
         } else
 #endif
         {
+#if defined(WALRUS_ENABLE_JIT)
+            if (UNLIKELY(moduleFunction->countTierUp())) {
+                tierUp(function);
+            }
+#endif
             while (true) {
                 try {
                     resultOffsets = interpret(newState, programCounter, frame, function->instance());
+                    if (UNLIKELY(resultOffsets == nullptr)) {
+                        return frame.releaseException();
+                    }
                     break;
                 } catch (std::unique_ptr<Exception>& e) {
                     if (UNLIKELY(!newState.m_currentFunction.hasValue())) {
-                        throw std::unique_ptr<Exception>(std::move(e));
+                        return e.release();
                     }
                     function = newState.m_currentFunction.value()->asDefinedFunction();
-                    moduleFunction = function->moduleFunction();
+                    bool hasProgramCounter = false;
                     for (size_t i = e->m_programCounterInfo.size(); i > 0; i--) {
                         if (e->m_programCounterInfo[i - 1].first == &newState) {
                             programCounter = e->m_programCounterInfo[i - 1].second;
+                            hasProgramCounter = true;
                             break;
                         }
                     }
-                    if (e->isUserException()) {
-                        bool isCatchSucessful = false;
-                        Tag* tag = e->tag().value();
-                        size_t offset = programCounter - reinterpret_cast<size_t>(moduleFunction->byteCode());
-                        for (const auto& item : moduleFunction->catchInfo()) {
-                            if (item.m_tryStart <= offset && offset < item.m_tryEnd) {
-                                if (item.m_tagIndex == std::numeric_limits<uint32_t>::max() || function->instance()->tag(item.m_tagIndex) == tag) {
-                                    programCounter = item.m_catchStartPosition + reinterpret_cast<size_t>(moduleFunction->byteCode());
-                                    uint8_t* sp = frame.bp() + item.m_stackSizeToBe;
-                                    size_t paramStackSize = tag->functionType()->paramStackSize();
-                                    if (item.m_tagIndex != std::numeric_limits<uint32_t>::max() && tag->functionType()->paramStackSize()) {
-                                        memcpy(sp, e->userExceptionData().data(), paramStackSize);
-                                    }
-                                    if (item.m_pushExnRef) {
-                                        *reinterpret_cast<GCException**>(sp + paramStackSize) = GCException::exceptionNew(e);
-                                    }
-                                    isCatchSucessful = true;
-                                    break;
-                                }
-                            }
-                        }
-                        if (isCatchSucessful) {
-                            continue;
-                        }
+                    if (UNLIKELY(!hasProgramCounter)) {
+                        // The frame is executed by the JIT code, which
+                        // has already searched its exception handlers.
+                        return e.release();
+                    }
+                    if (!catchException(newState, programCounter, frame, e.get())) {
+                        return e.release();
                     }
-                    throw std::unique_ptr<Exception>(std::move(e));
+                    e.release();
                 }
             }
         }
@@ -178,28 +208,42 @@ private:
         for (size_t i = 0; i < resultOffsetCount; i++) {
             *((size_t*)(bp + offsets[i])) = *((size_t*)(frame.bp() + resultOffsets[i]));
         }
+        return nullptr;
     }
 
+    // Searches the handlers of the current function for a user exception. When
+    // a handler is found, the exception is passed to it and programCounter is
+    // set to the start of the handler. Otherwise the exception is not touched.
+    static bool catchException(ExecutionState& state, size_t& programCounter, StackFrame& frame, Exception* exception);
+
+    static Exception* callFunction(ExecutionState& state, Function* target, uint8_t* bp, ByteCodeStackOffset* offsets,
+                                   uint16_t parameterOffsetCount, uint16_t resultOffsetCount);
+
     static ByteCodeStackOffset* interpret(ExecutionState& state,
                                           size_t programCounter,
                                           StackFrame& frame,
                                           Instance* instance);
 
-    static void callOperation(ExecutionState& state,
-                              size_t& programCounter,
-                              uint8_t* bp,
-                              Instance* instance);
+    static Exception* callOperation(ExecutionState& state,
+                                    size_t& programCounter,
+                                    uint8_t* bp,
+                                    Instance* instance);
+
+    static Exception* callIndirectOperation(ExecutionState& state,
+                                            size_t& programCounter,
+                                            uint8_t* bp,
+                                            Instance* instance,
+                                            bool is64);
 
-    static void callIndirectOperation(ExecutionState& state,
-                                      size_t& programCounter,
-                                      uint8_t* bp,
-                                      Instance* instance,
-                                      bool is64);
+    static Exception* callRefOperation(ExecutionState& state,
+                                       size_t& programCounter,
+                                       uint8_t* bp,
+                                       Instance* instance);
 
-    static void callRefOperation(ExecutionState& state,
-                                 size_t& programCounter,
-                                 uint8_t* bp,
-                                 Instance* instance);
+    static Exception* throwOperation(ExecutionState& state,
+                                     size_t programCounter,
+                                     uint8_t* bp,
+                                     Instance* instance);
 
     static bool tailCallOperation(ExecutionState& state,
                                   size_t& programCounter,
@@ -210,8 +254,15 @@ private:
                                   uint16_t parameterOffsetCount,
                                   uint16_t resultOffsetCount);
 
+    static void generateByteCode(ExecutionState& state, DefinedFunction* function);
+
     static bool testRefGeneric(void* refPtr, Value::Type type);
     static bool testRefDefined(void* refPtr, const CompositeType** typeInfo);
+
+#if defined(WALRUS_ENABLE_JIT)
+    static void tierUp(DefinedFunction* function);
+    static ByteCodeStackOffset* onStackReplacement(ExecutionState& state, DefinedFunction* function, size_t programCounter, StackFrame& frame);
+#endif
 };
 
 } // namespace Walrus
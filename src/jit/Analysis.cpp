@@ -19,6 +19,7 @@
 #include "Walrus.h"
 #include "jit/Compiler.h"
 #include "runtime/GCArray.h"
+#include "runtime/Memory.h"
 
 #include <set>
 
@@ -302,6 +303,10 @@ void JITCompiler::buildVariables(uint32_t requiredStackSize)
             label->m_dependencyStart = dependencySize;
             dependencySize += requiredStackSize;
 
+            if (label->info() & Label::kHasOSREntry) {
+                variableCount += requiredStackSize;
+            }
+
             if (label->info() & Label::kHasTryInfo) {
                 ASSERT(tryBlocks()[nextTryBlock].start == label);
 
@@ -390,6 +395,18 @@ void JITCompiler::buildVariables(uint32_t requiredStackSize)
                 activeTryBlocks.pop_back();
             }
 
+            if (label->info() & Label::kHasOSREntry) {
+                // All values are loaded from the frame of the interpreter.
+                m_variableList->pushCatchUpdate(label, requiredStackSize);
+
+                for (size_t i = 0; i < requiredStackSize; ++i) {
+                    VariableRef ref = m_variableList->variables.size();
+
+                    dependencyCtx.dependencies[label->m_dependencyStart + i].insert(VARIABLE_SET(ref, DependencyGenContext::Variable));
+                    m_variableList->variables.push_back(VariableList::Variable(VARIABLE_SET(i, Instruction::Offset), 0, label->id()));
+                }
+            }
+
             for (size_t i = 0; i < requiredStackSize; ++i) {
                 dependencyCtx.currentDependencies[i] = VARIABLE_SET_PTR(label);
                 dependencyCtx.currentOptions[i] = 0;
@@ -917,6 +934,1446 @@ void JITCompiler::buildVariables(uint32_t requiredStackSize)
             instr->convertBinaryToCompare();
         }
     }
+
+    optimizeBoundsChecks();
+}
+
+// Returns with the access size of loads and stores of the default
+// memory, which bounds checks can be removed or merged, and 0 otherwise.
+static uint32_t boundsCheckedAccessSize(Instruction* instr)
+{
+    if (instr->group() != Instruction::Load && instr->group() != Instruction::Store) {
+        return 0;
+    }
+
+    switch (instr->opcode()) {
+    case ByteCode::I32Load8SOpcode:
+    case ByteCode::I32Load8UOpcode:
+    case ByteCode::I64Load8SOpcode:
+    case ByteCode::I64Load8UOpcode:
+    case ByteCode::I32Store8Opcode:
+    case ByteCode::I64Store8Opcode:
+        return 1;
+    case ByteCode::I32Load16SOpcode:
+    case ByteCode::I32Load16UOpcode:
+    case ByteCode::I64Load16SOpcode:
+    case ByteCode::I64Load16UOpcode:
+    case ByteCode::I32Store16Opcode:
+    case ByteCode::I64Store16Opcode:
+        return 2;
+    case ByteCode::Load32Opcode:
+    case ByteCode::Store32Opcode:
+    case ByteCode::I32LoadOpcode:
+    case ByteCode::I64Load32SOpcode:
+    case ByteCode::I64Load32UOpcode:
+    case ByteCode::F32LoadOpcode:
+    case ByteCode::I32StoreOpcode:
+    case ByteCode::I64Store32Opcode:
+        return 4;
+    case ByteCode::Load64Opcode:
+    case ByteCode::Store64Opcode:
+    case ByteCode::I64LoadOpcode:
+    case ByteCode::F64LoadOpcode:
+    case ByteCode::I64StoreOpcode:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// End of the accessed memory area relative to the address operand.
+static uint64_t boundsCheckedAccessEnd(Instruction* instr, uint32_t size)
+{
+    switch (instr->opcode()) {
+    case ByteCode::Load32Opcode:
+    case ByteCode::Load64Opcode:
+    case ByteCode::Store32Opcode:
+    case ByteCode::Store64Opcode:
+        return size;
+    default:
+        return reinterpret_cast<ByteCodeOffset2Value*>(instr->byteCode())->uintValue() + static_cast<uint64_t>(size);
+    }
+}
+
+// Instructions which have no side effects, and can only trap
+// by an out of bounds memory access.
+static bool isBoundsCheckMergeable(Instruction* instr)
+{
+    switch (instr->group()) {
+    case Instruction::Immediate:
+    case Instruction::Move:
+    case Instruction::Unary:
+    case Instruction::UnaryFloat:
+    case Instruction::BinaryFloat:
+    case Instruction::Compare:
+    case Instruction::CompareFloat:
+    case Instruction::Convert:
+        return true;
+    case Instruction::Binary:
+        switch (instr->opcode()) {
+        case ByteCode::I32DivSOpcode:
+        case ByteCode::I32DivUOpcode:
+        case ByteCode::I32RemSOpcode:
+        case ByteCode::I32RemUOpcode:
+        case ByteCode::I64DivSOpcode:
+        case ByteCode::I64DivUOpcode:
+        case ByteCode::I64RemSOpcode:
+        case ByteCode::I64RemUOpcode:
+            return false;
+        default:
+            return true;
+        }
+    case Instruction::Load:
+        return boundsCheckedAccessSize(instr) != 0;
+    default:
+        return false;
+    }
+}
+
+static const int kMaxUpperBoundDepth = 8;
+static const uint64_t kMaxMergedBoundsCheckSize = 4096;
+
+// Returns with the largest unsigned value of a 32 bit variable. The
+// definitions list contains the only instruction which sets a variable.
+static uint64_t variableUpperBound(std::vector<Instruction*>& definitions, VariableRef ref, int depth)
+{
+    const uint64_t maxValue = 0xffffffff;
+    Instruction* instr = definitions[ref];
+
+    if (instr == nullptr || depth >= kMaxUpperBoundDepth) {
+        return maxValue;
+    }
+
+    depth++;
+
+    switch (instr->opcode()) {
+    case ByteCode::Const32Opcode:
+        return reinterpret_cast<Const32*>(instr->byteCode())->value();
+    case ByteCode::MoveI32Opcode:
+        return variableUpperBound(definitions, *instr->getParam(0), depth);
+    case ByteCode::I32Load8UOpcode:
+        return 0xff;
+    case ByteCode::I32Load16UOpcode:
+        return 0xffff;
+    case ByteCode::I32AndOpcode:
+        return std::min(variableUpperBound(definitions, *instr->getParam(0), depth),
+                        variableUpperBound(definitions, *instr->getParam(1), depth));
+    case ByteCode::I32OrOpcode:
+    case ByteCode::I32XorOpcode: {
+        uint64_t value = std::max(variableUpperBound(definitions, *instr->getParam(0), depth),
+                                  variableUpperBound(definitions, *instr->getParam(1), depth));
+        // All bits below the highest set bit can be set.
+        value |= value >> 1;
+        value |= value >> 2;
+        value |= value >> 4;
+        value |= value >> 8;
+        value |= value >> 16;
+        return value;
+    }
+    case ByteCode::I32AddOpcode: {
+        uint64_t value = variableUpperBound(definitions, *instr->getParam(0), depth)
+            + variableUpperBound(definitions, *instr->getParam(1), depth);
+        return value <= maxValue ? value : maxValue;
+    }
+    case ByteCode::I32MulOpcode: {
+        uint64_t value = variableUpperBound(definitions, *instr->getParam(0), depth)
+            * variableUpperBound(definitions, *instr->getParam(1), depth);
+        return value <= maxValue ? value : maxValue;
+    }
+    case ByteCode::I32ShlOpcode:
+    case ByteCode::I32ShrUOpcode: {
+        Instruction* shift = definitions[*instr->getParam(1)];
+
+        if (shift == nullptr || shift->opcode() != ByteCode::Const32Opcode) {
+            return maxValue;
+        }
+
+        uint32_t count = reinterpret_cast<Const32*>(shift->byteCode())->value() & 0x1f;
+        uint64_t value = variableUpperBound(definitions, *instr->getParam(0), depth);
+
+        if (instr->opcode() == ByteCode::I32ShrUOpcode) {
+            return value >> count;
+        }
+
+        value <<= count;
+        return value <= maxValue ? value : maxValue;
+    }
+    case ByteCode::I32RemUOpcode: {
+        uint64_t value = variableUpperBound(definitions, *instr->getParam(0), depth);
+        uint64_t divisor = variableUpperBound(definitions, *instr->getParam(1), depth);
+
+        if (divisor > 0 && divisor - 1 < value) {
+            return divisor - 1;
+        }
+        return value;
+    }
+    default:
+        return maxValue;
+    }
+}
+
+struct BoundsCheckState {
+    BoundsCheckState()
+        : isReachable(false)
+    {
+    }
+
+    void reset()
+    {
+        isReachable = true;
+        checkedEnds.clear();
+    }
+
+    bool merge(const BoundsCheckState& other);
+
+    // Unreachable states are not merged with other states.
+    bool isReachable;
+    // End of the memory areas which are known
+    // to be accessible through a variable.
+    std::map<VariableRef, uint64_t> checkedEnds;
+};
+
+bool BoundsCheckState::merge(const BoundsCheckState& other)
+{
+    if (!other.isReachable) {
+        return false;
+    }
+
+    if (!isReachable) {
+        *this = other;
+        return true;
+    }
+
+    bool changed = false;
+    auto it = checkedEnds.begin();
+
+    while (it != checkedEnds.end()) {
+        auto otherIt = other.checkedEnds.find(it->first);
+
+        if (otherIt == other.checkedEnds.end()) {
+            it = checkedEnds.erase(it);
+            changed = true;
+            continue;
+        }
+
+        if (otherIt->second < it->second) {
+            it->second = otherIt->second;
+            changed = true;
+        }
+        it++;
+    }
+
+    return changed;
+}
+
+void JITCompiler::optimizeBoundsChecks()
+{
+    InstructionListItem* item;
+
+    for (item = m_first; item != nullptr; item = item->next()) {
+        if (item->isInstruction() && boundsCheckedAccessSize(item->asInstruction()) != 0) {
+            break;
+        }
+    }
+
+    if (item == nullptr) {
+        return;
+    }
+
+    // The memory can only grow, so a successful access of a variable
+    // proves that the same area can be accessed again until the
+    // variable is redefined. Variables with a single definition
+    // may also have a known upper bound.
+    std::vector<VariableList::Variable>& variables = m_variableList->variables;
+    std::vector<size_t> sourceCount(variables.size(), 0);
+    std::vector<Instruction*> definitions(variables.size(), nullptr);
+
+    for (VariableRef ref = 0; ref < variables.size(); ref++) {
+        sourceCount[m_variableList->getMergeHead(ref)]++;
+    }
+
+    for (item = m_first; item != nullptr; item = item->next()) {
+        if (!item->isInstruction()) {
+            continue;
+        }
+
+        Instruction* instr = item->asInstruction();
+        Operand* result = instr->params() + instr->paramCount();
+        Operand* end = result + instr->resultCount();
+
+        while (result < end) {
+            if (sourceCount[*result] == 1) {
+                definitions[*result] = instr;
+            }
+            result++;
+        }
+    }
+
+    // Exception handlers and OSR entries are entered with unknown values.
+    std::set<Label*> entryLabels;
+
+    for (size_t i = m_tryBlockStart; i < m_tryBlocks.size(); i++) {
+        for (auto it : m_tryBlocks[i].catchBlocks) {
+            entryLabels.insert(it.u.handler);
+        }
+    }
+
+    uint64_t initialMemorySize = module()->memoryType(0)->initialSize() * Memory::s_memoryPageSize;
+    std::map<Label*, BoundsCheckState> labelStates;
+    BoundsCheckState state;
+    bool isFinalPass = false;
+    size_t removedCount = 0;
+
+    // The states of the labels are computed first, then
+    // the accesses are marked by a final pass.
+    while (true) {
+        bool changed = false;
+
+        state.reset();
+
+        for (item = m_first; item != nullptr; item = item->next()) {
+            if (item->isLabel()) {
+                Label* label = item->asLabel();
+
+                if ((label->info() & Label::kHasOSREntry) || entryLabels.find(label) != entryLabels.end()) {
+                    state.reset();
+                    continue;
+                }
+
+                state.merge(labelStates[label]);
+                continue;
+            }
+
+            Instruction* instr = item->asInstruction();
+            uint32_t size = boundsCheckedAccessSize(instr);
+
+            if (size != 0) {
+                VariableRef ref = *instr->getParam(0);
+                uint64_t end = boundsCheckedAccessEnd(instr, size);
+
+                if (isFinalPass) {
+                    auto it = state.checkedEnds.find(ref);
+
+                    if ((state.isReachable && it != state.checkedEnds.end() && it->second >= end)
+                        || variableUpperBound(definitions, ref, 0) + end <= initialMemorySize) {
+                        instr->addInfo(Instruction::kIsInBounds);
+                        removedCount++;
+                    }
+                }
+
+                if (state.isReachable) {
+                    uint64_t& checkedEnd = state.checkedEnds[ref];
+
+                    if (checkedEnd < end) {
+                        checkedEnd = end;
+                    }
+                }
+            }
+
+            if (state.isReachable) {
+                Operand* result = instr->params() + instr->paramCount();
+                Operand* end = result + instr->resultCount();
+
+                while (result < end) {
+                    state.checkedEnds.erase(*result++);
+                }
+            }
+
+            if (instr->group() == Instruction::DirectBranch) {
+                if (labelStates[instr->asExtended()->value().targetLabel].merge(state)) {
+                    changed = true;
+                }
+
+                if (instr->opcode() == ByteCode::JumpOpcode) {
+                    state = BoundsCheckState();
+                }
+                continue;
+            }
+
+            if (instr->group() == Instruction::BrTable) {
+                Label** label = instr->asBrTable()->targetLabels();
+                Label** end = label + instr->asBrTable()->targetLabelCount();
+
+                while (label < end) {
+                    if (labelStates[*label++].merge(state)) {
+                        changed = true;
+                    }
+                }
+
+                state = BoundsCheckState();
+                continue;
+            }
+
+            if (instr->opcode() == ByteCode::ThrowOpcode || instr->opcode() == ByteCode::UnreachableOpcode
+                || instr->opcode() == ByteCode::EndOpcode) {
+                state = BoundsCheckState();
+            }
+        }
+
+        if (isFinalPass) {
+            break;
+        }
+
+        if (!changed) {
+            isFinalPass = true;
+        }
+    }
+
+    // The bounds check of a load also covers the following accesses of
+    // the same variable, when only an out of bounds access can trap
+    // between them. Since the load has no side effects, trapping
+    // earlier is not observable.
+    size_t mergedCount = 0;
+
+    for (item = m_first; item != nullptr; item = item->next()) {
+        if (!item->isInstruction()) {
+            continue;
+        }
+
+        Instruction* instr = item->asInstruction();
+
+        if (instr->group() != Instruction::Load || (instr->info() & Instruction::kIsInBounds)) {
+            continue;
+        }
+
+        uint32_t size = boundsCheckedAccessSize(instr);
+        VariableRef ref = *instr->getParam(0);
+
+        if (size == 0 || *instr->getResult(0) == ref) {
+            continue;
+        }
+
+        uint64_t checkedEnd = boundsCheckedAccessEnd(instr, size);
+        uint64_t offset = checkedEnd - size;
+
+        for (InstructionListItem* next = item->next(); next != nullptr && next->isInstruction(); next = next->next()) {
+            Instruction* nextInstr = next->asInstruction();
+            uint32_t nextSize = boundsCheckedAccessSize(nextInstr);
+
+            if (nextSize != 0 && *nextInstr->getParam(0) == ref && !(nextInstr->info() & Instruction::kIsInBounds)) {
+                uint64_t end = boundsCheckedAccessEnd(nextInstr, nextSize);
+
+                if (end <= checkedEnd || end - offset <= kMaxMergedBoundsCheckSize) {
+                    nextInstr->addInfo(Instruction::kIsInBounds);
+                    mergedCount++;
+
+                    if (checkedEnd < end) {
+                        checkedEnd = end;
+                    }
+                }
+            }
+
+            if (!isBoundsCheckMergeable(nextInstr) || (nextInstr->resultCount() > 0 && *nextInstr->getResult(0) == ref)) {
+                break;
+            }
+        }
+
+        if (checkedEnd - offset != size) {
+            m_boundsCheckSizes[instr] = static_cast<uint32_t>(checkedEnd - offset);
+        }
+    }
+
+    if (m_JITFlags & JITFlagValue::JITVerbose) {
+        printf("Bounds checks: %d removed, %d merged\n", static_cast<int>(removedCount), static_cast<int>(mergedCount));
+    }
+}
+
+struct ConstantState {
+    struct Value {
+        uint64_t value;
+        bool is64;
+    };
+
+    ConstantState()
+        : isReachable(false)
+    {
+    }
+
+    void reset()
+    {
+        isReachable = true;
+        values.clear();
+    }
+
+    bool merge(const ConstantState& other);
+    bool get(Operand offset, bool is64, uint64_t& value);
+    void kill(Operand offset, Operand size);
+
+    void set(Operand offset, const Value& value)
+    {
+        kill(offset, value.is64 ? 2 : 1);
+        values[offset] = value;
+    }
+
+    // Unreachable states are not merged with other states.
+    bool isReachable;
+    // Constant values of the stack slots.
+    std::map<Operand, Value> values;
+};
+
+bool ConstantState::merge(const ConstantState& other)
+{
+    if (!other.isReachable) {
+        return false;
+    }
+
+    if (!isReachable) {
+        *this = other;
+        return true;
+    }
+
+    bool changed = false;
+    auto it = values.begin();
+
+    while (it != values.end()) {
+        auto otherIt = other.values.find(it->first);
+
+        if (otherIt == other.values.end() || otherIt->second.value != it->second.value
+            || otherIt->second.is64 != it->second.is64) {
+            it = values.erase(it);
+            changed = true;
+            continue;
+        }
+        it++;
+    }
+
+    return changed;
+}
+
+bool ConstantState::get(Operand offset, bool is64, uint64_t& value)
+{
+    auto it = values.find(offset);
+
+    if (it == values.end() || it->second.is64 != is64) {
+        return false;
+    }
+
+    value = it->second.value;
+    return true;
+}
+
+void ConstantState::kill(Operand offset, Operand size)
+{
+    // A 64 bit value starting in the previous slot is also overwritten.
+    auto it = values.lower_bound(offset > 0 ? offset - 1 : 0);
+
+    while (it != values.end() && it->first < offset + size) {
+        if (it->first < offset && !it->second.is64) {
+            it++;
+            continue;
+        }
+        it = values.erase(it);
+    }
+}
+
+// Number of the stack slots used by an operand.
+static Operand operandSize(Instruction* instr, uint32_t index)
+{
+    if (instr->group() == Instruction::Call) {
+        return 4;
+    }
+
+    switch (instr->getOperandDescriptor()[index] & Instruction::TypeMask) {
+    case Instruction::Int32Operand:
+    case Instruction::Float32Operand:
+        return 1;
+    case Instruction::V128Operand:
+        return 4;
+    default:
+        return 2;
+    }
+}
+
+static void killResults(Instruction* instr, ConstantState& state)
+{
+    if (instr->resultCount() == 0) {
+        return;
+    }
+
+    Operand size = operandSize(instr, instr->paramCount());
+    Operand* result = instr->getResult(0);
+    Operand* end = result + instr->resultCount();
+
+    while (result < end) {
+        state.kill(*result++, size);
+    }
+}
+
+template <typename T>
+static T rotateLeft(T value, T count)
+{
+    const T bits = sizeof(T) * 8;
+
+    count &= bits - 1;
+    return count == 0 ? value : static_cast<T>((value << count) | (value >> (bits - count)));
+}
+
+// Computes the result of integer operations with constant arguments.
+// Operations which may trap are only computed when they do not trap.
+static bool evaluateInstruction(Instruction* instr, ConstantState& state, ConstantState::Value& result)
+{
+    uint64_t param0;
+    uint64_t param1;
+
+    switch (instr->opcode()) {
+    case ByteCode::Const32Opcode:
+        result.value = reinterpret_cast<Const32*>(instr->byteCode())->value();
+        result.is64 = false;
+        return true;
+    case ByteCode::Const64Opcode:
+        result.value = reinterpret_cast<Const64*>(instr->byteCode())->value();
+        result.is64 = true;
+        return true;
+    case ByteCode::MoveI32Opcode:
+    case ByteCode::MoveF32Opcode:
+        result.is64 = false;
+        return state.get(*instr->getParam(0), false, result.value);
+    case ByteCode::MoveI64Opcode:
+    case ByteCode::MoveF64Opcode:
+        result.is64 = true;
+        return state.get(*instr->getParam(0), true, result.value);
+    case ByteCode::I32EqzOpcode:
+        if (!state.get(*instr->getParam(0), false, param0)) {
+            return false;
+        }
+        result.value = (param0 == 0);
+        result.is64 = false;
+        return true;
+    case ByteCode::I64EqzOpcode:
+        if (!state.get(*instr->getParam(0), true, param0)) {
+            return false;
+        }
+        result.value = (param0 == 0);
+        result.is64 = false;
+        return true;
+    case ByteCode::I32ClzOpcode:
+    case ByteCode::I32CtzOpcode:
+    case ByteCode::I32PopcntOpcode:
+    case ByteCode::I32Extend8SOpcode:
+    case ByteCode::I32Extend16SOpcode:
+    case ByteCode::I64ExtendI32SOpcode:
+    case ByteCode::I64ExtendI32UOpcode: {
+        if (!state.get(*instr->getParam(0), false, param0)) {
+            return false;
+        }
+
+        uint32_t value = static_cast<uint32_t>(param0);
+        result.is64 = false;
+
+        switch (instr->opcode()) {
+        case ByteCode::I32ClzOpcode:
+            result.value = static_cast<uint32_t>(clz(value));
+            break;
+        case ByteCode::I32CtzOpcode:
+            result.value = static_cast<uint32_t>(ctz(value));
+            break;
+        case ByteCode::I32PopcntOpcode:
+            result.value = static_cast<uint32_t>(popCount(value));
+            break;
+        case ByteCode::I32Extend8SOpcode:
+            result.value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(value)));
+            break;
+        case ByteCode::I32Extend16SOpcode:
+            result.value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(value)));
+            break;
+        case ByteCode::I64ExtendI32SOpcode:
+            result.value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(value)));
+            result.is64 = true;
+            break;
+        default:
+            ASSERT(instr->opcode() == ByteCode::I64ExtendI32UOpcode);
+            result.value = value;
+            result.is64 = true;
+            break;
+        }
+        return true;
+    }
+    case ByteCode::I64ClzOpcode:
+    case ByteCode::I64CtzOpcode:
+    case ByteCode::I64PopcntOpcode:
+    case ByteCode::I64Extend8SOpcode:
+    case ByteCode::I64Extend16SOpcode:
+    case ByteCode::I64Extend32SOpcode:
+    case ByteCode::I32WrapI64Opcode: {
+        if (!state.get(*instr->getParam(0), true, param0)) {
+            return false;
+        }
+
+        result.is64 = true;
+
+        switch (instr->opcode()) {
+        case ByteCode::I64ClzOpcode:
+            result.value = static_cast<uint64_t>(clz(static_cast<unsigned long long>(param0)));
+            break;
+        case ByteCode::I64CtzOpcode:
+            result.value = static_cast<uint64_t>(ctz(static_cast<unsigned long long>(param0)));
+            break;
+        case ByteCode::I64PopcntOpcode:
+            result.value = static_cast<uint64_t>(popCount(static_cast<unsigned long long>(param0)));
+            break;
+        case ByteCode::I64Extend8SOpcode:
+            result.value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(param0)));
+            break;
+        case ByteCode::I64Extend16SOpcode:
+            result.value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(param0)));
+            break;
+        case ByteCode::I64Extend32SOpcode:
+            result.value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(param0)));
+            break;
+        default:
+            ASSERT(instr->opcode() == ByteCode::I32WrapI64Opcode);
+            result.value = static_cast<uint32_t>(param0);
+            result.is64 = false;
+            break;
+        }
+        return true;
+    }
+    case ByteCode::I32AddOpcode:
+    case ByteCode::I32SubOpcode:
+    case ByteCode::I32MulOpcode:
+    case ByteCode::I32DivSOpcode:
+    case ByteCode::I32DivUOpcode:
+    case ByteCode::I32RemSOpcode:
+    case ByteCode::I32RemUOpcode:
+    case ByteCode::I32AndOpcode:
+    case ByteCode::I32OrOpcode:
+    case ByteCode::I32XorOpcode:
+    case ByteCode::I32ShlOpcode:
+    case ByteCode::I32ShrSOpcode:
+    case ByteCode::I32ShrUOpcode:
+    case ByteCode::I32RotlOpcode:
+    case ByteCode::I32RotrOpcode:
+    case ByteCode::I32EqOpcode:
+    case ByteCode::I32NeOpcode:
+    case ByteCode::I32LtSOpcode:
+    case ByteCode::I32LtUOpcode:
+    case ByteCode::I32GtSOpcode:
+    case ByteCode::I32GtUOpcode:
+    case ByteCode::I32LeSOpcode:
+    case ByteCode::I32LeUOpcode:
+    case ByteCode::I32GeSOpcode:
+    case ByteCode::I32GeUOpcode: {
+        if (!state.get(*instr->getParam(0), false, param0) || !state.get(*instr->getParam(1), false, param1)) {
+            return false;
+        }
+
+        uint32_t left = static_cast<uint32_t>(param0);
+        uint32_t right = static_cast<uint32_t>(param1);
+        int32_t signedLeft = static_cast<int32_t>(left);
+        int32_t signedRight = static_cast<int32_t>(right);
+        uint32_t value;
+
+        switch (instr->opcode()) {
+        case ByteCode::I32AddOpcode:
+            value = left + right;
+            break;
+        case ByteCode::I32SubOpcode:
+            value = left - right;
+            break;
+        case ByteCode::I32MulOpcode:
+            value = left * right;
+            break;
+        case ByteCode::I32DivSOpcode:
+            if (right == 0 || (signedRight == -1 && signedLeft == std::numeric_limits<int32_t>::min())) {
+                return false;
+            }
+            value = static_cast<uint32_t>(signedLeft / signedRight);
+            break;
+        case ByteCode::I32DivUOpcode:
+            if (right == 0) {
+                return false;
+            }
+            value = left / right;
+            break;
+        case ByteCode::I32RemSOpcode:
+            if (right == 0) {
+                return false;
+            }
+            value = (signedRight == -1) ? 0 : static_cast<uint32_t>(signedLeft % signedRight);
+            break;
+        case ByteCode::I32RemUOpcode:
+            if (right == 0) {
+                return false;
+            }
+            value = left % right;
+            break;
+        case ByteCode::I32AndOpcode:
+            value = left & right;
+            break;
+        case ByteCode::I32OrOpcode:
+            value = left | right;
+            break;
+        case ByteCode::I32XorOpcode:
+            value = left ^ right;
+            break;
+        case ByteCode::I32ShlOpcode:
+            value = left << (right & 0x1f);
+            break;
+        case ByteCode::I32ShrSOpcode:
+            value = static_cast<uint32_t>(signedLeft >> (right & 0x1f));
+            break;
+        case ByteCode::I32ShrUOpcode:
+            value = left >> (right & 0x1f);
+            break;
+        case ByteCode::I32RotlOpcode:
+            value = rotateLeft<uint32_t>(left, right);
+            break;
+        case ByteCode::I32RotrOpcode:
+            value = rotateLeft<uint32_t>(left, 32 - (right & 0x1f));
+            break;
+        case ByteCode::I32EqOpcode:
+            value = left == right;
+            break;
+        case ByteCode::I32NeOpcode:
+            value = left != right;
+            break;
+        case ByteCode::I32LtSOpcode:
+            value = signedLeft < signedRight;
+            break;
+        case ByteCode::I32LtUOpcode:
+            value = left < right;
+            break;
+        case ByteCode::I32GtSOpcode:
+            value = signedLeft > signedRight;
+            break;
+        case ByteCode::I32GtUOpcode:
+            value = left > right;
+            break;
+        case ByteCode::I32LeSOpcode:
+            value = signedLeft <= signedRight;
+            break;
+        case ByteCode::I32LeUOpcode:
+            value = left <= right;
+            break;
+        case ByteCode::I32GeSOpcode:
+            value = signedLeft >= signedRight;
+            break;
+        default:
+            ASSERT(instr->opcode() == ByteCode::I32GeUOpcode);
+            value = left >= right;
+            break;
+        }
+
+        result.value = value;
+        result.is64 = false;
+        return true;
+    }
+    case ByteCode::I64AddOpcode:
+    case ByteCode::I64SubOpcode:
+    case ByteCode::I64MulOpcode:
+    case ByteCode::I64DivSOpcode:
+    case ByteCode::I64DivUOpcode:
+    case ByteCode::I64RemSOpcode:
+    case ByteCode::I64RemUOpcode:
+    case ByteCode::I64AndOpcode:
+    case ByteCode::I64OrOpcode:
+    case ByteCode::I64XorOpcode:
+    case ByteCode::I64ShlOpcode:
+    case ByteCode::I64ShrSOpcode:
+    case ByteCode::I64ShrUOpcode:
+    case ByteCode::I64RotlOpcode:
+    case ByteCode::I64RotrOpcode:
+    case ByteCode::I64EqOpcode:
+    case ByteCode::I64NeOpcode:
+    case ByteCode::I64LtSOpcode:
+    case ByteCode::I64LtUOpcode:
+    case ByteCode::I64GtSOpcode:
+    case ByteCode::I64GtUOpcode:
+    case ByteCode::I64LeSOpcode:
+    case ByteCode::I64LeUOpcode:
+    case ByteCode::I64GeSOpcode:
+    case ByteCode::I64GeUOpcode: {
+        if (!state.get(*instr->getParam(0), true, param0) || !state.get(*instr->getParam(1), true, param1)) {
+            return false;
+        }
+
+        int64_t signedLeft = static_cast<int64_t>(param0);
+        int64_t signedRight = static_cast<int64_t>(param1);
+        uint64_t value;
+
+        result.is64 = true;
+
+        switch (instr->opcode()) {
+        case ByteCode::I64AddOpcode:
+            value = param0 + param1;
+            break;
+        case ByteCode::I64SubOpcode:
+            value = param0 - param1;
+            break;
+        case ByteCode::I64MulOpcode:
+            value = param0 * param1;
+            break;
+        case ByteCode::I64DivSOpcode:
+            if (param1 == 0 || (signedRight == -1 && signedLeft == std::numeric_limits<int64_t>::min())) {
+                return false;
+            }
+            value = static_cast<uint64_t>(signedLeft / signedRight);
+            break;
+        case ByteCode::I64DivUOpcode:
+            if (param1 == 0) {
+                return false;
+            }
+            value = param0 / param1;
+            break;
+        case ByteCode::I64RemSOpcode:
+            if (param1 == 0) {
+                return false;
+            }
+            value = (signedRight == -1) ? 0 : static_cast<uint64_t>(signedLeft % signedRight);
+            break;
+        case ByteCode::I64RemUOpcode:
+            if (param1 == 0) {
+                return false;
+            }
+            value = param0 % param1;
+            break;
+        case ByteCode::I64AndOpcode:
+            value = param0 & param1;
+            break;
+        case ByteCode::I64OrOpcode:
+            value = param0 | param1;
+            break;
+        case ByteCode::I64XorOpcode:
+            value = param0 ^ param1;
+            break;
+        case ByteCode::I64ShlOpcode:
+            value = param0 << (param1 & 0x3f);
+            break;
+        case ByteCode::I64ShrSOpcode:
+            value = static_cast<uint64_t>(signedLeft >> (param1 & 0x3f));
+            break;
+        case ByteCode::I64ShrUOpcode:
+            value = param0 >> (param1 & 0x3f);
+            break;
+        case ByteCode::I64RotlOpcode:
+            value = rotateLeft<uint64_t>(param0, param1);
+            break;
+        case ByteCode::I64RotrOpcode:
+            value = rotateLeft<uint64_t>(param0, 64 - (param1 & 0x3f));
+            break;
+        default:
+            result.is64 = false;
+
+            switch (instr->opcode()) {
+            case ByteCode::I64EqOpcode:
+                value = param0 == param1;
+                break;
+            case ByteCode::I64NeOpcode:
+                value = param0 != param1;
+                break;
+            case ByteCode::I64LtSOpcode:
+                value = signedLeft < signedRight;
+                break;
+            case ByteCode::I64LtUOpcode:
+                value = param0 < param1;
+                break;
+            case ByteCode::I64GtSOpcode:
+                value = signedLeft > signedRight;
+                break;
+            case ByteCode::I64GtUOpcode:
+                value = param0 > param1;
+                break;
+            case ByteCode::I64LeSOpcode:
+                value = signedLeft <= signedRight;
+                break;
+            case ByteCode::I64LeUOpcode:
+                value = param0 <= param1;
+                break;
+            case ByteCode::I64GeSOpcode:
+                value = signedLeft >= signedRight;
+                break;
+            default:
+                ASSERT(instr->opcode() == ByteCode::I64GeUOpcode);
+                value = param0 >= param1;
+                break;
+            }
+            break;
+        }
+
+        result.value = value;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool isDivRem(ByteCode::Opcode opcode, bool& is64)
+{
+    switch (opcode) {
+    case ByteCode::I32DivSOpcode:
+    case ByteCode::I32DivUOpcode:
+    case ByteCode::I32RemSOpcode:
+    case ByteCode::I32RemUOpcode:
+        is64 = false;
+        return true;
+    case ByteCode::I64DivSOpcode:
+    case ByteCode::I64DivUOpcode:
+    case ByteCode::I64RemSOpcode:
+    case ByteCode::I64RemUOpcode:
+        is64 = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void JITCompiler::propagateConstants()
+{
+    InstructionListItem* item;
+
+    for (item = m_first; item != nullptr; item = item->next()) {
+        if (item->isInstruction() && item->group() == Instruction::Immediate
+            && item->asInstruction()->opcode() != ByteCode::Const128Opcode) {
+            break;
+        }
+    }
+
+    if (item == nullptr) {
+        return;
+    }
+
+    // Exception handlers and OSR entries are entered with unknown values.
+    std::set<Label*> entryLabels;
+
+    for (size_t i = m_tryBlockStart; i < m_tryBlocks.size(); i++) {
+        for (auto it : m_tryBlocks[i].catchBlocks) {
+            entryLabels.insert(it.u.handler);
+        }
+    }
+
+    std::map<Label*, ConstantState> labelStates;
+    ConstantState state;
+    bool isFinalPass = false;
+    size_t foldedCount = 0;
+    size_t removedCount = 0;
+
+    // Similar to optimizeBoundsChecks(), except that only the
+    // reachable targets of the branches receive the state. The
+    // final pass replaces the instructions with known results
+    // by immediates, and removes the unreachable instructions.
+    while (true) {
+        bool changed = false;
+        InstructionListItem* prev = nullptr;
+
+        state.reset();
+
+        for (item = m_first; item != nullptr; prev = item, item = item->next()) {
+            if (item->isLabel()) {
+                Label* label = item->asLabel();
+
+                if ((label->info() & Label::kHasOSREntry) || entryLabels.find(label) != entryLabels.end()) {
+                    state.reset();
+                    continue;
+                }
+
+                state.merge(labelStates[label]);
+                continue;
+            }
+
+            Instruction* instr = item->asInstruction();
+
+            if (!state.isReachable) {
+                if (isFinalPass && instr->opcode() != ByteCode::EndOpcode) {
+                    item = removeInstruction(prev, instr);
+                    removedCount++;
+                }
+                continue;
+            }
+
+            if (instr->group() == Instruction::DirectBranch) {
+                Label* label = instr->asExtended()->value().targetLabel;
+                uint64_t value;
+
+                killResults(instr, state);
+
+                if ((instr->opcode() == ByteCode::JumpIfTrueOpcode || instr->opcode() == ByteCode::JumpIfFalseOpcode)
+                    && state.get(*instr->getParam(0), false, value)) {
+                    if ((value != 0) != (instr->opcode() == ByteCode::JumpIfTrueOpcode)) {
+                        if (isFinalPass) {
+                            item = removeInstruction(prev, instr);
+                            removedCount++;
+                        }
+                        continue;
+                    }
+
+                    if (isFinalPass) {
+                        instr->m_opcode = ByteCode::JumpOpcode;
+                        instr->m_paramCount = 0;
+                        foldedCount++;
+                    }
+                } else if (instr->opcode() != ByteCode::JumpOpcode) {
+                    if (labelStates[label].merge(state)) {
+                        changed = true;
+                    }
+                    continue;
+                }
+
+                if (labelStates[label].merge(state)) {
+                    changed = true;
+                }
+
+                state = ConstantState();
+                continue;
+            }
+
+            if (instr->group() == Instruction::BrTable) {
+                Label** label = instr->asBrTable()->targetLabels();
+                Label** end = label + instr->asBrTable()->targetLabelCount();
+                uint64_t value;
+
+                if (state.get(*instr->getParam(0), false, value)) {
+                    // The last target is the default target.
+                    size_t index = static_cast<size_t>(end - label - 1);
+
+                    if (value < index) {
+                        index = static_cast<size_t>(value);
+                    }
+
+                    label += index;
+                    end = label + 1;
+                }
+
+                while (label < end) {
+                    if (labelStates[*label++].merge(state)) {
+                        changed = true;
+                    }
+                }
+
+                state = ConstantState();
+                continue;
+            }
+
+            if (instr->opcode() == ByteCode::ThrowOpcode || instr->opcode() == ByteCode::UnreachableOpcode
+                || instr->opcode() == ByteCode::EndOpcode) {
+                state = ConstantState();
+                continue;
+            }
+
+            ConstantState::Value result;
+
+            if (evaluateInstruction(instr, state, result)) {
+                if (isFinalPass && instr->group() != Instruction::Immediate) {
+                    convertToImmediate(instr, result.value, result.is64);
+                    foldedCount++;
+                }
+
+                state.set(*instr->getResult(0), result);
+                continue;
+            }
+
+            bool is64;
+            uint64_t value;
+
+            if (isFinalPass && isDivRem(instr->opcode(), is64) && state.get(*instr->getParam(1), is64, value)) {
+                m_constantDivisors[instr] = value;
+            }
+
+            killResults(instr, state);
+        }
+
+        if (isFinalPass) {
+            break;
+        }
+
+        if (!changed) {
+            isFinalPass = true;
+        }
+    }
+
+    if (m_JITFlags & JITFlagValue::JITVerbose) {
+        printf("Constant propagation: %d folded, %d removed\n", static_cast<int>(foldedCount), static_cast<int>(removedCount));
+    }
+}
+
+static bool isLoopInvariant(JITCompiler* compiler, Instruction* instr, bool hasMemorySizeChange)
+{
+    if (instr->resultCount() != 1 || (instr->info() & Instruction::kIsExtended)) {
+        return false;
+    }
+
+    bool is64;
+
+    switch (instr->group()) {
+    case Instruction::Immediate:
+    case Instruction::Unary:
+    case Instruction::UnaryFloat:
+    case Instruction::BinaryFloat:
+    case Instruction::Compare:
+    case Instruction::CompareFloat:
+    case Instruction::Convert:
+    case Instruction::Move:
+        return true;
+    case Instruction::Binary:
+        // Division and remainder may trap.
+        return !isDivRem(instr->opcode(), is64);
+    case Instruction::Any:
+        switch (instr->opcode()) {
+        case ByteCode::GlobalGet32Opcode:
+        case ByteCode::GlobalGet64Opcode:
+        case ByteCode::GlobalGet128Opcode: {
+            uint32_t index = reinterpret_cast<ByteCodeOffsetValue*>(instr->byteCode())->uint32Value();
+            return !compiler->module()->globalType(index)->isMutable();
+        }
+        default:
+            return false;
+        }
+    case Instruction::Memory:
+        if (instr->opcode() == ByteCode::MemorySizeOpcode || instr->opcode() == ByteCode::MemorySizeM64Opcode) {
+            uint32_t memIndex = reinterpret_cast<ByteCodeOffsetMemIndex*>(instr->byteCode())->memIndex();
+            return !hasMemorySizeChange && !compiler->module()->memoryType(memIndex)->isShared();
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+static void updateWriteCount(Instruction* instr, std::map<Operand, uint32_t>& writeCount, bool increase)
+{
+    if (instr->resultCount() == 0) {
+        return;
+    }
+
+    Operand size = operandSize(instr, instr->paramCount());
+    Operand* result = instr->getResult(0);
+    Operand* end = result + instr->resultCount();
+
+    while (result < end) {
+        for (Operand i = 0; i < size; i++) {
+            if (increase) {
+                writeCount[*result + i]++;
+            } else {
+                writeCount[*result + i]--;
+            }
+        }
+        result++;
+    }
+}
+
+void JITCompiler::hoistLoopInvariants()
+{
+    // Loop headers and the ids of their last back edges.
+    std::vector<std::pair<Label*, size_t>> loops;
+    size_t nextId = 0;
+
+    for (InstructionListItem* item = m_first; item != nullptr; item = item->next()) {
+        item->m_id = nextId++;
+    }
+
+    for (InstructionListItem* item = m_first; item != nullptr; item = item->next()) {
+        if (!item->isLabel()) {
+            continue;
+        }
+
+        Label* label = item->asLabel();
+        size_t end = 0;
+
+        for (auto it : label->branches()) {
+            if (it->id() > label->id() && it->id() > end) {
+                end = it->id();
+            }
+        }
+
+        // OSR entries, exception handlers and try blocks are
+        // bound to their labels, so they are left unchanged.
+        if (end != 0 && !(label->info() & (Label::kHasOSREntry | Label::kHasTryInfo | Label::kHasCatchInfo))) {
+            loops.push_back(std::make_pair(label, end));
+        }
+    }
+
+    if (loops.empty()) {
+        return;
+    }
+
+    std::set<Label*> entryLabels;
+
+    for (size_t i = m_tryBlockStart; i < m_tryBlocks.size(); i++) {
+        for (auto it : m_tryBlocks[i].catchBlocks) {
+            entryLabels.insert(it.u.handler);
+        }
+    }
+
+    bool hasTryBlocks = m_tryBlockStart < m_tryBlocks.size();
+    size_t hoistedCount = 0;
+
+    // Inner loops are processed first, so their invariants
+    // can be moved further out by the enclosing loops.
+    for (auto it = loops.rbegin(); it != loops.rend(); it++) {
+        Label* header = it->first;
+        size_t end = it->second;
+
+        if (entryLabels.find(header) != entryLabels.end()) {
+            continue;
+        }
+
+        // Number of writes of each stack slot in the loop.
+        std::map<Operand, uint32_t> writeCount;
+        bool hasMemorySizeChange = false;
+        bool isValid = true;
+        InstructionListItem* item;
+
+        for (item = header->next(); item != nullptr && item->id() <= end; item = item->next()) {
+            if (item->isLabel()) {
+                // The loop must only be entered through its header.
+                for (auto branch : item->asLabel()->branches()) {
+                    if (branch->id() < header->id() || branch->id() > end) {
+                        isValid = false;
+                    }
+                }
+                continue;
+            }
+
+            Instruction* instr = item->asInstruction();
+
+            if (instr->group() == Instruction::Call || instr->opcode() == ByteCode::MemoryGrowOpcode
+                || instr->opcode() == ByteCode::MemoryGrowM64Opcode) {
+                hasMemorySizeChange = true;
+            }
+
+            updateWriteCount(instr, writeCount, true);
+        }
+
+        if (!isValid) {
+            continue;
+        }
+
+        // Only the straight line code at the start of the loop is
+        // processed, since it is executed by all iterations before
+        // any other instruction. An instruction is invariant if its
+        // sources are not modified by the loop, and its result is not
+        // modified by any other instruction, and not used before it.
+        std::vector<Instruction*> hoisted;
+        std::set<Operand> readSlots;
+        InstructionListItem* prev = header;
+
+        for (item = header->next(); item != nullptr && item->isInstruction(); item = prev->next()) {
+            Instruction* instr = item->asInstruction();
+
+            if (instr->group() == Instruction::DirectBranch || instr->group() == Instruction::BrTable
+                || instr->group() == Instruction::Return || instr->opcode() == ByteCode::ThrowOpcode
+                || instr->opcode() == ByteCode::UnreachableOpcode || instr->opcode() == ByteCode::EndOpcode
+                || (hasTryBlocks && instr->group() == Instruction::Call)) {
+                break;
+            }
+
+            bool isHoistable = isLoopInvariant(this, instr, hasMemorySizeChange);
+
+            if (isHoistable) {
+                Operand* param = instr->params();
+
+                for (uint32_t i = 0; i < instr->paramCount() && isHoistable; i++, param++) {
+                    Operand size = operandSize(instr, i);
+
+                    for (Operand j = 0; j < size; j++) {
+                        if (writeCount[*param + j] != 0) {
+                            isHoistable = false;
+                        }
+                    }
+                }
+
+                Operand result = *instr->getResult(0);
+                Operand size = operandSize(instr, instr->paramCount());
+
+                for (Operand j = 0; j < size && isHoistable; j++) {
+                    if (writeCount[result + j] != 1 || readSlots.find(result + j) != readSlots.end()) {
+                        isHoistable = false;
+                    }
+                }
+            }
+
+            if (isHoistable) {
+                updateWriteCount(instr, writeCount, false);
+                prev->m_next = instr->m_next;
+                hoisted.push_back(instr);
+                continue;
+            }
+
+            Operand* param = instr->params();
+            Operand* paramEnd = param + instr->paramCount();
+
+            while (param < paramEnd) {
+                // The maximum size is used, because some
+                // instructions have no operand descriptors.
+                for (Operand j = 0; j < 4; j++) {
+                    readSlots.insert(*param + j);
+                }
+                param++;
+            }
+
+            prev = item;
+        }
+
+        if (hoisted.empty()) {
+            continue;
+        }
+
+        for (size_t i = 0; i + 1 < hoisted.size(); i++) {
+            hoisted[i]->m_next = hoisted[i + 1];
+        }
+        hoisted.back()->m_next = header;
+
+        InstructionListItem* first = hoisted[0];
+
+        // The branches outside of the loop jump to a new
+        // label, which is placed before the hoisted code.
+        std::vector<Instruction*> branches;
+
+        for (auto branch : header->branches()) {
+            if (branch->id() < header->id()) {
+                branches.push_back(branch);
+            }
+        }
+
+        if (!branches.empty()) {
+            Label* preheader = new Label();
+
+            preheader->m_id = header->m_id;
+            preheader->m_next = first;
+            first = preheader;
+
+            for (auto branch : branches) {
+                header->remove(branch);
+
+                if (branch->group() == Instruction::DirectBranch) {
+                    branch->asExtended()->value().targetLabel = preheader;
+                    preheader->m_branches.push_back(branch);
+                    continue;
+                }
+
+                ASSERT(branch->group() == Instruction::BrTable);
+
+                Label** label = branch->asBrTable()->targetLabels();
+                Label** labelEnd = label + branch->asBrTable()->targetLabelCount();
+
+                for (; label < labelEnd; label++) {
+                    if (*label == header) {
+                        *label = preheader;
+                    }
+                }
+
+                preheader->append(branch);
+            }
+        }
+
+        if (m_first == header) {
+            m_first = first;
+        } else {
+            item = m_first;
+
+            while (item->next() != header) {
+                item = item->next();
+            }
+
+            item->m_next = first;
+        }
+
+        hoistedCount += hoisted.size();
+    }
+
+    if (m_JITFlags & JITFlagValue::JITVerbose) {
+        printf("Loop invariant code motion: %d hoisted\n", static_cast<int>(hoistedCount));
+    }
 }
 
 } // namespace Walrus
@@ -38,6 +38,12 @@
 #include <math.h>
 #include <map>
 
+#if defined(OS_POSIX) && !defined(OS_DARWIN) && (defined(CPU_X86_64) || defined(CPU_ARM64) || defined(CPU_RISCV64))
+#define WALRUS_JIT_GUARD_PAGES
+#include <signal.h>
+#include <ucontext.h>
+#endif
+
 // Inlined platform independent assembler backend.
 extern "C" {
 #include "../../third_party/sljit/sljit_src/sljitLir.c"
@@ -184,8 +190,43 @@ public:
         }
     }
 
+    void addGuardedCode(sljit_uw start, sljit_uw end)
+    {
+        size_t pos = 0;
+
+        while (pos < m_guardedCodeList.size() && m_guardedCodeList[pos] < start) {
+            pos += 2;
+        }
+
+        m_guardedCodeList.insert(m_guardedCodeList.begin() + pos, 2, start);
+        m_guardedCodeList[pos + 1] = end;
+    }
+
+    bool isGuardedCode(sljit_uw address)
+    {
+        size_t begin = 0;
+        size_t end = m_guardedCodeList.size() >> 1;
+
+        while (begin < end) {
+            size_t mid = (begin + end) >> 1;
+
+            if (address < m_guardedCodeList[mid << 1]) {
+                end = mid;
+            } else if (address >= m_guardedCodeList[(mid << 1) + 1]) {
+                begin = mid + 1;
+            } else {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
 private:
     std::vector<sljit_uw> m_trapList;
+    // Start and end address pairs of functions, which access
+    // memories without bounds checks. Sorted by start address.
+    std::vector<sljit_uw> m_guardedCodeList;
     std::vector<TryBlock> m_tryBlocks;
     std::vector<CatchBlock> m_catchBlocks;
 };
@@ -207,6 +248,16 @@ public:
         return offsetof(Table, m_elements);
     }
 
+    static sljit_sw tableTypeIds()
+    {
+        return offsetof(Table, m_typeIds);
+    }
+
+    static sljit_sw functionType()
+    {
+        return offsetof(Function, m_functionType);
+    }
+
     static sljit_sw objectTypeInfo()
     {
         return offsetof(Object, m_typeInfo);
@@ -255,6 +306,9 @@ CompileContext::CompileContext(Module* module, JITCompiler* compiler)
     , shuffleOffset(0)
 #endif /* SLJIT_CONFIG_X86 */
     , stackTmpStart(sizeof(sljit_sw))
+    , savedFrameOffset(0)
+    , directCallFrameStart(0)
+    , hasGuardedMemoryAccess(false)
     , nextTryBlock(0)
     , currentTryBlock(InstanceConstData::globalTryBlock)
     , trapBlocksStart(0)
@@ -1009,9 +1063,103 @@ static void emitStackInit(sljit_compiler* compiler, Instruction* instr)
     emitMove(compiler, type, &src, instr->operands());
 }
 
+#if defined(WALRUS_JIT_GUARD_PAGES)
+
+static struct sigaction s_previousSegvAction;
+
+static void guardPageSignalHandler(int signal, siginfo_t* info, void* uc)
+{
+    ExecutionContext* context = ExecutionContext::current;
+    ucontext_t* ucontext = reinterpret_cast<ucontext_t*>(uc);
+#if defined(CPU_X86_64)
+    sljit_uw pc = static_cast<sljit_uw>(ucontext->uc_mcontext.gregs[REG_RIP]);
+#elif defined(CPU_ARM64)
+    sljit_uw pc = static_cast<sljit_uw>(ucontext->uc_mcontext.pc);
+#else /* CPU_RISCV64 */
+    sljit_uw pc = static_cast<sljit_uw>(ucontext->uc_mcontext.__gregs[REG_PC]);
+#endif
+
+    if (context != nullptr && context->currentInstanceConstData->isGuardedCode(pc)) {
+        uint8_t* address = reinterpret_cast<uint8_t*>(info->si_addr);
+        Instance* instance = context->instance;
+        uint32_t memoryCount = instance->module()->numberOfMemoryTypes();
+
+        for (uint32_t i = 0; i < memoryCount; i++) {
+            Memory* memory = instance->memory(i);
+
+            if (address >= memory->buffer() + memory->sizeInByte() && address < memory->buffer() + memory->reservedSizeInByte()) {
+                // Continue on the trap path of the function.
+                context->error = ExecutionContext::OutOfBoundsMemAccessError;
+                pc = context->currentInstanceConstData->find(pc);
+#if defined(CPU_X86_64)
+                ucontext->uc_mcontext.gregs[REG_RIP] = static_cast<greg_t>(pc);
+#elif defined(CPU_ARM64)
+                ucontext->uc_mcontext.pc = pc;
+#else /* CPU_RISCV64 */
+                ucontext->uc_mcontext.__gregs[REG_PC] = pc;
+#endif
+                return;
+            }
+        }
+    }
+
+    // Not a guard page fault: forward it to the previous handler, and keep
+    // this handler installed, since the previous one may recover from it.
+    if (s_previousSegvAction.sa_flags & SA_SIGINFO) {
+        s_previousSegvAction.sa_sigaction(signal, info, uc);
+        return;
+    }
+
+    if (s_previousSegvAction.sa_handler == SIG_DFL) {
+        // The instruction faults again and terminates the process.
+        struct sigaction action;
+
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = SIG_DFL;
+        sigemptyset(&action.sa_mask);
+        sigaction(signal, &action, nullptr);
+        return;
+    }
+
+    if (s_previousSegvAction.sa_handler != SIG_IGN) {
+        s_previousSegvAction.sa_handler(signal);
+    }
+}
+
+static bool installGuardPageHandler()
+{
+    // Compilers may run on multiple threads. Function local
+    // statics are initialized only once in a thread safe way.
+    static bool installed = []() {
+        struct sigaction action;
+
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = guardPageSignalHandler;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        return sigaction(SIGSEGV, &action, &s_previousSegvAction) == 0;
+    }();
+
+    return installed;
+}
+
+#else /* !WALRUS_JIT_GUARD_PAGES */
+
+static bool installGuardPageHandler()
+{
+    return false;
+}
+
+#endif /* WALRUS_JIT_GUARD_PAGES */
+
 JITModule::~JITModule()
 {
-    delete m_instanceConstData;
+    delete m_instanceConstData.load(std::memory_order_relaxed);
+
+    for (auto it : m_previousInstanceConstData) {
+        delete it;
+    }
+
     sljit_free_code(m_moduleStart, nullptr);
 
     for (auto it : m_codeBlocks) {
@@ -1069,7 +1217,6 @@ JITCompiler::JITCompiler(Module* module, uint32_t JITFlags)
     , m_lastBrTableLabels(nullptr)
     , m_branchTableSize(0)
     , m_tryBlockStart(0)
-    , m_tryBlockOffset(0)
     , m_JITFlags(JITFlags)
     , m_options(0)
     , m_savedIntegerRegCount(0)
@@ -1078,15 +1225,15 @@ JITCompiler::JITCompiler(Module* module, uint32_t JITFlags)
     , m_savedVectorRegCount(0)
 #endif /* SLJIT_SEPARATE_VECTOR_REGISTERS */
     , m_stackTmpSize(0)
+    , m_directCallFrameSize(0)
 {
-    if (module->m_jitModule != nullptr) {
-        ASSERT(module->m_jitModule->m_instanceConstData != nullptr);
-        m_tryBlockOffset = module->m_jitModule->m_instanceConstData->tryBlocks().size();
-    }
-
     if (sljit_has_cpu_feature(SLJIT_HAS_CMOV)) {
         m_options |= JITCompiler::kHasCondMov;
     }
+
+    if (Memory::guardPagesEnabled() && installGuardPageHandler()) {
+        m_options |= JITCompiler::kUseGuardPages;
+    }
 }
 
 void JITCompiler::compileFunction(JITFunction* jitFunc, bool isExternal)
@@ -1133,6 +1280,8 @@ void JITCompiler::compileFunction(JITFunction* jitFunc, bool isExternal)
     emitProlog();
     m_context.tailCallLabel = sljit_emit_label(m_compiler);
 
+    size_t nextOSREntry = 0;
+
     for (InstructionListItem* item = m_first; item != nullptr; item = item->next()) {
 #if defined(WALRUS_JITPERF) && !defined(NDEBUG)
         if (perfEnabled) {
@@ -1156,6 +1305,14 @@ void JITCompiler::compileFunction(JITFunction* jitFunc, bool isExternal)
         if (item->isLabel()) {
             Label* label = item->asLabel();
 
+            if (UNLIKELY(label->info() & Label::kHasOSREntry)) {
+                // Called by the interpreter with the same arguments as the function.
+                ASSERT(nextOSREntry < m_osrEntryPositions.size());
+                m_functionList.back().osrEntries.push_back(std::make_pair(m_osrEntryPositions[nextOSREntry++], sljit_emit_label(m_compiler)));
+                emitEnter();
+                continue;
+            }
+
             if (UNLIKELY(label->info() & Label::kHasCatchInfo)) {
                 ASSERT(tryBlocks()[m_context.currentTryBlock].catchBlocks[0].u.handler == label);
                 emitCatch(m_compiler, &m_context);
@@ -1505,6 +1662,32 @@ void JITCompiler::generateCode()
         } while (brTable != nullptr);
     }
 
+    if (!m_directCalls.empty()) {
+        std::map<JITFunction*, sljit_label*> entryLabels;
+
+        for (auto it : m_functionList) {
+            if (it.isExported) {
+                entryLabels[it.jitFunc] = it.exportEntryLabel;
+            }
+        }
+
+        for (auto it : m_directCalls) {
+            JITFunction* jitFunc = it.target->jitFunction();
+            std::map<JITFunction*, sljit_label*>::iterator entry = entryLabels.find(jitFunc);
+
+            if (entry != entryLabels.end()) {
+                sljit_set_label(it.jump, entry->second);
+                continue;
+            }
+
+            // Compiled by a previous jitCompile call.
+            ASSERT(jitFunc->isCompiled());
+            sljit_set_target(it.jump, reinterpret_cast<sljit_uw>(jitFunc->exportEntry()));
+        }
+
+        m_directCalls.clear();
+    }
+
     void* code = sljit_generate_code(m_compiler, 0, nullptr);
 
 #ifdef WALRUS_JITPERF
@@ -1538,25 +1721,39 @@ void JITCompiler::generateCode()
         }
 
         JITModule* moduleDescriptor = module()->m_jitModule;
+        InstanceConstData* instanceConstData;
+        size_t tryBlockOffset = 0;
+        std::unique_lock<std::mutex> lock;
 
         if (moduleDescriptor == nullptr) {
-            InstanceConstData* instanceConstData = new InstanceConstData(m_context.trapBlocks, tryBlocks());
+            instanceConstData = new InstanceConstData(m_context.trapBlocks, tryBlocks());
             moduleDescriptor = new JITModule(instanceConstData, code);
             module()->m_jitModule = moduleDescriptor;
         } else {
-            moduleDescriptor->m_instanceConstData->append(m_context.trapBlocks, tryBlocks());
+            lock = std::unique_lock<std::mutex>(moduleDescriptor->m_mutex);
+
+            // The current data might be used by running code (e.g. by
+            // other threads when tiering is enabled), so a copy is updated.
+            InstanceConstData* previousInstanceConstData = moduleDescriptor->instanceConstData();
+            moduleDescriptor->m_previousInstanceConstData.push_back(previousInstanceConstData);
+
+            instanceConstData = new InstanceConstData(*previousInstanceConstData);
+            tryBlockOffset = instanceConstData->tryBlocks().size();
+            instanceConstData->append(m_context.trapBlocks, tryBlocks());
             moduleDescriptor->m_codeBlocks.push_back(code);
         }
 
         for (auto it : m_functionList) {
             it.jitFunc->m_module = moduleDescriptor;
+            it.jitFunc->m_tryBlockOffset = tryBlockOffset;
 
             if (!it.isExported) {
-                it.jitFunc->m_exportEntry = nullptr;
                 continue;
             }
 
-            it.jitFunc->m_exportEntry = reinterpret_cast<void*>(sljit_get_label_addr(it.exportEntryLabel));
+            if (it.guardedEndLabel != nullptr) {
+                instanceConstData->addGuardedCode(sljit_get_label_addr(it.exportEntryLabel), sljit_get_label_addr(it.guardedEndLabel));
+            }
 
             if (it.branchTableSize > 0) {
                 sljit_up* branchList = reinterpret_cast<sljit_up*>(it.jitFunc->m_constData);
@@ -1570,6 +1767,23 @@ void JITCompiler::generateCode()
                 } while (branchList < end);
             }
         }
+
+        // Functions are published after everything they depend on is ready.
+        moduleDescriptor->m_instanceConstData.store(instanceConstData, std::memory_order_release);
+
+        for (auto& it : m_functionList) {
+            void* exportEntry = nullptr;
+
+            if (it.isExported) {
+                exportEntry = reinterpret_cast<void*>(sljit_get_label_addr(it.exportEntryLabel));
+            }
+
+            for (auto entry : it.osrEntries) {
+                it.jitFunc->m_osrEntries.push_back(std::make_pair(entry.first, reinterpret_cast<void*>(sljit_get_label_addr(entry.second))));
+            }
+
+            it.jitFunc->m_exportEntry.store(exportEntry, std::memory_order_release);
+        }
     }
 
 #ifdef WALRUS_JITPERF
@@ -1630,6 +1844,11 @@ void JITCompiler::generateCode()
     sljit_free_compiler(m_compiler);
 }
 
+sljit_sw JITCompiler::tryBlockOffsetAddress()
+{
+    return reinterpret_cast<sljit_sw>(&m_functionList.back().jitFunc->m_tryBlockOffset);
+}
+
 void JITCompiler::clear()
 {
     InstructionListItem* item = m_first;
@@ -1638,6 +1857,13 @@ void JITCompiler::clear()
     m_last = nullptr;
     m_branchTableSize = 0;
     m_stackTmpSize = 0;
+    m_directCallFrameSize = 0;
+    m_osrEntryPositions.clear();
+    m_boundsCheckSizes.clear();
+    m_constantDivisors.clear();
+    m_foldedConst32.clear();
+    m_foldedConst64.clear();
+    m_context.hasGuardedMemoryAccess = false;
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
     m_context.shuffleOffset = 0;
 #endif /* SLJIT_CONFIG_X86 */
@@ -1661,14 +1887,8 @@ void JITCompiler::clear()
     m_context.trapJumps.clear();
 }
 
-void JITCompiler::emitProlog()
+void JITCompiler::emitEnter()
 {
-    FunctionList& func = m_functionList.back();
-
-    if (func.isExported) {
-        func.exportEntryLabel = sljit_emit_label(m_compiler);
-    }
-
     sljit_s32 options = SLJIT_ENTER_REG_ARG | SLJIT_ENTER_KEEP(2);
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
     options |= SLJIT_ENTER_USE_VEX;
@@ -1686,10 +1906,47 @@ void JITCompiler::emitProlog()
 #else /* !SLJIT_SEPARATE_VECTOR_REGISTERS */
     sljit_s32 saveds = (m_savedIntegerRegCount + 2) | SLJIT_ENTER_FLOAT(m_savedFloatRegCount) | SLJIT_ENTER_VECTOR(m_savedFloatRegCount);
 #endif /* SLJIT_SEPARATE_VECTOR_REGISTERS */
-    sljit_emit_enter(m_compiler, options, SLJIT_ARGS1(P, P_R), scratches, saveds, m_context.stackTmpStart + m_stackTmpSize);
+    sljit_sw localSize = m_context.stackTmpStart + m_stackTmpSize;
+
+    if (m_directCallFrameSize > 0) {
+        // The frame of the directly called functions is allocated
+        // on the machine stack, after the saved frame register.
+        localSize = (localSize + sizeof(sljit_sw) - 1) & ~static_cast<sljit_sw>(sizeof(sljit_sw) - 1);
+        m_context.savedFrameOffset = localSize;
+        m_context.directCallFrameStart = (localSize + sizeof(sljit_sw) + 0xf) & ~static_cast<sljit_sw>(0xf);
+        localSize = m_context.directCallFrameStart + static_cast<sljit_sw>(m_directCallFrameSize);
+    }
+
+    sljit_emit_enter(m_compiler, options, SLJIT_ARGS1(P, P_R), scratches, saveds, localSize);
 
     sljit_emit_op1(m_compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), kContextOffset, SLJIT_R0, 0);
 
+    if (m_directCallFrameSize > 0) {
+        sljit_emit_op1(m_compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), m_context.savedFrameOffset, kFrameReg, 0);
+    }
+
+    // The locals contain the frames of the directly called functions, which
+    // can be large, so the stack limit is checked after they are allocated.
+    // This covers both the function entry and the on-stack replacement entries.
+    sljit_get_local_base(m_compiler, SLJIT_R1, 0, 0);
+#ifdef STACK_GROWS_DOWN
+    sljit_jump* jump = sljit_emit_cmp(m_compiler, SLJIT_LESS, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_R0), OffsetOfContextField(stackLimit));
+#else
+    sljit_jump* jump = sljit_emit_cmp(m_compiler, SLJIT_GREATER, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_R0), OffsetOfContextField(stackLimit));
+#endif
+    m_context.appendTrapJump(ExecutionContext::OutOfStackError, jump);
+}
+
+void JITCompiler::emitProlog()
+{
+    FunctionList& func = m_functionList.back();
+
+    if (func.isExported) {
+        func.exportEntryLabel = sljit_emit_label(m_compiler);
+    }
+
+    emitEnter();
+
     m_context.branchTableOffset = 0;
     size_t size = func.branchTableSize * sizeof(sljit_up);
 #if (defined SLJIT_CONFIG_X86 && SLJIT_CONFIG_X86)
@@ -1787,7 +2044,7 @@ void JITCompiler::emitEpilog()
         }
     }
 
-    if (trapJumps.size() > 0 || m_tryBlockStart < m_tryBlocks.size()) {
+    if (trapJumps.size() > 0 || m_tryBlockStart < m_tryBlocks.size() || m_context.hasGuardedMemoryAccess) {
         lastLabel = sljit_emit_label(m_compiler);
 
         sljit_emit_op1(m_compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_SP), kContextOffset);
@@ -1847,7 +2104,7 @@ void JITCompiler::emitEpilog()
         size_t tryBlockId = trapBlocks[i].u.tryBlockId;
 
         if (tryBlockId == InstanceConstData::globalTryBlock) {
-            trapBlocks[i].u.handlerLabel = endLabel;
+            trapBlocks[i].u.handlerLabel = lastLabel;
         } else {
             trapBlocks[i].u.handlerLabel = tryBlocks()[tryBlockId].findHandlerLabel;
         }
@@ -1856,6 +2113,10 @@ void JITCompiler::emitEpilog()
     m_context.trapBlocksStart = end + 1;
     m_context.trapBlocks.push_back(TrapBlock(endLabel, lastLabel));
 
+    if (m_context.hasGuardedMemoryAccess) {
+        func.guardedEndLabel = endLabel;
+    }
+
     end = m_tryBlocks.size();
     for (size_t i = m_tryBlockStart; i < end; i++) {
         ASSERT(m_tryBlocks[i].returnToLabel == nullptr);
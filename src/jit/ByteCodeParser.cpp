@@ -22,7 +22,14 @@
 #include "runtime/JITExec.h"
 #include "runtime/Module.h"
 
+#ifdef WALRUS_JITPERF
+#include "jit/PerfDump.h"
+#endif
+
+#include <algorithm>
 #include <map>
+#include <set>
+#include <thread>
 
 #if defined(COMPILER_MSVC)
 #include <BaseTsd.h>
@@ -497,6 +504,9 @@ enum OperandTypes : uint32_t {
 #undef F32
 #undef F64
 
+const uint32_t Instruction::kPutI32Descriptor = OTPutI32;
+const uint32_t Instruction::kPutI64Descriptor = OTPutI64;
+
 enum ParamTypes {
     NoParam,
     ParamSrc,
@@ -600,6 +610,221 @@ static uint32_t typeToStructRequiredInit(Value::Type type, bool isGet)
     }
 }
 
+static size_t inlineFrameStart(ModuleFunction* function)
+{
+    return (static_cast<size_t>(function->requiredStackSize()) + 15) & ~static_cast<size_t>(15);
+}
+
+// Returns the frame size of the compiled code of a function. Inlined functions
+// use an area after the interpreter frame, which is only allocated when the
+// function has calls. The result only depends on the byte code, so it is
+// also known before the function is compiled.
+static size_t jitFrameSize(ModuleFunction* function, uint32_t JITFlags)
+{
+    size_t frameSize = function->requiredStackSize();
+
+    if (JITFlags & JITFlagValue::disableInline) {
+        return frameSize;
+    }
+
+    size_t inlineFrameEnd = inlineFrameStart(function) + JITCompiler::kInlineFrameSize;
+
+    if (inlineFrameEnd > std::numeric_limits<ByteCodeStackOffset>::max()) {
+        return frameSize;
+    }
+
+    size_t idx = 0;
+    size_t endIdx = function->byteCodeSize();
+
+    while (idx < endIdx) {
+        ByteCode* byteCode = function->getByteCode<ByteCode>(idx);
+
+        if (byteCode->opcode() == ByteCode::CallOpcode) {
+            return inlineFrameEnd;
+        }
+
+        idx += byteCode->getSize();
+    }
+
+    return frameSize;
+}
+
+// Only straight-line numeric code is inlined, so the
+// byte codes of the callee never leave the inlined body.
+static bool canBeInlined(ModuleFunction* function)
+{
+    size_t endIdx = function->byteCodeSize();
+
+    if (endIdx == 0 || endIdx > JITCompiler::kMaxInlinedFunctionSize
+        || !function->catchInfo().empty() || function->requiredStackSize() > JITCompiler::kInlineFrameSize) {
+        return false;
+    }
+
+    FunctionType* functionType = function->functionType();
+
+    for (auto it : functionType->param().types()) {
+        if (it != Value::I32 && it != Value::I64 && it != Value::F32 && it != Value::F64) {
+            return false;
+        }
+    }
+
+    for (auto it : functionType->result().types()) {
+        if (it != Value::I32 && it != Value::I64 && it != Value::F32 && it != Value::F64) {
+            return false;
+        }
+    }
+
+    size_t idx = 0;
+
+    while (idx < endIdx) {
+        ByteCode* byteCode = function->getByteCode<ByteCode>(idx);
+        ByteCode::Opcode opcode = byteCode->opcode();
+
+        if (opcode == ByteCode::V128LoadOpcode || opcode == ByteCode::V128StoreOpcode) {
+            return false;
+        }
+
+        switch (opcode) {
+#define CASE_INLINED_OPCODE(name, ...) case ByteCode::name##Opcode:
+            FOR_EACH_BYTECODE_BINARY_OP(CASE_INLINED_OPCODE)
+            FOR_EACH_BYTECODE_UNARY_OP(CASE_INLINED_OPCODE)
+            FOR_EACH_BYTECODE_UNARY_OP_2(CASE_INLINED_OPCODE)
+            FOR_EACH_BYTECODE_LOAD_OP(CASE_INLINED_OPCODE)
+            FOR_EACH_BYTECODE_STORE_OP(CASE_INLINED_OPCODE)
+#undef CASE_INLINED_OPCODE
+        case ByteCode::Const32Opcode:
+        case ByteCode::Const64Opcode:
+        case ByteCode::MoveI32Opcode:
+        case ByteCode::MoveI64Opcode:
+        case ByteCode::MoveF32Opcode:
+        case ByteCode::MoveF64Opcode:
+        case ByteCode::Load32Opcode:
+        case ByteCode::Load64Opcode:
+        case ByteCode::Store32Opcode:
+        case ByteCode::Store64Opcode:
+        case ByteCode::GlobalGet32Opcode:
+        case ByteCode::GlobalGet64Opcode:
+        case ByteCode::GlobalSet32Opcode:
+        case ByteCode::GlobalSet64Opcode:
+            break;
+        case ByteCode::EndOpcode:
+            if (idx + byteCode->getSize() != endIdx) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        idx += byteCode->getSize();
+    }
+
+    return true;
+}
+
+// The decision only depends on the byte code of the target, so the
+// same code is generated regardless of the state of other compilations.
+static ModuleFunction* inlineTarget(JITCompiler* compiler, Call* call, size_t frameSize)
+{
+    ModuleFunction* function = compiler->moduleFunction();
+    ModuleFunction* target = compiler->module()->function(call->index());
+
+    if (frameSize <= function->requiredStackSize() || target == function
+        || !target->hasByteCode() || !canBeInlined(target)) {
+        return nullptr;
+    }
+
+    return target;
+}
+
+static void appendMove(JITCompiler* compiler, ByteCode* byteCode, Value::Type type, size_t src, size_t dst)
+{
+    ByteCode::Opcode opcode;
+    uint32_t requiredInit;
+
+    switch (type) {
+    case Value::I32:
+        opcode = ByteCode::MoveI32Opcode;
+        requiredInit = OTOp1I32;
+        break;
+    case Value::I64:
+        opcode = ByteCode::MoveI64Opcode;
+        requiredInit = OTOp1I64;
+        break;
+    case Value::F32:
+        opcode = ByteCode::MoveF32Opcode;
+        requiredInit = OTF32ReinterpretI32;
+        break;
+    default:
+        ASSERT(type == Value::F64);
+        opcode = ByteCode::MoveF64Opcode;
+        requiredInit = OTF64ReinterpretI64;
+        break;
+    }
+
+    Instruction* instr = compiler->append(byteCode, Instruction::Move, opcode, 1, 1);
+    instr->setRequiredRegsDescriptor(requiredInit);
+
+    Operand* operands = instr->operands();
+    operands[0] = STACK_OFFSET(src);
+    operands[1] = STACK_OFFSET(dst);
+}
+
+// State of the function whose byte code is currently inlined.
+struct InlinedCall {
+    InlinedCall()
+        : call(nullptr)
+        , target(nullptr)
+        , position(0)
+        , frameStart(0)
+    {
+    }
+
+    Call* call;
+    ModuleFunction* target;
+    size_t position;
+    size_t frameStart;
+};
+
+// Copies the arguments to the parameters of the inlined function.
+static void beginInlinedCall(JITCompiler* compiler, InlinedCall& inlinedCall, Call* call, ModuleFunction* target)
+{
+    ByteCodeStackOffset* stackOffset = call->stackOffsets();
+    size_t dst = inlinedCall.frameStart;
+
+    for (auto it : target->functionType()->param().types()) {
+        appendMove(compiler, call, it, *stackOffset, dst);
+        stackOffset += (valueSize(it) + (sizeof(size_t) - 1)) / sizeof(size_t);
+        dst += valueStackAllocatedSize(it);
+    }
+
+    inlinedCall.call = call;
+    inlinedCall.target = target;
+    inlinedCall.position = 0;
+}
+
+// Copies the results of the inlined function to the results of the call.
+static void endInlinedCall(JITCompiler* compiler, InlinedCall& inlinedCall, End* end)
+{
+    FunctionType* functionType = inlinedCall.target->functionType();
+    ByteCodeStackOffset* stackOffset = inlinedCall.call->stackOffsets();
+    ByteCodeStackOffset* resultOffset = end->resultOffsets();
+
+    for (auto it : functionType->param().types()) {
+        stackOffset += (valueSize(it) + (sizeof(size_t) - 1)) / sizeof(size_t);
+    }
+
+    for (auto it : functionType->result().types()) {
+        appendMove(compiler, inlinedCall.call, it, inlinedCall.frameStart + *resultOffset, *stackOffset);
+        size_t size = (valueSize(it) + (sizeof(size_t) - 1)) / sizeof(size_t);
+        stackOffset += size;
+        resultOffset += size;
+    }
+
+    inlinedCall.call = nullptr;
+    inlinedCall.target = nullptr;
+}
+
 static void compileFunction(JITCompiler* compiler)
 {
     size_t idx = 0;
@@ -612,6 +837,9 @@ static void compileFunction(JITCompiler* compiler)
     }
 
     std::map<size_t, Label*> labels;
+    // Targets of the back edges counted by the interpreter.
+    std::set<size_t> loopHeaders;
+    bool hasOSREntries = (compiler->JITFlags() & JITFlagValue::useTiering) != 0;
 
     // Construct labels first
     while (idx < endIdx) {
@@ -622,10 +850,22 @@ static void compileFunction(JITCompiler* compiler)
         case ByteCode::JumpOpcode: {
             Jump* jump = reinterpret_cast<Jump*>(byteCode);
             labels[COMPUTE_OFFSET(idx, jump->offset())] = nullptr;
+
+            if (hasOSREntries && jump->offset() < 0) {
+                loopHeaders.insert(COMPUTE_OFFSET(idx, jump->offset()));
+            }
             break;
         }
         case ByteCode::JumpIfTrueOpcode:
-        case ByteCode::JumpIfFalseOpcode:
+        case ByteCode::JumpIfFalseOpcode: {
+            ByteCodeOffsetValue* offsetValue = reinterpret_cast<ByteCodeOffsetValue*>(byteCode);
+            labels[COMPUTE_OFFSET(idx, offsetValue->int32Value())] = nullptr;
+
+            if (hasOSREntries && offsetValue->int32Value() < 0) {
+                loopHeaders.insert(COMPUTE_OFFSET(idx, offsetValue->int32Value()));
+            }
+            break;
+        }
         case ByteCode::JumpIfNullOpcode:
         case ByteCode::JumpIfNonNullOpcode:
         case ByteCode::JumpIfCastGenericOpcode:
@@ -658,6 +898,8 @@ static void compileFunction(JITCompiler* compiler)
     for (auto it : function->catchInfo()) {
         labels[it.m_tryStart] = nullptr;
         labels[it.m_catchStartPosition] = nullptr;
+        // The code of catch handlers starts with the handler lookup.
+        loopHeaders.erase(it.m_catchStartPosition);
     }
 
     std::map<size_t, Label*>::iterator it;
@@ -677,9 +919,21 @@ static void compileFunction(JITCompiler* compiler)
         nextLabelIndex = it->first;
     }
 
+    size_t frameSize = jitFrameSize(function, compiler->JITFlags());
+    InlinedCall inlinedCall;
+    size_t inlinedCallCount = 0;
+
+    inlinedCall.frameStart = inlineFrameStart(function);
+
     idx = 0;
     while (idx < endIdx) {
         if (idx == nextLabelIndex) {
+            if (UNLIKELY(loopHeaders.find(idx) != loopHeaders.end())) {
+                // The entry is skipped by the normal control flow.
+                compiler->appendBranch(function->getByteCode<ByteCode>(idx), ByteCode::JumpOpcode, it->second, 0);
+                compiler->appendOSREntry(new Label(), idx);
+            }
+
             compiler->appendLabel(it->second);
 
             it++;
@@ -690,7 +944,15 @@ static void compileFunction(JITCompiler* compiler)
             }
         }
 
-        ByteCode* byteCode = function->getByteCode<ByteCode>(idx);
+        ByteCode* byteCode;
+        InstructionListItem* lastItem = compiler->last();
+
+        if (LIKELY(inlinedCall.target == nullptr)) {
+            byteCode = function->getByteCode<ByteCode>(idx);
+        } else {
+            byteCode = inlinedCall.target->getByteCode<ByteCode>(inlinedCall.position);
+        }
+
         ByteCode::Opcode opcode = byteCode->opcode();
         Instruction::Group group = Instruction::Any;
         uint8_t paramType = ParamTypes::NoParam;
@@ -1191,9 +1453,24 @@ static void compileFunction(JITCompiler* compiler)
 
             if (opcode == ByteCode::CallOpcode) {
                 Call* call = reinterpret_cast<Call*>(byteCode);
-                functionType = compiler->module()->function(call->index())->functionType();
+                ModuleFunction* target = inlineTarget(compiler, call, frameSize);
+
+                if (target != nullptr) {
+                    // The byte code of the target is processed before idx is advanced.
+                    ASSERT(inlinedCall.target == nullptr);
+                    beginInlinedCall(compiler, inlinedCall, call, target);
+                    inlinedCallCount++;
+                    continue;
+                }
+
+                target = compiler->module()->function(call->index());
+                functionType = target->functionType();
                 stackOffset = call->stackOffsets();
                 callerCount = 0;
+
+                if (compiler->isDirectCallTarget(target)) {
+                    compiler->increaseDirectCallFrameSize(compiler->directCallTargetFrameSize(target));
+                }
             } else if (opcode == ByteCode::CallRefOpcode) {
                 CallRef* callRef = reinterpret_cast<CallRef*>(byteCode);
                 functionType = callRef->functionType();
@@ -2550,6 +2827,12 @@ static void compileFunction(JITCompiler* compiler)
             break;
         }
         case ByteCode::EndOpcode: {
+            if (inlinedCall.target != nullptr) {
+                idx += inlinedCall.call->getSize();
+                endInlinedCall(compiler, inlinedCall, reinterpret_cast<End*>(byteCode));
+                continue;
+            }
+
             const TypeVector& result = function->functionType()->result();
 
             Instruction* instr = compiler->append(byteCode, Instruction::Any, opcode, result.size(), 0);
@@ -3713,10 +3996,38 @@ static void compileFunction(JITCompiler* compiler)
         }
         }
 
+        if (UNLIKELY(inlinedCall.target != nullptr)) {
+            // Move the stack operands of the inlined byte code into its frame.
+            Operand offset = STACK_OFFSET(inlinedCall.frameStart);
+            InstructionListItem* item = lastItem != nullptr ? lastItem->next() : compiler->first();
+
+            for (; item != nullptr; item = item->next()) {
+                ASSERT(item->isInstruction());
+                Instruction* instr = item->asInstruction();
+                Operand* operand = instr->operands();
+                Operand* end = operand + instr->paramCount() + instr->resultCount();
+
+                while (operand < end) {
+                    *operand++ += offset;
+                }
+            }
+
+            inlinedCall.position += byteCode->getSize();
+            continue;
+        }
+
         idx += byteCode->getSize();
     }
 
-    compiler->buildVariables(STACK_OFFSET(function->requiredStackSize()));
+    ASSERT(inlinedCall.target == nullptr);
+
+    if ((compiler->JITFlags() & JITFlagValue::JITVerbose) && inlinedCallCount > 0) {
+        printf("Inlined calls: %d\n", static_cast<int>(inlinedCallCount));
+    }
+
+    compiler->propagateConstants();
+    compiler->hoistLoopInvariants();
+    compiler->buildVariables(STACK_OFFSET(frameSize));
 
     if (compiler->JITFlags() & JITFlagValue::disableRegAlloc) {
         compiler->allocateRegistersSimple();
@@ -3732,7 +4043,7 @@ static void compileFunction(JITCompiler* compiler)
 
     compiler->freeVariables();
 
-    Walrus::JITFunction* jitFunc = new JITFunction();
+    Walrus::JITFunction* jitFunc = new JITFunction(frameSize);
 
     function->setJITFunction(jitFunc);
     compiler->compileFunction(jitFunc, true);
@@ -3822,13 +4133,63 @@ const uint8_t* VariableList::getOperandDescriptor(Instruction* instr)
     return instr->getOperandDescriptor();
 }
 
-void Module::jitCompile(ModuleFunction** functions, size_t functionsLength, uint32_t JITFlags)
+static bool canBeDirectCallTarget(ModuleFunction* function)
+{
+    size_t idx = 0;
+    size_t endIdx = function->byteCodeSize();
+
+    if (endIdx == 0) {
+        // Imported functions are called through their Function object.
+        return false;
+    }
+
+    while (idx < endIdx) {
+        ByteCode* byteCode = function->getByteCode<ByteCode>(idx);
+
+        switch (byteCode->opcode()) {
+        case ByteCode::ReturnCallOpcode:
+        case ByteCode::ReturnCallIndirectOpcode:
+        case ByteCode::ReturnCallIndirectM64Opcode:
+        case ByteCode::ReturnCallRefOpcode:
+            // Tail calls may replace the frame, which is
+            // owned by the caller for direct calls.
+            return false;
+        default:
+            break;
+        }
+
+        idx += byteCode->getSize();
+    }
+
+    return true;
+}
+
+void Module::jitCompileFunctions(ModuleFunction** functions, size_t functionsLength, uint32_t JITFlags)
 {
     JITCompiler compiler(this, JITFlags);
+    size_t functionCount = m_functions.size();
+    std::set<ModuleFunction*> compiledFunctions(functions, functions + functionsLength);
 
-    if (functionsLength == 0) {
-        size_t functionCount = m_functions.size();
+    // Calls to functions compiled by this or a previous code block
+    // are performed without leaving the JIT code.
+    for (size_t i = 0; i < functionCount; i++) {
+        JITFunction* jitFunc = m_functions[i]->jitFunction();
+
+        if (jitFunc != nullptr && !jitFunc->isCompiled()) {
+            continue;
+        }
+
+        if (jitFunc == nullptr && functionsLength > 0
+            && compiledFunctions.find(m_functions[i]) == compiledFunctions.end()) {
+            continue;
+        }
+
+        if (canBeDirectCallTarget(m_functions[i])) {
+            compiler.addDirectCallTarget(m_functions[i], jitFrameSize(m_functions[i], JITFlags));
+        }
+    }
 
+    if (functionsLength == 0) {
         for (size_t i = 0; i < functionCount; i++) {
             if (m_functions[i]->jitFunction() == nullptr) {
                 if (JITFlags & JITFlagValue::JITVerbose) {
@@ -3857,6 +4218,86 @@ void Module::jitCompile(ModuleFunction** functions, size_t functionsLength, uint
     compiler.generateCode();
 }
 
+void Module::jitCompile(ModuleFunction** functions, size_t functionsLength, uint32_t JITFlags)
+{
+    size_t threadCount = JITThreadCount();
+
+    if (JITFlags & JITFlagValue::JITVerbose) {
+        // Keep the output of the functions in order.
+        threadCount = 1;
+    }
+
+#ifdef WALRUS_JITPERF
+    if (PerfDump::instance().perfEnabled()) {
+        threadCount = 1;
+    }
+#endif /* WALRUS_JITPERF */
+
+    if (threadCount <= 1) {
+        jitCompileFunctions(functions, functionsLength, JITFlags);
+        return;
+    }
+
+    std::vector<ModuleFunction*> functionList;
+
+    if (functionsLength == 0) {
+        functions = m_functions.data();
+        functionsLength = m_functions.size();
+    }
+
+    for (size_t i = 0; i < functionsLength; i++) {
+        // Imported functions have no byte code.
+        if (functions[i]->jitFunction() == nullptr && functions[i]->byteCodeSize() > 0) {
+            functionList.push_back(functions[i]);
+        }
+    }
+
+    if (functionList.empty()) {
+        return;
+    }
+
+    if (m_jitModule == nullptr) {
+        // The first code block contains the entry code of the
+        // module, which is needed by the other code blocks.
+        jitCompileFunctions(functionList.data(), 1, JITFlags);
+        functionList.erase(functionList.begin());
+    }
+
+    if (functionList.size() < threadCount) {
+        threadCount = functionList.size();
+    }
+
+    // Each thread compiles its own code block. The blocks are balanced
+    // by assigning the largest remaining function to the smallest block.
+    std::sort(functionList.begin(), functionList.end(), [](ModuleFunction* a, ModuleFunction* b) {
+        return a->byteCodeSize() > b->byteCodeSize();
+    });
+
+    std::vector<std::vector<ModuleFunction*>> blocks(threadCount);
+    std::vector<size_t> blockSizes(threadCount, 0);
+
+    for (auto it : functionList) {
+        size_t smallest = std::min_element(blockSizes.begin(), blockSizes.end()) - blockSizes.begin();
+
+        blocks[smallest].push_back(it);
+        blockSizes[smallest] += it->byteCodeSize();
+    }
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.push_back(std::thread(&Module::jitCompileFunctions, this, blocks[i].data(), blocks[i].size(), JITFlags));
+    }
+
+    if (threadCount > 0) {
+        jitCompileFunctions(blocks[0].data(), blocks[0].size(), JITFlags);
+    }
+
+    for (auto& it : threads) {
+        it.join();
+    }
+}
+
 } // namespace Walrus
 
 #endif // WALRUS_ENABLE_JIT
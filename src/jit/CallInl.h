@@ -56,7 +56,7 @@ static sljit_sw callFunctionIndirect(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::IndirectCallTypeMismatchError;
         return ExecutionContext::IndirectCallTypeMismatchError;
     }
@@ -73,6 +73,24 @@ static sljit_sw callFunctionIndirect(
     return error;
 }
 
+static sljit_sw callFunctionIndirectTarget(
+    CallIndirect* code,
+    uint8_t* bp,
+    ExecutionContext* context,
+    Function* target)
+{
+    sljit_sw error = ExecutionContext::NoError;
+    try {
+        target->interpreterCall(context->state, bp, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize());
+    } catch (std::unique_ptr<Exception>& exception) {
+        context->capturedException = exception.release();
+        context->error = ExecutionContext::CapturedException;
+        error = ExecutionContext::CapturedException;
+    }
+
+    return error;
+}
+
 static sljit_sw callFunctionIndirectM64(
     CallIndirect* code,
     uint8_t* bp,
@@ -94,7 +112,7 @@ static sljit_sw callFunctionIndirectM64(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::IndirectCallTypeMismatchError;
         return ExecutionContext::IndirectCallTypeMismatchError;
     }
@@ -125,7 +143,7 @@ static sljit_sw callFunctionRef(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::CallRefTypeMismatchError;
         return ExecutionContext::CallRefTypeMismatchError;
     }
@@ -170,10 +188,12 @@ static sljit_sw resolvePendingTailCall(
         ModuleFunction* targetModuleFunction = definedTarget->moduleFunction();
         JITFunction* targetJitFunction = targetModuleFunction->jitFunction();
 
-        // It is really TCO capable function?
+        // It is really TCO capable function? Functions of the same module share their
+        // const data. When the target was compiled later, its data is a superset of
+        // the current one, so the current data is replaced.
         if (LIKELY(targetJitFunction != nullptr && targetJitFunction->isCompiled()
-                   && targetJitFunction->instanceConstData() == context->currentInstanceConstData)) {
-            size_t requiredStackSize = targetModuleFunction->requiredStackSize();
+                   && definedTarget->instance()->module() == context->instance->module())) {
+            size_t requiredStackSize = targetJitFunction->frameSize();
             // Allocate more stack and hang to pointer
             if (UNLIKELY(requiredStackSize > context->frameCapacity)) {
 #ifdef ENABLE_GC
@@ -202,6 +222,7 @@ static sljit_sw resolvePendingTailCall(
             // The caller jumps directly to the target entry.
             context->frameStart = bp;
             context->instance = definedTarget->instance();
+            context->currentInstanceConstData = targetJitFunction->instanceConstData();
             context->tailCallEntry = targetJitFunction->exportEntry();
             return ExecutionContext::TailCallJump;
         }
@@ -249,7 +270,7 @@ static sljit_sw tailCallFunctionIndirect(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::IndirectCallTypeMismatchError;
         return ExecutionContext::IndirectCallTypeMismatchError;
     }
@@ -278,7 +299,7 @@ static sljit_sw tailCallFunctionIndirectM64(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::IndirectCallTypeMismatchError;
         return ExecutionContext::IndirectCallTypeMismatchError;
     }
@@ -298,7 +319,7 @@ static sljit_sw tailCallFunctionRef(
     }
 
     const FunctionType* ft = target->functionType();
-    if (!ft->equals(code->functionType())) {
+    if (!ft->equals(code->functionType(), true)) {
         context->error = ExecutionContext::CallRefTypeMismatchError;
         return ExecutionContext::CallRefTypeMismatchError;
     }
@@ -306,6 +327,95 @@ static sljit_sw tailCallFunctionRef(
     return resolvePendingTailCall(target, code->stackOffsets(), code->parameterOffsetsSize(), code->resultOffsetsSize(), bp, context);
 }
 
+static void emitDirectCall(sljit_compiler* compiler, Instruction* instr, ModuleFunction* target)
+{
+    CompileContext* context = CompileContext::get(compiler);
+    Call* call = reinterpret_cast<Call*>(instr->byteCode());
+    FunctionType* functionType = target->functionType();
+    Operand* operand = instr->operands();
+    sljit_sw frameStart = context->directCallFrameStart;
+
+    ByteCodeStackOffset* stackOffset = emitStoreOntoStack(compiler, operand, call->stackOffsets(), functionType->param(), true);
+    operand += instr->paramCount();
+
+    // The frame of the callee is allocated in the local area of this
+    // function, and the callee checks the stack limit in its prolog
+    // after its own frame is allocated.
+    ByteCodeStackOffset* offsets = call->stackOffsets();
+    uint16_t parameterOffsetCount = call->parameterOffsetsSize();
+
+    for (uint16_t i = 0; i < parameterOffsetCount; i++) {
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM1(kFrameReg), offsets[i]);
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), frameStart + static_cast<sljit_sw>(i * sizeof(sljit_sw)), SLJIT_R1, 0);
+    }
+
+    // Same calling convention as the tail calls: context in R0, frame in kFrameReg.
+    // Errors are propagated by returning to the trap handler of this call site.
+    sljit_get_local_base(compiler, kFrameReg, 0, frameStart);
+    context->compiler->appendDirectCall(sljit_emit_call(compiler, SLJIT_CALL_REG_ARG, SLJIT_ARGS1(P, P)), target);
+
+    sljit_emit_op1(compiler, SLJIT_MOV, kFrameReg, 0, SLJIT_MEM1(SLJIT_SP), context->savedFrameOffset);
+    sljit_get_local_base(compiler, SLJIT_R2, 0, frameStart);
+
+    // The callee returns the result offsets of its frame in R0.
+    uint16_t resultOffsetCount = call->resultOffsetsSize();
+
+    for (uint16_t i = 0; i < resultOffsetCount; i++) {
+        sljit_emit_op1(compiler, SLJIT_MOV_U16, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_R0), static_cast<sljit_sw>(i * sizeof(ByteCodeStackOffset)));
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, SLJIT_MEM2(SLJIT_R2, SLJIT_R1), 0);
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(kFrameReg), stackOffset[i], SLJIT_R1, 0);
+    }
+
+    for (auto it : functionType->result().types()) {
+        ASSERT(VARIABLE_TYPE(*operand) != Instruction::ConstPtr);
+
+        if (VARIABLE_TYPE(*operand) == Instruction::Register) {
+            Operand src = VARIABLE_SET(STACK_OFFSET(*stackOffset), Instruction::Offset);
+            emitMove(compiler, Instruction::valueTypeToOperandType(it), &src, operand);
+        }
+
+        operand++;
+        stackOffset += (valueSize(it) + (sizeof(size_t) - 1)) / sizeof(size_t);
+    }
+}
+
+// Checks the table bounds and the canonical type id of the element
+// inline, and calls the target when they match. Other cases, including
+// subtypes and traps, are handled by the slow case helper. Returns
+// with the jump to the end of the call.
+static sljit_jump* emitIndirectCallFastPath(sljit_compiler* compiler, CallTable* callTable, bool is64)
+{
+    CompileContext* context = CompileContext::get(compiler);
+    sljit_jump* slowCases[2];
+
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R2, 0, SLJIT_MEM1(kInstanceReg), context->tableStart + (callTable->tableIndex() * sizeof(void*)));
+    sljit_emit_op1(compiler, is64 ? SLJIT_MOV : SLJIT_MOV_U32, SLJIT_R0, 0, SLJIT_MEM1(kFrameReg), callTable->calleeOffset());
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+    slowCases[0] = sljit_emit_cmp(compiler, SLJIT_GREATER_EQUAL, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_R2), JITFieldAccessor::tableSizeOffset());
+#else /* !SLJIT_64BIT_ARCHITECTURE */
+    slowCases[0] = sljit_emit_cmp(compiler, SLJIT_GREATER_EQUAL, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_R2), JITFieldAccessor::tableSizeOffset() + WORD_LOW_OFFSET);
+#endif /* SLJIT_64BIT_ARCHITECTURE */
+
+    // Tables of call_indirect always have type ids, and null
+    // elements have no type id, so they never match.
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_R2), JITFieldAccessor::tableTypeIds());
+    slowCases[1] = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL, SLJIT_MEM2(SLJIT_R1, SLJIT_R0), SLJIT_WORD_SHIFT,
+                                  SLJIT_IMM, reinterpret_cast<sljit_sw>(callTable->functionType()));
+
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R1, 0, SLJIT_MEM1(SLJIT_R2), JITFieldAccessor::tableElements());
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R3, 0, SLJIT_MEM2(SLJIT_R1, SLJIT_R0), SLJIT_WORD_SHIFT);
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R0, 0, SLJIT_IMM, reinterpret_cast<sljit_sw>(callTable));
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, kFrameReg, 0);
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_MEM1(SLJIT_SP), kContextOffset);
+    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS4(W, W, W, W, W), SLJIT_IMM, GET_FUNC_ADDR(sljit_sw, callFunctionIndirectTarget));
+    sljit_jump* done = sljit_emit_jump(compiler, SLJIT_JUMP);
+
+    sljit_label* slowCase = sljit_emit_label(compiler);
+    sljit_set_label(slowCases[0], slowCase);
+    sljit_set_label(slowCases[1], slowCase);
+    return done;
+}
+
 static void emitCall(sljit_compiler* compiler, Instruction* instr)
 {
     FunctionType* functionType;
@@ -318,8 +428,15 @@ static void emitCall(sljit_compiler* compiler, Instruction* instr)
     switch (instr->opcode()) {
     case ByteCode::CallOpcode: {
         Call* call = reinterpret_cast<Call*>(instr->byteCode());
+        ModuleFunction* target = context->compiler->module()->function(call->index());
+
+        if (context->compiler->isDirectCallTarget(target)) {
+            emitDirectCall(compiler, instr, target);
+            return;
+        }
+
         addr = GET_FUNC_ADDR(sljit_sw, callFunction);
-        functionType = context->compiler->module()->function(call->index())->functionType();
+        functionType = target->functionType();
         stackOffset = call->stackOffsets();
         break;
     }
@@ -451,11 +568,25 @@ static void emitCall(sljit_compiler* compiler, Instruction* instr)
         operand++;
     }
 
+    sljit_jump* fastPathDone = nullptr;
+
+    if (instr->opcode() == ByteCode::CallIndirectOpcode) {
+        fastPathDone = emitIndirectCallFastPath(compiler, reinterpret_cast<CallTable*>(instr->byteCode()), false);
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+    } else if (instr->opcode() == ByteCode::CallIndirectM64Opcode) {
+        fastPathDone = emitIndirectCallFastPath(compiler, reinterpret_cast<CallTable*>(instr->byteCode()), true);
+#endif /* SLJIT_64BIT_ARCHITECTURE */
+    }
+
     sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_R0, 0, SLJIT_IMM, reinterpret_cast<sljit_sw>(instr->byteCode()));
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, kFrameReg, 0);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_MEM1(SLJIT_SP), kContextOffset);
     sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3(W, W, W, W), SLJIT_IMM, addr);
 
+    if (fastPathDone != nullptr) {
+        sljit_set_label(fastPathDone, sljit_emit_label(compiler));
+    }
+
     if (isTailCall) {
         sljit_jump* tailCallJump = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_R0, 0, SLJIT_IMM, ExecutionContext::TailCallJump);
         context->earlyReturns.push_back(sljit_emit_jump(compiler, SLJIT_JUMP));
@@ -258,9 +258,10 @@ public:
     static const uint16_t kFreeUnusedEarly = 1 << 7;
     static const uint16_t kKeepInstruction = 1 << 8;
     static const uint16_t kEarlyReturn = kKeepInstruction;
-    // These two are only used by memory load/store instructions
+    // These three are only used by memory load/store instructions
     static const uint16_t kMultiMemory = 1 << 9;
     static const uint16_t kMemory64 = 1 << 10;
+    static const uint16_t kIsInBounds = 1 << 11;
 
     ByteCode::Opcode opcode() { return m_opcode; }
 
@@ -325,6 +326,10 @@ public:
 
     static uint32_t valueTypeToOperandType(Value::Type type);
 
+    // Operand descriptors of Const32 and Const64 instructions.
+    static const uint32_t kPutI32Descriptor;
+    static const uint32_t kPutI64Descriptor;
+
 protected:
     explicit Instruction(ByteCode* byteCode, Group group, ByteCode::Opcode opcode, uint32_t paramCount)
         : InstructionListItem(group)
@@ -412,6 +417,7 @@ public:
     static const uint16_t kHasLabelData = 1 << 1;
     static const uint16_t kHasTryInfo = 1 << 2;
     static const uint16_t kHasCatchInfo = 1 << 3;
+    static const uint16_t kHasOSREntry = 1 << 4;
 
     explicit Label()
         : InstructionListItem(CodeLabel)
@@ -427,6 +433,7 @@ public:
     }
 
     void append(Instruction* instr);
+    void remove(Instruction* instr);
     // Should be called before removing the other instruction.
     void merge(Label* other);
 
@@ -581,6 +588,12 @@ struct CompileContext {
     size_t dataSegmentsStart;
     size_t elementSegmentsStart;
     sljit_sw stackTmpStart;
+    // Local area slot which keeps the frame register during direct calls.
+    sljit_sw savedFrameOffset;
+    // Local area which is used as the frame of directly called functions.
+    sljit_sw directCallFrameStart;
+    // The current function relies on guard pages for memory accesses.
+    bool hasGuardedMemoryAccess;
     size_t nextTryBlock;
     size_t currentTryBlock;
     size_t trapBlocksStart;
@@ -609,6 +622,7 @@ struct VariableList {
             , info(typeInfo)
             , reg1(kUnusedReg)
             , reg2(kUnusedReg)
+            , spillWeight(0)
             , rangeEnd(id)
         {
             u.rangeStart = id;
@@ -619,6 +633,7 @@ struct VariableList {
             , info(typeInfo)
             , reg1(kUnusedReg)
             , reg2(kUnusedReg)
+            , spillWeight(0)
             , rangeEnd(instr->id())
         {
             if (instr->group() == Instruction::Immediate) {
@@ -633,6 +648,8 @@ struct VariableList {
         uint16_t info;
         uint8_t reg1;
         uint8_t reg2;
+        // Number of uses weighted by their loop depth.
+        uint32_t spillWeight;
         union {
             size_t rangeStart;
             size_t parent;
@@ -738,9 +755,15 @@ public:
 
     static const uint32_t kHasCondMov = 1 << 0;
     static const uint32_t kHasShortAtomic = 1 << 1;
+    static const uint32_t kUseGuardPages = 1 << 2;
 
     static const uint32_t kMaxInlinedBranchTable = 1024;
 
+    // Inlined functions use a fixed size area after the interpreter frame.
+    static const uint32_t kInlineFrameSize = 128;
+    // Byte code size limit of inlined functions.
+    static const uint32_t kMaxInlinedFunctionSize = 96;
+
     JITCompiler(Module* module, uint32_t JITFlags);
 
     ~JITCompiler()
@@ -780,6 +803,15 @@ public:
         append(label);
     }
 
+    // Entry point for the interpreter, which starts
+    // executing the function at the given byte code.
+    void appendOSREntry(Label* label, size_t position)
+    {
+        label->addInfo(Label::kHasOSREntry);
+        m_osrEntryPositions.push_back(position);
+        append(label);
+    }
+
     void increaseBranchTableSize(size_t value)
     {
         m_branchTableSize += value;
@@ -792,11 +824,61 @@ public:
         }
     }
 
+    void increaseDirectCallFrameSize(size_t value)
+    {
+        if (m_directCallFrameSize < value) {
+            m_directCallFrameSize = value;
+        }
+    }
+
+    size_t directCallFrameSize() { return m_directCallFrameSize; }
+
+    void addDirectCallTarget(ModuleFunction* moduleFunction, size_t frameSize)
+    {
+        m_directCallTargets[moduleFunction] = frameSize;
+    }
+
+    bool isDirectCallTarget(ModuleFunction* moduleFunction)
+    {
+        return m_directCallTargets.find(moduleFunction) != m_directCallTargets.end();
+    }
+
+    size_t directCallTargetFrameSize(ModuleFunction* moduleFunction)
+    {
+        ASSERT(isDirectCallTarget(moduleFunction));
+        return m_directCallTargets[moduleFunction];
+    }
+
+    void appendDirectCall(sljit_jump* jump, ModuleFunction* target)
+    {
+        m_directCalls.push_back(DirectCall(jump, target));
+    }
+
+    uint32_t boundsCheckSize(Instruction* instr, uint32_t size)
+    {
+        auto it = m_boundsCheckSizes.find(instr);
+        return it != m_boundsCheckSizes.end() ? it->second : size;
+    }
+
+    bool constantDivisor(Instruction* instr, uint64_t& value)
+    {
+        auto it = m_constantDivisors.find(instr);
+
+        if (it == m_constantDivisors.end()) {
+            return false;
+        }
+
+        value = it->second;
+        return true;
+    }
+
     void setModuleFunction(ModuleFunction* moduleFunction)
     {
         m_moduleFunction = moduleFunction;
     }
 
+    void propagateConstants();
+    void hoistLoopInvariants();
     void buildVariables(uint32_t requiredStackSize);
     void allocateRegistersSimple();
     void allocateRegisters();
@@ -807,7 +889,7 @@ public:
 
     std::vector<TryBlock>& tryBlocks() { return m_tryBlocks; }
     void initTryBlockStart() { m_tryBlockStart = m_tryBlocks.size(); }
-    size_t tryBlockOffset() { return m_tryBlockOffset; }
+    sljit_sw tryBlockOffsetAddress();
 
 #if !defined(NDEBUG)
     static const char** byteCodeNames()
@@ -822,6 +904,7 @@ private:
         FunctionList(JITFunction* jitFunc, bool isExported, size_t branchTableSize)
             : jitFunc(jitFunc)
             , exportEntryLabel(nullptr)
+            , guardedEndLabel(nullptr)
             , isExported(isExported)
             , branchTableSize(branchTableSize)
         {
@@ -829,13 +912,30 @@ private:
 
         JITFunction* jitFunc;
         sljit_label* exportEntryLabel;
+        sljit_label* guardedEndLabel;
         bool isExported;
         size_t branchTableSize;
+        std::vector<std::pair<size_t, sljit_label*>> osrEntries;
+    };
+
+    struct DirectCall {
+        DirectCall(sljit_jump* jump, ModuleFunction* target)
+            : jump(jump)
+            , target(target)
+        {
+        }
+
+        sljit_jump* jump;
+        ModuleFunction* target;
     };
 
     void append(InstructionListItem* item);
+    void optimizeBoundsChecks();
+    InstructionListItem* removeInstruction(InstructionListItem* prev, Instruction* instr);
+    void convertToImmediate(Instruction* instr, uint64_t value, bool is64);
 
     // Backend operations.
+    void emitEnter();
     void emitProlog();
     void emitEpilog();
 
@@ -856,8 +956,6 @@ private:
     size_t m_branchTableSize;
     // Start inside the m_tryBlocks vector.
     size_t m_tryBlockStart;
-    // Start inside the instance const data.
-    size_t m_tryBlockOffset;
     uint32_t m_JITFlags;
     uint32_t m_options;
     uint8_t m_savedIntegerRegCount;
@@ -866,9 +964,25 @@ private:
     uint8_t m_savedVectorRegCount;
 #endif /* SLJIT_SEPARATE_VECTOR_REGISTERS */
     uint8_t m_stackTmpSize;
+    // Largest frame required by the directly called functions.
+    size_t m_directCallFrameSize;
 
     std::vector<TryBlock> m_tryBlocks;
     std::vector<FunctionList> m_functionList;
+    // Functions which can be called without leaving the JIT
+    // code, and the frame sizes of their compiled code.
+    std::map<ModuleFunction*, size_t> m_directCallTargets;
+    // Calls which are linked to their targets by generateCode().
+    std::vector<DirectCall> m_directCalls;
+    // Byte code positions of the OSR entries of the current function.
+    std::vector<size_t> m_osrEntryPositions;
+    // Loads whose bounds check also covers the following accesses.
+    std::map<Instruction*, uint32_t> m_boundsCheckSizes;
+    // Divisors which are known constants, but not immediate operands.
+    std::map<Instruction*, uint64_t> m_constantDivisors;
+    // Byte codes of the instructions replaced by their constant results.
+    std::deque<Const32> m_foldedConst32;
+    std::deque<Const64> m_foldedConst64;
 #if defined(WALRUS_JITPERF) && !defined(NDEBUG)
     std::vector<DebugEntry> m_debugEntries;
 #endif /* WALRUS_JITPERF && !NDEBUG */
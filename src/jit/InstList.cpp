@@ -109,6 +109,11 @@ void Label::append(Instruction* instr)
     m_branches.push_back(instr);
 }
 
+void Label::remove(Instruction* instr)
+{
+    m_branches.erase(std::remove(m_branches.begin(), m_branches.end(), instr), m_branches.end());
+}
+
 void Label::merge(Label* other)
 {
     ASSERT(this != other);
@@ -269,6 +274,55 @@ InstructionListItem* JITCompiler::insertStackInit(InstructionListItem* prev, Var
     return instr;
 }
 
+InstructionListItem* JITCompiler::removeInstruction(InstructionListItem* prev, Instruction* instr)
+{
+    ASSERT(prev != nullptr && prev->m_next == instr);
+
+    if (instr->group() == Instruction::DirectBranch) {
+        instr->asExtended()->value().targetLabel->remove(instr);
+    } else if (instr->group() == Instruction::BrTable) {
+        Label** label = instr->asBrTable()->targetLabels();
+        Label** end = label + instr->asBrTable()->targetLabelCount();
+
+        while (label < end) {
+            (*label++)->remove(instr);
+        }
+    }
+
+    if (m_last == instr) {
+        m_last = prev;
+    }
+
+    prev->m_next = instr->m_next;
+    instr->deleteObject();
+    return prev;
+}
+
+void JITCompiler::convertToImmediate(Instruction* instr, uint64_t value, bool is64)
+{
+    ASSERT(instr->resultCount() == 1 && !(instr->info() & Instruction::kIsExtended));
+
+    Operand offset = *instr->getResult(0);
+    ByteCodeStackOffset dstOffset = static_cast<ByteCodeStackOffset>(offset * sizeof(uint32_t));
+
+    if (is64) {
+        m_foldedConst64.push_back(Const64(dstOffset, value));
+        instr->m_byteCode = &m_foldedConst64.back();
+        instr->m_opcode = ByteCode::Const64Opcode;
+        instr->setRequiredRegsDescriptor(Instruction::kPutI64Descriptor);
+    } else {
+        m_foldedConst32.push_back(Const32(dstOffset, static_cast<uint32_t>(value)));
+        instr->m_byteCode = &m_foldedConst32.back();
+        instr->m_opcode = ByteCode::Const32Opcode;
+        instr->setRequiredRegsDescriptor(Instruction::kPutI32Descriptor);
+    }
+
+    instr->m_group = Instruction::Immediate;
+    instr->m_paramCount = 0;
+    instr->setInfo(0);
+    *instr->operands() = offset;
+}
+
 void JITCompiler::insertStackInitList(InstructionListItem* prev, size_t variableListStart, size_t variableListSize)
 {
     size_t end = variableListStart + variableListSize;
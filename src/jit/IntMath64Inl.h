@@ -22,6 +22,115 @@ enum DivRemOptions : sljit_s32 {
     DivRemRemainder = 2 << 1,
 };
 
+// Division by a non-zero constant is replaced by shifts and multiplications,
+// which cannot trap. Returns false if the divisor is not supported.
+static bool emitDivRemByImmediate(sljit_compiler* compiler, JITArg* args, sljit_s32 options)
+{
+    sljit_s32 op32 = (options & DivRem32) ? SLJIT_32 : 0;
+    sljit_s32 movOpcode = (options & DivRem32) ? SLJIT_MOV32 : SLJIT_MOV;
+    sljit_sw bits = (options & DivRem32) ? 32 : 64;
+    sljit_uw divisor = static_cast<sljit_uw>(args[1].argw);
+
+    if (options & DivRem32) {
+        divisor = static_cast<sljit_u32>(divisor);
+    }
+
+    if (!(options & DivRemSigned)) {
+        if ((divisor & (divisor - 1)) == 0) {
+            if (options & DivRemRemainder) {
+                sljit_emit_op2(compiler, SLJIT_AND | op32, args[2].arg, args[2].argw, args[0].arg, args[0].argw, SLJIT_IMM, static_cast<sljit_sw>(divisor - 1));
+            } else {
+                sljit_emit_op2(compiler, SLJIT_LSHR | op32, args[2].arg, args[2].argw, args[0].arg, args[0].argw, SLJIT_IMM, ctz(divisor));
+            }
+            return true;
+        }
+
+        if (!(options & DivRem32)) {
+            return false;
+        }
+
+        // The quotient is ((x * m) >> 32 + x) >> l computed on 64 bit, where l is ceil(log2(d)).
+        sljit_sw shift = static_cast<sljit_sw>(64 - clz(divisor));
+        sljit_uw multiplier = ((((static_cast<sljit_uw>(1) << shift) - divisor) << 32) / divisor) + 1;
+
+        sljit_emit_op1(compiler, SLJIT_MOV_U32, SLJIT_R0, 0, args[0].arg, args[0].argw);
+        sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, static_cast<sljit_sw>(multiplier));
+        sljit_emit_op2(compiler, SLJIT_LSHR, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 32);
+        sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_R0, 0);
+        sljit_emit_op2(compiler, SLJIT_LSHR, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, shift);
+    } else {
+        sljit_uw absDivisor = args[1].argw < 0 ? 0 - static_cast<sljit_uw>(args[1].argw) : divisor;
+
+        if (absDivisor == 1) {
+            if (options & DivRemRemainder) {
+                sljit_emit_op1(compiler, movOpcode, args[2].arg, args[2].argw, SLJIT_IMM, 0);
+                return true;
+            }
+
+            if (args[1].argw == 1) {
+                sljit_emit_op1(compiler, movOpcode, args[2].arg, args[2].argw, args[0].arg, args[0].argw);
+                return true;
+            }
+
+            // Dividing by -1 may overflow.
+            return false;
+        }
+
+        if ((absDivisor & (absDivisor - 1)) == 0) {
+            // Negative values are rounded towards zero by adding d - 1 before the shift.
+            sljit_sw shift = ctz(absDivisor);
+
+            MOVE_TO_REG(compiler, movOpcode, SLJIT_R0, args[0].arg, args[0].argw);
+            sljit_emit_op2(compiler, SLJIT_ASHR | op32, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, bits - 1);
+            sljit_emit_op2(compiler, SLJIT_LSHR | op32, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, bits - shift);
+            sljit_emit_op2(compiler, SLJIT_ADD | op32, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_R0, 0);
+
+            if (options & DivRemRemainder) {
+                sljit_emit_op2(compiler, SLJIT_AND | op32, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, static_cast<sljit_sw>(0 - absDivisor));
+                sljit_emit_op2(compiler, SLJIT_SUB | op32, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+            } else {
+                sljit_emit_op2(compiler, SLJIT_ASHR | op32, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, shift);
+
+                if (args[1].argw < 0) {
+                    sljit_emit_op2(compiler, SLJIT_SUB | op32, SLJIT_R1, 0, SLJIT_IMM, 0, SLJIT_R1, 0);
+                }
+            }
+
+            MOVE_FROM_REG(compiler, movOpcode, args[2].arg, args[2].argw, SLJIT_R1);
+            return true;
+        }
+
+        if (!(options & DivRem32)) {
+            return false;
+        }
+
+        // The quotient is (x * m) >> (31 + l) computed on 64 bit, where l is ceil(log2(|d|)),
+        // and one is added to the quotient when x is negative to round towards zero.
+        sljit_sw shift = static_cast<sljit_sw>(64 - clz(absDivisor));
+        sljit_uw multiplier = ((static_cast<sljit_uw>(1) << (31 + shift)) / absDivisor) + 1;
+
+        divisor = absDivisor;
+
+        sljit_emit_op1(compiler, SLJIT_MOV_S32, SLJIT_R0, 0, args[0].arg, args[0].argw);
+        sljit_emit_op2(compiler, SLJIT_MUL, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_IMM, static_cast<sljit_sw>(multiplier));
+        sljit_emit_op2(compiler, SLJIT_ASHR, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 31 + shift);
+        sljit_emit_op2u(compiler, SLJIT_ADD | SLJIT_SET_CARRY, SLJIT_R0, 0, SLJIT_R0, 0);
+        sljit_emit_op2(compiler, SLJIT_ADDC, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, 0);
+
+        if (!(options & DivRemRemainder) && args[1].argw < 0) {
+            sljit_emit_op2(compiler, SLJIT_SUB32, SLJIT_R1, 0, SLJIT_IMM, 0, SLJIT_R1, 0);
+        }
+    }
+
+    if (options & DivRemRemainder) {
+        sljit_emit_op2(compiler, SLJIT_MUL32, SLJIT_R1, 0, SLJIT_R1, 0, SLJIT_IMM, static_cast<sljit_sw>(divisor));
+        sljit_emit_op2(compiler, SLJIT_SUB32, SLJIT_R1, 0, SLJIT_R0, 0, SLJIT_R1, 0);
+    }
+
+    MOVE_FROM_REG(compiler, SLJIT_MOV32, args[2].arg, args[2].argw, SLJIT_R1);
+    return true;
+}
+
 static void emitDivRem(sljit_compiler* compiler, sljit_s32 opcode, JITArg* args, sljit_s32 options)
 {
     CompileContext* context = CompileContext::get(compiler);
@@ -31,8 +140,9 @@ static void emitDivRem(sljit_compiler* compiler, sljit_s32 opcode, JITArg* args,
         if (args[1].argw == 0) {
             context->appendTrapJump(ExecutionContext::DivideByZeroError, sljit_emit_jump(compiler, SLJIT_JUMP));
             return;
-        } else if (args[1].argw == -1 && opcode == SLJIT_DIVMOD_SW) {
-            sljit_emit_op1(compiler, movOpcode, args[2].arg, args[2].argw, SLJIT_IMM, 0);
+        }
+
+        if (emitDivRemByImmediate(compiler, args, options)) {
             return;
         }
     }
@@ -107,6 +217,17 @@ static void emitBinary(sljit_compiler* compiler, Instruction* instr)
 {
     Operand* operands = instr->operands();
     JITArg args[3] = { operands, operands + 1, operands + 2 };
+    uint64_t divisor;
+
+    if ((instr->info() & Instruction::kDestroysR0R1) && CompileContext::get(compiler)->compiler->constantDivisor(instr, divisor)) {
+        args[1].arg = SLJIT_IMM;
+
+        if (instr->info() & Instruction::kIs32Bit) {
+            args[1].argw = static_cast<sljit_s32>(divisor);
+        } else {
+            args[1].argw = static_cast<sljit_sw>(divisor);
+        }
+    }
 
     sljit_s32 opcode;
 
@@ -206,6 +327,26 @@ static void emitBinary(sljit_compiler* compiler, Instruction* instr)
         break;
     }
 
+    if (opcode == SLJIT_MUL32 || opcode == SLJIT_MUL) {
+        if (SLJIT_IS_IMM(args[0].arg)) {
+            std::swap(args[0], args[1]);
+        }
+
+        if (SLJIT_IS_IMM(args[1].arg)) {
+            sljit_uw value = static_cast<sljit_uw>(args[1].argw);
+
+            if (opcode == SLJIT_MUL32) {
+                value = static_cast<sljit_u32>(value);
+            }
+
+            // Multiplying by a power of two is a shift.
+            if (value != 0 && (value & (value - 1)) == 0) {
+                opcode = (opcode == SLJIT_MUL32) ? SLJIT_SHL32 : SLJIT_SHL;
+                args[1].argw = ctz(value);
+            }
+        }
+    }
+
     sljit_emit_op2(compiler, opcode, args[2].arg, args[2].argw, args[0].arg, args[0].argw, args[1].arg, args[1].argw);
 }
 
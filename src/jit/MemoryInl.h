@@ -32,6 +32,8 @@ struct MemAddress {
         AbsoluteAddress = 1 << 6,
         NoOffset = 1 << 7,
         Memory64 = 1 << 8,
+        // The access is proven to be in bounds by the analysis.
+        InBounds = 1 << 9,
     };
 
     MemAddress(uint32_t options, uint8_t baseReg, uint8_t offsetReg, uint8_t sourceReg)
@@ -43,6 +45,9 @@ struct MemAddress {
     }
 
     void check(sljit_compiler* compiler, Operand* params, uint64_t offset64, sljit_u32 size, sljit_u16 memIndex);
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+    void checkGuarded(sljit_compiler* compiler, Operand* offsetOperand, uint64_t offset64, sljit_sw targetBufferOffset);
+#endif /* SLJIT_64BIT_ARCHITECTURE */
     void load(sljit_compiler* compiler);
 
     uint32_t options;
@@ -79,6 +84,12 @@ void MemAddress::check(sljit_compiler* compiler, Operand* offsetOperand, uint64_
     }
 
 #if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+    if ((context->compiler->options() & JITCompiler::kUseGuardPages) && !(options & (MemAddress::Memory64 | CheckNaturalAlignment))) {
+        // Out of bounds accesses fault on the guard pages of the memory.
+        checkGuarded(compiler, offsetOperand, offset64, targetBufferOffset);
+        return;
+    }
+
     JITArg offsetArg(offsetOperand);
 
     if ((options & MemAddress::Memory64) && SLJIT_IS_IMM(offsetArg.arg) && (~static_cast<uint64_t>(0) - offset64) < static_cast<uint64_t>(offsetArg.argw)) {
@@ -143,7 +154,7 @@ void MemAddress::check(sljit_compiler* compiler, Operand* offsetOperand, uint64_
             return;
         }
 
-        if (offset + size <= initialMemorySize) {
+        if (offset + size <= initialMemorySize || (options & InBounds)) {
             ASSERT(baseReg != 0);
             sljit_emit_op1(compiler, SLJIT_MOV_P, baseReg, 0, SLJIT_MEM1(kInstanceReg),
                            targetBufferOffset + offsetof(Memory::TargetBuffer, buffer));
@@ -192,6 +203,38 @@ void MemAddress::check(sljit_compiler* compiler, Operand* offsetOperand, uint64_
     }
 
     ASSERT(baseReg != 0 && offsetReg != 0);
+
+    if (options & InBounds) {
+        ASSERT(!(options & (MemAddress::Memory64 | CheckNaturalAlignment)));
+
+        sljit_emit_op1(compiler, SLJIT_MOV_U32, offsetReg, 0, offsetArg.arg, offsetArg.argw);
+        sljit_emit_op1(compiler, SLJIT_MOV_P, baseReg, 0, SLJIT_MEM1(kInstanceReg),
+                       targetBufferOffset + offsetof(Memory::TargetBuffer, buffer));
+        load(compiler);
+
+        uint32_t checkedOptions = AbsoluteAddress;
+#if (defined SLJIT_32BIT_ARCHITECTURE && SLJIT_32BIT_ARCHITECTURE)
+        checkedOptions |= DontUseOffsetReg;
+#endif /* SLJIT_32BIT_ARCHITECTURE */
+
+        if (offset == 0 && !(options & checkedOptions)) {
+            memArg.arg = SLJIT_MEM2(baseReg, offsetReg);
+            memArg.argw = 0;
+            return;
+        }
+
+        sljit_emit_op2(compiler, SLJIT_ADD, baseReg, 0, baseReg, 0, offsetReg, 0);
+
+        memArg.arg = SLJIT_MEM1(baseReg);
+        memArg.argw = static_cast<sljit_sw>(offset);
+
+        if ((options & AbsoluteAddress) && offset != 0) {
+            sljit_emit_op2(compiler, SLJIT_ADD, baseReg, 0, baseReg, 0, SLJIT_IMM, static_cast<sljit_sw>(offset));
+            memArg.argw = 0;
+        }
+        return;
+    }
+
 #if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
     sljit_emit_op1(compiler, (options & MemAddress::Memory64) ? SLJIT_MOV : SLJIT_MOV_U32, offsetReg, 0, offsetArg.arg, offsetArg.argw);
 #else /* !SLJIT_64BIT_ARCHITECTURE */
@@ -268,6 +311,50 @@ void MemAddress::check(sljit_compiler* compiler, Operand* offsetOperand, uint64_
     }
 }
 
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+
+void MemAddress::checkGuarded(sljit_compiler* compiler, Operand* offsetOperand, uint64_t offset64, sljit_sw targetBufferOffset)
+{
+    CompileContext* context = CompileContext::get(compiler);
+    JITArg offsetArg(offsetOperand);
+    sljit_sw offset = static_cast<sljit_sw>(offset64);
+
+    ASSERT(baseReg != 0);
+    context->hasGuardedMemoryAccess = true;
+
+    if (SLJIT_IS_IMM(offsetArg.arg)) {
+        offset += static_cast<sljit_sw>(static_cast<sljit_u32>(offsetArg.argw));
+
+        sljit_emit_op1(compiler, SLJIT_MOV_P, baseReg, 0, SLJIT_MEM1(kInstanceReg),
+                       targetBufferOffset + offsetof(Memory::TargetBuffer, buffer));
+        load(compiler);
+    } else {
+        ASSERT(offsetReg != 0);
+        sljit_emit_op1(compiler, SLJIT_MOV_U32, offsetReg, 0, offsetArg.arg, offsetArg.argw);
+        sljit_emit_op1(compiler, SLJIT_MOV_P, baseReg, 0, SLJIT_MEM1(kInstanceReg),
+                       targetBufferOffset + offsetof(Memory::TargetBuffer, buffer));
+        load(compiler);
+
+        if (offset == 0 && !(options & AbsoluteAddress)) {
+            memArg.arg = SLJIT_MEM2(baseReg, offsetReg);
+            memArg.argw = 0;
+            return;
+        }
+
+        sljit_emit_op2(compiler, SLJIT_ADD, baseReg, 0, baseReg, 0, offsetReg, 0);
+    }
+
+    memArg.arg = SLJIT_MEM1(baseReg);
+    memArg.argw = offset;
+
+    if ((options & AbsoluteAddress) && offset != 0) {
+        sljit_emit_op2(compiler, SLJIT_ADD, baseReg, 0, baseReg, 0, SLJIT_IMM, offset);
+        memArg.argw = 0;
+    }
+}
+
+#endif /* SLJIT_64BIT_ARCHITECTURE */
+
 void MemAddress::load(sljit_compiler* compiler)
 {
     if (options & LoadInteger) {
@@ -721,10 +808,14 @@ static void emitLoad(sljit_compiler* compiler, Instruction* instr)
     }
 #endif /* HAS_SIMD */
 
+    if (instr->info() & Instruction::kIsInBounds) {
+        options |= MemAddress::InBounds;
+    }
+
     Operand* operands = instr->operands();
     MemAddress addr(options, instr->requiredReg(start + 0), instr->requiredReg(start + 1), 0);
 
-    addr.check(compiler, operands, offset, size, memIndex);
+    addr.check(compiler, operands, offset, CompileContext::get(compiler)->compiler->boundsCheckSize(instr, size), memIndex);
 
     if (addr.memArg.arg == 0) {
         return;
@@ -1169,6 +1260,10 @@ static void emitStore(sljit_compiler* compiler, Instruction* instr)
     }
 #endif /* HAS_SIMD */
 
+    if (instr->info() & Instruction::kIsInBounds) {
+        options |= MemAddress::InBounds;
+    }
+
     Operand* operands = instr->operands();
     MemAddress addr(options, instr->requiredReg(start), instr->requiredReg(start + 1), instr->requiredReg(start == 0 ? 2 : 0));
 #if (defined SLJIT_32BIT_ARCHITECTURE && SLJIT_32BIT_ARCHITECTURE)
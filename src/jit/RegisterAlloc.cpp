@@ -300,14 +300,24 @@ uint8_t RegisterSet::allocateRegister(VariableList::Variable* variable)
         i = 2;
     }
 
+    // The spilled variable has the lowest weight, or
+    // the longest range when the weights are equal.
+    uint32_t minSpillWeight = ~static_cast<uint32_t>(0);
+
     while (i < size) {
         if (m_registers[i].rangeEnd == kUnassignedReg) {
             break;
         }
 
-        if (m_registers[i].rangeEnd > maxRangeEnd) {
-            maxRangeEnd = m_registers[i].rangeEnd;
-            maxRangeIndex = i;
+        if (m_registers[i].rangeEnd != kReservedReg) {
+            ASSERT(m_registers[i].variable != nullptr);
+            uint32_t spillWeight = m_registers[i].variable->spillWeight;
+
+            if (spillWeight < minSpillWeight || (spillWeight == minSpillWeight && m_registers[i].rangeEnd > maxRangeEnd)) {
+                minSpillWeight = spillWeight;
+                maxRangeEnd = m_registers[i].rangeEnd;
+                maxRangeIndex = i;
+            }
         }
 
         i++;
@@ -316,7 +326,9 @@ uint8_t RegisterSet::allocateRegister(VariableList::Variable* variable)
     if (i == size) {
         ASSERT(maxRangeEnd != 0 || variable != nullptr);
 
-        if (variable != nullptr && variable->rangeEnd >= maxRangeEnd) {
+        if (variable != nullptr
+            && (variable->spillWeight < minSpillWeight
+                || (variable->spillWeight == minSpillWeight && variable->rangeEnd >= maxRangeEnd))) {
             return VariableList::kUnusedReg;
         }
 
@@ -637,6 +649,72 @@ bool RegisterFile::reuseResult(uint8_t type, VariableList::Variable** reusableRe
     return false;
 }
 
+static void markLoop(std::vector<int32_t>& depthChanges, Label* label, Instruction* instr)
+{
+    if (label->id() < instr->id()) {
+        depthChanges[label->id()]++;
+        depthChanges[instr->id() + 1]--;
+    }
+}
+
+// Loops are the instruction ranges between the labels and
+// their backward branches, and values used in deeply nested
+// loops are the most expensive to keep in memory.
+static void computeSpillWeights(InstructionListItem* first, InstructionListItem* last, VariableList* variableList)
+{
+    std::vector<int32_t> depthChanges(last->id() + 2, 0);
+
+    for (InstructionListItem* item = first; item != nullptr; item = item->next()) {
+        if (item->isLabel()) {
+            continue;
+        }
+
+        Instruction* instr = item->asInstruction();
+
+        if (instr->group() == Instruction::DirectBranch) {
+            markLoop(depthChanges, instr->asExtended()->value().targetLabel, instr);
+        } else if (instr->group() == Instruction::BrTable) {
+            Label** label = instr->asBrTable()->targetLabels();
+            Label** end = label + instr->asBrTable()->targetLabelCount();
+            std::set<Label*> loopLabels;
+
+            while (label < end) {
+                if (loopLabels.insert(*label).second) {
+                    markLoop(depthChanges, *label, instr);
+                }
+                label++;
+            }
+        }
+    }
+
+    const int32_t maxDepth = 4;
+    int32_t depth = 0;
+
+    for (InstructionListItem* item = first; item != nullptr; item = item->next()) {
+        depth += depthChanges[item->id()];
+        ASSERT(depth >= 0);
+
+        if (item->isLabel()) {
+            continue;
+        }
+
+        Instruction* instr = item->asInstruction();
+        Operand* operand = instr->operands();
+        Operand* end = operand + instr->paramCount() + instr->resultCount();
+        uint32_t weight = static_cast<uint32_t>(1) << (3 * std::min(depth, maxDepth));
+
+        while (operand < end) {
+            VariableList::Variable& variable = variableList->variables[*operand++];
+
+            if (variable.spillWeight <= std::numeric_limits<uint32_t>::max() - weight) {
+                variable.spillWeight += weight;
+            } else {
+                variable.spillWeight = std::numeric_limits<uint32_t>::max();
+            }
+        }
+    }
+}
+
 void JITCompiler::allocateRegisters()
 {
     if (m_variableList == nullptr) {
@@ -658,6 +736,8 @@ void JITCompiler::allocateRegisters()
 
     RegisterFile regs(numberOfscratchRegs, numberOfsavedRegs);
 
+    computeSpillWeights(m_first, m_last, m_variableList);
+
     size_t variableListParamCount = m_variableList->paramCount;
     for (size_t i = 0; i < variableListParamCount; i++) {
         VariableList::Variable* variable = m_variableList->variables.data() + i;
@@ -957,6 +1037,25 @@ void JITCompiler::allocateRegisters()
     m_savedVectorRegCount = regs.vectorSet().getSavedRegCount();
 #endif /* SLJIT_SEPARATE_VECTOR_REGISTERS */
 
+    if (m_JITFlags & JITFlagValue::JITVerbose) {
+        size_t registerCount = 0;
+        size_t spillCount = 0;
+
+        for (auto& it : m_variableList->variables) {
+            if ((it.info & (VariableList::kIsMerged | VariableList::kIsImmediate)) || it.u.rangeStart >= it.rangeEnd) {
+                continue;
+            }
+
+            if (it.reg1 != VariableList::kUnusedReg) {
+                registerCount++;
+            } else {
+                spillCount++;
+            }
+        }
+
+        printf("Register allocation: %d variables in registers, %d spilled\n", static_cast<int>(registerCount), static_cast<int>(spillCount));
+    }
+
     // Insert stack inits before the offsets are destroyed.
     insertStackInitList(nullptr, 0, variableListParamCount);
 
@@ -189,6 +189,28 @@ static void emitElemDrop(sljit_compiler* compiler, Instruction* instr)
     sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS2V(32, W), SLJIT_IMM, GET_FUNC_ADDR(sljit_sw, dropElement));
 }
 
+// The elementReg holds the address of the updated element, and it is
+// overwritten. Tables without type ids are left unchanged.
+static void emitUpdateTypeId(sljit_compiler* compiler, sljit_s32 elementReg, JITArg& value, sljit_sw tableOffset)
+{
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, SLJIT_MEM1(kInstanceReg), tableOffset);
+    sljit_emit_op2(compiler, SLJIT_SUB, elementReg, 0, elementReg, 0, SLJIT_MEM1(SLJIT_TMP_DEST_REG), JITFieldAccessor::tableElements());
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, SLJIT_MEM1(SLJIT_TMP_DEST_REG), JITFieldAccessor::tableTypeIds());
+    sljit_jump* noTypeIds = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_TMP_DEST_REG, 0, SLJIT_IMM, 0);
+
+    sljit_emit_op2(compiler, SLJIT_ADD, elementReg, 0, elementReg, 0, SLJIT_TMP_DEST_REG, 0);
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, value.arg, value.argw);
+
+    // The type id of a null element is nullptr.
+    static_assert(Value::NullBits == 0, "Null references must be zero");
+    sljit_jump* isNull = sljit_emit_cmp(compiler, SLJIT_EQUAL, SLJIT_TMP_DEST_REG, 0, SLJIT_IMM, 0);
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, SLJIT_MEM1(SLJIT_TMP_DEST_REG), JITFieldAccessor::functionType());
+    sljit_set_label(isNull, sljit_emit_label(compiler));
+
+    sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_MEM1(elementReg), 0, SLJIT_TMP_DEST_REG, 0);
+    sljit_set_label(noTypeIds, sljit_emit_label(compiler));
+}
+
 static void emitTable(sljit_compiler* compiler, Instruction* instr)
 {
     sljit_sw addr;
@@ -529,6 +551,7 @@ static void emitTable(sljit_compiler* compiler, Instruction* instr)
         sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, SLJIT_MEM1(SLJIT_TMP_DEST_REG), JITFieldAccessor::tableElements());
         sljit_emit_op2_shift(compiler, SLJIT_ADD | SLJIT_SHL_IMM, destinationReg, 0, SLJIT_TMP_DEST_REG, 0, destinationReg, 0, SLJIT_WORD_SHIFT);
         sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_MEM1(destinationReg), 0, src[1].arg, src[1].argw);
+        emitUpdateTypeId(compiler, destinationReg, src[1], context->tableStart + ((reinterpret_cast<TableSet*>(instr->byteCode()))->tableIndex() * sizeof(void*)));
         break;
     }
     case ByteCode::TableSetM64Opcode: {
@@ -569,6 +592,7 @@ static void emitTable(sljit_compiler* compiler, Instruction* instr)
         sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_TMP_DEST_REG, 0, SLJIT_MEM1(SLJIT_TMP_DEST_REG), JITFieldAccessor::tableElements());
         sljit_emit_op2_shift(compiler, SLJIT_ADD | SLJIT_SHL_IMM, destinationReg, 0, SLJIT_TMP_DEST_REG, 0, destinationReg, 0, SLJIT_WORD_SHIFT);
         sljit_emit_op1(compiler, SLJIT_MOV_P, SLJIT_MEM1(destinationReg), 0, src.arg, src.argw);
+        emitUpdateTypeId(compiler, destinationReg, src, context->tableStart + ((reinterpret_cast<TableSet*>(instr->byteCode()))->tableIndex() * sizeof(void*)));
         break;
     }
     case ByteCode::TableGetOpcode: {
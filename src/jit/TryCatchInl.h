@@ -72,6 +72,12 @@ InstanceConstData::InstanceConstData(std::vector<TrapBlock>& trapBlocks, std::ve
 
 void InstanceConstData::append(std::vector<TrapBlock>& trapBlocks, std::vector<Walrus::TryBlock>& tryBlocks)
 {
+    if (trapBlocks.empty()) {
+        // No function of the code block can trap.
+        ASSERT(tryBlocks.empty());
+        return;
+    }
+
     sljit_uw itemCount = trapListCountItems(trapBlocks);
     sljit_uw endAddress = sljit_get_label_addr(trapBlocks[0].endLabel);
     sljit_uw pos = 0;
@@ -224,8 +230,13 @@ static void emitCatch(sljit_compiler* compiler, CompileContext* context)
 
     tryBlock.throwJumps.clear();
 
+    if (context->compiler->directCallFrameSize() > 0) {
+        // Directly called functions return here with the frame register unrestored.
+        sljit_emit_op1(compiler, SLJIT_MOV, kFrameReg, 0, SLJIT_MEM1(SLJIT_SP), context->savedFrameOffset);
+    }
+
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_MEM1(SLJIT_SP), kContextOffset);
-    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, static_cast<sljit_sw>(context->compiler->tryBlockOffset() + context->currentTryBlock));
+    sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, SLJIT_MEM0(), context->compiler->tryBlockOffsetAddress(), SLJIT_IMM, static_cast<sljit_sw>(context->currentTryBlock));
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, kFrameReg, 0);
     sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3(W, W, W, W), SLJIT_IMM, GET_FUNC_ADDR(sljit_sw, findCatch));
     sljit_emit_ijump(compiler, SLJIT_JUMP, SLJIT_R0, 0);
@@ -18,6 +18,7 @@
 #include "parser/WASMParser.h"
 #include "interpreter/ByteCode.h"
 #include "runtime/GCArray.h"
+#include "runtime/Engine.h"
 #include "runtime/Module.h"
 #include "runtime/Store.h"
 #include "runtime/TypeStore.h"
@@ -25,6 +26,250 @@
 #include "wabt/binary-reader.h"
 #include "wabt/walrus/binary-reader-walrus.h"
 
+#include <inttypes.h>
+#include <thread>
+#include <unordered_map>
+
+#if defined(OS_POSIX)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Identifies the build which created a serialized module. It is set
+// by the build system from the source revision and the configuration.
+#ifndef WALRUS_BUILD_ID
+#define WALRUS_BUILD_ID "unknown"
+#endif
+
+namespace Walrus {
+
+static const uint64_t s_fnvOffsetBasis = 14695981039346656037ull;
+
+// FNV-1a hash.
+static uint64_t hashBytes(const uint8_t* data, size_t len, uint64_t hash = s_fnvOffsetBasis)
+{
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t buildId()
+{
+    static const char id[] = WALRUS_BUILD_ID;
+    return hashBytes(reinterpret_cast<const uint8_t*>(id), sizeof(id) - 1);
+}
+
+// Serialized modules start with this header, followed by the
+// wasm binary and the functions defined by the binary.
+struct SerializedModuleHeader {
+    static const uint32_t s_magic = 0x4d535257; // WRSM
+    static const uint32_t s_version = 2;
+
+    uint32_t m_magic;
+    uint32_t m_version;
+    // The layout of the byte code depends on the build.
+    uint32_t m_opcodeCount;
+    uint32_t m_pointerSize;
+    uint64_t m_buildId;
+    uint32_t m_featureFlags;
+    uint64_t m_binaryLength;
+    // Hash of the data after the header.
+    uint64_t m_checksum;
+};
+
+class SerializedModuleReader {
+public:
+    SerializedModuleReader(const uint8_t* data, size_t len)
+        : m_data(data)
+        , m_end(data + len)
+        , m_hasError(false)
+    {
+    }
+
+    bool hasError() const { return m_hasError; }
+    size_t remaining() const { return static_cast<size_t>(m_end - m_data); }
+
+    bool canRead(uint64_t length)
+    {
+        if (m_hasError || length > static_cast<uint64_t>(m_end - m_data)) {
+            m_hasError = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* readBytes(uint64_t length)
+    {
+        if (!canRead(length)) {
+            return nullptr;
+        }
+
+        // Byte sequences are padded to 8 bytes.
+        length = (length + 7) & ~static_cast<uint64_t>(7);
+
+        if (!canRead(length)) {
+            return nullptr;
+        }
+
+        const uint8_t* result = m_data;
+        m_data += length;
+        return result;
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value = 0;
+        if (canRead(sizeof(T))) {
+            memcpy(&value, m_data, sizeof(T));
+            m_data += sizeof(T);
+        }
+        return value;
+    }
+
+private:
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    bool m_hasError;
+};
+
+class SerializedModuleWriter {
+public:
+    SerializedModuleWriter(std::vector<uint8_t>& out)
+        : m_out(out)
+    {
+    }
+
+    void writeBytes(const void* data, size_t length)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        m_out.insert(m_out.end(), bytes, bytes + length);
+        m_out.resize(m_out.size() + ((8 - (length & 7)) & 7), 0);
+    }
+
+    template <typename T>
+    void write(T value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        m_out.insert(m_out.end(), bytes, bytes + sizeof(T));
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+// Byte codes which refer to the types of the module.
+static bool hasTypeInfo(ByteCode::Opcode opcode)
+{
+    switch (opcode) {
+    case ByteCode::CallIndirectOpcode:
+    case ByteCode::CallIndirectM64Opcode:
+    case ByteCode::ReturnCallIndirectOpcode:
+    case ByteCode::ReturnCallIndirectM64Opcode:
+    case ByteCode::CallRefOpcode:
+    case ByteCode::ReturnCallRefOpcode:
+    case ByteCode::JumpIfCastDefinedOpcode:
+    case ByteCode::RefCastDefinedOpcode:
+    case ByteCode::RefTestDefinedOpcode:
+    case ByteCode::ArrayNewOpcode:
+    case ByteCode::ArrayNewDefaultOpcode:
+    case ByteCode::ArrayNewFixedOpcode:
+    case ByteCode::ArrayNewDataOpcode:
+    case ByteCode::ArrayNewElemOpcode:
+    case ByteCode::StructNewOpcode:
+    case ByteCode::StructNewDefaultOpcode:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Casts refer to the sub type list of the type.
+static const void* typeInfo(ByteCode* code)
+{
+    switch (code->opcode()) {
+    case ByteCode::CallIndirectOpcode:
+    case ByteCode::CallIndirectM64Opcode:
+    case ByteCode::ReturnCallIndirectOpcode:
+    case ByteCode::ReturnCallIndirectM64Opcode:
+        return reinterpret_cast<CallTable*>(code)->functionType();
+    case ByteCode::CallRefOpcode:
+        return reinterpret_cast<CallRef*>(code)->functionType();
+    case ByteCode::ReturnCallRefOpcode:
+        return reinterpret_cast<ReturnCallRef*>(code)->functionType();
+    case ByteCode::JumpIfCastDefinedOpcode:
+        return reinterpret_cast<JumpIfCastDefined*>(code)->typeInfo();
+    case ByteCode::RefCastDefinedOpcode:
+        return reinterpret_cast<RefCastDefined*>(code)->typeInfo();
+    case ByteCode::RefTestDefinedOpcode:
+        return reinterpret_cast<RefTestDefined*>(code)->typeInfo();
+    case ByteCode::ArrayNewOpcode:
+        return reinterpret_cast<ArrayNew*>(code)->typeInfo();
+    case ByteCode::ArrayNewDefaultOpcode:
+        return reinterpret_cast<ArrayNewDefault*>(code)->typeInfo();
+    case ByteCode::ArrayNewFixedOpcode:
+        return reinterpret_cast<ArrayNewFixed*>(code)->typeInfo();
+    case ByteCode::ArrayNewDataOpcode:
+    case ByteCode::ArrayNewElemOpcode:
+        return reinterpret_cast<ArrayNewFrom*>(code)->typeInfo();
+    case ByteCode::StructNewOpcode:
+        return reinterpret_cast<StructNew*>(code)->typeInfo();
+    default:
+        ASSERT(code->opcode() == ByteCode::StructNewDefaultOpcode);
+        return reinterpret_cast<StructNewDefault*>(code)->typeInfo();
+    }
+}
+
+static void setTypeInfo(ByteCode* code, ByteCode::Opcode opcode, CompositeType* type)
+{
+    switch (opcode) {
+    case ByteCode::CallIndirectOpcode:
+    case ByteCode::CallIndirectM64Opcode:
+    case ByteCode::ReturnCallIndirectOpcode:
+    case ByteCode::ReturnCallIndirectM64Opcode:
+        reinterpret_cast<CallTable*>(code)->setFunctionType(type->asFunction());
+        break;
+    case ByteCode::CallRefOpcode:
+        reinterpret_cast<CallRef*>(code)->setFunctionType(type->asFunction());
+        break;
+    case ByteCode::ReturnCallRefOpcode:
+        reinterpret_cast<ReturnCallRef*>(code)->setFunctionType(type->asFunction());
+        break;
+    case ByteCode::JumpIfCastDefinedOpcode:
+        reinterpret_cast<JumpIfCastDefined*>(code)->setTypeInfo(type->subTypeList());
+        break;
+    case ByteCode::RefCastDefinedOpcode:
+        reinterpret_cast<RefCastDefined*>(code)->setTypeInfo(type->subTypeList());
+        break;
+    case ByteCode::RefTestDefinedOpcode:
+        reinterpret_cast<RefTestDefined*>(code)->setTypeInfo(type->subTypeList());
+        break;
+    case ByteCode::ArrayNewOpcode:
+        reinterpret_cast<ArrayNew*>(code)->setTypeInfo(type->asArray());
+        break;
+    case ByteCode::ArrayNewDefaultOpcode:
+        reinterpret_cast<ArrayNewDefault*>(code)->setTypeInfo(type->asArray());
+        break;
+    case ByteCode::ArrayNewFixedOpcode:
+        reinterpret_cast<ArrayNewFixed*>(code)->setTypeInfo(type->asArray());
+        break;
+    case ByteCode::ArrayNewDataOpcode:
+    case ByteCode::ArrayNewElemOpcode:
+        reinterpret_cast<ArrayNewFrom*>(code)->setTypeInfo(type->asArray());
+        break;
+    case ByteCode::StructNewOpcode:
+        reinterpret_cast<StructNew*>(code)->setTypeInfo(type->asStruct());
+        break;
+    default:
+        ASSERT(opcode == ByteCode::StructNewDefaultOpcode);
+        reinterpret_cast<StructNewDefault*>(code)->setTypeInfo(type->asStruct());
+        break;
+    }
+}
+
+} // namespace Walrus
+
 namespace wabt {
 
 #define PARSER_RESOURCE_LIMIT (uint16_t)16384
@@ -676,6 +921,13 @@ private:
     size_t m_lastI32EqzPos;
     bool m_useJIT;
 
+    // Function bodies are read from a serialized module.
+    Walrus::SerializedModuleReader* m_serializedModule;
+    // Function bodies are only validated, their byte code is generated later.
+    Walrus::LazyByteCodeGenerator* m_lazyGenerator;
+    // The binary is appended while it is parsed.
+    Walrus::WASMStreamingParser* m_stream;
+
     Walrus::FunctionType* getFunctionType(Index index)
     {
         return m_result.m_compositeTypes[index]->asFunction();
@@ -793,6 +1045,7 @@ private:
         // Copy the final byte code.
         m_currentFunction->m_byteCode.reserve(m_currentByteCode.size());
         memcpy(m_currentFunction->m_byteCode.data(), m_currentByteCode.data(), m_currentByteCode.size());
+        m_currentFunction->buildCatchRanges();
         m_currentFunction = nullptr;
         m_currentFunctionType = nullptr;
         m_currentByteCode.clear();
@@ -887,7 +1140,8 @@ private:
     }
 
 public:
-    WASMBinaryReader(Walrus::TypeStore& typeStore, bool useJIT = false)
+    WASMBinaryReader(Walrus::TypeStore& typeStore, bool useJIT = false, Walrus::SerializedModuleReader* serializedModule = nullptr,
+                     Walrus::LazyByteCodeGenerator* lazyGenerator = nullptr)
         : m_readerOffsetPointer(nullptr)
         , m_readerDataPointer(nullptr)
         , m_codeEndOffset(0)
@@ -904,7 +1158,13 @@ public:
         , m_preprocessData(*this)
         , m_lastI32EqzPos(s_noI32Eqz)
         , m_useJIT(useJIT)
+        , m_serializedModule(serializedModule)
+        , m_lazyGenerator(lazyGenerator)
+        , m_stream(nullptr)
     {
+        m_skipFunctionBodies = serializedModule != nullptr;
+        m_validateFunctionBodiesOnly = lazyGenerator != nullptr;
+        m_result.m_lazyByteCodeGenerator = lazyGenerator;
     }
 
     ~WASMBinaryReader()
@@ -925,7 +1185,12 @@ public:
         m_result.m_version = version;
     }
 
-    virtual void EndModule() override {}
+    virtual void EndModule() override
+    {
+        if (m_lazyGenerator != nullptr) {
+            m_lazyGenerator->setParsingResult(m_result, m_readerDataPointer);
+        }
+    }
 
     virtual void OnFeatureCount(Index count) override {}
 
@@ -1359,8 +1624,101 @@ public:
         m_result.m_start = funcIndex;
     }
 
+    void readSerializedFunction(Walrus::ModuleFunction* function, Index index)
+    {
+        Walrus::SerializedModuleReader& reader = *m_serializedModule;
+
+        if (reader.read<uint32_t>() != index) {
+            m_walrusParseError = std::string("invalid serialized module");
+            return;
+        }
+
+        function->m_hasTryCatch = reader.read<uint32_t>() != 0;
+        function->m_requiredStackSize = static_cast<uint16_t>(reader.read<uint32_t>());
+
+        uint32_t localCount = reader.read<uint32_t>();
+        if (reader.canRead(static_cast<uint64_t>(localCount) * sizeof(uint32_t))) {
+            function->m_local.reserve(localCount);
+            for (uint32_t i = 0; i < localCount; i++) {
+                function->m_local.push_back(static_cast<Walrus::Value::Type>(reader.read<uint32_t>()));
+            }
+        }
+
+        uint32_t catchInfoCount = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < catchInfoCount && !reader.hasError(); i++) {
+            Walrus::ModuleFunction::CatchInfo info;
+            info.m_tryStart = reader.read<uint64_t>();
+            info.m_tryEnd = reader.read<uint64_t>();
+            info.m_catchStartPosition = reader.read<uint64_t>();
+            info.m_stackSizeToBe = reader.read<uint64_t>();
+            info.m_tagIndex = reader.read<uint32_t>();
+            info.m_pushExnRef = reader.read<uint32_t>() != 0;
+            function->m_catchInfo.push_back(info);
+        }
+        function->buildCatchRanges();
+
+        uint64_t byteCodeSize = reader.read<uint64_t>();
+        const uint8_t* byteCode = reader.readBytes(byteCodeSize);
+        uint64_t codeCount = reader.read<uint64_t>();
+
+        if (reader.hasError()) {
+            m_walrusParseError = std::string("invalid serialized module");
+            return;
+        }
+
+        function->m_byteCode.reserve(byteCodeSize);
+        memcpy(function->m_byteCode.data(), byteCode, byteCodeSize);
+
+        // Restore the opcode addresses and the type pointers.
+        size_t position = 0;
+        for (uint64_t i = 0; i < codeCount; i++) {
+            Walrus::ByteCode::Opcode opcode = static_cast<Walrus::ByteCode::Opcode>(reader.read<uint32_t>());
+            uint32_t size = reader.read<uint32_t>();
+
+            if (opcode >= Walrus::ByteCode::OpcodeKindEnd || size < sizeof(Walrus::ByteCode) || size > byteCodeSize - position) {
+                m_walrusParseError = std::string("invalid serialized module");
+                return;
+            }
+
+            Walrus::ByteCode* code = function->getByteCode<Walrus::ByteCode>(position);
+            code->setOpcode(m_useJIT ? Walrus::ByteCode::baseOpcode(opcode) : opcode);
+
+            if (Walrus::hasTypeInfo(opcode)) {
+                uint32_t typeIndex = reader.read<uint32_t>();
+
+                if (typeIndex >= m_result.m_compositeTypes.size()) {
+                    m_walrusParseError = std::string("invalid serialized module");
+                    return;
+                }
+
+                Walrus::setTypeInfo(code, opcode, m_result.m_compositeTypes[typeIndex]);
+            }
+
+            if (code->getSize() != size) {
+                m_walrusParseError = std::string("invalid serialized module");
+                return;
+            }
+
+            position += size;
+        }
+
+        if (reader.hasError() || position != byteCodeSize) {
+            m_walrusParseError = std::string("invalid serialized module");
+        }
+    }
+
     virtual void BeginFunctionBody(Index index, Offset size) override
     {
+        if (m_serializedModule != nullptr) {
+            readSerializedFunction(m_result.m_functions[index], index);
+            return;
+        }
+
+        if (m_lazyGenerator != nullptr) {
+            m_lazyGenerator->addFunctionBody(m_result.m_functions[index], index, *m_readerOffsetPointer, size);
+            return;
+        }
+
         ASSERT(resumeGenerateByteCodeAfterNBlockEnd() == 0);
         ASSERT(m_currentFunction == nullptr);
         beginFunction(m_result.m_functions[index], false);
@@ -1417,7 +1775,8 @@ public:
     virtual void OnEndPreprocess() override
     {
         m_preprocessData.m_inPreprocess = false;
-        m_skipValidationUntil = *m_readerOffsetPointer - 1;
+        // Lazily generated function bodies are never validated again.
+        m_skipValidationUntil = std::max(m_skipValidationUntil, *m_readerOffsetPointer - 1);
         m_shouldContinueToGenerateByteCode = true;
         m_recursiveTypeStart = 0;
         m_recursiveTypeEnd = 0;
@@ -3586,6 +3945,10 @@ public:
 
     virtual void EndFunctionBody(Index index) override
     {
+        if (m_serializedModule != nullptr || m_lazyGenerator != nullptr) {
+            return;
+        }
+
         // FIXME too many stack usage. we could not support this(yet)
         if (m_initialFunctionStackSize > std::numeric_limits<Walrus::ByteCodeStackOffset>::max()) {
             m_walrusParseError = std::string("Function stack usage is larger then supported maxium (65535 bytes).");
@@ -3593,6 +3956,12 @@ public:
         }
 
         m_lastI32EqzPos = s_noI32Eqz;
+#if !defined(WALRUS_PROFILE_BYTECODE_PAIRS)
+        // The JIT compiler does not support superinstructions.
+        if (!m_useJIT) {
+            generateSuperInstructions();
+        }
+#endif
 #if !defined(NDEBUG)
         if (getenv("DUMP_BYTECODE") && strlen(getenv("DUMP_BYTECODE"))) {
             m_currentFunction->dumpByteCode(m_currentByteCode);
@@ -3840,6 +4209,53 @@ public:
         pushByteCode(Walrus::I8X16Shuffle(src0, src1, dst, value), WASMOpcode::I8X16ShuffleOpcode);
     }
 
+    static Walrus::ByteCode::Opcode superInstructionOpcode(Walrus::ByteCode* first, Walrus::ByteCode* second)
+    {
+        Walrus::ByteCode::Opcode firstOpcode = first->opcode();
+        Walrus::ByteCode::Opcode secondOpcode = second->opcode();
+
+#define COMPARE_JUMP_OPCODE(name, base, op, paramType, jumpType)                                                              \
+    if (firstOpcode == Walrus::ByteCode::base##Opcode && secondOpcode == Walrus::ByteCode::jumpType##Opcode                   \
+        && reinterpret_cast<Walrus::base*>(first)->dstOffset() == reinterpret_cast<Walrus::jumpType*>(second)->srcOffset()) { \
+        return Walrus::ByteCode::name##Opcode;                                                                                \
+    }
+        FOR_EACH_BYTECODE_COMPARE_JUMP_OP(COMPARE_JUMP_OPCODE)
+#undef COMPARE_JUMP_OPCODE
+
+#define LOAD_BINARY_OPCODE(name, load, loadType, binary, op, paramType)                                                  \
+    if (firstOpcode == Walrus::ByteCode::load##Opcode && secondOpcode == Walrus::ByteCode::binary##Opcode) {             \
+        Walrus::ByteCodeStackOffset dstOffset = reinterpret_cast<Walrus::load*>(first)->dstOffset();                     \
+        const Walrus::ByteCodeStackOffset* srcOffset = reinterpret_cast<Walrus::binary*>(second)->srcOffset();           \
+        if (dstOffset == srcOffset[0] || dstOffset == srcOffset[1]) {                                                    \
+            return Walrus::ByteCode::name##Opcode;                                                                       \
+        }                                                                                                                \
+    }
+        FOR_EACH_BYTECODE_LOAD_BINARY_OP(LOAD_BINARY_OPCODE)
+#undef LOAD_BINARY_OPCODE
+
+        return Walrus::ByteCode::OpcodeKindEnd;
+    }
+
+    // Replaces the first byte code of the frequent pairs with a superinstruction.
+    void generateSuperInstructions()
+    {
+        size_t position = 0;
+        size_t end = m_currentByteCode.size();
+
+        while (position < end) {
+            Walrus::ByteCode* code = peekByteCode<Walrus::ByteCode>(position);
+            position += code->getSize();
+
+            if (position < end) {
+                Walrus::ByteCode::Opcode opcode = superInstructionOpcode(code, peekByteCode<Walrus::ByteCode>(position));
+
+                if (opcode != Walrus::ByteCode::OpcodeKindEnd) {
+                    code->setOpcode(opcode);
+                }
+            }
+        }
+    }
+
     void generateBinaryCode(WASMOpcode code, size_t src0, size_t src1, size_t dst)
     {
         switch (code) {
@@ -4018,6 +4434,25 @@ public:
     }
 
     Walrus::WASMParsingResult& parsingResult() { return m_result; }
+
+    // The function bodies are validated when the module is parsed.
+    void skipValidation()
+    {
+        m_skipValidationUntil = std::numeric_limits<size_t>::max();
+    }
+
+    void setStream(Walrus::WASMStreamingParser* stream)
+    {
+        m_stream = stream;
+        m_isStreaming = stream != nullptr;
+    }
+
+    virtual bool waitForData(size_t end, const uint8_t** data) override
+    {
+        bool result = m_stream->waitForData(end, data);
+        m_readerDataPointer = *data;
+        return result;
+    }
 };
 
 } // namespace wabt
@@ -4029,11 +4464,16 @@ WASMParsingResult::WASMParsingResult()
     , m_typesAddedToStore(false)
     , m_version(0)
     , m_start(0)
+    , m_lazyByteCodeGenerator(nullptr)
 {
 }
 
 void WASMParsingResult::clear()
 {
+    if (m_lazyByteCodeGenerator != nullptr) {
+        delete m_lazyByteCodeGenerator;
+    }
+
     for (size_t i = 0; i < m_imports.size(); i++) {
         delete m_imports[i];
     }
@@ -4077,9 +4517,238 @@ void WASMParsingResult::clear()
     }
 }
 
-std::pair<Optional<Module*>, std::string> WASMParser::parseBinary(Store* store, const std::string& filename, const uint8_t* data, size_t len, const uint32_t JITFlags, const uint32_t featureFlags)
+LazyByteCodeGenerator::LazyByteCodeGenerator(uint32_t featureFlags, uint32_t JITFlags)
+    : m_code(nullptr)
+    , m_codeSize(0)
+    , m_codeOffset(0)
+    , m_featureFlags(featureFlags)
+    , m_JITFlags(JITFlags)
+    , m_dataCount(0)
 {
-    wabt::WASMBinaryReader delegate(store->getTypeStore(), JITFlags & JITFlagValue::useJIT);
+}
+
+void LazyByteCodeGenerator::addFunctionBody(ModuleFunction* function, uint32_t index, size_t offset, size_t size)
+{
+    // The function is published by the module.
+    function->m_hasByteCode.store(false, std::memory_order_relaxed);
+    function->m_lazyIndex = index;
+
+    if (m_bodies.size() <= index) {
+        m_bodies.resize(index + 1);
+    }
+    m_bodies[index] = { offset, size };
+}
+
+void LazyByteCodeGenerator::setParsingResult(WASMParsingResult& result, const uint8_t* binary)
+{
+    size_t start = std::numeric_limits<size_t>::max();
+    size_t end = 0;
+
+    for (auto& it : m_bodies) {
+        // Imported functions have no body.
+        if (it.m_size > 0) {
+            start = std::min(start, it.m_offset);
+            end = std::max(end, it.m_offset + it.m_size);
+        }
+    }
+
+    if (start < end) {
+        m_code = binary + start;
+        m_codeSize = end - start;
+        m_codeOffset = start;
+    }
+
+    if (m_JITFlags & JITFlagValue::lazyCompile) {
+        // The binary is not available after the module is
+        // parsed, so the range of the function bodies is copied.
+        m_ownedCode.assign(m_code, m_code + m_codeSize);
+        m_code = m_ownedCode.data();
+    }
+
+    m_dataCount = static_cast<uint32_t>(result.m_datas.size());
+    m_functions = result.m_functions;
+    m_compositeTypes = result.m_compositeTypes;
+    m_globalTypes = result.m_globalTypes;
+    m_tableTypes = result.m_tableTypes;
+    m_memoryTypes = result.m_memoryTypes;
+    m_tagTypes = result.m_tagTypes;
+}
+
+void LazyByteCodeGenerator::swapParsingResult(WASMParsingResult& result)
+{
+    std::swap(m_functions, result.m_functions);
+    std::swap(m_compositeTypes, result.m_compositeTypes);
+    std::swap(m_globalTypes, result.m_globalTypes);
+    std::swap(m_tableTypes, result.m_tableTypes);
+    std::swap(m_memoryTypes, result.m_memoryTypes);
+    std::swap(m_tagTypes, result.m_tagTypes);
+}
+
+std::string LazyByteCodeGenerator::generate(Module* module, ModuleFunction* function)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // Another thread might generate the byte code before the lock is acquired.
+    if (function->hasByteCode()) {
+        return std::string();
+    }
+
+    wabt::WASMBinaryReader delegate(module->store()->getTypeStore(), m_JITFlags & JITFlagValue::useJIT);
+    delegate.skipValidation();
+
+    // The items are moved back before the delegate frees them.
+    swapParsingResult(delegate.parsingResult());
+
+    function->m_local.clear();
+    std::string error = readFunctionBody(&delegate, function);
+
+    swapParsingResult(delegate.parsingResult());
+
+    if (delegate.WalrusParseError().length()) {
+        return delegate.WalrusParseError();
+    }
+
+    if (error.length()) {
+        return error;
+    }
+
+#if defined(WALRUS_ENABLE_JIT)
+    // With tiering, the functions are compiled when they become hot.
+    if ((m_JITFlags & (JITFlagValue::useJIT | JITFlagValue::useTiering)) == JITFlagValue::useJIT) {
+        module->jitCompile(&function, 1, m_JITFlags);
+    }
+#endif
+
+    function->m_hasByteCode.store(true, std::memory_order_release);
+    return std::string();
+}
+
+std::string LazyByteCodeGenerator::readFunctionBody(wabt::WASMBinaryReader* delegate, ModuleFunction* function)
+{
+    const FunctionBody& body = m_bodies[function->m_lazyIndex];
+    ASSERT(body.m_offset >= m_codeOffset);
+
+    return wabt::ReadWasmFunctionBody(m_code, m_codeSize, body.m_offset - m_codeOffset, body.m_size,
+                                      function->m_lazyIndex, m_dataCount, delegate, m_featureFlags);
+}
+
+void LazyByteCodeGenerator::generateFunctions(TypeStore* typeStore, ModuleFunction** functions, size_t count, std::string* error)
+{
+    wabt::WASMBinaryReader delegate(*typeStore, m_JITFlags & JITFlagValue::useJIT);
+    delegate.skipValidation();
+
+    // Each thread uses its own copy, which is
+    // cleared before the delegate frees the items.
+    WASMParsingResult& result = delegate.parsingResult();
+    result.m_functions = m_functions;
+    result.m_compositeTypes = m_compositeTypes;
+    result.m_globalTypes = m_globalTypes;
+    result.m_tableTypes = m_tableTypes;
+    result.m_memoryTypes = m_memoryTypes;
+    result.m_tagTypes = m_tagTypes;
+
+    for (size_t i = 0; i < count; i++) {
+        ModuleFunction* function = functions[i];
+
+        *error = readFunctionBody(&delegate, function);
+        if (delegate.WalrusParseError().length()) {
+            *error = delegate.WalrusParseError();
+        }
+
+        if (error->length()) {
+            break;
+        }
+
+        // The threads are joined before the functions are used.
+        function->m_hasByteCode.store(true, std::memory_order_relaxed);
+    }
+
+    result.m_functions.clear();
+    result.m_compositeTypes.clear();
+    result.m_globalTypes.clear();
+    result.m_tableTypes.clear();
+    result.m_memoryTypes.clear();
+    result.m_tagTypes.clear();
+}
+
+std::string LazyByteCodeGenerator::generateAll(TypeStore& typeStore, uint32_t threadCount)
+{
+    std::vector<ModuleFunction*> functionList;
+
+    for (size_t i = 0; i < m_functions.size(); i++) {
+        // Imported functions have no body.
+        if (!m_functions[i]->hasByteCode()) {
+            functionList.push_back(m_functions[i]);
+        }
+    }
+
+    if (functionList.size() < threadCount) {
+        threadCount = std::max(static_cast<uint32_t>(functionList.size()), 1u);
+    }
+
+    // Each thread generates the byte code of its own block. The blocks are
+    // balanced by assigning the largest remaining body to the smallest block.
+    std::sort(functionList.begin(), functionList.end(), [this](ModuleFunction* a, ModuleFunction* b) {
+        return m_bodies[a->m_lazyIndex].m_size > m_bodies[b->m_lazyIndex].m_size;
+    });
+
+    std::vector<std::vector<ModuleFunction*>> blocks(threadCount);
+    std::vector<size_t> blockSizes(threadCount, 0);
+
+    for (auto it : functionList) {
+        size_t smallest = std::min_element(blockSizes.begin(), blockSizes.end()) - blockSizes.begin();
+
+        blocks[smallest].push_back(it);
+        blockSizes[smallest] += m_bodies[it->m_lazyIndex].m_size;
+    }
+
+    std::vector<std::string> errors(threadCount);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.push_back(std::thread(&LazyByteCodeGenerator::generateFunctions, this, &typeStore, blocks[i].data(), blocks[i].size(), &errors[i]));
+    }
+
+    generateFunctions(&typeStore, blocks[0].data(), blocks[0].size(), &errors[0]);
+
+    for (auto& it : threads) {
+        it.join();
+    }
+
+    for (auto& it : errors) {
+        if (it.length()) {
+            // The remaining functions are generated in index order, so the
+            // same error is reported as by a single threaded parser.
+            functionList.clear();
+            for (size_t i = 0; i < m_functions.size(); i++) {
+                if (!m_functions[i]->hasByteCode()) {
+                    functionList.push_back(m_functions[i]);
+                }
+            }
+
+            std::string error;
+            generateFunctions(&typeStore, functionList.data(), functionList.size(), &error);
+            return error;
+        }
+    }
+
+    return std::string();
+}
+
+static std::pair<Optional<Module*>, std::string> parseBinaryInternal(Store* store, const std::string& filename, const uint8_t* data, size_t len,
+                                                                     const uint32_t JITFlags, const uint32_t featureFlags, SerializedModuleReader* serializedModule,
+                                                                     WASMStreamingParser* stream)
+{
+    bool lazyCompile = (JITFlags & JITFlagValue::lazyCompile) && serializedModule == nullptr;
+    // The byte code of the functions is generated by this many threads.
+    uint32_t threadCount = store->engine() ? store->engine()->parserThreadCount() : 1;
+    LazyByteCodeGenerator* lazyGenerator = nullptr;
+    if (lazyCompile || (threadCount > 1 && serializedModule == nullptr)) {
+        lazyGenerator = new LazyByteCodeGenerator(featureFlags, JITFlags);
+    }
+
+    wabt::WASMBinaryReader delegate(store->getTypeStore(), JITFlags & JITFlagValue::useJIT, serializedModule, lazyGenerator);
+    delegate.setStream(stream);
 
     std::string error = ReadWasmBinary(filename, data, len, &delegate, featureFlags);
 
@@ -4097,9 +4766,26 @@ std::pair<Optional<Module*>, std::string> WASMParser::parseBinary(Store* store,
         return std::make_pair(nullptr, error);
     }
 
+    if (lazyGenerator && !lazyCompile) {
+        error = lazyGenerator->generateAll(store->getTypeStore(), threadCount);
+
+        if (error.length()) {
+            if (delegate.parsingResult().m_typesAddedToStore) {
+                store->getTypeStore().releaseTypes(delegate.parsingResult().m_compositeTypes);
+            }
+            return std::make_pair(nullptr, error);
+        }
+
+        // All byte code is generated.
+        delete lazyGenerator;
+        delegate.parsingResult().m_lazyByteCodeGenerator = nullptr;
+    }
+
     Module* module = new Module(store, delegate.parsingResult());
 #if defined(WALRUS_ENABLE_JIT)
-    if (JITFlags & JITFlagValue::useJIT) {
+    if (JITFlags & JITFlagValue::useTiering) {
+        module->enableTierUp(JITFlags);
+    } else if ((JITFlags & JITFlagValue::useJIT) && !lazyCompile) {
         module->jitCompile(nullptr, 0, JITFlags);
     }
 #endif
@@ -4107,4 +4793,325 @@ std::pair<Optional<Module*>, std::string> WASMParser::parseBinary(Store* store,
     return std::make_pair(module, std::string());
 }
 
+std::pair<Optional<Module*>, std::string> WASMParser::parseBinary(Store* store, const std::string& filename, const uint8_t* data, size_t len, const uint32_t JITFlags, const uint32_t featureFlags)
+{
+    return parseBinaryInternal(store, filename, data, len, JITFlags, featureFlags, nullptr, nullptr);
+}
+
+const size_t WASMStreamingParser::s_initialBufferSize;
+
+WASMStreamingParser::WASMStreamingParser(Store* store, const std::string& filename, size_t size, const uint32_t JITFlags, const uint32_t featureFlags)
+    : m_store(store)
+    , m_filename(filename)
+    , m_JITFlags(JITFlags)
+    , m_featureFlags(featureFlags)
+    , m_size(size)
+    , m_buffer(new uint8_t[std::min(size, s_initialBufferSize)])
+    , m_capacity(std::min(size, s_initialBufferSize))
+    , m_available(0)
+    , m_finished(false)
+    , m_result(nullptr, std::string())
+{
+    m_thread = std::thread(&WASMStreamingParser::parse, this);
+}
+
+WASMStreamingParser::~WASMStreamingParser()
+{
+    if (m_thread.joinable()) {
+        finish();
+    }
+}
+
+bool WASMStreamingParser::append(const uint8_t* data, size_t len)
+{
+    if (m_finished || len > m_size - m_available) {
+        return false;
+    }
+
+    if (len > m_capacity - m_available) {
+        size_t capacity = std::min(std::max(m_capacity * 2, m_available + len), m_size);
+        std::unique_ptr<uint8_t[]> buffer(new uint8_t[capacity]);
+
+        // The available bytes are not modified anymore, so
+        // they can be copied while the parser reads them.
+        memcpy(buffer.get(), m_buffer.get(), m_available);
+        memcpy(buffer.get() + m_available, data, len);
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_retiredBuffers.push_back(std::move(m_buffer));
+        m_buffer = std::move(buffer);
+        m_capacity = capacity;
+        m_available += len;
+        m_condition.notify_one();
+        return true;
+    }
+
+    // The parser never reads the bytes after m_available.
+    memcpy(m_buffer.get() + m_available, data, len);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_available += len;
+    m_condition.notify_one();
+    return true;
+}
+
+std::pair<Optional<Module*>, std::string> WASMStreamingParser::finish()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_finished = true;
+        m_condition.notify_one();
+    }
+
+    m_thread.join();
+    return m_result;
+}
+
+void WASMStreamingParser::parse()
+{
+    const uint8_t* data;
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        data = m_buffer.get();
+    }
+
+    // The parser waits for the header first, which updates the address.
+    m_result = parseBinaryInternal(m_store, m_filename, data, m_size, m_JITFlags, m_featureFlags, nullptr, this);
+}
+
+bool WASMStreamingParser::waitForData(size_t end, const uint8_t** data)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_available < end && !m_finished) {
+        m_condition.wait(lock);
+    }
+
+    // The parser does not keep pointers into the binary
+    // between the calls, so the previous buffers are freed.
+    *data = m_buffer.get();
+    m_retiredBuffers.clear();
+    return m_available >= end;
+}
+
+void WASMParser::serialize(Module* module, const uint8_t* data, size_t len, const uint32_t featureFlags, std::vector<uint8_t>& out)
+{
+    // Imported functions have no body.
+    size_t firstFunction = 0;
+    for (size_t i = 0; i < module->m_imports.size(); i++) {
+        if (module->m_imports[i]->importType() == ImportType::Function) {
+            firstFunction++;
+        }
+    }
+
+    SerializedModuleHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_magic = SerializedModuleHeader::s_magic;
+    header.m_version = SerializedModuleHeader::s_version;
+    header.m_opcodeCount = ByteCode::OpcodeKindEnd;
+    header.m_pointerSize = sizeof(void*);
+    header.m_buildId = buildId();
+    header.m_featureFlags = featureFlags;
+    header.m_binaryLength = len;
+
+    // The header is written again when the checksum is known.
+    SerializedModuleWriter writer(out);
+    writer.writeBytes(&header, sizeof(header));
+    size_t headerSize = out.size();
+    writer.writeBytes(data, len);
+
+    std::unordered_map<const void*, uint32_t> typeIndex;
+    for (uint32_t i = 0; i < module->m_compositeTypes.size(); i++) {
+        CompositeType* type = module->m_compositeTypes[i];
+        typeIndex.insert(std::make_pair(type, i));
+        typeIndex.insert(std::make_pair(type->subTypeList(), i));
+    }
+
+    // The functions created for constant expressions are also written,
+    // they are ignored when the module is deserialized.
+    for (size_t i = firstFunction; i < module->m_functions.size(); i++) {
+        ModuleFunction* function = module->m_functions[i];
+
+        // Modules which cannot be compiled are not serialized.
+        if (!function->hasByteCode() && !module->generateByteCode(function).empty()) {
+            out.clear();
+            return;
+        }
+
+        writer.write<uint32_t>(static_cast<uint32_t>(i));
+        writer.write<uint32_t>(function->m_hasTryCatch ? 1 : 0);
+        writer.write<uint32_t>(function->m_requiredStackSize);
+
+        writer.write<uint32_t>(static_cast<uint32_t>(function->m_local.size()));
+        for (size_t j = 0; j < function->m_local.size(); j++) {
+            writer.write<uint32_t>(function->m_local[j]);
+        }
+
+        writer.write<uint32_t>(static_cast<uint32_t>(function->m_catchInfo.size()));
+        for (size_t j = 0; j < function->m_catchInfo.size(); j++) {
+            const ModuleFunction::CatchInfo& info = function->m_catchInfo[j];
+            writer.write<uint64_t>(info.m_tryStart);
+            writer.write<uint64_t>(info.m_tryEnd);
+            writer.write<uint64_t>(info.m_catchStartPosition);
+            writer.write<uint64_t>(info.m_stackSizeToBe);
+            writer.write<uint32_t>(info.m_tagIndex);
+            writer.write<uint32_t>(info.m_pushExnRef ? 1 : 0);
+        }
+
+        size_t byteCodeSize = function->byteCodeSize();
+        uint64_t codeCount = 0;
+        for (size_t position = 0; position < byteCodeSize; codeCount++) {
+            position += function->getByteCode<ByteCode>(position)->getSize();
+        }
+
+        writer.write<uint64_t>(byteCodeSize);
+        writer.writeBytes(function->byteCode(), byteCodeSize);
+        writer.write<uint64_t>(codeCount);
+
+        // The opcode addresses and type pointers are replaced by indices.
+        for (size_t position = 0; position < byteCodeSize;) {
+            ByteCode* code = function->getByteCode<ByteCode>(position);
+            ByteCode::Opcode opcode = code->opcode();
+            size_t size = code->getSize();
+
+            writer.write<uint32_t>(opcode);
+            writer.write<uint32_t>(static_cast<uint32_t>(size));
+
+            if (hasTypeInfo(opcode)) {
+                auto it = typeIndex.find(typeInfo(code));
+                RELEASE_ASSERT(it != typeIndex.end());
+                writer.write<uint32_t>(it->second);
+            }
+
+            position += size;
+        }
+    }
+
+    header.m_checksum = hashBytes(out.data() + headerSize, out.size() - headerSize);
+    memcpy(out.data(), &header, sizeof(header));
+}
+
+std::pair<Optional<Module*>, std::string> WASMParser::deserialize(Store* store, const std::string& filename, const uint8_t* data, size_t len, const uint32_t JITFlags,
+                                                                  const uint8_t* binary, size_t binaryLength)
+{
+    SerializedModuleReader reader(data, len);
+    const uint8_t* headerData = reader.readBytes(sizeof(SerializedModuleHeader));
+
+    if (headerData == nullptr) {
+        return std::make_pair(nullptr, std::string("invalid serialized module"));
+    }
+
+    SerializedModuleHeader header;
+    memcpy(&header, headerData, sizeof(header));
+
+    if (header.m_magic != SerializedModuleHeader::s_magic || header.m_version != SerializedModuleHeader::s_version
+        || header.m_opcodeCount != ByteCode::OpcodeKindEnd || header.m_pointerSize != sizeof(void*)
+        || header.m_buildId != buildId()) {
+        return std::make_pair(nullptr, std::string("serialized module is created by a different build"));
+    }
+
+    // Detects truncated or corrupted data. It is not a protection
+    // against modified data, see the description of deserialize().
+    size_t headerSize = len - reader.remaining();
+
+    if (hashBytes(data + headerSize, len - headerSize) != header.m_checksum) {
+        return std::make_pair(nullptr, std::string("invalid serialized module"));
+    }
+
+    const uint8_t* moduleBinary = reader.readBytes(header.m_binaryLength);
+
+    if (moduleBinary == nullptr) {
+        return std::make_pair(nullptr, std::string("invalid serialized module"));
+    }
+
+    if (binary != nullptr && (binaryLength != header.m_binaryLength || memcmp(binary, moduleBinary, binaryLength) != 0)) {
+        return std::make_pair(nullptr, std::string("serialized module is created from a different binary"));
+    }
+
+    return parseBinaryInternal(store, filename, moduleBinary, header.m_binaryLength, JITFlags, header.m_featureFlags, &reader, nullptr);
+}
+
+static bool isPrivateCacheDirectory(const std::string& path)
+{
+#if defined(OS_POSIX)
+    struct stat info;
+
+    if (stat(path.data(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return false;
+    }
+
+    return info.st_uid == geteuid() && (info.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#else
+    return false;
+#endif
+}
+
+static bool readCacheFile(const std::string& path, std::vector<uint8_t>& out)
+{
+    FILE* fp = fopen(path.data(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size_t size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    out.resize(size);
+
+    bool success = fread(out.data(), 1, size, fp) == size;
+    fclose(fp);
+    return success;
+}
+
+std::pair<Optional<Module*>, std::string> WASMParser::parseBinaryWithCache(Store* store, const std::string& cacheDir, const std::string& filename, const uint8_t* data, size_t len,
+                                                                           const uint32_t JITFlags, const uint32_t featureFlags)
+{
+    // Serialized modules are executed without validation, so only
+    // a directory which cannot be modified by others is used.
+    if (!isPrivateCacheDirectory(cacheDir)) {
+        return parseBinary(store, filename, data, len, JITFlags, featureFlags);
+    }
+
+    uint64_t hash = hashBytes(data, len);
+    hash = (hash ^ featureFlags) * 1099511628211ull;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".wmod", hash);
+    std::string path = cacheDir + "/" + name;
+
+    std::vector<uint8_t> cache;
+    if (readCacheFile(path, cache)) {
+        auto parseResult = deserialize(store, filename, cache.data(), cache.size(), JITFlags, data, len);
+        if (parseResult.second.empty()) {
+            return parseResult;
+        }
+    }
+
+    auto parseResult = parseBinary(store, filename, data, len, JITFlags, featureFlags);
+    if (!parseResult.second.empty()) {
+        return parseResult;
+    }
+
+    cache.clear();
+    serialize(parseResult.first.value(), data, len, featureFlags, cache);
+    if (cache.empty()) {
+        return parseResult;
+    }
+
+    // Other processes must never see a partially written file.
+    std::string tmpPath = path + ".tmp";
+    FILE* fp = fopen(tmpPath.data(), "wb");
+    if (fp) {
+        bool success = fwrite(cache.data(), 1, cache.size(), fp) == cache.size();
+        success = fclose(fp) == 0 && success;
+
+        if (!success || rename(tmpPath.data(), path.data()) != 0) {
+            remove(tmpPath.data());
+        }
+    }
+
+    return parseResult;
+}
+
 } // namespace Walrus
@@ -19,10 +19,15 @@
 
 #include "runtime/Module.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace Walrus {
 
 class Module;
 class Store;
+class TypeStore;
 
 struct WASMParsingResult {
     // should be allocated in the stack
@@ -50,12 +55,137 @@ struct WASMParsingResult {
     Vector<TableType*> m_tableTypes;
     Vector<MemoryType*> m_memoryTypes;
     Vector<TagType*> m_tagTypes;
+
+    LazyByteCodeGenerator* m_lazyByteCodeGenerator;
+};
+
+// Keeps the code section of a module parsed with JITFlagValue::lazyCompile.
+// The function bodies are validated by the parser, and their byte code is
+// generated from the code section when the functions are called first. When
+// the JIT compiler is used without tiering, the functions are also compiled
+// at that time. It is also used to generate the byte code of all functions
+// in parallel after the (sequential) validation when the parser uses
+// multiple threads, which reads the binary of the caller.
+class LazyByteCodeGenerator {
+    friend class WASMParser;
+    friend class wabt::WASMBinaryReader;
+
+public:
+    LazyByteCodeGenerator(uint32_t featureFlags, uint32_t JITFlags);
+
+    // Can be called from multiple threads, the byte
+    // code of a function is generated only once.
+    std::string generate(Module* module, ModuleFunction* function);
+    // Generates the byte code of all functions before the module is created.
+    std::string generateAll(TypeStore& typeStore, uint32_t threadCount);
+
+private:
+    struct FunctionBody {
+        size_t m_offset;
+        size_t m_size;
+    };
+
+    void addFunctionBody(ModuleFunction* function, uint32_t index, size_t offset, size_t size);
+    // The binary must be complete, and it is only used by this call
+    // unless the functions are generated by generateAll.
+    void setParsingResult(WASMParsingResult& result, const uint8_t* binary);
+    void swapParsingResult(WASMParsingResult& result);
+    std::string readFunctionBody(wabt::WASMBinaryReader* delegate, ModuleFunction* function);
+    // Stops at the first function which cannot be compiled.
+    void generateFunctions(TypeStore* typeStore, ModuleFunction** functions, size_t count, std::string* error);
+
+    std::mutex m_mutex;
+    // The function bodies of the module, starting at m_codeOffset in the
+    // binary. Points to m_ownedCode after a lazily compiled module is parsed.
+    const uint8_t* m_code;
+    size_t m_codeSize;
+    size_t m_codeOffset;
+    std::vector<uint8_t> m_ownedCode;
+    uint32_t m_featureFlags;
+    uint32_t m_JITFlags;
+    uint32_t m_dataCount;
+    // Indexed by function index.
+    std::vector<FunctionBody> m_bodies;
+
+    // The byte code generator needs these parts of the parsing result.
+    Vector<ModuleFunction*> m_functions;
+    Vector<CompositeType*> m_compositeTypes;
+    Vector<GlobalType*> m_globalTypes;
+    Vector<TableType*> m_tableTypes;
+    Vector<MemoryType*> m_memoryTypes;
+    Vector<TagType*> m_tagTypes;
+};
+
+// Parses a binary on a background thread while its bytes are appended, so
+// reading the binary overlaps with the validation and byte code generation
+// of the sections and function bodies which are already available. The
+// size of the binary must be known in advance to detect its end, but the
+// buffer only grows as the bytes are appended. The parser switches to a
+// grown buffer when it waits for data. The store must not be used until
+// finish returns.
+class WASMStreamingParser {
+    friend class wabt::WASMBinaryReader;
+
+public:
+    WASMStreamingParser(Store* store, const std::string& filename, size_t size, const uint32_t JITFlags = 0, const uint32_t featureFlags = 0);
+    ~WASMStreamingParser();
+
+    // Returns false if the binary is larger than the size passed to the constructor.
+    bool append(const uint8_t* data, size_t len);
+    // Waits for the parser. A missing part of the binary is reported as an error.
+    std::pair<Optional<Module*>, std::string> finish();
+
+private:
+    static const size_t s_initialBufferSize = 64 * 1024;
+
+    void parse();
+    // Also updates data to the current address of the binary.
+    bool waitForData(size_t end, const uint8_t** data);
+
+    Store* m_store;
+    std::string m_filename;
+    uint32_t m_JITFlags;
+    uint32_t m_featureFlags;
+    size_t m_size;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    // Only modified by the appending thread, and
+    // the parser only reads the available bytes.
+    std::unique_ptr<uint8_t[]> m_buffer;
+    size_t m_capacity;
+    size_t m_available;
+    bool m_finished;
+    // The parser might still read the previous buffers
+    // until it switches to the current one.
+    std::vector<std::unique_ptr<uint8_t[]>> m_retiredBuffers;
+
+    std::pair<Optional<Module*>, std::string> m_result;
+    std::thread m_thread;
 };
 
 class WASMParser {
 public:
     // returns <result, error>
     static std::pair<Optional<Module*>, std::string> parseBinary(Store* store, const std::string& filename, const uint8_t* data, size_t len, const uint32_t JITFlags = 0, const uint32_t featureFlags = 0);
+
+    // A serialized module contains the binary and the byte code of its functions,
+    // so deserializing it skips the validation and byte code generation of the
+    // function bodies. The format is only readable by the same build of walrus.
+    // The output is empty if a lazily compiled function cannot be compiled.
+    static void serialize(Module* module, const uint8_t* data, size_t len, const uint32_t featureFlags, std::vector<uint8_t>& out);
+    // When binary is not null, the module must be serialized from the same binary.
+    // Data created by another build, and truncated or corrupted data is rejected.
+    // The byte code is not validated, so the data must come from a trusted
+    // source: a modified serialized module can execute arbitrary byte code.
+    static std::pair<Optional<Module*>, std::string> deserialize(Store* store, const std::string& filename, const uint8_t* data, size_t len, const uint32_t JITFlags = 0,
+                                                                 const uint8_t* binary = nullptr, size_t binaryLength = 0);
+    // Loads the module from cacheDir when the same binary was parsed before with
+    // the same features, otherwise parses the binary and stores the serialized
+    // module in cacheDir. The cache is not used when cacheDir is not owned by
+    // the current user or is writable by other users.
+    static std::pair<Optional<Module*>, std::string> parseBinaryWithCache(Store* store, const std::string& cacheDir, const std::string& filename, const uint8_t* data, size_t len,
+                                                                          const uint32_t JITFlags = 0, const uint32_t featureFlags = 0);
 };
 
 } // namespace Walrus
@@ -324,11 +324,7 @@ FunctionType* ComponentTypeFunc::createFunctionType(Store* store, bool is64)
     }
 
     functionType->initDone();
-
-    Vector<CompositeType*> typeList;
-    typeList.push_back(functionType);
-    store->getTypeStore().updateTypes(typeList);
-    return typeList[0]->asFunction();
+    return store->getTypeStore().updateFunctionType(functionType);
 }
 
 Component::Component(Store* store)
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Walrus.h"
+
+#include "runtime/Engine.h"
+#include "runtime/Memory.h"
+
+#include <thread>
+
+namespace Walrus {
+
+static uint32_t threadCount(uint32_t count)
+{
+    if (count == 0) {
+        count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    return count;
+}
+
+Engine::Engine(const EngineConfig& config)
+    : m_config(config)
+    , m_JITThreadCount(threadCount(config.JITThreadCount))
+    , m_parserThreadCount(threadCount(config.parserThreadCount))
+    , m_memoryPool(nullptr)
+{
+    if (config.guardPages) {
+        Memory::enableGuardPages();
+    }
+
+    if (config.memoryPoolSlots > 0) {
+        uint64_t slotSizeInByte = MemoryPool::s_defaultSlotSizeInByte;
+        if (Memory::guardPagesEnabled()) {
+            slotSizeInByte = Memory::s_guardedReservedSize;
+        }
+
+        // The memories are allocated without the pool when it cannot be created.
+        m_memoryPool = MemoryPool::create(config.memoryPoolSlots, slotSizeInByte);
+    }
+}
+
+} // namespace Walrus
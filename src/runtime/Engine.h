@@ -17,9 +17,102 @@
 #ifndef __WalrusEngine__
 #define __WalrusEngine__
 
+#include "runtime/MemoryPool.h"
+
 namespace Walrus {
 
+// Options of an engine. Only the guard pages are process wide: they are
+// enabled when the first engine which requests them is created, and stay
+// enabled for all engines, since the signal handler and the reservation
+// of the memories are shared by the process.
+struct EngineConfig {
+    static const uint32_t s_defaultTierUpThreshold = 1000;
+
+    EngineConfig()
+        : JITFlags(0)
+        , featureFlags(0)
+        , tierUpThreshold(s_defaultTierUpThreshold)
+        , JITThreadCount(1)
+        , parserThreadCount(1)
+        , memoryPoolSlots(0)
+        , guardPages(false)
+        , reserveMemoryMaximum(false)
+    {
+    }
+
+    // JITFlagValue and wabt::FeatureFlagValue bits
+    // used by the modules parsed with the engine.
+    uint32_t JITFlags;
+    uint32_t featureFlags;
+    // Number of calls and loop iterations before a function is compiled
+    // with tiering. Both 0 and 1 compile a function after its first call.
+    uint32_t tierUpThreshold;
+    // Maximum number of threads used by the JIT compiler and by the byte
+    // code generator for a module. Passing 0 selects the number of hardware
+    // threads.
+    uint32_t JITThreadCount;
+    uint32_t parserThreadCount;
+    // The memory pool is disabled when it is 0.
+    size_t memoryPoolSlots;
+    bool guardPages;
+    bool reserveMemoryMaximum;
+    // The parsed modules are cached in this directory when it is not empty.
+    std::string cacheDir;
+};
+
 class Engine {
+public:
+    Engine()
+        : m_JITThreadCount(1)
+        , m_parserThreadCount(1)
+        , m_memoryPool(nullptr)
+    {
+    }
+
+    explicit Engine(const EngineConfig& config);
+
+    ~Engine()
+    {
+        delete m_memoryPool;
+    }
+
+    const EngineConfig& config() const
+    {
+        return m_config;
+    }
+
+    // The thread counts of the config, where 0 is
+    // replaced by the number of hardware threads.
+    uint32_t JITThreadCount() const
+    {
+        return m_JITThreadCount;
+    }
+
+    uint32_t parserThreadCount() const
+    {
+        return m_parserThreadCount;
+    }
+
+    // Allocate the linear memories of the stores using this engine from a
+    // pool of slotCount slots. Must be called before any memory is created.
+    // Returns false when the pool cannot be created.
+    bool enableMemoryPool(size_t slotCount, uint64_t slotSizeInByte)
+    {
+        ASSERT(m_memoryPool == nullptr);
+        m_memoryPool = MemoryPool::create(slotCount, slotSizeInByte);
+        return m_memoryPool != nullptr;
+    }
+
+    MemoryPool* memoryPool() const
+    {
+        return m_memoryPool;
+    }
+
+private:
+    EngineConfig m_config;
+    uint32_t m_JITThreadCount;
+    uint32_t m_parserThreadCount;
+    MemoryPool* m_memoryPool;
 };
 
 } // namespace Walrus
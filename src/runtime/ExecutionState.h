@@ -29,6 +29,7 @@ public:
     friend class Exception;
     friend class Trap;
     friend class Interpreter;
+    friend class PreparedCall;
 
     ExecutionState(ExecutionState& parent)
         : m_parent(&parent)
@@ -23,6 +23,7 @@
 #include "runtime/Tag.h"
 #include "runtime/Instance.h"
 #include "runtime/Value.h"
+#include "runtime/Trap.h"
 
 namespace Walrus {
 
@@ -98,7 +99,67 @@ void DefinedFunction::call(ExecutionState& state, Value* argv, Value* result)
 void DefinedFunction::interpreterCall(ExecutionState& state, uint8_t* bp, ByteCodeStackOffset* offsets,
                                       uint16_t parameterOffsetCount, uint16_t resultOffsetCount)
 {
-    Interpreter::callInterpreter(state, this, bp, offsets, parameterOffsetCount, resultOffsetCount);
+    Exception* exception = Interpreter::callInterpreter(state, this, bp, offsets, parameterOffsetCount, resultOffsetCount);
+
+    // Native and compiled callers expect C++ exceptions.
+    if (UNLIKELY(exception != nullptr)) {
+        Trap::throwException(state, std::unique_ptr<Exception>(exception));
+    }
+}
+
+PreparedCall* PreparedCall::create(DefinedFunction* function)
+{
+    const FunctionType* ft = function->functionType();
+    const TypeVector::Types* types[2] = { &ft->param().types(), &ft->result().types() };
+
+    // The offsets must fit into ByteCodeStackOffset.
+    if (std::max(types[0]->size(), types[1]->size()) * s_slotSize > std::numeric_limits<ByteCodeStackOffset>::max()) {
+        return nullptr;
+    }
+
+    PreparedCall* preparedCall = new PreparedCall(function);
+
+    for (size_t i = 0; i < 2; i++) {
+        for (size_t j = 0; j < types[i]->size(); j++) {
+            Value::Type type = (*types[i])[j];
+            size_t size = valueStackAllocatedSize(type);
+
+            if (Value::isRefType(type) || size > s_slotSize) {
+                delete preparedCall;
+                return nullptr;
+            }
+
+            for (size_t k = 0; k < size; k += sizeof(size_t)) {
+                preparedCall->m_offsets.push_back(static_cast<ByteCodeStackOffset>(j * s_slotSize + k));
+            }
+        }
+
+        if (i == 0) {
+            preparedCall->m_parameterOffsetCount = static_cast<uint16_t>(preparedCall->m_offsets.size());
+        }
+    }
+
+    preparedCall->m_resultOffsetCount = static_cast<uint16_t>(preparedCall->m_offsets.size() - preparedCall->m_parameterOffsetCount);
+    return preparedCall;
+}
+
+Trap::TrapResult PreparedCall::call(uint8_t* slots)
+{
+    Trap::TrapResult result;
+
+    // Unwinding is only set up when an exception is thrown.
+    try {
+        ExecutionState state;
+        Exception* exception = Interpreter::callInterpreter(state, m_function, slots, m_offsets.data(),
+                                                            m_parameterOffsetCount, m_resultOffsetCount);
+        if (UNLIKELY(exception != nullptr)) {
+            result.exception.reset(exception);
+        }
+    } catch (std::unique_ptr<Exception>& e) {
+        result.exception = std::move(e);
+    }
+
+    return result;
 }
 
 void NativeFunction::interpreterCall(ExecutionState& state, uint8_t* bp, ByteCodeStackOffset* offsets,
@@ -47,6 +47,8 @@ class LoweredFunction;
 class WasiFunction;
 
 class Function : public Extern {
+    friend class JITFieldAccessor;
+
 public:
     enum Kind {
         DefinedFunctionKind,
@@ -118,6 +120,40 @@ protected:
     ModuleFunction* m_moduleFunction;
 };
 
+// A call of a defined function which is prepared once and executed many
+// times. The arguments and results are stored in slots of s_slotSize bytes
+// of a caller provided buffer: argument i is read from slot i, and result i
+// is written to slot i. The offsets of the values are computed when the call
+// is prepared, so calls neither allocate memory nor convert values.
+class PreparedCall {
+public:
+    static const size_t s_slotSize = 8;
+
+    // Returns nullptr if a parameter or result does not fit into a slot.
+    static PreparedCall* create(DefinedFunction* function);
+
+    DefinedFunction* function() const
+    {
+        return m_function;
+    }
+
+    // The buffer must contain max(param count, result count) slots.
+    Trap::TrapResult call(uint8_t* slots);
+
+private:
+    PreparedCall(DefinedFunction* function)
+        : m_function(function)
+        , m_parameterOffsetCount(0)
+        , m_resultOffsetCount(0)
+    {
+    }
+
+    DefinedFunction* m_function;
+    uint16_t m_parameterOffsetCount;
+    uint16_t m_resultOffsetCount;
+    std::vector<ByteCodeStackOffset> m_offsets;
+};
+
 class NativeFunction : public Function {
 public:
     virtual void interpreterCall(ExecutionState& state, uint8_t* bp, ByteCodeStackOffset* offsets,
@@ -173,6 +209,11 @@ public:
         return WasiFunctionKind;
     }
 
+    WasiFunctionCallback callback() const
+    {
+        return m_callback;
+    }
+
     void setRunningInstance(Instance* instance)
     {
         m_runningInstance = instance;
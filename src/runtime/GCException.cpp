@@ -60,13 +60,18 @@ GCException::GCException(std::unique_ptr<Exception>& e)
 }
 
 void GCException::throwException()
+{
+    throw takeException();
+}
+
+std::unique_ptr<Exception> GCException::takeException()
 {
     if (m_exception == nullptr) {
         // Currently an engine limitation.
         Trap::throwException("Exception has been thrown");
     }
 
-    throw std::move(m_exception);
+    return std::move(m_exception);
 }
 
 } // namespace Walrus
@@ -28,6 +28,8 @@ public:
     static GCException* exceptionNew(std::unique_ptr<Exception>& e);
 
     void throwException();
+    // Moves out the exception, which can only be thrown once.
+    std::unique_ptr<Exception> takeException();
 
     std::unique_ptr<Exception>& exception()
     {
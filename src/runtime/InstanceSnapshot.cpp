@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Walrus.h"
+
+#include "runtime/InstanceSnapshot.h"
+#include "runtime/Instance.h"
+#include "runtime/Module.h"
+#include "runtime/Memory.h"
+#include "runtime/Table.h"
+#include "runtime/Global.h"
+#include "runtime/Trap.h"
+
+#include <unordered_map>
+
+#if defined(OS_POSIX)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(MFD_CLOEXEC)
+#define WALRUS_USE_MEMFD
+#endif
+#endif
+
+namespace Walrus {
+
+typedef std::unordered_map<void*, size_t> FunctionIndexMap;
+
+// Functions are saved by their index, other references cannot be saved.
+static bool findFunctionIndex(const FunctionIndexMap& functionIndices, void* ref, size_t& functionIndex)
+{
+    if (ref == nullptr || Value::isI31Value(ref)) {
+        functionIndex = ~static_cast<size_t>(0);
+        return true;
+    }
+
+    auto iter = functionIndices.find(ref);
+    if (iter == functionIndices.end()) {
+        return false;
+    }
+
+    functionIndex = iter->second;
+    return true;
+}
+
+static bool saveReference(const FunctionIndexMap& functionIndices, void* ref, void*& value, size_t& functionIndex)
+{
+    if (!findFunctionIndex(functionIndices, ref, functionIndex)) {
+        return false;
+    }
+
+    value = functionIndex == ~static_cast<size_t>(0) ? ref : nullptr;
+    return true;
+}
+
+#if defined(WALRUS_USE_MEMFD)
+static bool isZero(const uint8_t* buffer, size_t size)
+{
+    const uint64_t* ptr = reinterpret_cast<const uint64_t*>(buffer);
+    const uint64_t* end = reinterpret_cast<const uint64_t*>(buffer + size);
+
+    while (ptr < end) {
+        if (*ptr++ != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int createMemoryImage(const uint8_t* buffer, uint64_t sizeInByte)
+{
+    int fd = memfd_create("walrus-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(sizeInByte)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // The file is zero filled, only the non-zero pages are written.
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    uint64_t offset = 0;
+
+    while (offset < sizeInByte) {
+        if (isZero(buffer + offset, pageSize)) {
+            offset += pageSize;
+            continue;
+        }
+
+        uint64_t end = offset + pageSize;
+        while (end < sizeInByte && !isZero(buffer + end, pageSize)) {
+            end += pageSize;
+        }
+
+        while (offset < end) {
+            ssize_t written = pwrite(fd, buffer + offset, static_cast<size_t>(end - offset), static_cast<off_t>(offset));
+            if (written <= 0) {
+                close(fd);
+                return -1;
+            }
+            offset += static_cast<uint64_t>(written);
+        }
+    }
+
+#if defined(F_ADD_SEALS)
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+    return fd;
+}
+#endif
+
+InstanceSnapshot* InstanceSnapshot::create(Instance* instance)
+{
+    Module* module = instance->module();
+    std::unique_ptr<InstanceSnapshot> snapshot(new InstanceSnapshot(module));
+
+    for (auto import : module->imports()) {
+        switch (import->importType()) {
+        case ImportType::Memory:
+        case ImportType::Table:
+            return nullptr;
+        case ImportType::Global:
+            snapshot->m_numberOfImportedGlobals++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    FunctionIndexMap functionIndices;
+    for (size_t i = 0; i < module->numberOfFunctions(); i++) {
+        functionIndices.insert(std::make_pair(instance->function(i), i));
+    }
+
+    for (size_t i = snapshot->m_numberOfImportedGlobals; i < module->numberOfGlobalTypes(); i++) {
+        SavedGlobal saved = { instance->global(i)->value(), s_notFunction };
+
+        if (saved.value.isRef() && !findFunctionIndex(functionIndices, saved.value.asReference(), saved.functionIndex)) {
+            return nullptr;
+        }
+        snapshot->m_globals.push_back(saved);
+    }
+
+    snapshot->m_tables.resize(module->numberOfTableTypes());
+    for (size_t i = 0; i < module->numberOfTableTypes(); i++) {
+        Table* table = instance->table(i);
+        TableImage& image = snapshot->m_tables[i];
+
+        image.size = table->size();
+        image.elements.resize(static_cast<size_t>(image.size));
+        for (uint64_t j = 0; j < image.size; j++) {
+            void* ref = table->is64() ? table->uncheckedGetElementM64(j) : table->uncheckedGetElement(static_cast<uint32_t>(j));
+            SavedReference& saved = image.elements[static_cast<size_t>(j)];
+            if (!saveReference(functionIndices, ref, saved.value, saved.functionIndex)) {
+                return nullptr;
+            }
+        }
+    }
+
+    snapshot->m_elementSegments.resize(module->numberOfElemSegments());
+    for (size_t i = 0; i < module->numberOfElemSegments(); i++) {
+        ElementSegment* segment = instance->elementSegment(i);
+        auto& elements = snapshot->m_elementSegments[i];
+
+        elements.resize(segment->size());
+        for (size_t j = 0; j < segment->size(); j++) {
+            if (!saveReference(functionIndices, segment->element(j), elements[j].value, elements[j].functionIndex)) {
+                return nullptr;
+            }
+        }
+    }
+
+    snapshot->m_droppedDataSegments.resize(module->numberOfDataSegments());
+    for (size_t i = 0; i < module->numberOfDataSegments(); i++) {
+        snapshot->m_droppedDataSegments[i] = instance->dataSegment(i)->sizeInByte() == 0;
+    }
+
+    // Memories are captured last, since the previous steps may fail.
+    snapshot->m_memories.resize(module->numberOfMemoryTypes());
+    for (size_t i = 0; i < module->numberOfMemoryTypes(); i++) {
+        Memory* memory = instance->memory(i);
+        MemoryImage& image = snapshot->m_memories[i];
+
+        image.sizeInByte = memory->sizeInByte();
+        image.fd = -1;
+
+        if (image.sizeInByte == 0) {
+            continue;
+        }
+
+#if defined(WALRUS_USE_MEMFD)
+        image.fd = createMemoryImage(memory->buffer(), image.sizeInByte);
+        if (image.fd >= 0) {
+            continue;
+        }
+#endif
+        image.data.assign(memory->buffer(), memory->buffer() + image.sizeInByte);
+    }
+
+    return snapshot.release();
+}
+
+InstanceSnapshot::~InstanceSnapshot()
+{
+#if defined(OS_POSIX)
+    for (auto& image : m_memories) {
+        if (image.fd >= 0) {
+            close(image.fd);
+        }
+    }
+#endif
+}
+
+Instance* InstanceSnapshot::instantiate(ExecutionState& state, const ExternVector& imports) const
+{
+    return m_module->instantiate(state, imports, this);
+}
+
+void* InstanceSnapshot::restoreReference(Instance* instance, const SavedReference& reference) const
+{
+    if (reference.functionIndex == s_notFunction) {
+        return reference.value;
+    }
+    return instance->function(reference.functionIndex);
+}
+
+Memory* InstanceSnapshot::createMemory(ExecutionState& state, Store* store, size_t index) const
+{
+    const MemoryImage& image = m_memories[index];
+    MemoryType* type = m_module->memoryType(index);
+    Memory* memory = Memory::createMemory(store, image.sizeInByte, type->maximumSize() * Memory::s_memoryPageSize,
+                                          type->isShared(), type->is64());
+
+    if (image.fd >= 0) {
+        if (UNLIKELY(!memory->mapImage(image.fd, image.sizeInByte))) {
+            Trap::throwException(state, "cannot map memory snapshot");
+        }
+    } else if (!image.data.empty()) {
+        memcpy(memory->buffer(), image.data.data(), image.data.size());
+    }
+    return memory;
+}
+
+Table* InstanceSnapshot::createTable(Instance* instance, Store* store, size_t index) const
+{
+    const TableImage& image = m_tables[index];
+    TableType* type = m_module->tableType(index);
+    Table* table = Table::createTable(store, type->type(), image.size, type->maximumSize(), type->is64());
+
+    for (uint64_t i = 0; i < image.size; i++) {
+        void* ref = restoreReference(instance, image.elements[static_cast<size_t>(i)]);
+        if (table->is64()) {
+            table->uncheckedSetElementM64(i, ref);
+        } else {
+            table->uncheckedSetElement(static_cast<uint32_t>(i), ref);
+        }
+    }
+    return table;
+}
+
+Global* InstanceSnapshot::createGlobal(Instance* instance, Store* store, size_t index) const
+{
+    ASSERT(index >= m_numberOfImportedGlobals);
+    const SavedGlobal& saved = m_globals[index - m_numberOfImportedGlobals];
+    GlobalType* type = m_module->globalType(index);
+
+    if (saved.functionIndex != s_notFunction) {
+        return Global::createGlobal(store, Value(saved.value.type(), instance->function(saved.functionIndex)), type->type());
+    }
+    return Global::createGlobal(store, saved.value, type->type());
+}
+
+void InstanceSnapshot::initElementSegment(Instance* instance, size_t index, ElementSegment* segment) const
+{
+    const auto& elements = m_elementSegments[index];
+
+    // A dropped segment is an empty segment.
+    new (segment) ElementSegment(elements.size());
+    void** result = segment->elements();
+
+    for (size_t i = 0; i < elements.size(); i++) {
+        result[i] = restoreReference(instance, elements[i]);
+    }
+}
+
+} // namespace Walrus
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __WalrusInstanceSnapshot__
+#define __WalrusInstanceSnapshot__
+
+#include "runtime/Object.h"
+#include "runtime/Value.h"
+
+namespace Walrus {
+
+class ExecutionState;
+class Module;
+class Instance;
+class Store;
+class Memory;
+class Table;
+class Global;
+class ElementSegment;
+
+// Immutable image of the memories, globals, tables and segments of an
+// instance. Instances created from a snapshot skip the constant expressions,
+// the data segment copies and the start function. Linear memories are mapped
+// copy-on-write from a memfd when the platform supports it, so creating an
+// instance does not depend on the size of the data segments.
+class InstanceSnapshot {
+    friend class Module;
+
+public:
+    // Captures the current state of the instance, usually right after
+    // Module::instantiate returned. Returns nullptr when the state cannot be
+    // captured: the module imports memories or tables, or the instance holds
+    // references other than its own functions.
+    static InstanceSnapshot* create(Instance* instance);
+
+    ~InstanceSnapshot();
+
+    Module* module() const
+    {
+        return m_module;
+    }
+
+    // The imports must be the same as the imports of the captured instance,
+    // since the captured state may depend on them.
+    Instance* instantiate(ExecutionState& state, const ExternVector& imports) const;
+
+private:
+    // Function references are stored as function indices, other
+    // references (null and i31 values) are stored as they are.
+    struct SavedReference {
+        void* value;
+        size_t functionIndex;
+    };
+
+    struct SavedGlobal {
+        Value value;
+        size_t functionIndex;
+    };
+
+    struct MemoryImage {
+        uint64_t sizeInByte;
+        // A sealed memfd or -1, in which case the content is in data.
+        int fd;
+        std::vector<uint8_t> data;
+    };
+
+    struct TableImage {
+        uint64_t size;
+        std::vector<SavedReference> elements;
+    };
+
+    static const size_t s_notFunction = ~static_cast<size_t>(0);
+
+    explicit InstanceSnapshot(Module* module)
+        : m_module(module)
+        , m_numberOfImportedGlobals(0)
+    {
+    }
+
+    void* restoreReference(Instance* instance, const SavedReference& reference) const;
+
+    // Used by Module::instantiate.
+    Memory* createMemory(ExecutionState& state, Store* store, size_t index) const;
+    Table* createTable(Instance* instance, Store* store, size_t index) const;
+    Global* createGlobal(Instance* instance, Store* store, size_t index) const;
+    void initElementSegment(Instance* instance, size_t index, ElementSegment* segment) const;
+
+    bool isDataSegmentDropped(size_t index) const
+    {
+        return m_droppedDataSegments[index];
+    }
+
+    Module* m_module;
+    size_t m_numberOfImportedGlobals;
+    std::vector<MemoryImage> m_memories;
+    std::vector<TableImage> m_tables;
+    std::vector<SavedGlobal> m_globals;
+    std::vector<std::vector<SavedReference>> m_elementSegments;
+    std::vector<bool> m_droppedDataSegments;
+};
+
+} // namespace Walrus
+
+#endif // __WalrusInstanceSnapshot__
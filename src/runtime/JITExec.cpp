@@ -25,12 +25,31 @@
 
 namespace Walrus {
 
-ByteCodeStackOffset* JITFunction::call(ExecutionContext& context, uint8_t* bp) const
+MAY_THREAD_LOCAL ExecutionContext* ExecutionContext::current = nullptr;
+
+void* JITFunction::osrEntry(size_t position) const
 {
-    ASSERT(m_exportEntry);
+    ASSERT(isCompiled());
+
+    auto it = std::lower_bound(m_osrEntries.begin(), m_osrEntries.end(), std::make_pair(position, static_cast<void*>(nullptr)));
+
+    if (it == m_osrEntries.end() || it->first != position) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+ByteCodeStackOffset* JITFunction::call(ExecutionContext& context, uint8_t* bp, void* entry) const
+{
+    ASSERT(isCompiled());
 
     ExecutionState& state = context.state;
-    ByteCodeStackOffset* resultOffsets = m_module->exportCall()(&context, bp, m_exportEntry);
+    ExecutionContext* previous = ExecutionContext::current;
+
+    ExecutionContext::current = &context;
+    ByteCodeStackOffset* resultOffsets = m_module->exportCall()(&context, bp, entry);
+    ExecutionContext::current = previous;
 
     if (context.error != ExecutionContext::NoError) {
         if (UNLIKELY(context.ownedFrame != nullptr)) {
@@ -126,4 +145,62 @@ ByteCodeStackOffset* JITFunction::call(ExecutionContext& context, uint8_t* bp) c
     return resultOffsets;
 }
 
+#if defined(WALRUS_ENABLE_JIT)
+TierUpCompiler::TierUpCompiler(Module* module, uint32_t JITFlags)
+    : m_module(module)
+    , m_JITFlags(JITFlags)
+    , m_terminate(false)
+{
+}
+
+TierUpCompiler::~TierUpCompiler()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_terminate = true;
+    }
+
+    m_condition.notify_one();
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void TierUpCompiler::enqueue(ModuleFunction* function)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&TierUpCompiler::run, this);
+    }
+
+    m_queue.push_back(function);
+    m_condition.notify_one();
+}
+
+void TierUpCompiler::run()
+{
+    std::vector<ModuleFunction*> batch;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_terminate || !m_queue.empty(); });
+
+            if (m_terminate) {
+                return;
+            }
+
+            // Functions which became hot during the previous
+            // compilation are compiled together.
+            batch.swap(m_queue);
+        }
+
+        m_module->jitCompile(batch.data(), batch.size(), m_JITFlags);
+        batch.clear();
+    }
+}
+#endif
+
 } // namespace Walrus
@@ -20,6 +20,8 @@
 #include "interpreter/ByteCode.h"
 #include "runtime/Instance.h"
 #include "runtime/Memory.h"
+#include <mutex>
+#include <thread>
 
 namespace Walrus {
 
@@ -72,6 +74,7 @@ struct ExecutionContext {
         , frameStart(nullptr)
         , ownedFrame(nullptr)
         , frameCapacity(0)
+        , stackLimit(state.stackLimit())
     {
     }
 
@@ -91,6 +94,11 @@ struct ExecutionContext {
     uint8_t* frameStart;
     uint8_t* ownedFrame;
     size_t frameCapacity;
+    // Checked by the JIT code before calling a function directly.
+    size_t stackLimit;
+
+    // The context of the innermost running JIT code on this thread.
+    static MAY_THREAD_LOCAL ExecutionContext* current;
 };
 
 class JITModule {
@@ -113,23 +121,30 @@ public:
         return reinterpret_cast<ExportCall>(m_moduleStart);
     }
 
-    InstanceConstData* instanceConstData() { return m_instanceConstData; }
+    InstanceConstData* instanceConstData() { return m_instanceConstData.load(std::memory_order_acquire); }
 
 private:
-    InstanceConstData* m_instanceConstData;
+    // Replaced by a new copy when more functions are compiled,
+    // since running code may still use the previous one.
+    std::atomic<InstanceConstData*> m_instanceConstData;
+    std::vector<InstanceConstData*> m_previousInstanceConstData;
     void* m_moduleStart;
     // Does not include m_moduleStart code block
     std::vector<void*> m_codeBlocks;
+    // Code blocks might be compiled by multiple threads.
+    std::mutex m_mutex;
 };
 
 class JITFunction {
     friend class JITCompiler;
 
 public:
-    JITFunction()
+    explicit JITFunction(size_t frameSize)
         : m_exportEntry(nullptr)
         , m_constData(nullptr)
         , m_module(nullptr)
+        , m_tryBlockOffset(0)
+        , m_frameSize(frameSize)
     {
     }
 
@@ -140,16 +155,57 @@ public:
         }
     }
 
-    bool isCompiled() const { return m_exportEntry != nullptr; }
-    void* exportEntry() const { return m_exportEntry; }
+    bool isCompiled() const { return m_exportEntry.load(std::memory_order_acquire) != nullptr; }
+    void* exportEntry() const { return m_exportEntry.load(std::memory_order_acquire); }
     InstanceConstData* instanceConstData() const { return m_module->instanceConstData(); }
-    ByteCodeStackOffset* call(ExecutionContext& context, uint8_t* bp) const;
+    void* osrEntry(size_t position) const;
+    // The frame of the compiled code is larger than the frame
+    // of the interpreter when other functions are inlined.
+    size_t frameSize() const { return m_frameSize; }
+
+    ByteCodeStackOffset* call(ExecutionContext& context, uint8_t* bp) const
+    {
+        return call(context, bp, exportEntry());
+    }
+
+    ByteCodeStackOffset* call(ExecutionContext& context, uint8_t* bp, void* entry) const;
 
 private:
-    void* m_exportEntry;
+    // Set last, after the function is ready to run.
+    std::atomic<void*> m_exportEntry;
+    // Sorted list of byte code positions where the interpreter
+    // can continue the execution in the compiled code.
+    std::vector<std::pair<size_t, void*>> m_osrEntries;
     void* m_constData;
     JITModule* m_module;
+    // Start of the try blocks of the function in the instance const data,
+    // which is only known when the code block is added to the module.
+    size_t m_tryBlockOffset;
+    size_t m_frameSize;
+};
+
+#if defined(WALRUS_ENABLE_JIT)
+// Compiles the hot functions of a module in a background thread.
+class TierUpCompiler {
+public:
+    TierUpCompiler(Module* module, uint32_t JITFlags);
+    ~TierUpCompiler();
+
+    void enqueue(ModuleFunction* function);
+
+private:
+    void run();
+
+    Module* m_module;
+    uint32_t m_JITFlags;
+    bool m_terminate;
+    std::vector<ModuleFunction*> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    // Started by the first enqueue.
+    std::thread m_thread;
 };
+#endif
 
 } // namespace Walrus
 
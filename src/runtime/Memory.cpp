@@ -16,7 +16,9 @@
 #include "Walrus.h"
 
 #include "Memory.h"
+#include "MemoryPool.h"
 #include "Store.h"
+#include "runtime/Engine.h"
 #include "runtime/Trap.h"
 #include "runtime/Instance.h"
 #include "runtime/Module.h"
@@ -30,26 +32,64 @@ namespace Walrus {
 
 DEFINE_GLOBAL_TYPE_INFO(memoryTypeInfo, MemoryKind);
 
+bool Memory::s_guardPagesEnabled = false;
+
+bool Memory::enableGuardPages()
+{
+#if defined(WALRUS_USE_MMAP) && defined(WALRUS_64)
+    s_guardPagesEnabled = true;
+#endif
+    return s_guardPagesEnabled;
+}
+
 Memory* Memory::createMemory(Store* store, uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isShared, bool is64)
 {
-    Memory* mem = new Memory(initialSizeInByte, maximumSizeInByte, isShared, is64);
+    MemoryPool* pool = store->engine() ? store->engine()->memoryPool() : nullptr;
+    bool reserveMaximum = store->memoryReservationPolicy() == Store::MemoryReservationPolicy::Maximum;
+    Memory* mem = new Memory(pool, reserveMaximum, initialSizeInByte, maximumSizeInByte, isShared, is64);
     store->appendExtern(mem);
     return mem;
 }
 
-Memory::Memory(uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isShared, bool is64)
+Memory::Memory(MemoryPool* pool, bool reserveMaximum, uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isShared, bool is64)
     : Extern(GET_GLOBAL_TYPE_INFO(memoryTypeInfo))
     , m_sizeInByte(initialSizeInByte)
     , m_reservedSizeInByte(0)
     , m_maximumSizeInByte(maximumSizeInByte)
     , m_buffer(nullptr)
     , m_targetBuffers(nullptr)
+    , m_pool(nullptr)
     , m_isShared(isShared)
     , m_is64(is64)
+    , m_hasMappedFile(false)
 {
     RELEASE_ASSERT(initialSizeInByte <= std::numeric_limits<size_t>::max());
 #if defined(WALRUS_USE_MMAP)
-    if (m_maximumSizeInByte) {
+    // Shared memories are not pooled, since their addresses identify waiters.
+    if (pool && m_maximumSizeInByte && !isShared) {
+        bool fits = initialSizeInByte <= pool->slotSizeInByte()
+            && (!s_guardPagesEnabled || is64 || pool->slotSizeInByte() >= s_guardedReservedSize);
+        m_buffer = fits ? pool->allocate() : nullptr;
+
+        if (m_buffer) {
+            m_pool = pool;
+            m_reservedSizeInByte = pool->slotSizeInByte();
+            mprotect(m_buffer, initialSizeInByte, (PROT_READ | PROT_WRITE));
+            return;
+        }
+
+        if (!fits) {
+            pool->recordMiss();
+        }
+    }
+
+    if (s_guardPagesEnabled && !is64) {
+        // Everything after the accessible area is a guard page.
+        m_reservedSizeInByte = s_guardedReservedSize;
+        m_buffer = reinterpret_cast<uint8_t*>(mmap(NULL, m_reservedSizeInByte, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+        RELEASE_ASSERT(MAP_FAILED != m_buffer);
+        mprotect(m_buffer, initialSizeInByte, (PROT_READ | PROT_WRITE));
+    } else if (m_maximumSizeInByte) {
 #ifndef WALRUS_32_MEMORY_INITIAL_MMAP_RESERVED_ADDRESS_SIZE
 #define WALRUS_32_MEMORY_INITIAL_MMAP_RESERVED_ADDRESS_SIZE (1024 * 1024 * 64)
 #endif
@@ -62,6 +102,10 @@ Memory::Memory(uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isSh
 #else
             WALRUS_64_MEMORY_INITIAL_MMAP_RESERVED_ADDRESS_SIZE;
 #endif
+        // Shared memories cannot move, since other threads access them.
+        if (reserveMaximum || isShared) {
+            initialReservedSize = s_maxReservedSize;
+        }
         m_reservedSizeInByte = std::min(std::max(initialReservedSize, initialSizeInByte), m_maximumSizeInByte);
         m_buffer = reinterpret_cast<uint8_t*>(mmap(NULL, m_reservedSizeInByte, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
         RELEASE_ASSERT(MAP_FAILED != m_buffer);
@@ -80,7 +124,9 @@ Memory::Memory(uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isSh
 Memory::~Memory()
 {
 #if defined(WALRUS_USE_MMAP)
-    if (m_buffer) {
+    if (m_pool) {
+        m_pool->release(m_buffer, m_sizeInByte, m_hasMappedFile);
+    } else if (m_buffer) {
         munmap(m_buffer, m_reservedSizeInByte);
     }
 #else
@@ -91,6 +137,7 @@ Memory::~Memory()
 
 bool Memory::grow(uint64_t growSizeInByte)
 {
+    std::lock_guard<std::mutex> guard(m_mutex);
     uint64_t newSizeInByte = growSizeInByte + m_sizeInByte;
     if (newSizeInByte > m_sizeInByte && newSizeInByte <= m_maximumSizeInByte) {
 #if defined(WALRUS_USE_MMAP)
@@ -98,11 +145,34 @@ bool Memory::grow(uint64_t growSizeInByte)
             mprotect(m_buffer + m_sizeInByte, growSizeInByte, (PROT_READ | PROT_WRITE));
             m_sizeInByte = newSizeInByte;
         } else {
+            if (m_isShared) {
+                return false;
+            }
+
             auto newReservedSizeInByte = std::min(newSizeInByte * 2, m_maximumSizeInByte);
             auto newBuffer = reinterpret_cast<uint8_t*>(mmap(NULL, newReservedSizeInByte, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
             if (MAP_FAILED == newBuffer) {
                 return false;
             }
+
+#if defined(MREMAP_FIXED)
+            // Move the pages into the new reservation instead of copying them. This
+            // requires that the accessible area is a single anonymous mapping, so
+            // pooled memories and memories with a mapped file are copied instead.
+            if (!m_pool && !m_hasMappedFile && m_sizeInByte > 0
+                && mremap(m_buffer, m_sizeInByte, m_sizeInByte, MREMAP_MAYMOVE | MREMAP_FIXED, newBuffer) != MAP_FAILED) {
+                mprotect(newBuffer + m_sizeInByte, growSizeInByte, (PROT_READ | PROT_WRITE));
+                if (m_reservedSizeInByte > m_sizeInByte) {
+                    munmap(m_buffer + m_sizeInByte, m_reservedSizeInByte - m_sizeInByte);
+                }
+
+                m_buffer = newBuffer;
+                m_sizeInByte = newSizeInByte;
+                m_reservedSizeInByte = newReservedSizeInByte;
+                updateTargetBuffers();
+                return true;
+            }
+#endif
             mprotect(newBuffer, newSizeInByte, (PROT_READ | PROT_WRITE));
 
             // Slower copy than memcpy, but reduces the memory peak increase.
@@ -128,7 +198,9 @@ bool Memory::grow(uint64_t growSizeInByte)
                 } while (src < end);
 
                 // Unmap the segment.
-                munmap(start, 1024 * 1024);
+                if (!m_pool) {
+                    munmap(start, 1024 * 1024);
+                }
             }
 
             uint8_t* start = reinterpret_cast<uint8_t*>(src);
@@ -138,9 +210,15 @@ bool Memory::grow(uint64_t growSizeInByte)
                 src++;
                 dst++;
             }
-            munmap(start, reinterpret_cast<uint8_t*>(bufferEnd) - start);
+            if (m_pool) {
+                m_pool->release(m_buffer, m_sizeInByte, m_hasMappedFile);
+                m_pool = nullptr;
+            } else {
+                munmap(start, m_buffer + m_reservedSizeInByte - start);
+            }
 
             m_buffer = newBuffer;
+            m_hasMappedFile = false;
             m_sizeInByte = newSizeInByte;
             m_reservedSizeInByte = newReservedSizeInByte;
         }
@@ -156,13 +234,7 @@ bool Memory::grow(uint64_t growSizeInByte)
         m_sizeInByte = newSizeInByte;
 #endif
 
-        TargetBuffer* targetBuffer = m_targetBuffers;
-
-        while (targetBuffer != nullptr) {
-            targetBuffer->sizeInByte = sizeInByte();
-            targetBuffer->buffer = buffer();
-            targetBuffer = targetBuffer->next;
-        }
+        updateTargetBuffers();
         return true;
     } else if (newSizeInByte == m_sizeInByte) {
         return true;
@@ -170,6 +242,34 @@ bool Memory::grow(uint64_t growSizeInByte)
     return false;
 }
 
+void Memory::updateTargetBuffers()
+{
+    TargetBuffer* targetBuffer = m_targetBuffers;
+
+    while (targetBuffer != nullptr) {
+        targetBuffer->sizeInByte = sizeInByte();
+        targetBuffer->buffer = buffer();
+        targetBuffer = targetBuffer->next;
+    }
+}
+
+bool Memory::mapImage(int fd, uint64_t sizeInByte)
+{
+    ASSERT(sizeInByte <= m_sizeInByte);
+#if defined(WALRUS_USE_MMAP)
+    if (sizeInByte == 0) {
+        return true;
+    }
+    if (mmap(m_buffer, sizeInByte, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        return false;
+    }
+    m_hasMappedFile = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
 void Memory::throwRangeException(ExecutionState& state, uint32_t offset, uint32_t addend, uint32_t size) const
 {
     std::string str = "out of bounds memory access: access at ";
@@ -296,6 +396,7 @@ void Memory::fillMemory(size_t start, uint8_t value, size_t size)
 
 void Memory::TargetBuffer::enque(Memory* memory)
 {
+    std::lock_guard<std::mutex> guard(memory->m_mutex);
     next = memory->m_targetBuffers;
     buffer = memory->buffer();
     sizeInByte = memory->sizeInByte();
@@ -310,6 +411,7 @@ void Memory::TargetBuffer::deque(Memory* memory)
         return;
     }
 
+    std::lock_guard<std::mutex> guard(memory->m_mutex);
     TargetBuffer* current = memory->m_targetBuffers;
 
     if (current == this) {
@@ -22,11 +22,13 @@
 #include "runtime/Object.h"
 #include "runtime/Store.h"
 #include <atomic>
+#include <mutex>
 
 namespace Walrus {
 
 class Store;
 class DataSegment;
+class MemoryPool;
 
 class Memory : public Extern {
     friend class JITCompiler;
@@ -36,6 +38,14 @@ public:
     static const uint64_t s_maxMemory64Grow = ~static_cast<uint64_t>(0) / s_memoryPageSize;
     static const uint64_t s_maxMemory64 = ~static_cast<uint64_t>(0);
     static const uint32_t s_maxMemory32 = ~static_cast<uint32_t>(0);
+    // Any 32 bit index plus any 32 bit static offset is inside this range.
+    static const uint64_t s_guardedReservedSize = (static_cast<uint64_t>(1) << 33) + s_memoryPageSize;
+    // Upper limit of the address space reserved for the maximum size.
+#if defined(WALRUS_64)
+    static const uint64_t s_maxReservedSize = static_cast<uint64_t>(1) << 40;
+#else
+    static const uint64_t s_maxReservedSize = static_cast<uint64_t>(1) << 30;
+#endif
 
     // Caching memory target for fast access.
     struct TargetBuffer {
@@ -60,6 +70,17 @@ public:
     static Memory* createMemory(Store* store, uint64_t initialSizeInByte, uint64_t maximumSizeInByte,
                                 bool isShared, bool is64);
 
+    // Reserve s_guardedReservedSize address space for 32 bit memories, so the
+    // JIT code can rely on guard pages instead of explicit bounds checks.
+    // Must be called before any memory is created. Returns false when
+    // the platform does not support it.
+    static bool enableGuardPages();
+
+    static bool guardPagesEnabled()
+    {
+        return s_guardPagesEnabled;
+    }
+
     ~Memory();
 
     uint8_t* buffer() const
@@ -72,6 +93,11 @@ public:
         return m_sizeInByte;
     }
 
+    uint64_t reservedSizeInByte() const
+    {
+        return m_reservedSizeInByte;
+    }
+
     uint64_t sizeInPageSize() const
     {
         return sizeInByte() / s_memoryPageSize;
@@ -99,6 +125,10 @@ public:
 
     bool grow(uint64_t growSizeInByte);
 
+    // Replaces the first sizeInByte bytes of the memory with a private,
+    // copy-on-write mapping of the file. Returns false on failure.
+    bool mapImage(int fd, uint64_t sizeInByte);
+
     template <typename T>
     void load(ExecutionState& state, uint32_t offset, uint32_t addend, T* out) const
     {
@@ -297,44 +327,13 @@ public:
     template <typename T>
     void atomicWait(ExecutionState& state, Store* store, uint8_t* absoluteAddress, const T& expect, int64_t timeOut, uint32_t* out) const
     {
-        T read;
-        atomicLoad(state, absoluteAddress - m_buffer, 0, &read);
-        if (read != expect) {
-            // "not-equal", the loaded value did not match the expected value
-            *out = 1;
-        } else {
-            // wait process
-            bool notified = false;
-            Waiter* waiter = store->getWaiter(static_cast<void*>(absoluteAddress));
-
-            // lock waiter
-            std::unique_lock<std::mutex> lock(waiter->m_mutex);
-
-            Waiter::WaiterItem* item = new Waiter::WaiterItem(waiter);
-            waiter->m_waiterItemList.push_back(item);
-
-            // wait
-            notified = (waiter->m_condition.wait_for(lock, std::chrono::nanoseconds(timeOut)) == std::cv_status::no_timeout);
-
-            ASSERT(std::find(waiter->m_waiterItemList.begin(), waiter->m_waiterItemList.end(), item) != waiter->m_waiterItemList.end());
-            auto iter = waiter->m_waiterItemList.begin();
-            while (iter != waiter->m_waiterItemList.end()) {
-                if (*iter == item) {
-                    waiter->m_waiterItemList.erase(iter);
-                    break;
-                }
-                iter++;
-            }
-            delete item;
-
-            if (notified) {
-                // "ok", woken by another agent in the cluster
-                *out = 0;
-            } else {
-                // "timed-out", not woken before timeout expired
-                *out = 2;
-            }
-        }
+        // Called with the lock of the address held.
+        auto isExpected = [&]() -> bool {
+            T read;
+            atomicLoad(state, absoluteAddress - m_buffer, 0, &read);
+            return read == expect;
+        };
+        *out = store->waiterTable().wait(static_cast<void*>(absoluteAddress), isExpected, timeOut);
     }
 
     void atomicNotify(ExecutionState& state, Store* store, uint32_t offset, uint32_t addend, const uint32_t& count, uint32_t* out) const
@@ -361,17 +360,7 @@ public:
 
     void atomicNotify(Store* store, uint8_t* absoluteAddress, const uint32_t& count, uint32_t* out) const
     {
-        Waiter* waiter = store->getWaiter(static_cast<void*>(absoluteAddress));
-
-        waiter->m_mutex.lock();
-        uint32_t realCount = std::min(waiter->m_waiterItemList.size(), (size_t)count);
-
-        for (uint32_t i = 0; i < realCount; i++) {
-            waiter->m_waiterItemList[i]->m_waiter->m_condition.notify_one();
-        }
-
-        waiter->m_mutex.unlock();
-        *out = realCount;
+        *out = store->waiterTable().notify(static_cast<void*>(absoluteAddress), count);
     }
 
 #ifdef CPU_ARM32
@@ -424,9 +413,10 @@ public:
     void fillMemory(size_t start, uint8_t value, size_t size);
 
 private:
-    Memory(uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isShared, bool is64);
+    Memory(MemoryPool* pool, bool reserveMaximum, uint64_t initialSizeInByte, uint64_t maximumSizeInByte, bool isShared, bool is64);
 
     void throwRangeException(ExecutionState& state, uint32_t offset, uint32_t addend, uint32_t size) const;
+    void updateTargetBuffers();
 
     inline void checkAccess(ExecutionState& state, uint32_t offset, uint32_t size, uint32_t addend = 0) const
     {
@@ -471,13 +461,20 @@ private:
     void checkAtomicAccessM64(ExecutionState& state, uint64_t offset, uint64_t size, uint64_t addend = 0) const;
     void throwUnsharedMemoryException(ExecutionState& state) const;
 
+    static bool s_guardPagesEnabled;
+
     uint64_t m_sizeInByte;
     uint64_t m_reservedSizeInByte;
     uint64_t m_maximumSizeInByte;
     uint8_t* m_buffer;
     TargetBuffer* m_targetBuffers;
+    // Guards growing and the target buffer list of shared memories.
+    std::mutex m_mutex;
+    // The pool owning m_buffer, if any.
+    MemoryPool* m_pool;
     bool m_isShared;
     bool m_is64;
+    bool m_hasMappedFile;
 };
 
 } // namespace Walrus
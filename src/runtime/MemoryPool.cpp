@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Walrus.h"
+
+#include "runtime/MemoryPool.h"
+#include "runtime/Memory.h"
+
+#if defined(OS_POSIX)
+#define WALRUS_USE_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace Walrus {
+
+MemoryPool* MemoryPool::create(size_t slotCount, uint64_t slotSizeInByte)
+{
+#if defined(WALRUS_USE_MMAP)
+    // Slots are aligned to wasm pages.
+    slotSizeInByte = (slotSizeInByte + Memory::s_memoryPageSize - 1) & ~static_cast<uint64_t>(Memory::s_memoryPageSize - 1);
+
+    if (slotCount == 0 || slotSizeInByte == 0 || slotSizeInByte > std::numeric_limits<size_t>::max() / slotCount) {
+        return nullptr;
+    }
+
+    void* base = mmap(NULL, static_cast<size_t>(slotSizeInByte * slotCount), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    return new MemoryPool(reinterpret_cast<uint8_t*>(base), slotCount, slotSizeInByte);
+#else
+    return nullptr;
+#endif
+}
+
+MemoryPool::MemoryPool(uint8_t* base, size_t slotCount, uint64_t slotSizeInByte)
+    : m_base(base)
+    , m_slotSizeInByte(slotSizeInByte)
+    , m_usedSlots(slotCount, false)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.slotCount = slotCount;
+
+    // The lowest slots are allocated first.
+    m_freeSlots.reserve(slotCount);
+    for (size_t i = slotCount; i > 0; i--) {
+        m_freeSlots.push_back(i - 1);
+    }
+}
+
+MemoryPool::~MemoryPool()
+{
+    // All memories must be released before the pool.
+    ASSERT(m_stats.slotsInUse == 0);
+#if defined(WALRUS_USE_MMAP)
+    munmap(m_base, static_cast<size_t>(m_slotSizeInByte * m_stats.slotCount));
+#endif
+}
+
+uint8_t* MemoryPool::allocate()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if (m_freeSlots.empty()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    size_t index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    m_stats.allocations++;
+    if (m_usedSlots[index]) {
+        m_stats.reuses++;
+    }
+    m_usedSlots[index] = true;
+
+    m_stats.slotsInUse++;
+    m_stats.highWaterMark = std::max(m_stats.highWaterMark, m_stats.slotsInUse);
+    return m_base + index * m_slotSizeInByte;
+}
+
+void MemoryPool::release(uint8_t* slot, uint64_t usedSizeInByte, bool hasMappedFile)
+{
+    ASSERT(slot >= m_base && static_cast<size_t>(slot - m_base) % m_slotSizeInByte == 0);
+
+#if defined(WALRUS_USE_MMAP)
+    if (usedSizeInByte > 0) {
+        if (hasMappedFile) {
+            // Dropping the private pages would expose the file content again.
+            mmap(slot, usedSizeInByte, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        } else {
+            madvise(slot, usedSizeInByte, MADV_DONTNEED);
+            mprotect(slot, usedSizeInByte, PROT_NONE);
+        }
+    }
+#endif
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_freeSlots.push_back(static_cast<size_t>(slot - m_base) / m_slotSizeInByte);
+    m_stats.slotsInUse--;
+}
+
+void MemoryPool::recordMiss()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stats.misses++;
+}
+
+MemoryPool::Stats MemoryPool::stats()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_stats;
+}
+
+} // namespace Walrus
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __WalrusMemoryPool__
+#define __WalrusMemoryPool__
+
+#include <mutex>
+
+namespace Walrus {
+
+// Preallocated address space for linear memories. The slots are reset with
+// madvise and mprotect when a memory is released, so creating and destroying
+// memories does not map and unmap address space.
+class MemoryPool {
+public:
+    struct Stats {
+        size_t slotCount;
+        size_t slotsInUse;
+        // Maximum of slotsInUse.
+        size_t highWaterMark;
+        size_t allocations;
+        // Allocations which received a previously used slot.
+        size_t reuses;
+        // Memories which did not fit into a slot, or found no free slot.
+        size_t misses;
+    };
+
+#if defined(WALRUS_64)
+    static const uint64_t s_defaultSlotSizeInByte = static_cast<uint64_t>(1) << 32;
+#else
+    static const uint64_t s_defaultSlotSizeInByte = 1024 * 1024 * 64;
+#endif
+
+    // Returns nullptr when the platform does not support memory
+    // pools, or the address space cannot be reserved.
+    static MemoryPool* create(size_t slotCount, uint64_t slotSizeInByte);
+
+    ~MemoryPool();
+
+    uint64_t slotSizeInByte() const
+    {
+        return m_slotSizeInByte;
+    }
+
+    // Returns an inaccessible slot, or nullptr when all slots are used.
+    uint8_t* allocate();
+    // Discards the content of the first usedSizeInByte bytes and makes
+    // them inaccessible. Files mapped into the slot are replaced as well.
+    void release(uint8_t* slot, uint64_t usedSizeInByte, bool hasMappedFile);
+    void recordMiss();
+
+    Stats stats();
+
+private:
+    MemoryPool(uint8_t* base, size_t slotCount, uint64_t slotSizeInByte);
+
+    std::mutex m_mutex;
+    uint8_t* m_base;
+    uint64_t m_slotSizeInByte;
+    std::vector<size_t> m_freeSlots;
+    std::vector<bool> m_usedSlots;
+    Stats m_stats;
+};
+
+} // namespace Walrus
+
+#endif // __WalrusMemoryPool__
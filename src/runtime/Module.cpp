@@ -16,8 +16,10 @@
 #include "Walrus.h"
 
 #include "runtime/Store.h"
+#include "runtime/Engine.h"
 #include "runtime/Module.h"
 #include "runtime/Instance.h"
+#include "runtime/InstanceSnapshot.h"
 #include "runtime/Function.h"
 #include "runtime/Global.h"
 #include "runtime/Table.h"
@@ -35,11 +37,14 @@ namespace Walrus {
 DEFINE_GLOBAL_TYPE_INFO(moduleTypeInfo, ModuleKind);
 
 ModuleFunction::ModuleFunction(FunctionType* functionType)
-    : m_hasTryCatch(false)
+    : m_hasByteCode(true)
+    , m_hasTryCatch(false)
     , m_requiredStackSize(std::max(functionType->paramStackSize(), functionType->resultStackSize()))
+    , m_lazyIndex(0)
     , m_functionType(functionType)
 #if defined(WALRUS_ENABLE_JIT)
     , m_jitFunction(nullptr)
+    , m_tierUpCounter(0)
 #endif
 {
 }
@@ -60,24 +65,97 @@ Module::Module(Store* store, WASMParsingResult& result)
     , m_tableTypes(std::move(result.m_tableTypes))
     , m_memoryTypes(std::move(result.m_memoryTypes))
     , m_tagTypes(std::move(result.m_tagTypes))
+    , m_lazyByteCodeGenerator(result.m_lazyByteCodeGenerator)
 #if defined(WALRUS_ENABLE_JIT)
     , m_jitModule(nullptr)
+    , m_tierUpCompiler(nullptr)
 #endif
 {
+    result.m_lazyByteCodeGenerator = nullptr;
     store->appendModule(this);
 }
 
 ModuleFunction::~ModuleFunction()
 {
 #if defined(WALRUS_ENABLE_JIT)
-    if (m_jitFunction != nullptr) {
-        delete m_jitFunction;
+    JITFunction* jitFunction = m_jitFunction.load(std::memory_order_relaxed);
+
+    if (jitFunction != nullptr) {
+        delete jitFunction;
     }
 #endif
 }
 
+void ModuleFunction::buildCatchRanges()
+{
+    m_catchRanges.clear();
+
+    size_t i = 0;
+    while (i < m_catchInfo.size()) {
+        CatchRange range = { m_catchInfo[i].m_tryStart, m_catchInfo[i].m_tryEnd, static_cast<uint32_t>(i), 0, s_noCatchRange };
+
+        while (i < m_catchInfo.size() && m_catchInfo[i].m_tryStart == range.m_tryStart && m_catchInfo[i].m_tryEnd == range.m_tryEnd) {
+            range.m_catchCount++;
+            i++;
+        }
+        m_catchRanges.push_back(range);
+    }
+
+    // Outer ranges are ordered before the ranges they enclose.
+    std::stable_sort(m_catchRanges.data(), m_catchRanges.data() + m_catchRanges.size(), [](const CatchRange& a, const CatchRange& b) {
+        return a.m_tryStart < b.m_tryStart || (a.m_tryStart == b.m_tryStart && a.m_tryEnd > b.m_tryEnd);
+    });
+
+    std::vector<uint32_t> enclosingRanges;
+    for (size_t i = 0; i < m_catchRanges.size(); i++) {
+        CatchRange& range = m_catchRanges[i];
+
+        while (!enclosingRanges.empty() && m_catchRanges[enclosingRanges.back()].m_tryEnd <= range.m_tryStart) {
+            enclosingRanges.pop_back();
+        }
+
+        if (!enclosingRanges.empty()) {
+            ASSERT(m_catchRanges[enclosingRanges.back()].m_tryEnd >= range.m_tryEnd);
+            range.m_parent = enclosingRanges.back();
+        }
+        enclosingRanges.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+const ModuleFunction::CatchRange* ModuleFunction::findCatchRange(size_t offset) const
+{
+    // Last range which starts at or before the offset.
+    const CatchRange* begin = m_catchRanges.data();
+    const CatchRange* range = std::upper_bound(begin, begin + m_catchRanges.size(), offset, [](size_t offset, const CatchRange& range) {
+        return offset < range.m_tryStart;
+    });
+
+    if (range == begin) {
+        return nullptr;
+    }
+
+    // The range may end before the offset, but one of its enclosing ranges may contain it.
+    for (range--; range != nullptr; range = parentCatchRange(range)) {
+        if (offset < range->m_tryEnd) {
+            return range;
+        }
+    }
+    return nullptr;
+}
+
 Module::~Module()
 {
+#if defined(WALRUS_ENABLE_JIT)
+    // The compiler thread must be stopped before the functions are freed.
+    if (m_tierUpCompiler != nullptr) {
+        delete m_tierUpCompiler;
+    }
+#endif
+
+    if (m_lazyByteCodeGenerator != nullptr) {
+        delete m_lazyByteCodeGenerator;
+    }
+
     // Types are freed by the type store.
 
     for (size_t i = 0; i < m_imports.size(); i++) {
@@ -123,8 +201,15 @@ Module::~Module()
 #endif
 }
 
-Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports)
+std::string Module::generateByteCode(ModuleFunction* function)
+{
+    ASSERT(m_lazyByteCodeGenerator != nullptr);
+    return m_lazyByteCodeGenerator->generate(this, function);
+}
+
+Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports, const InstanceSnapshot* snapshot)
 {
+    ASSERT(!snapshot || snapshot->module() == this);
     Instance* instance = Instance::newInstance(this);
 
     void** references = instance->alignedEnd();
@@ -243,6 +328,12 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
 
     // init table
     while (tableIndex < m_tableTypes.size()) {
+        if (snapshot) {
+            instance->m_tables[tableIndex] = snapshot->createTable(instance, m_store, tableIndex);
+            tableIndex++;
+            continue;
+        }
+
         TableType* tableType = m_tableTypes[tableIndex];
         void* initValue = nullptr;
 
@@ -271,6 +362,12 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
 
     // init memory
     while (memIndex < m_memoryTypes.size()) {
+        if (snapshot) {
+            instance->m_memories[memIndex] = snapshot->createMemory(state, m_store, memIndex);
+            memIndex++;
+            continue;
+        }
+
         instance->m_memories[memIndex] = Memory::createMemory(m_store, m_memoryTypes[memIndex]->initialSize() * Memory::s_memoryPageSize, m_memoryTypes[memIndex]->maximumSize() * Memory::s_memoryPageSize,
                                                               m_memoryTypes[memIndex]->isShared(), m_memoryTypes[memIndex]->is64());
         memIndex++;
@@ -289,6 +386,12 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
 
     // init global
     while (globIndex < m_globalTypes.size()) {
+        if (snapshot) {
+            instance->m_globals[globIndex] = snapshot->createGlobal(instance, m_store, globIndex);
+            globIndex++;
+            continue;
+        }
+
         GlobalType* globalType = m_globalTypes[globIndex];
         instance->m_globals[globIndex] = Global::createGlobal(m_store, Value(globalType->type()), globalType->type());
 
@@ -315,6 +418,12 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
 
     // init table(elem segment)
     for (size_t i = 0; i < m_elements.size(); i++) {
+        if (snapshot) {
+            // Active segments are already copied into the table images.
+            snapshot->initElementSegment(instance, i, instance->m_elementSegments + i);
+            continue;
+        }
+
         Element* elem = m_elements[i];
         const auto& exprs = elem->exprFunctions();
 
@@ -381,6 +490,15 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
     for (size_t i = 0; i < m_datas.size(); i++) {
         Data* init = m_datas[i];
         instance->m_dataSegments[i] = DataSegment(init);
+
+        if (snapshot) {
+            // Active segments are already copied into the memory images.
+            if (snapshot->isDataSegmentDropped(i)) {
+                instance->m_dataSegments[i].drop();
+            }
+            continue;
+        }
+
         struct RunData {
             Data* init;
             Instance* instance;
@@ -422,7 +540,7 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
     ASSERT(tagIndex == numberOfTagTypes());
 #endif
 
-    if (m_seenStartAttribute) {
+    if (m_seenStartAttribute && !snapshot) {
         ASSERT(instance->m_functions[m_start]->functionType()->param().size() == 0);
         ASSERT(instance->m_functions[m_start]->functionType()->result().size() == 0);
         instance->m_functions[m_start]->call(state, nullptr, nullptr);
@@ -431,6 +549,41 @@ Instance* Module::instantiate(ExecutionState& state, const ExternVector& imports
     return instance;
 }
 
+#if defined(WALRUS_ENABLE_JIT)
+uint32_t Module::JITThreadCount() const
+{
+    return m_store->engine() ? m_store->engine()->JITThreadCount() : 1;
+}
+
+void Module::enableTierUp(uint32_t JITFlags)
+{
+    ASSERT(m_tierUpCompiler == nullptr);
+    m_tierUpCompiler = new TierUpCompiler(this, JITFlags);
+
+    uint32_t threshold = EngineConfig::s_defaultTierUpThreshold;
+    if (m_store->engine()) {
+        threshold = m_store->engine()->config().tierUpThreshold;
+    }
+
+    // A counter of 0 would disable tiering.
+    if (threshold == 0) {
+        threshold = 1;
+    } else if (threshold > INT32_MAX) {
+        threshold = INT32_MAX;
+    }
+
+    for (size_t i = 0; i < m_functions.size(); i++) {
+        m_functions[i]->setTierUpCounter(static_cast<int32_t>(threshold));
+    }
+}
+
+void Module::tierUp(ModuleFunction* function)
+{
+    ASSERT(m_tierUpCompiler != nullptr);
+    m_tierUpCompiler->enqueue(function);
+}
+#endif
+
 #if !defined(NDEBUG)
 
 static const char* typeName(Value::Type v)
@@ -19,6 +19,7 @@
 
 #include "runtime/ObjectType.h"
 #include "runtime/Object.h"
+#include <atomic>
 
 namespace wabt {
 class WASMBinaryReader;
@@ -30,8 +31,12 @@ namespace Walrus {
 class Store;
 class Module;
 class Instance;
+class InstanceSnapshot;
 class JITFunction;
 class JITModule;
+class TierUpCompiler;
+class WASMParser;
+class LazyByteCodeGenerator;
 
 struct WASMParsingResult;
 
@@ -40,6 +45,15 @@ enum JITFlagValue : uint32_t {
     JITVerbose = 1 << 1,
     JITVerboseColor = 1 << 2,
     disableRegAlloc = 1 << 3,
+    // Functions are interpreted first, and compiled
+    // in the background when they become hot.
+    useTiering = 1 << 4,
+    // Function bodies are only validated when the module is parsed, and
+    // their byte code is generated when they are called first. Without
+    // tiering, the JIT compiler also compiles them at that time.
+    lazyCompile = 1 << 5,
+    // Small callees are not inlined into their callers.
+    disableInline = 1 << 6,
 };
 
 enum class SegmentMode {
@@ -202,6 +216,8 @@ private:
 
 class ModuleFunction {
     friend class wabt::WASMBinaryReader;
+    friend class WASMParser;
+    friend class LazyByteCodeGenerator;
 
 public:
     struct CatchInfo {
@@ -213,9 +229,30 @@ public:
         bool m_pushExnRef;
     };
 
+    // The catch clauses of a try block, which are consecutive items of
+    // catchInfo(). Try blocks are properly nested, so the ranges are sorted
+    // by their start offsets, and each range refers to the innermost range
+    // which encloses it.
+    struct CatchRange {
+        size_t m_tryStart;
+        size_t m_tryEnd;
+        uint32_t m_firstCatch;
+        uint32_t m_catchCount;
+        uint32_t m_parent;
+    };
+
+    static const uint32_t s_noCatchRange = std::numeric_limits<uint32_t>::max();
+
     ModuleFunction(FunctionType* functionType);
     ~ModuleFunction();
 
+    // False until the byte code of a function parsed
+    // with JITFlagValue::lazyCompile is generated.
+    bool hasByteCode() const
+    {
+        return m_hasByteCode.load(std::memory_order_acquire);
+    }
+
     bool hasTryCatch() const { return m_hasTryCatch; }
     uint16_t requiredStackSize() const { return m_requiredStackSize; }
     FunctionType* functionType() const { return m_functionType; }
@@ -242,22 +279,55 @@ public:
         return m_catchInfo;
     }
 
+    // Must be called after catchInfo() is filled.
+    void buildCatchRanges();
+
+    // Returns the innermost range which contains the offset, or nullptr.
+    const CatchRange* findCatchRange(size_t offset) const;
+
+    const CatchRange* parentCatchRange(const CatchRange* range) const
+    {
+        return range->m_parent == s_noCatchRange ? nullptr : &m_catchRanges[range->m_parent];
+    }
+
 #if defined(WALRUS_ENABLE_JIT)
     void setJITFunction(JITFunction* jitFunction)
     {
-        ASSERT(m_jitFunction == nullptr);
-        m_jitFunction = jitFunction;
+        ASSERT(m_jitFunction.load(std::memory_order_relaxed) == nullptr);
+        m_jitFunction.store(jitFunction, std::memory_order_release);
     }
 
     JITFunction* jitFunction()
     {
-        return m_jitFunction;
+        return m_jitFunction.load(std::memory_order_acquire);
+    }
+
+    void setTierUpCounter(int32_t value)
+    {
+        m_tierUpCounter.store(value, std::memory_order_relaxed);
+    }
+
+    // Called by the interpreter for calls and loop back-edges, possibly
+    // on several threads. Returns true once, when the counter reaches
+    // zero. A counter which is not positive (zero is the default) is
+    // not decremented, which disables tiering. Racing decrements may
+    // move the counter below zero, which also stops the counting.
+    bool countTierUp()
+    {
+        if (LIKELY(m_tierUpCounter.load(std::memory_order_relaxed) <= 0)) {
+            return false;
+        }
+
+        return m_tierUpCounter.fetch_sub(1, std::memory_order_relaxed) == 1;
     }
 #endif
 
 private:
+    std::atomic<bool> m_hasByteCode;
     bool m_hasTryCatch;
     uint16_t m_requiredStackSize;
+    // Function index used by LazyByteCodeGenerator.
+    uint32_t m_lazyIndex;
     FunctionType* m_functionType;
     ValueTypeVector m_local;
     VectorWithFixedSize<uint8_t, std::allocator<uint8_t>> m_byteCode;
@@ -266,8 +336,11 @@ private:
     Vector<std::pair<Value, size_t>, std::allocator<std::pair<Value, size_t>>> m_constantDebugData;
 #endif
     Vector<CatchInfo, std::allocator<CatchInfo>> m_catchInfo;
+    Vector<CatchRange, std::allocator<CatchRange>> m_catchRanges;
 #if defined(WALRUS_ENABLE_JIT)
-    JITFunction* m_jitFunction;
+    // Written by the background compiler when tiering is enabled.
+    std::atomic<JITFunction*> m_jitFunction;
+    std::atomic<int32_t> m_tierUpCounter;
 #endif
 };
 
@@ -355,6 +428,8 @@ class Module : public Object {
     friend class wabt::WASMComponentBinaryReader;
     friend class JITCompiler;
     friend class Store;
+    friend class WASMParser;
+    friend class InstanceSnapshot;
 
 public:
     Module(Store* store, WASMParsingResult& result);
@@ -453,16 +528,40 @@ public:
 
     void postParsing();
 
-    Instance* instantiate(ExecutionState& state, const ExternVector& imports);
+    // Generates the byte code of a function when it is called first. Returns
+    // with an error message if the function cannot be compiled.
+    std::string generateByteCode(ModuleFunction* function);
+
+    Instance* instantiate(ExecutionState& state, const ExternVector& imports)
+    {
+        return instantiate(state, imports, nullptr);
+    }
 
 #if defined(WALRUS_ENABLE_JIT)
     /* Passing 0 as functionsLength compiles all functions. */
     void jitCompile(ModuleFunction** functions, size_t functionsLength, uint32_t JITFlags);
+
+    // Maximum number of threads used by jitCompile,
+    // which is selected by the engine of the store.
+    uint32_t JITThreadCount() const;
+
+    // Functions are compiled by a background thread after they are
+    // executed EngineConfig::tierUpThreshold times.
+    void enableTierUp(uint32_t JITFlags);
+    void tierUp(ModuleFunction* function);
 #endif
 
 private:
     ~Module();
 
+    // When a snapshot is passed, the state is restored from the snapshot
+    // instead of evaluating the initializers and the start function.
+    Instance* instantiate(ExecutionState& state, const ExternVector& imports, const InstanceSnapshot* snapshot);
+
+#if defined(WALRUS_ENABLE_JIT)
+    void jitCompileFunctions(ModuleFunction** functions, size_t functionsLength, uint32_t JITFlags);
+#endif
+
     Store* m_store;
     bool m_seenStartAttribute;
     uint32_t m_version;
@@ -481,8 +580,11 @@ private:
     TableTypeVector m_tableTypes;
     MemoryTypeVector m_memoryTypes;
     TagTypeVector m_tagTypes;
+    LazyByteCodeGenerator* m_lazyByteCodeGenerator;
 #if defined(WALRUS_ENABLE_JIT)
     JITModule* m_jitModule;
+    TierUpCompiler* m_tierUpCompiler;
+
 #endif
 };
 
@@ -23,22 +23,17 @@
 
 namespace Walrus {
 
-bool FunctionType::equals(const FunctionType* other, bool isSubType) const
+bool FunctionType::equalsSlowCase(const FunctionType* other, bool isSubType) const
 {
-    if (this == other) {
-        return true;
-    }
+    ASSERT(this != other);
 
-    // TODO: This should work for all types.
-    // However, functions defined by API has no type at
-    // the moment represented by a null recursive type.
+    // Canonical types are unique, so different types
+    // can only match when subtyping is allowed.
     if (getRecursiveType() != nullptr && other->getRecursiveType() != nullptr) {
-        if (isSubType) {
-            return other->isSubTypeOf(this);
-        }
-        return getRecursiveType() == other->getRecursiveType();
+        return isSubType && other->isSubTypeOf(this);
     }
 
+    // Types without a recursive type are compared structurally.
     if (getRecursiveType() != nullptr && !getRecursiveType()->isSingleType()) {
         return false;
     }
@@ -204,9 +204,20 @@ public:
         m_resultStackSize = computeStackSize(m_resultTypes);
     }
 
-    bool equals(const FunctionType* other, bool isSubType = false) const;
+    // Types created by modules and by the host are canonicalized by the TypeStore,
+    // so equal types are usually the same object. When isSubType is true, this
+    // type can also be a subtype of the other type.
+    bool equals(const FunctionType* other, bool isSubType = false) const
+    {
+        if (LIKELY(this == other)) {
+            return true;
+        }
+        return equalsSlowCase(other, isSubType);
+    }
 
 private:
+    bool equalsSlowCase(const FunctionType* other, bool isSubType) const;
+
     TypeVector m_paramTypes;
     TypeVector m_resultTypes;
     size_t m_paramStackSize;
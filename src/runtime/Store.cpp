@@ -16,6 +16,7 @@
 #include "Walrus.h"
 
 #include "runtime/Store.h"
+#include "runtime/Engine.h"
 #include "runtime/Module.h"
 #include "runtime/Instance.h"
 #include "runtime/Component.h"
@@ -40,6 +41,7 @@ static const FunctionType g_defaultFunctionTypes[] = {
 
 Store::Store(Engine* engine)
     : m_engine(engine)
+    , m_memoryReservationPolicy(engine && engine->config().reserveMemoryMaximum ? MemoryReservationPolicy::Maximum : MemoryReservationPolicy::Initial)
 #ifdef ENABLE_WASI
     , m_wasiData(nullptr)
 #endif
@@ -81,10 +83,6 @@ Store::~Store()
         delete m_externs[i];
     }
 
-    for (size_t i = 0; i < m_waiterList.size(); i++) {
-        delete m_waiterList[i];
-    }
-
     Store::finalize();
 
 #ifdef ENABLE_GC
@@ -106,20 +104,6 @@ FunctionType* Store::getDefaultFunctionType(Value::Type type)
     return const_cast<FunctionType*>(g_defaultFunctionTypes + static_cast<size_t>(type));
 }
 
-Waiter* Store::getWaiter(void* address)
-{
-    std::lock_guard<std::mutex> guard(m_waiterListLock);
-    for (size_t i = 0; i < m_waiterList.size(); i++) {
-        if (m_waiterList[i]->m_address == address) {
-            return m_waiterList[i];
-        }
-    }
-
-    Waiter* waiter = new Waiter(address);
-    m_waiterList.push_back(waiter);
-    return waiter;
-}
-
 FunctionType* Store::createDefinedFunctionType(DefinedFunctionType type)
 {
     const CompositeType** noIndex = reinterpret_cast<const CompositeType**>(TypeStore::NoIndex);
@@ -336,11 +320,7 @@ FunctionType* Store::createDefinedFunctionType(DefinedFunctionType type)
     }
 
     functionType->initDone();
-
-    Vector<CompositeType*> typeList;
-    typeList.push_back(functionType);
-    m_typeStore.updateTypes(typeList);
-    functionType = typeList[0]->asFunction();
+    functionType = m_typeStore.updateFunctionType(functionType);
 
     m_definedFuncTypes[type] = functionType;
     return functionType;
@@ -20,8 +20,9 @@
 #include "util/Vector.h"
 #include "runtime/TypeStore.h"
 #include "runtime/Value.h"
+#include "runtime/WaiterTable.h"
+
 #include <mutex>
-#include <condition_variable>
 
 namespace Walrus {
 
@@ -38,27 +39,6 @@ class FunctionType;
 class WasiStoreData;
 #endif
 
-struct Waiter {
-    struct WaiterItem {
-        WaiterItem(Waiter* waiter)
-            : m_waiter(waiter)
-        {
-        }
-
-        Waiter* m_waiter;
-    };
-
-    Waiter(void* addr)
-        : m_address(addr)
-    {
-    }
-
-    void* m_address;
-    std::mutex m_mutex;
-    std::condition_variable m_condition;
-    std::vector<WaiterItem*> m_waiterItemList;
-};
-
 class Store {
 public:
     enum DefinedFunctionType : uint8_t {
@@ -123,10 +103,34 @@ public:
         ComponentInstance* m_instance;
     };
 
+    // Address space reserved for the linear memories created by the store.
+    // Growing a memory within its reservation never moves the memory.
+    enum class MemoryReservationPolicy : uint8_t {
+        // Reserve at least the initial size, see Memory::Memory.
+        Initial,
+        // Reserve the declared maximum size, up to Memory::s_maxReservedSize.
+        Maximum,
+    };
+
     Store(Engine* engine);
 
     ~Store();
 
+    Engine* engine() const
+    {
+        return m_engine;
+    }
+
+    MemoryReservationPolicy memoryReservationPolicy() const
+    {
+        return m_memoryReservationPolicy;
+    }
+
+    void setMemoryReservationPolicy(MemoryReservationPolicy policy)
+    {
+        m_memoryReservationPolicy = policy;
+    }
+
     static void finalize();
     static FunctionType* getDefaultFunctionType(Value::Type type);
 
@@ -140,26 +144,31 @@ public:
 
     void appendModule(Module* module)
     {
+        std::lock_guard<std::mutex> guard(m_mutex);
         m_modules.push_back(module);
     }
 
     void appendInstance(Instance* instance)
     {
+        std::lock_guard<std::mutex> guard(m_mutex);
         m_instances.push_back(instance);
     }
 
     void appendComponent(Component* component)
     {
+        std::lock_guard<std::mutex> guard(m_mutex);
         m_components.push_back(component);
     }
 
     void appendComponentInstance(ComponentInstance* instance)
     {
+        std::lock_guard<std::mutex> guard(m_mutex);
         m_componentInstances.push_back(instance);
     }
 
     void appendExtern(Extern* ext)
     {
+        std::lock_guard<std::mutex> guard(m_mutex);
         m_externs.push_back(ext);
     }
 
@@ -174,7 +183,10 @@ public:
         return m_typeStore;
     }
 
-    Waiter* getWaiter(void* address);
+    WaiterTable& waiterTable()
+    {
+        return m_waiterTable;
+    }
 
     ComponentContext* context() const
     {
@@ -198,18 +210,21 @@ private:
     FunctionType* createDefinedFunctionType(DefinedFunctionType type);
 
     Engine* m_engine;
+    MemoryReservationPolicy m_memoryReservationPolicy;
     TypeStore m_typeStore;
 
     FunctionType* m_definedFuncTypes[FUNC_TYPES_NUM];
 
+    // Guards the object lists below, since threads started by
+    // wasi-threads create their instances concurrently.
+    std::mutex m_mutex;
     Vector<Module*> m_modules;
     Vector<Instance*> m_instances;
     Vector<Component*> m_components;
     Vector<ComponentInstance*> m_componentInstances;
     Vector<Extern*> m_externs;
 
-    std::mutex m_waiterListLock;
-    std::vector<Waiter*> m_waiterList;
+    WaiterTable m_waiterTable;
 
     ComponentContext* m_context;
 #ifdef ENABLE_WASI
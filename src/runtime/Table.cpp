@@ -30,6 +30,39 @@ namespace Walrus {
 
 DEFINE_GLOBAL_TYPE_INFO(tableTypeInfo, TableKind);
 
+static bool isFunctionTable(const Type& type)
+{
+    Value::Type kind = Value::toNonNullableRefType(type.type());
+
+    if (kind == Value::DefinedRef) {
+        return type.ref()->kind() == ObjectType::FunctionKind;
+    }
+    return kind == Value::FuncRef || kind == Value::NoFuncRef;
+}
+
+template <typename T>
+static T* allocateTableData(T* data, uint64_t size)
+{
+#ifdef ENABLE_GC
+    if (LIKELY(data != nullptr)) {
+        return reinterpret_cast<T*>(GC_REALLOC(data, static_cast<size_t>(size) * sizeof(T)));
+    }
+    return reinterpret_cast<T*>(GC_MALLOC_UNCOLLECTABLE(static_cast<size_t>(size) * sizeof(T)));
+#else
+    return reinterpret_cast<T*>(realloc(data, static_cast<size_t>(size) * sizeof(T)));
+#endif
+}
+
+template <typename T>
+static void freeTableData(T* data)
+{
+#ifdef ENABLE_GC
+    GC_FREE(data);
+#else
+    free(data);
+#endif
+}
+
 Table* Table::createTable(Store* store, Type type, uint64_t initialSize, uint64_t maximumSize, bool is64, void* init)
 {
     Table* tbl = new Table(type, initialSize, maximumSize, is64, init ? init : reinterpret_cast<void*>(Value::NullBits));
@@ -44,9 +77,10 @@ Table::Table(Type type, uint64_t initialSize, uint64_t maximumSize, bool is64, v
     , m_is64(is64)
     , m_size(initialSize)
     , m_maximumSize(maximumSize)
+    , m_elements(nullptr)
+    , m_typeIds(nullptr)
 {
     if (initialSize == 0) {
-        m_elements = nullptr;
         return;
     }
 
@@ -55,21 +89,19 @@ Table::Table(Type type, uint64_t initialSize, uint64_t maximumSize, bool is64, v
         initialSize = SIZE_MAX / sizeof(void*);
     }
 
-#ifdef ENABLE_GC
-    m_elements = reinterpret_cast<void**>(GC_MALLOC_UNCOLLECTABLE(static_cast<size_t>(initialSize) * sizeof(void*)));
-#else
-    m_elements = reinterpret_cast<void**>(malloc(static_cast<size_t>(initialSize) * sizeof(void*)));
-#endif
+    m_elements = allocateTableData(m_elements, initialSize);
     std::fill(m_elements, m_elements + initialSize, init);
+
+    if (isFunctionTable(type)) {
+        m_typeIds = allocateTableData(m_typeIds, initialSize);
+        std::fill(m_typeIds, m_typeIds + initialSize, typeIdOf(init));
+    }
 }
 
 Table::~Table()
 {
-#ifdef ENABLE_GC
-    GC_FREE(m_elements);
-#else
-    free(m_elements);
-#endif
+    freeTableData(m_elements);
+    freeTableData(m_typeIds);
 }
 
 bool Table::grow(uint64_t newSize, void* val)
@@ -84,21 +116,22 @@ bool Table::grow(uint64_t newSize, void* val)
         newSize = SIZE_MAX / sizeof(void*);
     }
 
-    void** elements;
-#ifdef ENABLE_GC
-    if (LIKELY(m_elements != nullptr)) {
-        elements = reinterpret_cast<void**>(GC_REALLOC(m_elements, static_cast<size_t>(newSize) * sizeof(void*)));
-    } else {
-        elements = reinterpret_cast<void**>(GC_MALLOC_UNCOLLECTABLE(static_cast<size_t>(newSize) * sizeof(void*)));
-    }
-#else
-    elements = reinterpret_cast<void**>(realloc(m_elements, static_cast<size_t>(newSize) * sizeof(void*)));
-#endif
+    void** elements = allocateTableData(m_elements, newSize);
     if (elements == nullptr) {
         return false;
     }
-
     m_elements = elements;
+
+    // The constructor allocates the type ids only for non-empty tables.
+    if (isFunctionTable(m_type)) {
+        const FunctionType** typeIds = allocateTableData(m_typeIds, newSize);
+        if (typeIds == nullptr) {
+            return false;
+        }
+        m_typeIds = typeIds;
+        std::fill(m_typeIds + m_size, m_typeIds + newSize, typeIdOf(val));
+    }
+
     std::fill(m_elements + m_size, m_elements + newSize, val);
     m_size = newSize;
     return true;
@@ -142,17 +175,36 @@ void Table::throwException(ExecutionState& state) const
 void Table::initTable(ElementSegment* source, uint64_t dstStart, uint32_t srcStart, uint32_t srcSize)
 {
     memcpy(m_elements + dstStart, source->elements() + srcStart, srcSize * sizeof(void*));
+
+    if (m_typeIds != nullptr) {
+        for (uint32_t i = 0; i < srcSize; i++) {
+            m_typeIds[dstStart + i] = typeIdOf(source->element(srcStart + i));
+        }
+    }
 }
 
 void Table::copyTable(const Table* srcTable, uint64_t n, uint64_t srcIndex, uint64_t dstIndex)
 {
     memmove(m_elements + dstIndex, srcTable->m_elements + srcIndex, n * sizeof(void*));
+
+    if (m_typeIds == nullptr) {
+        return;
+    }
+
+    if (srcTable->m_typeIds != nullptr) {
+        memmove(m_typeIds + dstIndex, srcTable->m_typeIds + srcIndex, n * sizeof(const FunctionType*));
+        return;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        m_typeIds[dstIndex + i] = typeIdOf(m_elements[dstIndex + i]);
+    }
 }
 
 void Table::fillTable(uint64_t n, void* value, uint64_t index)
 {
     while (n > 0) {
-        m_elements[index] = value;
+        uncheckedSetElementInternal(index, value);
         n--;
         index++;
     }
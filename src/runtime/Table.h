@@ -20,6 +20,7 @@
 #include "runtime/Type.h"
 #include "runtime/Value.h"
 #include "runtime/Object.h"
+#include "runtime/Function.h"
 
 namespace Walrus {
 
@@ -85,13 +86,26 @@ public:
         return m_elements[elemIndex];
     }
 
+    // Canonical function type of an element, which is nullptr for null
+    // elements. Only tables of function references have type ids.
+    const FunctionType* uncheckedGetTypeId(uint64_t elemIndex) const
+    {
+        ASSERT(m_typeIds != nullptr && elemIndex < m_size);
+        return m_typeIds[elemIndex];
+    }
+
+    bool hasTypeIds() const
+    {
+        return m_typeIds != nullptr;
+    }
+
     void setElement(ExecutionState& state, uint32_t elemIndex, void* val)
     {
         ASSERT(!m_is64);
         if (UNLIKELY(elemIndex >= m_size)) {
             throwException(state);
         }
-        m_elements[elemIndex] = val;
+        uncheckedSetElementInternal(elemIndex, val);
     }
 
     void setElementM64(ExecutionState& state, uint64_t elemIndex, void* val)
@@ -100,19 +114,19 @@ public:
         if (UNLIKELY(elemIndex >= m_size)) {
             throwException(state);
         }
-        m_elements[elemIndex] = val;
+        uncheckedSetElementInternal(elemIndex, val);
     }
 
     void uncheckedSetElement(uint32_t elemIndex, void* val)
     {
         ASSERT(!m_is64 && elemIndex < m_size);
-        m_elements[elemIndex] = val;
+        uncheckedSetElementInternal(elemIndex, val);
     }
 
     void uncheckedSetElementM64(uint64_t elemIndex, void* val)
     {
         ASSERT(m_is64 && elemIndex < m_size);
-        m_elements[elemIndex] = val;
+        uncheckedSetElementInternal(elemIndex, val);
     }
 
     bool grow(uint64_t newSize, void* val);
@@ -132,6 +146,22 @@ private:
         return size <= m_size && start <= m_size - size;
     }
 
+    static const FunctionType* typeIdOf(void* val)
+    {
+        if (Value::isNull(val)) {
+            return nullptr;
+        }
+        return reinterpret_cast<Function*>(val)->functionType();
+    }
+
+    void uncheckedSetElementInternal(uint64_t elemIndex, void* val)
+    {
+        m_elements[elemIndex] = val;
+        if (m_typeIds != nullptr) {
+            m_typeIds[elemIndex] = typeIdOf(val);
+        }
+    }
+
     void throwException(ExecutionState& state) const;
 
     // Table has elements of reference type (FuncRef | ExternRef)
@@ -142,6 +172,10 @@ private:
 
     // FIXME handle references of Function objects
     void** m_elements;
+    // Parallel to m_elements for tables of function references. Function
+    // types are canonicalized by the TypeStore, so call_indirect compares
+    // the expected type with the id of the element without loading the callee.
+    const FunctionType** m_typeIds;
 };
 
 } // namespace Walrus
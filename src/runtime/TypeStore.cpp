@@ -379,6 +379,16 @@ void TypeStore::updateTypes(Vector<CompositeType*>& types)
     }
 }
 
+FunctionType* TypeStore::updateFunctionType(FunctionType* type)
+{
+    ASSERT(type->getRecursiveType() == nullptr && type->subTypeList() == reinterpret_cast<const CompositeType**>(NoIndex));
+
+    Vector<CompositeType*> typeList;
+    typeList.push_back(type);
+    updateTypes(typeList);
+    return typeList[0]->asFunction();
+}
+
 void TypeStore::destroyRecursiveType(RecursiveType* recType)
 {
     ASSERT(recType->m_refCount == 0);
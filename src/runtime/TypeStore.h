@@ -97,6 +97,9 @@ public:
     }
 
     void updateTypes(Vector<CompositeType*>& types);
+    // Canonicalizes a function type created outside of modules, which has
+    // no type references. The passed type is replaced by the returned type.
+    FunctionType* updateFunctionType(FunctionType* type);
     void releaseTypes(Vector<CompositeType*>& types);
     void releaseTypes(CompositeTypeVector& types);
 
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Walrus.h"
+
+#include "runtime/WaiterTable.h"
+
+#include <chrono>
+
+#if defined(WALRUS_USE_FUTEX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Walrus {
+
+WaiterTable::~WaiterTable()
+{
+#ifndef NDEBUG
+    for (size_t i = 0; i < s_shardCount; i++) {
+        ASSERT(m_shards[i].queues.empty());
+    }
+#endif
+}
+
+WaiterTable::WaitResult WaiterTable::park(Shard& shard, std::unique_lock<std::mutex>& lock, void* address, WaitNode& node, int64_t timeOut)
+{
+    WaitQueue& queue = shard.queues.insert(std::make_pair(address, WaitQueue{ nullptr, nullptr })).first->second;
+
+    node.prev = queue.tail;
+    if (queue.tail) {
+        queue.tail->next = &node;
+    } else {
+        queue.head = &node;
+    }
+    queue.tail = &node;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    bool infinite = timeOut < 0;
+
+    // Large timeouts would overflow the deadline.
+    if (!infinite && timeOut > std::numeric_limits<int64_t>::max() - std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count()) {
+        infinite = true;
+    }
+    Clock::time_point deadline = start;
+    if (!infinite) {
+        deadline += std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timeOut));
+    }
+
+#if defined(WALRUS_USE_FUTEX)
+    lock.unlock();
+
+    while (node.notified.load(std::memory_order_acquire) == 0) {
+        struct timespec remaining;
+        struct timespec* timeout = nullptr;
+
+        if (!infinite) {
+            int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+            if (nanoseconds <= 0) {
+                break;
+            }
+            remaining.tv_sec = static_cast<time_t>(nanoseconds / 1000000000);
+            remaining.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+            timeout = &remaining;
+        }
+
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&node.notified), FUTEX_WAIT_PRIVATE, 0, timeout, nullptr, 0);
+    }
+
+    // Notify wakes the futex with the lock held, so the
+    // node cannot be freed before the wake call returns.
+    lock.lock();
+#else
+    while (node.notified.load(std::memory_order_relaxed) == 0) {
+        if (infinite) {
+            node.condition.wait(lock);
+        } else if (node.condition.wait_until(lock, deadline) == std::cv_status::timeout) {
+            break;
+        }
+    }
+#endif
+
+    if (node.notified.load(std::memory_order_relaxed) != 0) {
+        return Ok;
+    }
+
+    remove(shard, address, &node);
+    return TimedOut;
+}
+
+void WaiterTable::remove(Shard& shard, void* address, WaitNode* node)
+{
+    auto iter = shard.queues.find(address);
+    ASSERT(iter != shard.queues.end());
+    WaitQueue& queue = iter->second;
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        queue.head = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        queue.tail = node->prev;
+    }
+
+    if (queue.head == nullptr) {
+        shard.queues.erase(iter);
+    }
+}
+
+uint32_t WaiterTable::notify(void* address, uint32_t count)
+{
+    Shard& shard = shardOf(address);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    auto iter = shard.queues.find(address);
+    if (iter == shard.queues.end()) {
+        return 0;
+    }
+
+    WaitQueue& queue = iter->second;
+    uint32_t woken = 0;
+
+    while (woken < count && queue.head != nullptr) {
+        WaitNode* node = queue.head;
+
+        queue.head = node->next;
+        if (queue.head) {
+            queue.head->prev = nullptr;
+        }
+
+        node->notified.store(1, std::memory_order_release);
+#if defined(WALRUS_USE_FUTEX)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&node->notified), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        node->condition.notify_one();
+#endif
+        woken++;
+    }
+
+    if (queue.head == nullptr) {
+        shard.queues.erase(iter);
+    }
+    return woken;
+}
+
+} // namespace Walrus
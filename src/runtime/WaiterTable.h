@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022-present Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __WalrusWaiterTable__
+#define __WalrusWaiterTable__
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#if defined(__linux__)
+#define WALRUS_USE_FUTEX
+#endif
+
+namespace Walrus {
+
+// Threads blocked by memory.atomic.wait, indexed by address. The addresses
+// are distributed over shards which have their own locks, and each waiting
+// thread is parked on its own futex (or condition variable), so notify only
+// touches the threads it wakes up. Queues are freed when they become empty.
+class WaiterTable {
+public:
+    // Results of memory.atomic.wait.
+    enum WaitResult : uint32_t {
+        Ok = 0,
+        NotEqual = 1,
+        TimedOut = 2,
+    };
+
+    WaiterTable() {}
+    ~WaiterTable();
+
+    // Blocks the thread until it is notified or the timeout (in nanoseconds,
+    // negative values mean infinite) expires. The isExpected function is
+    // called with the lock of the address held, so a notify between the
+    // comparison and the blocking cannot be lost.
+    template <typename IsExpected>
+    WaitResult wait(void* address, const IsExpected& isExpected, int64_t timeOut)
+    {
+        Shard& shard = shardOf(address);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+
+        if (!isExpected()) {
+            return NotEqual;
+        }
+
+        WaitNode node;
+        return park(shard, lock, address, node, timeOut);
+    }
+
+    // Wakes up at most count threads waiting on the address in
+    // FIFO order, and returns the number of woken threads.
+    uint32_t notify(void* address, uint32_t count);
+
+private:
+    static const size_t s_shardCount = 64;
+
+    struct WaitNode {
+        WaitNode()
+            : prev(nullptr)
+            , next(nullptr)
+            , notified(0)
+        {
+        }
+
+        WaitNode* prev;
+        WaitNode* next;
+        // Set to 1 by notify, this is the futex word on Linux.
+        std::atomic<uint32_t> notified;
+#if !defined(WALRUS_USE_FUTEX)
+        std::condition_variable condition;
+#endif
+    };
+
+    struct WaitQueue {
+        WaitNode* head;
+        WaitNode* tail;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<void*, WaitQueue> queues;
+    };
+
+    Shard& shardOf(void* address)
+    {
+        // Fibonacci hashing, since the low bits of aligned addresses are
+        // zero. The top 6 bits select one of the 64 shards.
+        static_assert(s_shardCount == 64, "the shift depends on the shard count");
+        uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address)) * 0x9E3779B97F4A7C15ull;
+        return m_shards[hash >> 58];
+    }
+
+    WaitResult park(Shard& shard, std::unique_lock<std::mutex>& lock, void* address, WaitNode& node, int64_t timeOut);
+    static void remove(Shard& shard, void* address, WaitNode* node);
+
+    Shard m_shards[s_shardCount];
+};
+
+} // namespace Walrus
+
+#endif // __WalrusWaiterTable__
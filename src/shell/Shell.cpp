@@ -14,6 +14,7 @@
 #include "runtime/Module.h"
 #include "runtime/ComponentInstance.h"
 #include "runtime/Instance.h"
+#include "runtime/InstanceSnapshot.h"
 #include "runtime/Function.h"
 #include "runtime/Table.h"
 #include "runtime/Memory.h"
@@ -34,6 +35,13 @@
 #include "wasi/WASI02.h"
 #endif
 
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 struct spectestseps : std::numpunct<char> {
     char do_thousands_sep() const { return '_'; }
     std::string do_grouping() const { return "\3"; }
@@ -53,9 +61,16 @@ struct ParseOptions {
 
 static uint32_t s_JITFlags = 0;
 static uint32_t s_FeatureFlags = 0;
+static std::string s_cacheDir;
+static bool s_instanceSnapshot = false;
+static bool s_streamCompile = false;
+static bool s_memoryPoolStats = false;
 
 using namespace Walrus;
 
+// Options of the engine, which also apply to the stores.
+static EngineConfig s_engineConfig;
+
 static void printI32(int32_t v)
 {
     std::stringstream ss;
@@ -157,10 +172,154 @@ static ExternalValue* findExternalValue(size_t value)
     return externalValues.back();
 }
 
-static Trap::TrapResult executeWASM(Store* store, const std::string& filename, const std::vector<uint8_t>& src,
+static std::vector<uint8_t> readFile(const std::string& path, bool& success)
+{
+    std::vector<uint8_t> buf;
+    FILE* fp = fopen(path.data(), "rb");
+
+    success = false;
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        size_t sz = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        buf.resize(sz);
+        success = fread(buf.data(), 1, sz, fp) == sz;
+        fclose(fp);
+    }
+    return buf;
+}
+
+// The binaries of the input files are mapped into memory when possible, so
+// they are not copied, and the pages are only read when they are used.
+class InputFile {
+public:
+    InputFile()
+        : m_mapped(nullptr)
+        , m_mappedSize(0)
+    {
+    }
+
+    ~InputFile()
+    {
+#if defined(OS_POSIX)
+        if (m_mapped) {
+            munmap(m_mapped, m_mappedSize);
+        }
+#endif
+    }
+
+    bool open(const std::string& path)
+    {
+#if defined(OS_POSIX)
+        int fd = ::open(path.data(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            // Empty files cannot be mapped.
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    m_mapped = reinterpret_cast<uint8_t*>(mapped);
+                    m_mappedSize = static_cast<size_t>(st.st_size);
+                }
+            }
+            close(fd);
+
+            if (m_mapped) {
+                return true;
+            }
+        }
+#endif
+        bool success;
+        m_buffer = readFile(path, success);
+        return success;
+    }
+
+    const uint8_t* data() const
+    {
+        return m_mapped ? m_mapped : m_buffer.data();
+    }
+
+    size_t size() const
+    {
+        return m_mapped ? m_mappedSize : m_buffer.size();
+    }
+
+private:
+    uint8_t* m_mapped;
+    size_t m_mappedSize;
+    std::vector<uint8_t> m_buffer;
+};
+
+// When --stream-compile is specified, the binary is appended to the parser in
+// chunks, so reading the pages of mapped files overlaps with parsing.
+static std::pair<Optional<Module*>, std::string> parseBinary(Store* store, const std::string& filename, const uint8_t* data, size_t size, uint32_t featureFlags)
+{
+    if (!s_streamCompile) {
+        return WASMParser::parseBinary(store, filename, data, size, s_JITFlags, featureFlags);
+    }
+
+    const size_t chunkSize = 64 * 1024;
+    WASMStreamingParser parser(store, filename, size, s_JITFlags, featureFlags);
+
+    for (size_t offset = 0; offset < size; offset += chunkSize) {
+        parser.append(data + offset, std::min(chunkSize, size - offset));
+    }
+    return parser.finish();
+}
+
+// When --cache-dir is specified, parsed modules are serialized into the cache
+// directory, and later runs load the byte code from there.
+static std::pair<Optional<Module*>, std::string> parseModule(Store* store, const std::string& filename, const uint8_t* data, size_t size, uint32_t featureFlags)
+{
+    if (s_cacheDir.empty()) {
+        return parseBinary(store, filename, data, size, featureFlags);
+    }
+    return WASMParser::parseBinaryWithCache(store, s_cacheDir, filename, data, size, s_JITFlags, featureFlags);
+}
+
+// When --instance-snapshot is specified, the instance is replaced
+// by an instance created from its snapshot if it can be captured.
+static Instance* instantiateModule(ExecutionState& state, Module* module, const ExternVector& importValues)
+{
+    Instance* instance = module->instantiate(state, importValues);
+
+    if (s_instanceSnapshot) {
+        std::unique_ptr<InstanceSnapshot> snapshot(InstanceSnapshot::create(instance));
+        if (snapshot) {
+            instance = snapshot->instantiate(state, importValues);
+        }
+    }
+    return instance;
+}
+
+#ifdef ENABLE_WASI
+// Imports of wasi-threads programs: the thread-spawn function and the shared
+// memory, which is created by the host. Returns false for other imports.
+static bool importWasiThreads(Store* store, ImportType* import, ExternVector& importValues)
+{
+    if (import->moduleName() == "wasi" && import->fieldName() == "thread-spawn") {
+        // The function is imported even if the import has a different type,
+        // so the instantiation reports an incompatible import type instead
+        // of binding the following imports to the wrong entries.
+        FunctionType* ft = store->getDefinedFunctionType(Store::I32_RI32);
+        importValues.push_back(WasiFunction::createWasiFunction(store, ft, &WASI::thread_spawn));
+        return true;
+    }
+
+    if (import->moduleName() == "env" && import->importType() == ImportType::Memory && import->memoryType()->isShared()) {
+        const MemoryType* type = import->memoryType();
+        importValues.push_back(Memory::createMemory(store, type->initialSize() * Memory::s_memoryPageSize,
+                                                    type->maximumSize() * Memory::s_memoryPageSize, true, type->is64()));
+        return true;
+    }
+    return false;
+}
+#endif
+
+static Trap::TrapResult executeWASM(Store* store, const std::string& filename, const uint8_t* binary, size_t size,
                                     std::map<std::string, Instance*>* registeredInstanceMap = nullptr)
 {
-    auto parseResult = WASMParser::parseBinary(store, filename, src.data(), src.size(), s_JITFlags, s_FeatureFlags);
+    auto parseResult = parseModule(store, filename, binary, size, s_FeatureFlags);
     if (!parseResult.second.empty()) {
         Trap::TrapResult tr;
         tr.exception = Exception::create(parseResult.second);
@@ -298,6 +457,8 @@ static Trap::TrapResult executeWASM(Store* store, const std::string& filename, c
                 }
                 hasWasiImport = true;
             }
+        } else if ((!registeredInstanceMap || registeredInstanceMap->find(import->moduleName()) == registeredInstanceMap->end())
+                   && importWasiThreads(store, import, importValues)) {
 #endif
         } else if (registeredInstanceMap) {
             auto iter = registeredInstanceMap->find(import->moduleName());
@@ -341,7 +502,7 @@ static Trap::TrapResult executeWASM(Store* store, const std::string& filename, c
     Walrus::Trap trap;
     return trap.run([](ExecutionState& state, void* d) {
         RunData* data = reinterpret_cast<RunData*>(d);
-        Instance* instance = data->module->instantiate(state, data->importValues);
+        Instance* instance = instantiateModule(state, data->module, data->importValues);
 
 #ifdef ENABLE_WASI
         if (data->hasWasiImport) {
@@ -374,9 +535,9 @@ static Trap::TrapResult executeWASM(Store* store, const std::string& filename, c
                     &data);
 }
 
-static Trap::TrapResult executeWASMComponent(Store* store, const std::string& filename, const std::vector<uint8_t>& src)
+static Trap::TrapResult executeWASMComponent(Store* store, const std::string& filename, const uint8_t* binary, size_t size)
 {
-    std::pair<Optional<Component*>, std::string> parseResult = WASMComponentParser::parseBinary(store, filename, src.data(), src.size(), s_JITFlags, s_FeatureFlags);
+    std::pair<Optional<Component*>, std::string> parseResult = WASMComponentParser::parseBinary(store, filename, binary, size, s_JITFlags, s_FeatureFlags);
     if (!parseResult.second.empty()) {
         Trap::TrapResult tr;
         tr.exception = Exception::create(parseResult.second);
@@ -853,13 +1014,13 @@ static Instance* fetchInstance(wabt::Var& moduleVar, std::map<size_t, Instance*>
     return registeredInstanceMap[moduleVar.name()];
 }
 
-static void executeWAST(Store* store, const std::string& filename, const std::vector<uint8_t>& src)
+static void executeWAST(Store* store, const std::string& filename, const uint8_t* data, size_t size)
 {
     wabt::Errors errors;
     wabt::Features features;
     features.EnableAll();
     wabt::WastParseOptions parseWastOptions(features);
-    auto lexer = wabt::WastLexer::CreateBufferLexer("test.wabt", src.data(), src.size(), &errors);
+    auto lexer = wabt::WastLexer::CreateBufferLexer("test.wabt", data, size, &errors);
     ASSERT(lexer);
 
     if (lexer->IsComponent()) {
@@ -873,7 +1034,7 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
             result = WriteBinaryComponent(&stream, component.get(), writeBinaryOptions);
 
             if (wabt::Succeeded(result)) {
-                auto trapResult = executeWASMComponent(store, filename, stream.output_buffer().data);
+                auto trapResult = executeWASMComponent(store, filename, stream.output_buffer().data.data(), stream.output_buffer().data.size());
                 if (trapResult.exception) {
                     std::string& errorMessage = trapResult.exception->message();
                     printf("Error: %s\n", errorMessage.c_str());
@@ -912,7 +1073,7 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
         case wabt::CommandType::ScriptModule: {
             auto* moduleCommand = static_cast<wabt::ModuleCommand*>(command.get());
             auto buf = readModuleData(&moduleCommand->module);
-            auto trapResult = executeWASM(store, filename, buf->data, &registeredInstanceMap);
+            auto trapResult = executeWASM(store, filename, buf->data.data(), buf->data.size(), &registeredInstanceMap);
             if (trapResult.exception) {
                 std::string& errorMessage = trapResult.exception->message();
                 printf("Error: %s\n", errorMessage.c_str());
@@ -993,7 +1154,7 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
                 RELEASE_ASSERT_NOT_REACHED();
             }
             auto buf = readModuleData(&tsm->module);
-            auto trapResult = executeWASM(store, filename, buf->data, &registeredInstanceMap);
+            auto trapResult = executeWASM(store, filename, buf->data.data(), buf->data.size(), &registeredInstanceMap);
             RELEASE_ASSERT(trapResult.exception);
             std::string& s = trapResult.exception->message();
             if (s.find(assertModuleUninstantiable->text) != 0) {
@@ -1063,7 +1224,7 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
                 printf("assertModuleInvalid (expect compile error: '%s', actual '%s'(line: %d)) : OK\n", assertModuleInvalid->text.data(), errors[0].message.c_str(), errors[0].loc.line);
                 break;
             }
-            auto trapResult = executeWASM(store, filename, buf);
+            auto trapResult = executeWASM(store, filename, buf.data(), buf.size());
             if (trapResult.exception == nullptr) {
                 printf("Execute WASM returned nullptr (in wabt::CommandType::AssertInvalid case)\n");
                 printf("Expected exception:%s\n", assertModuleInvalid->text.data());
@@ -1094,7 +1255,7 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
             } else {
                 buf = dsm->data;
             }
-            auto trapResult = executeWASM(store, filename, buf);
+            auto trapResult = executeWASM(store, filename, buf.data(), buf.size());
             if (trapResult.exception == nullptr) {
                 printf("Execute WASM returned nullptr (in wabt::CommandType::AssertUnlinkable case)\n");
                 printf("Expected exception:%s\n", assertUnlinkable->text.data());
@@ -1130,9 +1291,9 @@ static void executeWAST(Store* store, const std::string& filename, const std::ve
     }
 }
 
-static void runExports(Store* store, const std::string& filename, const std::vector<uint8_t>& src, std::string& exportToRun)
+static void runExports(Store* store, const std::string& filename, const uint8_t* binary, size_t size, std::string& exportToRun)
 {
-    auto parseResult = WASMParser::parseBinary(store, filename, src.data(), src.size(), s_JITFlags);
+    auto parseResult = parseModule(store, filename, binary, size, 0);
     if (!parseResult.second.empty()) {
         fprintf(stderr, "parse error: %s\n", parseResult.second.c_str());
         return;
@@ -1157,7 +1318,7 @@ static void runExports(Store* store, const std::string& filename, const std::vec
                         wasiImportFunc->ptr));
                 }
             }
-        } else {
+        } else if (!importWasiThreads(store, import, importValues)) {
             fprintf(stderr, "error: module has imports, but imports are not supported\n");
             return;
         }
@@ -1176,7 +1337,7 @@ static void runExports(Store* store, const std::string& filename, const std::vec
 
     trap.run([](ExecutionState& state, void* d) {
         auto data = reinterpret_cast<RunData*>(d);
-        Instance* instance = data->module->instantiate(state, data->importValues);
+        Instance* instance = instantiateModule(state, data->module, data->importValues);
 
         for (auto&& exp : data->module->exports()) {
             if (exp->exportType() == ExportType::Function) {
@@ -1254,7 +1415,63 @@ static void parseArguments(int argc, const char* argv[], ParseOptions& options)
                 } else if (strcmp(argv[i], "--jit-no-reg-alloc") == 0) {
                     s_JITFlags |= JITFlagValue::disableRegAlloc;
                     continue;
+                } else if (strcmp(argv[i], "--jit-no-inline") == 0) {
+                    s_JITFlags |= JITFlagValue::disableInline;
+                    continue;
+                } else if (strcmp(argv[i], "--jit-tiering") == 0) {
+                    s_JITFlags |= JITFlagValue::useJIT | JITFlagValue::useTiering;
+                    continue;
+                } else if (strcmp(argv[i], "--jit-threads") == 0) {
+                    if (i + 1 == argc || argv[i + 1][0] == '-') {
+                        fprintf(stderr, "error: --jit-threads requires an argument\n");
+                        exit(1);
+                    }
+                    ++i;
+                    s_engineConfig.JITThreadCount = static_cast<uint32_t>(atoi(argv[i]));
+                    continue;
+                } else if (strcmp(argv[i], "--jit-guard-pages") == 0) {
+                    s_engineConfig.guardPages = true;
+                    continue;
 #endif
+                } else if (strcmp(argv[i], "--cache-dir") == 0) {
+                    if (i + 1 == argc || argv[i + 1][0] == '-') {
+                        fprintf(stderr, "error: --cache-dir requires an argument\n");
+                        exit(1);
+                    }
+                    ++i;
+                    s_cacheDir = argv[i];
+                    continue;
+                } else if (strcmp(argv[i], "--stream-compile") == 0) {
+                    s_streamCompile = true;
+                    continue;
+                } else if (strcmp(argv[i], "--lazy-compile") == 0) {
+                    s_JITFlags |= JITFlagValue::lazyCompile;
+                    continue;
+                } else if (strcmp(argv[i], "--parser-threads") == 0) {
+                    if (i + 1 == argc || argv[i + 1][0] == '-') {
+                        fprintf(stderr, "error: --parser-threads requires an argument\n");
+                        exit(1);
+                    }
+                    ++i;
+                    s_engineConfig.parserThreadCount = static_cast<uint32_t>(atoi(argv[i]));
+                    continue;
+                } else if (strcmp(argv[i], "--instance-snapshot") == 0) {
+                    s_instanceSnapshot = true;
+                    continue;
+                } else if (strcmp(argv[i], "--memory-pool") == 0) {
+                    if (i + 1 == argc || argv[i + 1][0] == '-') {
+                        fprintf(stderr, "error: --memory-pool requires an argument\n");
+                        exit(1);
+                    }
+                    ++i;
+                    s_engineConfig.memoryPoolSlots = static_cast<size_t>(atoi(argv[i]));
+                    continue;
+                } else if (strcmp(argv[i], "--memory-pool-stats") == 0) {
+                    s_memoryPoolStats = true;
+                    continue;
+                } else if (strcmp(argv[i], "--reserve-memory-maximum") == 0) {
+                    s_engineConfig.reserveMemoryMaximum = true;
+                    continue;
                 } else if (strcmp(argv[i], "--env") == 0) {
                     if (i + 1 == argc || argv[i + 1][0] == '-') {
                         fprintf(stderr, "error: --env requires an argument\n");
@@ -1296,7 +1513,19 @@ static void parseArguments(int argc, const char* argv[], ParseOptions& options)
                     fprintf(stdout, "\t--jit\n\t\tEnable just-in-time interpretation.\n\n");
                     fprintf(stdout, "\t--jit-verbose\n\t\tEnable verbose output for just-in-time interpretation.\n\n");
                     fprintf(stdout, "\t--jit-verbose-color\n\t\tEnable colored verbose output for just-in-time interpretation.\n\n");
+                    fprintf(stdout, "\t--jit-tiering\n\t\tStart in the interpreter, and compile hot functions in the background.\n\n");
+                    fprintf(stdout, "\t--jit-threads <N>\n\t\tCompile the functions of a module using N threads (0 means one thread per core).\n\n");
+                    fprintf(stdout, "\t--jit-no-inline\n\t\tDo not inline small functions into their callers.\n\n");
+                    fprintf(stdout, "\t--jit-guard-pages\n\t\tReplace the bounds checks of 32 bit memory accesses with guard pages.\n\n");
 #endif
+                    fprintf(stdout, "\t--cache-dir <DIR>\n\t\tStore the parsed modules in DIR, and load them from there when the same module is executed again. DIR must be owned by the user, and must not be writable by others.\n\n");
+                    fprintf(stdout, "\t--stream-compile\n\t\tParse modules on a background thread while their binary is appended in chunks.\n\n");
+                    fprintf(stdout, "\t--lazy-compile\n\t\tGenerate the byte code of functions when they are called first.\n\n");
+                    fprintf(stdout, "\t--parser-threads <N>\n\t\tGenerate the byte code of the functions using N threads (0 means one thread per core).\n\n");
+                    fprintf(stdout, "\t--instance-snapshot\n\t\tCapture a snapshot of each instance, and replace the instance with a copy-on-write instance created from it.\n\n");
+                    fprintf(stdout, "\t--memory-pool <N>\n\t\tAllocate linear memories from a pool of N preallocated slots.\n\n");
+                    fprintf(stdout, "\t--memory-pool-stats\n\t\tPrint the usage of the memory pool before exiting.\n\n");
+                    fprintf(stdout, "\t--reserve-memory-maximum\n\t\tReserve address space for the maximum size of linear memories, so growing never moves them.\n\n");
                     fprintf(stdout, "\t--mapdirs <HOST_DIR> <VIRTUAL_DIR>\n\t\tMap real directories to virtual ones for WASI functions to use.\n\t\tExample: ./walrus test.wasm --mapdirs this/real/directory/ this/virtual/directory\n\n");
                     fprintf(stdout, "\t--env\n\t\tShare host environment to walrus WASI.\n\n");
                     fprintf(stdout, "\t--args <MODULE_FILE_NAME> [<ARG1> <ARG2> ... <ARGN>]\n\t\tRun Webassembly module with arguments: must be followed by the name of the Webassembly module file, then optionally following arguments which are passed on to the module\n\t\tExample: ./walrus --args test.wasm 'hello' 'world' 42\n\n");
@@ -1340,13 +1569,25 @@ int main(int argc, const char* argv[])
     ProfilerStart("gperf_result");
 #endif
 
-    Engine* engine = new Engine();
-    Store* store = new Store(engine);
-
     ParseOptions options;
 
     parseArguments(argc, argv, options);
 
+    s_engineConfig.JITFlags = s_JITFlags;
+    s_engineConfig.featureFlags = s_FeatureFlags;
+    s_engineConfig.cacheDir = s_cacheDir;
+
+    Engine* engine = new Engine(s_engineConfig);
+    Store* store = new Store(engine);
+
+    if (s_engineConfig.guardPages && !Memory::guardPagesEnabled()) {
+        fprintf(stderr, "warning: --jit-guard-pages is not supported on this platform\n");
+    }
+
+    if (s_engineConfig.memoryPoolSlots > 0 && engine->memoryPool() == nullptr) {
+        fprintf(stderr, "warning: cannot create a memory pool with %zu slots\n", s_engineConfig.memoryPoolSlots);
+    }
+
 #ifdef ENABLE_WASI
     // initialize WASI
     uvwasi_t uvwasi;
@@ -1380,34 +1621,20 @@ int main(int argc, const char* argv[])
 
     int result = 0;
     for (const auto& filePath : options.fileNames) {
-        FILE* fp = fopen(filePath.data(), "r");
-        if (fp) {
-            fseek(fp, 0, SEEK_END);
-            size_t sz = ftell(fp);
-            fseek(fp, 0, SEEK_SET);
-            std::vector<uint8_t> buf;
-            buf.resize(sz);
-            int ret = fread(buf.data(), 1, sz, fp);
-            fclose(fp);
-            // read again with binary mode if result is not success
-            // this one needs for windows
-            if (UNLIKELY((size_t)ret != sz)) {
-                FILE* fp = fopen(filePath.data(), "rb");
-                fread(buf.data(), sz, 1, fp);
-                fclose(fp);
-            }
+        InputFile file;
+        if (file.open(filePath)) {
             if (endsWith(filePath, "wasm")) {
                 if (!options.exportToRun.empty()) {
-                    runExports(store, filePath, buf, options.exportToRun);
-                } else if (wabt::ReadBinaryIsComponent(buf.data(), buf.size())) {
-                    auto trapResult = executeWASMComponent(store, filePath, buf);
+                    runExports(store, filePath, file.data(), file.size(), options.exportToRun);
+                } else if (wabt::ReadBinaryIsComponent(file.data(), file.size())) {
+                    auto trapResult = executeWASMComponent(store, filePath, file.data(), file.size());
                     if (trapResult.exception) {
                         fprintf(stderr, "Uncaught Exception: %s\n", trapResult.exception->message().data());
                         result = -1;
                         break;
                     }
                 } else {
-                    auto trapResult = executeWASM(store, filePath, buf);
+                    auto trapResult = executeWASM(store, filePath, file.data(), file.size());
                     if (trapResult.exception) {
                         fprintf(stderr, "Uncaught Exception: %s\n", trapResult.exception->message().data());
                         result = -1;
@@ -1415,7 +1642,7 @@ int main(int argc, const char* argv[])
                     }
                 }
             } else if (endsWith(filePath, "wat") || endsWith(filePath, "wast")) {
-                executeWAST(store, filePath, buf);
+                executeWAST(store, filePath, file.data(), file.size());
             }
         } else {
             printf("Cannot open file %s\n", filePath.data());
@@ -1425,12 +1652,25 @@ int main(int argc, const char* argv[])
     }
 
 #ifdef ENABLE_WASI
+    // Threads started by wasi-threads may still use the store.
+    if (WASI::hasRunningThreads()) {
+        fflush(nullptr);
+        std::_Exit(result);
+    }
+
     uvwasi_destroy(&uvwasi);
     // Wasi 0.2
     destroyWasi02Data(store->wasiData());
 #endif
     // finalize
     delete store;
+
+    if (s_memoryPoolStats && engine->memoryPool() != nullptr) {
+        MemoryPool::Stats stats = engine->memoryPool()->stats();
+        printf("Memory pool: %zu slots, %zu in use, high water mark %zu, %zu allocations, %zu reuses, %zu misses\n",
+               stats.slotCount, stats.slotsInUse, stats.highWaterMark, stats.allocations, stats.reuses, stats.misses);
+    }
+
     delete engine;
     for (auto it : externalValues) {
         delete it;
@@ -24,6 +24,23 @@ extern "C" {
 #include "runtime/Value.h"
 #include "runtime/Memory.h"
 #include "runtime/Instance.h"
+#include "runtime/Module.h"
+#include "runtime/Table.h"
+#include "runtime/Global.h"
+#include "runtime/Tag.h"
+#include "runtime/Trap.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#if defined(OS_POSIX)
+#include <pthread.h>
+#endif
+
+#ifdef ENABLE_GC
+#include "GCUtil.h"
+#endif /* ENABLE_GC */
 
 // https://github.com/WebAssembly/WASI/blob/main/legacy/preview1/docs.md
 
@@ -739,6 +756,175 @@ void WASI::sched_yield(ExecutionState& state, Value* argv, Value* result, Instan
     result[0] = Value(uvwasi_sched_yield(WASI::g_uvwasi));
 }
 
+// https://github.com/WebAssembly/wasi-threads
+
+struct SpawnedThread {
+    Function* start;
+    int32_t threadId;
+    int32_t startArg;
+};
+
+// Thread ids are positive 29 bit integers.
+static const int32_t s_maxThreadId = 0x1FFFFFFF;
+
+// Serializes the instantiation of new threads.
+static std::mutex g_threadSpawnLock;
+static int32_t g_nextThreadId = 1;
+static std::atomic<uint32_t> g_runningThreads(0);
+
+static void* runSpawnedThread(void* data)
+{
+    std::unique_ptr<SpawnedThread> thread(reinterpret_cast<SpawnedThread*>(data));
+
+#if defined(ENABLE_GC) && defined(GC_THREADS)
+    struct GC_stack_base stackBase;
+    GC_get_stack_base(&stackBase);
+    GC_register_my_thread(&stackBase);
+#endif
+
+    Trap trap;
+    auto trapResult = trap.run([](ExecutionState& state, void* data) {
+        SpawnedThread* thread = reinterpret_cast<SpawnedThread*>(data);
+        Value argv[2] = { Value(thread->threadId), Value(thread->startArg) };
+        thread->start->call(state, argv, nullptr);
+    },
+                               thread.get());
+
+    if (trapResult.exception) {
+        // A trap in any thread terminates the whole program.
+        fprintf(stderr, "Uncaught Exception: %s\n", trapResult.exception->message().data());
+        fflush(nullptr);
+        std::_Exit(1);
+    }
+
+#if defined(ENABLE_GC) && defined(GC_THREADS)
+    GC_unregister_my_thread();
+#endif
+
+    g_runningThreads--;
+    return nullptr;
+}
+
+void WASI::thread_spawn(ExecutionState& state, Value* argv, Value* result, Instance* instance)
+{
+    ASSERT(argv[0].type() == Value::I32);
+    result[0] = Value(int32_t(-1));
+
+    Module* module = instance->module();
+    Store* store = module->store();
+
+    // Threads communicate through the shared memory.
+    if (module->numberOfMemoryTypes() == 0 || !instance->memory(0)->isShared()) {
+        return;
+    }
+
+    std::string startName("wasi_thread_start");
+    Function* start = instance->resolveExportFunction(startName);
+    if (start == nullptr) {
+        return;
+    }
+
+    const FunctionType* startType = start->functionType();
+    if (startType->param().size() != 2 || startType->result().size() != 0
+        || startType->param().types()[0] != Value::I32 || startType->param().types()[1] != Value::I32) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(g_threadSpawnLock);
+
+    if (g_nextThreadId > s_maxThreadId) {
+        return;
+    }
+
+    // The new instance receives the same imports, including the shared memory.
+    ExternVector imports;
+    imports.reserve(module->imports().size());
+
+    uint32_t functionIndex = 0;
+    uint32_t tableIndex = 0;
+    uint32_t memoryIndex = 0;
+    uint32_t globalIndex = 0;
+    uint32_t tagIndex = 0;
+
+    for (auto import : module->imports()) {
+        switch (import->importType()) {
+        case ImportType::Function: {
+            Function* function = instance->function(functionIndex++);
+            // Wasi functions are bound to the instance which imports them.
+            if (function->kind() == Function::WasiFunctionKind) {
+                function = WasiFunction::createWasiFunction(store, const_cast<FunctionType*>(function->functionType()),
+                                                            function->asWasiFunction()->callback());
+            }
+            imports.push_back(function);
+            break;
+        }
+        case ImportType::Table:
+            imports.push_back(instance->table(tableIndex++));
+            break;
+        case ImportType::Memory:
+            imports.push_back(instance->memory(memoryIndex++));
+            break;
+        case ImportType::Global:
+            imports.push_back(instance->global(globalIndex++));
+            break;
+        case ImportType::Tag:
+            imports.push_back(instance->tag(tagIndex++));
+            break;
+        }
+    }
+
+    struct InstantiateData {
+        Module* module;
+        ExternVector& imports;
+        Instance* instance;
+    } data = { module, imports, nullptr };
+
+    Trap trap;
+    auto trapResult = trap.run([](ExecutionState& state, void* d) {
+        InstantiateData* data = reinterpret_cast<InstantiateData*>(d);
+        data->instance = data->module->instantiate(state, data->imports);
+    },
+                               &data);
+
+    if (trapResult.exception) {
+        return;
+    }
+
+#if defined(ENABLE_GC) && defined(GC_THREADS)
+    GC_allow_register_threads();
+#endif
+
+    SpawnedThread* thread = new SpawnedThread{ data.instance->resolveExportFunction(startName), g_nextThreadId, argv[0].asI32() };
+    g_runningThreads++;
+
+#if defined(OS_POSIX)
+    // Wasm code may use the same amount of native stack as the main thread.
+    pthread_attr_t attributes;
+    pthread_t handle;
+
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, STACK_LIMIT_FROM_BASE + 1024 * 1024);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    int error = pthread_create(&handle, &attributes, runSpawnedThread, thread);
+    pthread_attr_destroy(&attributes);
+
+    if (error != 0) {
+        g_runningThreads--;
+        delete thread;
+        return;
+    }
+#else
+    std::thread(runSpawnedThread, thread).detach();
+#endif
+
+    result[0] = Value(g_nextThreadId++);
+}
+
+bool WASI::hasRunningThreads()
+{
+    return g_runningThreads.load() != 0;
+}
+
 } // namespace Walrus
 
 #endif
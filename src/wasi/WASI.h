@@ -185,6 +185,13 @@ public:
     static uvwasi_errno_t resolvePath(const std::string& mappedPath, const std::string& realPath, const std::string& guestPath, uvwasi_lookupflags_t flags, std::string& resolvedPath);
     static WasiFuncInfo* find(const std::string& funcName);
 
+    // wasi-threads, imported as "wasi" "thread-spawn". The module is instantiated
+    // again with the same imports, and its wasi_thread_start export runs on a new
+    // native thread. Returns the new thread id, or a negative value on error.
+    static void thread_spawn(ExecutionState& state, Value* argv, Value* result, Instance* instance);
+    // True if a thread started by thread_spawn has not finished yet.
+    static bool hasRunningThreads();
+
 private:
     // wasi functions
 #define DECLARE_FUNCTION(NAME, FUNCTYPE) static void NAME(ExecutionState& state, Value* argv, Value* result, Instance* instance);
@@ -0,0 +1,192 @@
+(module
+  (memory 1)
+  (data (i32.const 0) "\ff\ff\ff\7f\00\00\00\00\ff\ff\ff\ff\ff\ff\ff\7f")
+
+  ;; Bits 0-5 are set by the taken if branches (jump_if_false), and
+  ;; bits 8-13 by the not taken br_if branches (jump_if_true).
+  (func (export "i32_s") (param i32 i32) (result i32)
+    (local $r i32)
+    (if (i32.eq (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (i32.ne (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (i32.lt_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (i32.le_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (if (i32.gt_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 16)))))
+    (if (i32.ge_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 32)))))
+    (block $b0 (br_if $b0 (i32.eq (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (i32.ne (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (i32.lt_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (i32.le_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (block $b4 (br_if $b4 (i32.gt_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 4096))))
+    (block $b5 (br_if $b5 (i32.ge_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 8192))))
+    (local.get $r)
+  )
+  (func (export "i32_u") (param i32 i32) (result i32)
+    (local $r i32)
+    (if (i32.lt_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (i32.le_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (i32.gt_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (i32.ge_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (block $b0 (br_if $b0 (i32.lt_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (i32.le_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (i32.gt_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (i32.ge_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (local.get $r)
+  )
+  (func (export "i64_s") (param i64 i64) (result i32)
+    (local $r i32)
+    (if (i64.eq (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (i64.ne (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (i64.lt_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (i64.le_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (if (i64.gt_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 16)))))
+    (if (i64.ge_s (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 32)))))
+    (block $b0 (br_if $b0 (i64.eq (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (i64.ne (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (i64.lt_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (i64.le_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (block $b4 (br_if $b4 (i64.gt_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 4096))))
+    (block $b5 (br_if $b5 (i64.ge_s (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 8192))))
+    (local.get $r)
+  )
+  (func (export "i64_u") (param i64 i64) (result i32)
+    (local $r i32)
+    (if (i64.lt_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (i64.le_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (i64.gt_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (i64.ge_u (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (block $b0 (br_if $b0 (i64.lt_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (i64.le_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (i64.gt_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (i64.ge_u (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (local.get $r)
+  )
+  (func (export "f32") (param f32 f32) (result i32)
+    (local $r i32)
+    (if (f32.eq (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (f32.ne (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (f32.lt (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (f32.le (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (if (f32.gt (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 16)))))
+    (if (f32.ge (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 32)))))
+    (block $b0 (br_if $b0 (f32.eq (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (f32.ne (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (f32.lt (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (f32.le (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (block $b4 (br_if $b4 (f32.gt (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 4096))))
+    (block $b5 (br_if $b5 (f32.ge (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 8192))))
+    (local.get $r)
+  )
+  (func (export "f64") (param f64 f64) (result i32)
+    (local $r i32)
+    (if (f64.eq (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 1)))))
+    (if (f64.ne (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 2)))))
+    (if (f64.lt (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 4)))))
+    (if (f64.le (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 8)))))
+    (if (f64.gt (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 16)))))
+    (if (f64.ge (local.get 0) (local.get 1)) (then (local.set $r (i32.or (local.get $r) (i32.const 32)))))
+    (block $b0 (br_if $b0 (f64.eq (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 256))))
+    (block $b1 (br_if $b1 (f64.ne (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 512))))
+    (block $b2 (br_if $b2 (f64.lt (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 1024))))
+    (block $b3 (br_if $b3 (f64.le (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 2048))))
+    (block $b4 (br_if $b4 (f64.gt (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 4096))))
+    (block $b5 (br_if $b5 (f64.ge (local.get 0) (local.get 1))) (local.set $r (i32.or (local.get $r) (i32.const 8192))))
+    (local.get $r)
+  )
+
+  ;; The result of the comparison is also stored in a local.
+  (func (export "local") (param i32 i32) (result i32)
+    (local $c i32)
+    (block $b
+      (local.set $c (i32.lt_s (local.get 0) (local.get 1)))
+      (br_if $b (local.get $c))
+      (return (i32.add (local.get $c) (i32.const 10)))
+    )
+    (i32.add (local.get $c) (i32.const 20))
+  )
+
+  ;; The loop starts between the comparison and the branch.
+  (func (export "loop-param") (param $n i32) (result i32)
+    (local $i i32)
+    (i32.gt_s (local.get $n) (i32.const 0))
+    (loop $l (param i32)
+      (if (then (local.set $i (i32.add (local.get $i) (i32.const 1)))))
+      (i32.lt_s (local.get $i) (local.get $n))
+      (br_if $l (i32.lt_s (local.get $i) (local.get $n)))
+      (drop)
+    )
+    (local.get $i)
+  )
+
+  ;; Operations with an immediate operand read a preallocated constant slot.
+  (func (export "loop-imm") (result i32)
+    (local $i i32)
+    (loop $l
+      (br_if $l (i32.lt_u (local.tee $i (i32.add (local.get $i) (i32.const 3))) (i32.const 100)))
+    )
+    (local.get $i)
+  )
+
+  ;; The loaded value is the first or the second operand.
+  (func (export "load-i32") (param $p i32) (param $v i32) (result i32 i32 i32 i32 i32 i32)
+    (i32.add (i32.load (local.get $p)) (local.get $v))
+    (i32.sub (local.get $v) (i32.load (local.get $p)))
+    (i32.mul (i32.load (local.get $p)) (local.get $v))
+    (i32.and (local.get $v) (i32.load (local.get $p)))
+    (i32.or (i32.load (local.get $p)) (local.get $v))
+    (i32.xor (i32.load (local.get $p)) (local.get $v))
+  )
+  (func (export "load-i64") (param $p i32) (param $v i64) (result i64 i64 i64 i64 i64 i64)
+    (i64.add (i64.load (local.get $p)) (local.get $v))
+    (i64.sub (local.get $v) (i64.load (local.get $p)))
+    (i64.mul (i64.load (local.get $p)) (local.get $v))
+    (i64.and (local.get $v) (i64.load (local.get $p)))
+    (i64.or (i64.load (local.get $p)) (local.get $v))
+    (i64.xor (i64.load (local.get $p)) (local.get $v))
+  )
+)
+
+(assert_return (invoke "i32_s" (i32.const -2147483648) (i32.const 2147483647)) (i32.const 0x310e))
+(assert_return (invoke "i32_s" (i32.const 2147483647) (i32.const -2147483648)) (i32.const 0xd32))
+(assert_return (invoke "i32_s" (i32.const -1) (i32.const 0)) (i32.const 0x310e))
+(assert_return (invoke "i32_s" (i32.const -2147483648) (i32.const -2147483648)) (i32.const 0x1629))
+(assert_return (invoke "i32_s" (i32.const -5) (i32.const -5)) (i32.const 0x1629))
+(assert_return (invoke "i64_s" (i64.const -9223372036854775808) (i64.const 9223372036854775807)) (i32.const 0x310e))
+(assert_return (invoke "i64_s" (i64.const 9223372036854775807) (i64.const -9223372036854775808)) (i32.const 0xd32))
+(assert_return (invoke "i64_s" (i64.const -1) (i64.const 0)) (i32.const 0x310e))
+(assert_return (invoke "i64_s" (i64.const -9223372036854775808) (i64.const -9223372036854775808)) (i32.const 0x1629))
+(assert_return (invoke "i64_s" (i64.const -5) (i64.const -5)) (i32.const 0x1629))
+(assert_return (invoke "i32_u" (i32.const -1) (i32.const 0)) (i32.const 0x30c))
+(assert_return (invoke "i32_u" (i32.const 0) (i32.const -1)) (i32.const 0xc03))
+(assert_return (invoke "i32_u" (i32.const 2147483647) (i32.const -2147483648)) (i32.const 0xc03))
+(assert_return (invoke "i32_u" (i32.const -2147483648) (i32.const 2147483647)) (i32.const 0x30c))
+(assert_return (invoke "i32_u" (i32.const -1) (i32.const -1)) (i32.const 0x50a))
+(assert_return (invoke "i64_u" (i64.const -1) (i64.const 0)) (i32.const 0x30c))
+(assert_return (invoke "i64_u" (i64.const 0) (i64.const -1)) (i32.const 0xc03))
+(assert_return (invoke "i64_u" (i64.const 9223372036854775807) (i64.const -9223372036854775808)) (i32.const 0xc03))
+(assert_return (invoke "i64_u" (i64.const -9223372036854775808) (i64.const 9223372036854775807)) (i32.const 0x30c))
+(assert_return (invoke "i64_u" (i64.const -1) (i64.const -1)) (i32.const 0x50a))
+(assert_return (invoke "f32" (f32.const -inf) (f32.const inf)) (i32.const 0x310e))
+(assert_return (invoke "f32" (f32.const 1.5) (f32.const -1.5)) (i32.const 0xd32))
+(assert_return (invoke "f32" (f32.const -0) (f32.const 0)) (i32.const 0x1629))
+(assert_return (invoke "f32" (f32.const nan) (f32.const 1)) (i32.const 0x3d02))
+(assert_return (invoke "f32" (f32.const 1) (f32.const nan)) (i32.const 0x3d02))
+(assert_return (invoke "f32" (f32.const nan) (f32.const nan)) (i32.const 0x3d02))
+(assert_return (invoke "f32" (f32.const -nan:0x1) (f32.const inf)) (i32.const 0x3d02))
+(assert_return (invoke "f64" (f64.const -inf) (f64.const inf)) (i32.const 0x310e))
+(assert_return (invoke "f64" (f64.const 1.5) (f64.const -1.5)) (i32.const 0xd32))
+(assert_return (invoke "f64" (f64.const -0) (f64.const 0)) (i32.const 0x1629))
+(assert_return (invoke "f64" (f64.const nan) (f64.const 1)) (i32.const 0x3d02))
+(assert_return (invoke "f64" (f64.const 1) (f64.const nan)) (i32.const 0x3d02))
+(assert_return (invoke "f64" (f64.const nan) (f64.const nan)) (i32.const 0x3d02))
+(assert_return (invoke "f64" (f64.const -nan:0x1) (f64.const inf)) (i32.const 0x3d02))
+(assert_return (invoke "local" (i32.const 1) (i32.const 2)) (i32.const 21))
+(assert_return (invoke "local" (i32.const 2) (i32.const 1)) (i32.const 10))
+(assert_return (invoke "loop-param" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "loop-param" (i32.const 5)) (i32.const 5))
+(assert_return (invoke "loop-imm") (i32.const 102))
+(assert_return (invoke "load-i32" (i32.const 0) (i32.const 3))
+  (i32.const -2147483646) (i32.const -2147483644) (i32.const 2147483645) (i32.const 3) (i32.const 2147483647) (i32.const 2147483644))
+(assert_return (invoke "load-i64" (i32.const 8) (i64.const 3))
+  (i64.const -9223372036854775806) (i64.const -9223372036854775804) (i64.const 9223372036854775805) (i64.const 3) (i64.const 9223372036854775807) (i64.const 9223372036854775804))
+(assert_trap (invoke "load-i32" (i32.const 65533) (i32.const 0)) "out of bounds memory access")
+(assert_trap (invoke "load-i64" (i32.const 65529) (i64.const 0)) "out of bounds memory access")
@@ -0,0 +1,106 @@
+(module
+  (memory 2)
+  (table 4 funcref)
+  (global $counter (mut i32) (i32.const 0))
+  (global $ref (mut funcref) (ref.func $two))
+
+  (data (i32.const 16) "\01\02\03\04")
+  (data (i32.const 70000) "snapshot")
+  (data $passive "\aa\bb")
+  (data $dropped "\cc\dd")
+  (elem (i32.const 1) $one $two)
+  (elem $elems func $two $one)
+
+  (func $one (result i32) i32.const 1)
+  (func $two (result i32) i32.const 2)
+
+  (func $start
+    global.get $counter
+    i32.const 1
+    i32.add
+    global.set $counter
+
+    i32.const 20
+    i32.const 0x55667788
+    i32.store
+
+    (table.set (i32.const 3) (ref.func $one))
+    (global.set $ref (ref.func $one))
+    data.drop $dropped
+  )
+  (start $start)
+
+  (func (export "counter") (result i32)
+    global.get $counter
+  )
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store
+  )
+
+  (func (export "call") (param i32) (result i32)
+    local.get 0
+    call_indirect (result i32)
+  )
+
+  (func (export "call_global") (result i32)
+    (table.set (i32.const 0) (global.get $ref))
+    (call_indirect (result i32) (i32.const 0))
+  )
+
+  (func (export "init_passive") (result i32)
+    i32.const 0
+    i32.const 0
+    i32.const 2
+    memory.init $passive
+    i32.const 0
+    i32.load16_u
+  )
+
+  (func (export "init_dropped")
+    i32.const 0
+    i32.const 0
+    i32.const 2
+    memory.init $dropped
+  )
+
+  (func (export "init_elems") (result i32)
+    i32.const 0
+    i32.const 0
+    i32.const 1
+    table.init $elems
+    i32.const 0
+    call_indirect (result i32)
+  )
+
+  (func (export "grow") (result i32)
+    i32.const 1
+    memory.grow
+  )
+)
+
+(assert_return (invoke "counter") (i32.const 1))
+(assert_return (invoke "load" (i32.const 16)) (i32.const 0x04030201))
+(assert_return (invoke "load" (i32.const 20)) (i32.const 0x55667788))
+(assert_return (invoke "load" (i32.const 70000)) (i32.const 0x70616e73))
+(assert_return (invoke "load" (i32.const 131068)) (i32.const 0))
+(assert_return (invoke "store" (i32.const 16) (i32.const 7)))
+(assert_return (invoke "load" (i32.const 16)) (i32.const 7))
+(assert_return (invoke "call" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "call" (i32.const 2)) (i32.const 2))
+(assert_return (invoke "call" (i32.const 3)) (i32.const 1))
+(assert_trap (invoke "call" (i32.const 0)) "uninitialized element")
+(assert_return (invoke "call_global") (i32.const 1))
+(assert_return (invoke "init_passive") (i32.const 0xbbaa))
+(assert_trap (invoke "init_dropped") "out of bounds memory access")
+(assert_return (invoke "init_elems") (i32.const 2))
+(assert_return (invoke "grow") (i32.const 2))
+(assert_return (invoke "load" (i32.const 131072)) (i32.const 0))
+(assert_return (invoke "load" (i32.const 70000)) (i32.const 0x70616e73))
@@ -0,0 +1,33 @@
+(module
+  (memory 1)
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store
+  )
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (func (export "grow") (param i32) (result i32)
+    local.get 0
+    memory.grow
+  )
+)
+
+(assert_return (invoke "store" (i32.const 0) (i32.const 0x11223344)))
+(assert_return (invoke "store" (i32.const 65532) (i32.const 0x55667788)))
+;; Grow past the initial 64 MiB address space reservation of 32 bit memories.
+(assert_return (invoke "grow" (i32.const 1535)) (i32.const 1))
+(assert_return (invoke "load" (i32.const 0)) (i32.const 0x11223344))
+(assert_return (invoke "load" (i32.const 65532)) (i32.const 0x55667788))
+(assert_return (invoke "load" (i32.const 65536)) (i32.const 0))
+(assert_return (invoke "store" (i32.const 0x5fffffc) (i32.const 0x99aabbcc)))
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 1536))
+(assert_return (invoke "load" (i32.const 0)) (i32.const 0x11223344))
+(assert_return (invoke "load" (i32.const 0x5fffffc)) (i32.const 0x99aabbcc))
+(assert_return (invoke "load" (i32.const 0x6000000)) (i32.const 0))
+(assert_trap (invoke "load" (i32.const 0x6010000)) "out of bounds memory access")
@@ -0,0 +1,95 @@
+;; Executed several times by the module-cache suite of run-tests.py:
+;; the byte code of these modules is loaded from the cache directory,
+;; or parsed again when the cached file is truncated, corrupted or was
+;; created by another build.
+
+(module
+  (memory 1)
+  (data (i32.const 16) "\01\02\03\04")
+  (table 2 funcref)
+  (elem (i32.const 0) $double $square)
+  (type $unary (func (param i32) (result i32)))
+
+  (func $double (param i32) (result i32)
+    local.get 0
+    local.get 0
+    i32.add
+  )
+
+  (func $square (param i32) (result i32)
+    local.get 0
+    local.get 0
+    i32.mul
+  )
+
+  (func (export "call") (param i32 i32) (result i32)
+    local.get 1
+    local.get 0
+    call_indirect (type $unary)
+  )
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (func (export "sum") (param i32) (result i64)
+    (local i64)
+    block
+      loop
+        local.get 0
+        i32.eqz
+        br_if 1
+        local.get 1
+        local.get 0
+        i64.extend_i32_u
+        i64.add
+        local.set 1
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br 0
+      end
+    end
+    local.get 1
+  )
+)
+
+(assert_return (invoke "call" (i32.const 0) (i32.const 21)) (i32.const 42))
+(assert_return (invoke "call" (i32.const 1) (i32.const 12)) (i32.const 144))
+(assert_trap (invoke "call" (i32.const 2) (i32.const 1)) "undefined element")
+(assert_return (invoke "load" (i32.const 16)) (i32.const 0x04030201))
+(assert_return (invoke "sum" (i32.const 1000)) (i64.const 500500))
+
+(module
+  (global $counter (mut i32) (i32.const 0))
+
+  (func (export "next") (result i32)
+    global.get $counter
+    i32.const 1
+    i32.add
+    global.set $counter
+    global.get $counter
+  )
+
+  (func (export "fac") (param i64) (result i64)
+    local.get 0
+    i64.const 2
+    i64.lt_u
+    if (result i64)
+      i64.const 1
+    else
+      local.get 0
+      local.get 0
+      i64.const 1
+      i64.sub
+      call 1
+      i64.mul
+    end
+  )
+)
+
+(assert_return (invoke "next") (i32.const 1))
+(assert_return (invoke "next") (i32.const 2))
+(assert_return (invoke "fac" (i64.const 20)) (i64.const 2432902008176640000))
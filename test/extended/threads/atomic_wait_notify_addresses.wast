@@ -0,0 +1,58 @@
+;; Waiters of different addresses are kept in different shards of the
+;; waiter table. Without other threads every wait times out, and every
+;; notify finds no waiter.
+(module
+  (memory 1 1 shared)
+
+  ;; Returns the number of addresses in [0, 4 * $count) for which both
+  ;; a wait with the given timeout timed out and a notify woke nobody.
+  (func (export "wait-all") (param $count i32) (param $timeout i64) (result i32)
+    (local $i i32)
+    (local $passed i32)
+    (loop $next
+      (if (i32.and
+            (i32.eq (memory.atomic.wait32 (i32.shl (local.get $i) (i32.const 2)) (i32.const 0) (local.get $timeout)) (i32.const 2))
+            (i32.eqz (memory.atomic.notify (i32.shl (local.get $i) (i32.const 2)) (i32.const -1))))
+        (then (local.set $passed (i32.add (local.get $passed) (i32.const 1)))))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $next (i32.lt_u (local.get $i) (local.get $count)))
+    )
+    (local.get $passed)
+  )
+
+  ;; Same as wait-all with 64 bit waits at every 8th byte.
+  (func (export "wait64-all") (param $count i32) (param $timeout i64) (result i32)
+    (local $i i32)
+    (local $passed i32)
+    (loop $next
+      (if (i32.and
+            (i32.eq (memory.atomic.wait64 (i32.shl (local.get $i) (i32.const 3)) (i64.const 0) (local.get $timeout)) (i32.const 2))
+            (i32.eqz (memory.atomic.notify (i32.shl (local.get $i) (i32.const 3)) (i32.const 1))))
+        (then (local.set $passed (i32.add (local.get $passed) (i32.const 1)))))
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (br_if $next (i32.lt_u (local.get $i) (local.get $count)))
+    )
+    (local.get $passed)
+  )
+
+  (func (export "store") (param i32 i32)
+    (i32.atomic.store (local.get 0) (local.get 1))
+  )
+
+  (func (export "wait32") (param i32 i32 i64) (result i32)
+    (memory.atomic.wait32 (local.get 0) (local.get 1) (local.get 2))
+  )
+)
+
+;; A zero timeout returns without blocking.
+(assert_return (invoke "wait-all" (i32.const 1024) (i64.const 0)) (i32.const 1024))
+(assert_return (invoke "wait64-all" (i32.const 1024) (i64.const 0)) (i32.const 1024))
+;; Short timeouts expire, and the waiters are removed from the table.
+(assert_return (invoke "wait-all" (i32.const 64) (i64.const 1000)) (i32.const 64))
+(assert_return (invoke "wait64-all" (i32.const 64) (i64.const 1000)) (i32.const 64))
+(assert_return (invoke "wait-all" (i32.const 4) (i64.const 1000000)) (i32.const 4))
+
+;; A value which does not match returns immediately, even without a timeout.
+(assert_return (invoke "store" (i32.const 256) (i32.const 1)))
+(assert_return (invoke "wait32" (i32.const 256) (i32.const 0) (i64.const -1)) (i32.const 1))
+(assert_return (invoke "wait32" (i32.const 256) (i32.const 1) (i64.const 0)) (i32.const 2))
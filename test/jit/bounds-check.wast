@@ -0,0 +1,116 @@
+(module
+  (memory 1 2)
+
+  (func (export "sum4") (param i32) (result i32)
+    local.get 0
+    i32.load offset=0
+    local.get 0
+    i32.load offset=12
+    i32.add
+    local.get 0
+    i32.load offset=4
+    i32.add
+    local.get 0
+    i32.load8_u offset=8
+    i32.add
+  )
+
+  (func (export "store-load") (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    i32.store offset=0
+    local.get 0
+    i32.load offset=4
+  )
+
+  (func (export "masked") (param i32) (result i32)
+    local.get 0
+    i32.const 0xfff0
+    i32.and
+    i32.load offset=12
+    local.get 0
+    i32.const 0x3ff
+    i32.rem_u
+    i32.load16_u
+    i32.add
+    local.get 0
+    i32.const 20
+    i32.shr_u
+    i32.load8_u offset=0x1000
+    i32.add
+  )
+
+  (func (export "loop") (param i32 i32) (result i64)
+    (local i64)
+    loop $loop
+      local.get 2
+      local.get 0
+      i64.load offset=8
+      i64.add
+      local.get 1
+      i32.const 2
+      i32.shl
+      i64.load32_u offset=16
+      i64.add
+      local.set 2
+      local.get 1
+      i32.const 1
+      i32.sub
+      local.tee 1
+      br_if $loop
+    end
+    local.get 2
+  )
+
+  (func (export "grow-loop") (param i32) (result i32)
+    (local i32)
+    loop $loop
+      local.get 0
+      i32.load
+      local.get 1
+      i32.add
+      local.set 1
+      i32.const 1
+      memory.grow
+      drop
+      local.get 0
+      i32.const 0x10000
+      i32.add
+      local.tee 0
+      i32.const 0x20000
+      i32.lt_u
+      br_if $loop
+    end
+    local.get 1
+  )
+
+  (func (export "read") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (data (i32.const 0) "\01\00\00\00\02\00\00\00\03\00\00\00\04\00\00\00\05\00\00\00\06\00\00\00")
+)
+
+(assert_return (invoke "sum4" (i32.const 0)) (i32.const 10))
+(assert_return (invoke "sum4" (i32.const 4)) (i32.const 14))
+(assert_return (invoke "sum4" (i32.const 65520)) (i32.const 0))
+(assert_trap (invoke "sum4" (i32.const 65521)) "out of bounds memory access")
+(assert_trap (invoke "sum4" (i32.const -1)) "out of bounds memory access")
+
+(assert_return (invoke "store-load" (i32.const 32) (i32.const 7)) (i32.const 0))
+(assert_trap (invoke "store-load" (i32.const 65532) (i32.const 9)) "out of bounds memory access")
+(assert_return (invoke "read" (i32.const 65532)) (i32.const 9))
+
+(assert_return (invoke "masked" (i32.const 0)) (i32.const 5))
+(assert_return (invoke "masked" (i32.const 0xffffffff)) (i32.const 521))
+
+(assert_return (invoke "loop" (i32.const 0) (i32.const 1)) (i64.const 0x0000000400000009))
+(assert_return (invoke "loop" (i32.const 8) (i32.const 2)) (i64.const 0x0000000c00000010))
+(assert_trap (invoke "loop" (i32.const 65528) (i32.const 1)) "out of bounds memory access")
+(assert_trap (invoke "loop" (i32.const 0) (i32.const 16380)) "out of bounds memory access")
+
+(assert_return (invoke "grow-loop" (i32.const 0)) (i32.const 1))
+(assert_return (invoke "grow-loop" (i32.const 0)) (i32.const 1))
+(assert_return (invoke "read" (i32.const 0x1fffc)) (i32.const 0))
+(assert_trap (invoke "read" (i32.const 0x1fffd)) "out of bounds memory access")
@@ -0,0 +1,260 @@
+(module
+  (func (export "fold32") (result i32)
+    i32.const 7
+    i32.const 5
+    i32.mul
+    i32.const 3
+    i32.sub
+    i32.const 4
+    i32.shl
+    i32.const 0xff
+    i32.xor
+    i32.clz
+  )
+
+  (func (export "fold64") (result i64)
+    (local i64)
+    i64.const -8
+    i64.const 3
+    i64.div_s
+    local.set 0
+    local.get 0
+    i64.const 1
+    i64.rotr
+    local.get 0
+    i64.const 7
+    i64.rem_u
+    i64.add
+  )
+
+  (func (export "fold-trap") (result i32)
+    i32.const 10
+    i32.const 0
+    i32.div_u
+  )
+
+  (func (export "fold-overflow") (result i64)
+    i64.const 0x8000000000000000
+    i64.const -1
+    i64.div_s
+  )
+
+  (func (export "branch") (param i32) (result i32)
+    (local i32)
+    i32.const 5
+    local.set 1
+    block $b
+      local.get 1
+      i32.const 5
+      i32.ne
+      br_if $b
+      local.get 0
+      i32.const 100
+      i32.add
+      local.set 0
+    end
+    local.get 1
+    i32.const 4
+    i32.gt_u
+    if (result i32)
+      local.get 0
+    else
+      i32.const -1
+    end
+  )
+
+  (func (export "br-table") (param i32) (result i32)
+    block $a
+      block $b
+        block $c
+          i32.const 1
+          br_table $a $b $c
+        end
+        i32.const 3
+        return
+      end
+      local.get 0
+      i32.const 2
+      i32.mul
+      return
+    end
+    i32.const 1
+  )
+
+  (func (export "loop") (param i32) (result i32)
+    (local i32 i32)
+    i32.const 10
+    local.set 1
+    loop $l
+      local.get 2
+      local.get 0
+      local.get 1
+      i32.rem_u
+      i32.add
+      local.set 2
+      local.get 0
+      local.get 1
+      i32.div_u
+      local.tee 0
+      br_if $l
+    end
+    local.get 2
+  )
+
+  (func (export "div_s") (param i32 i32) (result i32)
+    local.get 0
+    i32.const 4
+    i32.div_s
+    local.get 0
+    i32.const -8
+    i32.div_s
+    i32.const 16
+    i32.shl
+    i32.xor
+    local.get 0
+    i32.const 7
+    i32.div_s
+    local.get 0
+    i32.const -10
+    i32.div_s
+    i32.const 8
+    i32.shl
+    i32.xor
+    local.get 1
+    select
+  )
+
+  (func (export "div_u") (param i32 i32) (result i32)
+    local.get 0
+    i32.const 16
+    i32.div_u
+    local.get 0
+    i32.const 3
+    i32.div_u
+    local.get 0
+    i32.const 7
+    i32.div_u
+    local.get 1
+    select
+    i32.add
+  )
+
+  (func (export "rem_s") (param i32) (result i32)
+    local.get 0
+    i32.const 8
+    i32.rem_s
+    i32.const 16
+    i32.shl
+    local.get 0
+    i32.const -7
+    i32.rem_s
+    i32.const 8
+    i32.shl
+    i32.xor
+    local.get 0
+    i32.const -1
+    i32.rem_s
+    i32.xor
+  )
+
+  (func (export "rem_u") (param i32) (result i32)
+    local.get 0
+    i32.const 32
+    i32.rem_u
+    i32.const 8
+    i32.shl
+    local.get 0
+    i32.const 10
+    i32.rem_u
+    i32.add
+  )
+
+  (func (export "div_min") (param i32) (result i32)
+    local.get 0
+    i32.const 0x80000000
+    i32.div_s
+    local.get 0
+    i32.const 0x80000000
+    i32.rem_s
+    i32.add
+  )
+
+  (func (export "div_s64") (param i64) (result i64)
+    local.get 0
+    i64.const -16
+    i64.div_s
+    local.get 0
+    i64.const 16
+    i64.rem_s
+    i64.const 32
+    i64.shl
+    i64.xor
+  )
+
+  (func (export "rem_s64") (param i64) (result i64)
+    local.get 0
+    i64.const -1
+    i64.rem_s
+    local.get 0
+    i64.const 10
+    i64.rem_s
+    i64.add
+  )
+
+  (func (export "mul") (param i32 i64) (result i64)
+    i32.const 8
+    local.get 0
+    i32.mul
+    i64.extend_i32_u
+    local.get 1
+    i64.const 0x100000000
+    i64.mul
+    i64.add
+  )
+)
+
+(assert_return (invoke "fold32") (i32.const 22))
+(assert_return (invoke "fold64") (i64.const 0x7fffffffffffffff))
+(assert_trap (invoke "fold-trap") "integer divide by zero")
+(assert_trap (invoke "fold-overflow") "integer overflow")
+
+(assert_return (invoke "branch" (i32.const 1)) (i32.const 101))
+(assert_return (invoke "br-table" (i32.const 21)) (i32.const 42))
+
+(assert_return (invoke "loop" (i32.const 12345)) (i32.const 15))
+(assert_return (invoke "loop" (i32.const -1)) (i32.const 57))
+
+(assert_return (invoke "div_s" (i32.const 100) (i32.const 1)) (i32.const 0xfff40019))
+(assert_return (invoke "div_s" (i32.const -100) (i32.const 1)) (i32.const 0xfff3ffe7))
+(assert_return (invoke "div_s" (i32.const 100) (i32.const 0)) (i32.const 0xfffff60e))
+(assert_return (invoke "div_s" (i32.const -100) (i32.const 0)) (i32.const 0xfffff5f2))
+(assert_return (invoke "div_s" (i32.const 0x80000000) (i32.const 0)) (i32.const 0x217a176e))
+(assert_return (invoke "div_s" (i32.const 0x7fffffff) (i32.const 0)) (i32.const 0x217a1092))
+(assert_return (invoke "div_s" (i32.const -3) (i32.const 1)) (i32.const 0))
+
+(assert_return (invoke "div_u" (i32.const 100) (i32.const 1)) (i32.const 39))
+(assert_return (invoke "div_u" (i32.const 100) (i32.const 0)) (i32.const 20))
+(assert_return (invoke "div_u" (i32.const -1) (i32.const 1)) (i32.const 0x65555554))
+(assert_return (invoke "div_u" (i32.const -1) (i32.const 0)) (i32.const 0x34924923))
+
+(assert_return (invoke "rem_s" (i32.const 100)) (i32.const 0x00040200))
+(assert_return (invoke "rem_s" (i32.const -100)) (i32.const 0x0003fe00))
+(assert_return (invoke "rem_s" (i32.const -13)) (i32.const 0x0004fa00))
+(assert_return (invoke "rem_s" (i32.const 0x80000000)) (i32.const 0xfffffe00))
+
+(assert_return (invoke "rem_u" (i32.const 12345)) (i32.const 0x1905))
+(assert_return (invoke "rem_u" (i32.const -1)) (i32.const 0x1f05))
+
+(assert_return (invoke "div_min" (i32.const 0x80000000)) (i32.const 1))
+(assert_return (invoke "div_min" (i32.const 0x80000001)) (i32.const 0x80000001))
+(assert_return (invoke "div_min" (i32.const -1)) (i32.const -1))
+(assert_return (invoke "div_min" (i32.const 5)) (i32.const 5))
+
+(assert_return (invoke "div_s64" (i64.const 100)) (i64.const 0xfffffffbfffffffa))
+(assert_return (invoke "div_s64" (i64.const -100)) (i64.const 0xfffffffc00000006))
+(assert_return (invoke "div_s64" (i64.const 0x8000000000000000)) (i64.const 0x0800000000000000))
+
+(assert_return (invoke "rem_s64" (i64.const 0x8000000000000000)) (i64.const -8))
+(assert_return (invoke "rem_s64" (i64.const 123)) (i64.const 3))
+
+(assert_return (invoke "mul" (i32.const 0x30000001) (i64.const 3)) (i64.const 0x0000000380000008))
@@ -0,0 +1,194 @@
+(module
+  (memory 1)
+  (global $counter (mut i32) (i32.const 0))
+  (global $scale (mut f64) (f64.const 2.5))
+
+  (func $add (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    i32.add
+  )
+
+  (func $mix (param i32 i64 f32 f64) (result f64 i64 i32 f32)
+    local.get 3
+    global.get $scale
+    f64.mul
+    local.get 1
+    i64.const 3
+    i64.shl
+    local.get 0
+    i32.const 7
+    i32.xor
+    local.get 2
+    f32.neg
+  )
+
+  (func $load (param i32) (result i64)
+    local.get 0
+    i64.load offset=8
+  )
+
+  (func $store (param i32 i64)
+    local.get 0
+    local.get 1
+    i64.store offset=8
+    global.get $counter
+    i32.const 1
+    i32.add
+    global.set $counter
+  )
+
+  (func $div (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    i32.div_s
+  )
+
+  (func $branch (param i32) (result i32)
+    local.get 0
+    if (result i32)
+      i32.const 1
+    else
+      i32.const 2
+    end
+  )
+
+  (func (export "sum") (param i32) (result i32)
+    (local i32 i32)
+    loop $loop
+      local.get 1
+      local.get 2
+      call $add
+      local.set 1
+      local.get 2
+      i32.const 1
+      call $add
+      local.tee 2
+      local.get 0
+      i32.lt_u
+      br_if $loop
+    end
+    local.get 1
+  )
+
+  (func (export "mix") (param i32 i64 f32 f64) (result f64 i64 i32 f32)
+    local.get 0
+    local.get 1
+    local.get 2
+    local.get 3
+    call $mix
+  )
+
+  (func (export "memory") (param i32 i64) (result i64 i32)
+    local.get 0
+    local.get 1
+    call $store
+    local.get 0
+    call $load
+    global.get $counter
+  )
+
+  (func (export "div") (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    call $div
+    local.get 1
+    call $branch
+    call $add
+  )
+)
+
+(assert_return (invoke "sum" (i32.const 10)) (i32.const 45))
+(assert_return (invoke "mix" (i32.const 5) (i64.const 6) (f32.const 1.5) (f64.const 4.0))
+  (f64.const 10.0) (i64.const 48) (i32.const 2) (f32.const -1.5))
+(assert_return (invoke "memory" (i32.const 16) (i64.const 0x123456789)) (i64.const 0x123456789) (i32.const 1))
+(assert_return (invoke "memory" (i32.const 32) (i64.const -1)) (i64.const -1) (i32.const 2))
+(assert_trap (invoke "memory" (i32.const 65530) (i64.const 0)) "out of bounds memory access")
+(assert_return (invoke "div" (i32.const 100) (i32.const 7)) (i32.const 15))
+(assert_trap (invoke "div" (i32.const 100) (i32.const 0)) "integer divide by zero")
+
+;; The callees are small and numeric only, so they are always inlined.
+;; The callers update the state before the inlined callees trap.
+(module
+  (memory 1)
+  (global $calls (mut i32) (i32.const 0))
+
+  (func $checked_div (param i64 i64) (result i64)
+    global.get $calls
+    i32.const 1
+    i32.add
+    global.set $calls
+    local.get 0
+    local.get 1
+    i64.div_s
+  )
+
+  (func $to_int (param f32) (result i32)
+    local.get 0
+    i32.trunc_f32_s
+  )
+
+  (func $read (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (func (export "div_loop") (param i64 i32) (result i64)
+    (local i64)
+    loop $loop
+      local.get 0
+      local.get 1
+      i64.extend_i32_s
+      call $checked_div
+      local.get 2
+      i64.add
+      local.set 2
+      local.get 1
+      i32.const 1
+      i32.sub
+      local.tee 1
+      i32.const -1
+      i32.ne
+      br_if $loop
+    end
+    local.get 2
+  )
+
+  (func (export "convert") (param f32) (result i32)
+    local.get 0
+    call $to_int
+    i32.const 1
+    i32.add
+  )
+
+  (func (export "read_loop") (param i32) (result i32)
+    (local i32)
+    loop $loop
+      local.get 0
+      call $read
+      local.get 1
+      i32.add
+      local.set 1
+      local.get 0
+      i32.const 4096
+      i32.add
+      local.set 0
+      br $loop
+    end
+    local.get 1
+  )
+
+  (func (export "calls") (result i32)
+    global.get $calls
+  )
+)
+
+(assert_trap (invoke "div_loop" (i64.const 60) (i32.const 3)) "integer divide by zero")
+(assert_return (invoke "calls") (i32.const 4))
+(assert_trap (invoke "div_loop" (i64.const 0x8000000000000000) (i32.const -1)) "integer overflow")
+(assert_return (invoke "calls") (i32.const 5))
+(assert_return (invoke "convert" (f32.const -7.5)) (i32.const -6))
+(assert_trap (invoke "convert" (f32.const nan)) "invalid conversion to integer")
+(assert_trap (invoke "convert" (f32.const 3e9)) "integer overflow")
+(assert_trap (invoke "read_loop" (i32.const 0)) "out of bounds memory access")
+(assert_return (invoke "calls") (i32.const 5))
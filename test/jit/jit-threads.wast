@@ -0,0 +1,109 @@
+(module
+  (memory 1)
+  (tag $except0 (param i32))
+
+  (func $square (param i32) (result i32)
+    local.get 0
+    local.get 0
+    i32.mul
+  )
+
+  (func $sum (param i32) (result i32)
+    (local i32)
+    (block $exit
+      (loop $loop
+        local.get 0
+        i32.eqz
+        br_if $exit
+        local.get 1
+        local.get 0
+        call $square
+        i32.add
+        local.set 1
+        local.get 0
+        i32.const 1
+        i32.sub
+        local.set 0
+        br $loop
+      )
+    )
+    local.get 1
+  )
+
+  (func $check (param i32) (result i32)
+    local.get 0
+    i32.const 100
+    i32.gt_u
+    if
+      local.get 0
+      throw $except0
+    end
+    local.get 0
+  )
+
+  (func $try (param i32) (result i32)
+    (try (result i32)
+      (do
+        local.get 0
+        call $check
+      )
+      (catch $except0
+        i32.const -1
+        i32.mul
+      )
+    )
+  )
+
+  (func $try2 (param i32) (result i32)
+    (try (result i32)
+      (do
+        local.get 0
+        call $try
+        i32.const 1
+        i32.add
+        call $check
+      )
+      (catch_all
+        i32.const 0
+      )
+    )
+  )
+
+  (func $store (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    i32.store
+    local.get 0
+    i32.load
+  )
+
+  (func (export "sum") (param i32) (result i32)
+    local.get 0
+    call $sum
+  )
+
+  (func (export "try") (param i32) (result i32)
+    local.get 0
+    call $try
+  )
+
+  (func (export "try2") (param i32) (result i32)
+    local.get 0
+    call $try2
+  )
+
+  (func (export "store") (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    call $store
+  )
+)
+
+(assert_return (invoke "sum" (i32.const 10)) (i32.const 385))
+(assert_return (invoke "try" (i32.const 50)) (i32.const 50))
+(assert_return (invoke "try" (i32.const 500)) (i32.const -500))
+(assert_return (invoke "try2" (i32.const 99)) (i32.const 100))
+(assert_return (invoke "try2" (i32.const 100)) (i32.const 0))
+(assert_return (invoke "try2" (i32.const -5)) (i32.const 6))
+(assert_return (invoke "store" (i32.const 16) (i32.const 1234)) (i32.const 1234))
+(assert_trap (invoke "store" (i32.const 65534) (i32.const 1)) "out of bounds memory access")
@@ -0,0 +1,188 @@
+(module
+  (memory 1 4)
+  (global $g i32 (i32.const 7))
+  (global $g64 i64 (i64.const 0x100000000))
+  (global $m (mut i32) (i32.const 3))
+
+  (func (export "global") (param i32) (result i32)
+    (local i32)
+    loop $l
+      global.get $g
+      i32.const 3
+      i32.mul
+      local.get 1
+      i32.add
+      local.set 1
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 1
+  )
+
+  (func (export "mutable") (param i32) (result i32)
+    (local i32)
+    loop $l
+      global.get $m
+      i32.const 1
+      i32.add
+      global.set $m
+      global.get $m
+      local.get 1
+      i32.add
+      local.set 1
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 1
+  )
+
+  (func (export "size") (param i32) (result i32)
+    (local i32)
+    loop $l
+      memory.size
+      local.get 1
+      i32.add
+      local.set 1
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 1
+  )
+
+  (func (export "size-grow") (param i32) (result i32)
+    (local i32)
+    loop $l
+      memory.size
+      local.get 1
+      i32.add
+      local.set 1
+      i32.const 1
+      memory.grow
+      drop
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 1
+  )
+
+  (func (export "modified") (param i32) (result i32)
+    (local i32 i32)
+    loop $l
+      i32.const 10
+      local.set 1
+      local.get 1
+      local.get 2
+      i32.add
+      local.set 2
+      local.get 1
+      i32.const 1
+      i32.add
+      local.set 1
+      local.get 1
+      local.get 2
+      i32.add
+      local.set 2
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 2
+  )
+
+  (func (export "read-before") (param i32) (result i32)
+    (local i32 i32)
+    loop $l
+      local.get 1
+      local.get 2
+      i32.add
+      local.set 2
+      i32.const 5
+      local.set 1
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $l
+    end
+    local.get 2
+  )
+
+  (func (export "float") (param f64 i32) (result f64)
+    (local f64)
+    loop $l
+      local.get 0
+      local.get 0
+      f64.mul
+      local.get 2
+      f64.add
+      local.set 2
+      local.get 1
+      i32.const 1
+      i32.sub
+      local.tee 1
+      br_if $l
+    end
+    local.get 2
+  )
+
+  (func (export "nested") (param i32 i32) (result i64)
+    (local i32 i64)
+    loop $outer
+      local.get 1
+      local.set 2
+      loop $inner
+        global.get $g64
+        local.get 0
+        i64.extend_i32_u
+        i64.mul
+        local.get 1
+        i32.const 3
+        i32.mul
+        i64.extend_i32_u
+        i64.add
+        local.get 3
+        i64.add
+        local.set 3
+        local.get 2
+        i32.const 1
+        i32.sub
+        local.tee 2
+        br_if $inner
+      end
+      local.get 0
+      i32.const 1
+      i32.sub
+      local.tee 0
+      br_if $outer
+    end
+    local.get 3
+  )
+)
+
+(assert_return (invoke "global" (i32.const 5)) (i32.const 105))
+(assert_return (invoke "mutable" (i32.const 3)) (i32.const 15))
+(assert_return (invoke "mutable" (i32.const 1)) (i32.const 7))
+
+(assert_return (invoke "size" (i32.const 3)) (i32.const 3))
+(assert_return (invoke "size-grow" (i32.const 3)) (i32.const 6))
+(assert_return (invoke "size" (i32.const 2)) (i32.const 8))
+(assert_return (invoke "size-grow" (i32.const 2)) (i32.const 8))
+
+(assert_return (invoke "modified" (i32.const 2)) (i32.const 42))
+(assert_return (invoke "read-before" (i32.const 3)) (i32.const 10))
+(assert_return (invoke "float" (f64.const 1.5) (i32.const 3)) (f64.const 6.75))
+(assert_return (invoke "nested" (i32.const 3) (i32.const 2)) (i64.const 0xc00000024))
@@ -0,0 +1,77 @@
+(module
+  (memory 1 2)
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+
+  (func (export "load_offset") (param i32) (result i64)
+    local.get 0
+    i64.load offset=0xfffffff0
+  )
+
+  (func (export "load_const") (result i32)
+    i32.const 65534
+    i32.load16_u offset=1
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store
+  )
+
+  (func (export "store_v128") (param i32)
+    local.get 0
+    v128.const i32x4 1 2 3 4
+    v128.store offset=8
+  )
+
+  (func (export "try_load") (param i32) (result i32)
+    (try (result i32)
+      (do
+        local.get 0
+        i32.load
+      )
+      (catch_all
+        i32.const -1
+      )
+    )
+  )
+
+  (func $inner (param i32) (result i32)
+    local.get 0
+    i32.load8_s
+  )
+
+  (func (export "nested") (param i32) (result i32)
+    local.get 0
+    call $inner
+    i32.const 1
+    i32.add
+  )
+
+  (func (export "grow") (result i32)
+    i32.const 1
+    memory.grow
+  )
+)
+
+(assert_return (invoke "store" (i32.const 65532) (i32.const 0x12345678)))
+(assert_return (invoke "load" (i32.const 65532)) (i32.const 0x12345678))
+(assert_trap (invoke "load" (i32.const 65533)) "out of bounds memory access")
+(assert_trap (invoke "load" (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "load_offset" (i32.const 0)) "out of bounds memory access")
+(assert_trap (invoke "load_offset" (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "load_const") "out of bounds memory access")
+(assert_trap (invoke "store" (i32.const 65534) (i32.const 0x11223344)) "out of bounds memory access")
+(assert_return (invoke "load" (i32.const 65532)) (i32.const 0x12345678))
+(assert_trap (invoke "store_v128" (i32.const 65520)) "out of bounds memory access")
+(assert_trap (invoke "try_load" (i32.const 65536)) "out of bounds memory access")
+(assert_trap (invoke "nested" (i32.const 65536)) "out of bounds memory access")
+(assert_return (invoke "nested" (i32.const 65535)) (i32.const 19))
+(assert_return (invoke "grow") (i32.const 1))
+(assert_return (invoke "load" (i32.const 65536)) (i32.const 0))
+(assert_trap (invoke "load" (i32.const 131069)) "out of bounds memory access")
+(assert_return (invoke "grow") (i32.const -1))
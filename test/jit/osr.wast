@@ -0,0 +1,157 @@
+(module
+  (tag $except0 (param i32))
+
+  (func (export "mix") (param i32) (result f64)
+    (local i32 i64 f64 v128)
+    (loop $loop
+      local.get 2
+      local.get 1
+      i64.extend_i32_u
+      i64.add
+      local.set 2
+
+      local.get 3
+      local.get 1
+      f64.convert_i32_u
+      f64.const 0.5
+      f64.mul
+      f64.add
+      local.set 3
+
+      local.get 4
+      local.get 1
+      i32x4.splat
+      i32x4.add
+      local.set 4
+
+      local.get 1
+      i32.const 1
+      i32.add
+      local.tee 1
+      local.get 0
+      i32.lt_u
+      br_if $loop
+    )
+    local.get 2
+    f64.convert_i64_u
+    local.get 3
+    f64.add
+    local.get 4
+    i32x4.extract_lane 3
+    f64.convert_i32_s
+    f64.add
+  )
+
+  (func (export "nested") (param i32) (result i32)
+    (local i32 i32 i32)
+    (loop $outer
+      i32.const 0
+      local.set 2
+      (loop $inner
+        local.get 3
+        local.get 1
+        local.get 2
+        i32.mul
+        i32.add
+        local.set 3
+
+        local.get 2
+        i32.const 1
+        i32.add
+        local.tee 2
+        local.get 0
+        i32.lt_u
+        br_if $inner
+      )
+      local.get 1
+      i32.const 1
+      i32.add
+      local.tee 1
+      local.get 0
+      i32.lt_u
+      br_if $outer
+    )
+    local.get 3
+  )
+
+  (func (export "operand") (param i32) (result i32)
+    (local i32)
+    i32.const 7
+    (block $exit (param i32) (result i32)
+      (loop $loop (param i32) (result i32)
+        local.get 1
+        i32.const 1
+        i32.add
+        local.tee 1
+        local.get 0
+        i32.ge_u
+        br_if $exit
+        i32.const 3
+        i32.mul
+        i32.const 1
+        i32.add
+        br $loop
+      )
+    )
+    local.get 1
+    i32.add
+  )
+
+  (func (export "catch") (param i32 i32) (result i32)
+    (local i32)
+    (try (result i32)
+      (do
+        (loop $loop
+          local.get 2
+          local.get 1
+          i32.eq
+          if
+            local.get 2
+            throw $except0
+          end
+
+          local.get 2
+          i32.const 1
+          i32.add
+          local.tee 2
+          local.get 0
+          i32.lt_u
+          br_if $loop
+        )
+        i32.const -1
+      )
+      (catch $except0
+        i32.const 1
+        i32.add
+      )
+    )
+  )
+
+  (func (export "trap") (param i32) (result i32)
+    (local i32)
+    (loop $loop
+      i32.const 1000
+      local.get 0
+      local.get 1
+      i32.sub
+      i32.div_u
+      drop
+
+      local.get 1
+      i32.const 1
+      i32.add
+      local.tee 1
+      local.get 0
+      i32.le_u
+      br_if $loop
+    )
+    local.get 1
+  )
+)
+
+(assert_return (invoke "mix" (i32.const 200000)) (f64.const 0x1.a90de8dc00000p+34))
+(assert_return (invoke "nested" (i32.const 600)) (i32.const -2067648368))
+(assert_return (invoke "operand" (i32.const 100000)) (i32.const -10280990))
+(assert_return (invoke "catch" (i32.const 200000) (i32.const 150000)) (i32.const 150001))
+(assert_return (invoke "catch" (i32.const 200000) (i32.const 300000)) (i32.const -1))
+(assert_trap (invoke "trap" (i32.const 100000)) "integer divide by zero")
@@ -0,0 +1,244 @@
+;; Many values are live across three nested loops, so some of them
+;; are spilled. The loop carried values should keep their registers.
+(module
+  (func (export "nested") (param $n i32) (param $m i32) (param $p i32)
+    (param $p0 i32) (param $p1 i32) (param $p2 i32) (param $p3 i32)
+    (param $p4 i32) (param $p5 i32) (param $p6 i32) (param $p7 i32) (result i32 f64)
+    (local $i i32) (local $j i32) (local $k i32)
+    (local $a0 i32) (local $a1 i32) (local $a2 i32) (local $a3 i32)
+    (local $a4 i32) (local $a5 i32) (local $a6 i32) (local $a7 i32)
+    (local $a8 i32) (local $a9 i32) (local $a10 i32) (local $a11 i32)
+    (local $f0 f64) (local $f1 f64) (local $f2 f64) (local $f3 f64)
+    i32.const 1
+    local.set $a0
+    i32.const 8
+    local.set $a1
+    i32.const 15
+    local.set $a2
+    i32.const 22
+    local.set $a3
+    i32.const 29
+    local.set $a4
+    i32.const 36
+    local.set $a5
+    i32.const 43
+    local.set $a6
+    i32.const 50
+    local.set $a7
+    i32.const 57
+    local.set $a8
+    i32.const 64
+    local.set $a9
+    i32.const 71
+    local.set $a10
+    i32.const 78
+    local.set $a11
+    f64.const 0.5
+    local.set $f0
+    f64.const 1.5
+    local.set $f1
+    f64.const 2.5
+    local.set $f2
+    f64.const 3.5
+    local.set $f3
+    i32.const 0
+    local.set $i
+    loop $i_loop
+      i32.const 0
+      local.set $j
+      loop $j_loop
+        i32.const 0
+        local.set $k
+        loop $k_loop
+          local.get $a0
+          local.get $p0
+          i32.add
+          local.get $k
+          i32.add
+          local.set $a0
+          local.get $a1
+          local.get $p1
+          local.get $j
+          i32.add
+          i32.xor
+          local.set $a1
+          local.get $a2
+          local.get $a0
+          i32.const 3
+          i32.mul
+          i32.add
+          local.set $a2
+          local.get $a3
+          local.get $p2
+          i32.sub
+          local.set $a3
+          local.get $a4
+          local.get $a1
+          i32.const 0xff
+          i32.and
+          i32.add
+          local.set $a4
+          local.get $a5
+          i32.const 5
+          i32.mul
+          local.get $p3
+          i32.add
+          local.set $a5
+          local.get $a6
+          local.get $a5
+          i32.add
+          local.get $i
+          i32.add
+          local.set $a6
+          local.get $a7
+          local.get $a2
+          i32.xor
+          local.set $a7
+          local.get $a8
+          local.get $p4
+          local.get $k
+          i32.mul
+          i32.add
+          local.set $a8
+          local.get $a9
+          local.get $p5
+          local.get $k
+          i32.const 7
+          i32.and
+          i32.shl
+          i32.or
+          local.set $a9
+          local.get $a10
+          local.get $a9
+          i32.add
+          local.get $p6
+          i32.sub
+          local.set $a10
+          local.get $a11
+          local.get $p7
+          i32.add
+          local.get $a3
+          i32.add
+          local.set $a11
+          local.get $f0
+          f64.const 1.25
+          f64.add
+          local.set $f0
+          local.get $f1
+          f64.const 0.5
+          f64.mul
+          local.get $f0
+          f64.add
+          local.set $f1
+          local.get $f2
+          local.get $k
+          f64.convert_i32_u
+          f64.add
+          local.set $f2
+          local.get $f3
+          local.get $f1
+          f64.const 0.125
+          f64.mul
+          f64.sub
+          local.set $f3
+          local.get $k
+          i32.const 1
+          i32.add
+          local.tee $k
+          local.get $p
+          i32.lt_u
+          br_if $k_loop
+        end
+        local.get $a0
+        local.get $a11
+        i32.add
+        local.set $a0
+        local.get $f0
+        f64.const 0.5
+        f64.mul
+        local.set $f0
+        local.get $j
+        i32.const 1
+        i32.add
+        local.tee $j
+        local.get $m
+        i32.lt_u
+        br_if $j_loop
+      end
+      local.get $a1
+      local.get $a10
+      i32.add
+      local.set $a1
+      local.get $i
+      i32.const 1
+      i32.add
+      local.tee $i
+      local.get $n
+      i32.lt_u
+      br_if $i_loop
+    end
+    i32.const 0
+    i32.const 31
+    i32.mul
+    local.get $a0
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a1
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a2
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a3
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a4
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a5
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a6
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a7
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a8
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a9
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a10
+    i32.add
+    i32.const 31
+    i32.mul
+    local.get $a11
+    i32.add
+    local.get $f0
+    local.get $f1
+    f64.add
+    local.get $f2
+    f64.add
+    local.get $f3
+    f64.add
+  )
+)
+
+(assert_return (invoke "nested" (i32.const 1) (i32.const 1) (i32.const 1) (i32.const 1) (i32.const 2) (i32.const 3) (i32.const 4) (i32.const 5) (i32.const 6) (i32.const 7) (i32.const 8))
+  (i32.const 1633961672) (f64.const 9.0625))
+(assert_return (invoke "nested" (i32.const 3) (i32.const 4) (i32.const 5) (i32.const 11) (i32.const -2) (i32.const 7) (i32.const 74565) (i32.const 3) (i32.const 1) (i32.const -9) (i32.const 100))
+  (i32.const -1803698776) (f64.const 22.192187992219004))
+(assert_return (invoke "nested" (i32.const 2) (i32.const 10) (i32.const 17) (i32.const -1) (i32.const 2147483647) (i32.const 5) (i32.const -3) (i32.const 9) (i32.const 85) (i32.const 2) (i32.const -100000))
+  (i32.const 873993113) (f64.const 253.75008774014123))
@@ -0,0 +1,101 @@
+(module
+  (memory 1)
+  (tag $except0 (param i32))
+
+  (func $add (param i32 i32) (result i32)
+    local.get 0
+    local.get 1
+    i32.add
+  )
+
+  (func $check (param i32) (result i32)
+    local.get 0
+    i32.const 5000
+    i32.eq
+    if
+      local.get 0
+      throw $except0
+    end
+    local.get 0
+  )
+
+  (func (export "sum") (param i32) (result i32)
+    (local i32 i32)
+    (loop $loop
+      local.get 1
+      local.get 2
+      call $add
+      local.set 1
+
+      local.get 2
+      i32.const 1
+      i32.add
+      local.tee 2
+      local.get 0
+      i32.lt_u
+      br_if $loop
+    )
+    local.get 1
+  )
+
+  (func (export "fill") (param i32) (result i32)
+    (local i32)
+    (block $exit
+      (loop $loop
+        local.get 1
+        local.get 0
+        i32.ge_u
+        br_if $exit
+
+        local.get 1
+        i32.const 2
+        i32.shl
+        local.get 1
+        i32.store
+
+        local.get 1
+        i32.const 1
+        i32.add
+        local.set 1
+        br $loop
+      )
+    )
+    i32.const 1000
+    i32.load
+  )
+
+  (func (export "catch") (param i32) (result i32)
+    (local i32)
+    (try (result i32)
+      (do
+        (loop $loop
+          local.get 1
+          call $check
+          i32.const 1
+          i32.add
+          local.tee 1
+          local.get 0
+          i32.lt_u
+          br_if $loop
+        )
+        i32.const -1
+      )
+      (catch $except0)
+    )
+  )
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load
+  )
+)
+
+(assert_return (invoke "sum" (i32.const 10)) (i32.const 45))
+(assert_return (invoke "sum" (i32.const 100000)) (i32.const 704982704))
+(assert_return (invoke "sum" (i32.const 10)) (i32.const 45))
+(assert_return (invoke "fill" (i32.const 16384)) (i32.const 250))
+(assert_return (invoke "catch" (i32.const 4000)) (i32.const -1))
+(assert_return (invoke "catch" (i32.const 10000)) (i32.const 5000))
+(assert_return (invoke "catch" (i32.const 10000)) (i32.const 5000))
+(assert_return (invoke "load" (i32.const 65532)) (i32.const 16383))
+(assert_trap (invoke "load" (i32.const 65533)) "out of bounds memory access")
@@ -0,0 +1,125 @@
+;; Executed by the memory-pool suite of run-tests.py with a pool of two
+;; slots. The memories of the last two instances do not fit into the
+;; pool, so they are allocated without it.
+
+(module $m0
+  (memory (export "memory") 1 2)
+  (data (i32.const 0) "\01")
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load8_u
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store8
+  )
+
+  (func (export "grow") (param i32) (result i32)
+    local.get 0
+    memory.grow
+  )
+)
+
+(assert_return (invoke $m0 "load" (i32.const 0)) (i32.const 1))
+(assert_return (invoke $m0 "load" (i32.const 65535)) (i32.const 0))
+(assert_return (invoke $m0 "store" (i32.const 65535) (i32.const 10)))
+(assert_return (invoke $m0 "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke $m0 "load" (i32.const 131071)) (i32.const 0))
+(assert_trap (invoke $m0 "load" (i32.const 131072)) "out of bounds memory access")
+
+(module $m1
+  (memory (export "memory") 1 2)
+  (data (i32.const 0) "\02")
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load8_u
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store8
+  )
+
+  (func (export "grow") (param i32) (result i32)
+    local.get 0
+    memory.grow
+  )
+)
+
+(assert_return (invoke $m1 "load" (i32.const 0)) (i32.const 2))
+(assert_return (invoke $m1 "load" (i32.const 65535)) (i32.const 0))
+(assert_return (invoke $m1 "store" (i32.const 65535) (i32.const 11)))
+(assert_return (invoke $m1 "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke $m1 "load" (i32.const 131071)) (i32.const 0))
+(assert_trap (invoke $m1 "load" (i32.const 131072)) "out of bounds memory access")
+
+(module $m2
+  (memory (export "memory") 1 2)
+  (data (i32.const 0) "\03")
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load8_u
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store8
+  )
+
+  (func (export "grow") (param i32) (result i32)
+    local.get 0
+    memory.grow
+  )
+)
+
+(assert_return (invoke $m2 "load" (i32.const 0)) (i32.const 3))
+(assert_return (invoke $m2 "load" (i32.const 65535)) (i32.const 0))
+(assert_return (invoke $m2 "store" (i32.const 65535) (i32.const 12)))
+(assert_return (invoke $m2 "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke $m2 "load" (i32.const 131071)) (i32.const 0))
+(assert_trap (invoke $m2 "load" (i32.const 131072)) "out of bounds memory access")
+
+(module $m3
+  (memory (export "memory") 1 2)
+  (data (i32.const 0) "\04")
+
+  (func (export "load") (param i32) (result i32)
+    local.get 0
+    i32.load8_u
+  )
+
+  (func (export "store") (param i32 i32)
+    local.get 0
+    local.get 1
+    i32.store8
+  )
+
+  (func (export "grow") (param i32) (result i32)
+    local.get 0
+    memory.grow
+  )
+)
+
+(assert_return (invoke $m3 "load" (i32.const 0)) (i32.const 4))
+(assert_return (invoke $m3 "load" (i32.const 65535)) (i32.const 0))
+(assert_return (invoke $m3 "store" (i32.const 65535) (i32.const 13)))
+(assert_return (invoke $m3 "grow" (i32.const 1)) (i32.const 1))
+(assert_return (invoke $m3 "load" (i32.const 131071)) (i32.const 0))
+(assert_trap (invoke $m3 "load" (i32.const 131072)) "out of bounds memory access")
+
+;; The memories of the instances are not shared.
+(assert_return (invoke $m0 "load" (i32.const 0)) (i32.const 1))
+(assert_return (invoke $m0 "load" (i32.const 65535)) (i32.const 10))
+(assert_return (invoke $m1 "load" (i32.const 0)) (i32.const 2))
+(assert_return (invoke $m1 "load" (i32.const 65535)) (i32.const 11))
+(assert_return (invoke $m2 "load" (i32.const 0)) (i32.const 3))
+(assert_return (invoke $m2 "load" (i32.const 65535)) (i32.const 12))
+(assert_return (invoke $m3 "load" (i32.const 0)) (i32.const 4))
+(assert_return (invoke $m3 "load" (i32.const 65535)) (i32.const 13))
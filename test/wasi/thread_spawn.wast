@@ -0,0 +1,55 @@
+(module
+  (import "wasi" "thread-spawn" (func $thread_spawn (param i32) (result i32)))
+  (import "env" "memory" (memory 1 1 shared))
+
+  ;; Address 0: sum of the start arguments
+  ;; Address 4: number of finished threads
+  (func (export "wasi_thread_start") (param $tid i32) (param $arg i32)
+    (drop (i32.atomic.rmw.add (i32.const 0) (local.get $arg)))
+    (drop (i32.atomic.rmw.add (i32.const 4) (i32.const 1)))
+    (drop (memory.atomic.notify (i32.const 4) (i32.const 1)))
+  )
+
+  (func (export "run") (param $count i32) (result i32)
+    (local $i i32)
+    (local $finished i32)
+    (loop $spawn
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (if (i32.le_s (call $thread_spawn (local.get $i)) (i32.const 0))
+        (then (return (i32.const -1))))
+      (br_if $spawn (i32.lt_u (local.get $i) (local.get $count)))
+    )
+    (loop $wait
+      (local.set $finished (i32.atomic.load (i32.const 4)))
+      (if (i32.lt_u (local.get $finished) (local.get $count))
+        (then
+          (drop (memory.atomic.wait32 (i32.const 4) (local.get $finished) (i64.const -1)))
+          (br $wait)))
+    )
+    (i32.atomic.load (i32.const 0))
+  )
+)
+
+(assert_return (invoke "run" (i32.const 8)) (i32.const 36))
+
+(module
+  (import "wasi" "thread-spawn" (func $thread_spawn (param i32) (result i32)))
+  (memory 1)
+
+  (func (export "wasi_thread_start") (param i32 i32))
+
+  ;; Threads cannot be started without a shared memory.
+  (func (export "spawn") (result i32)
+    (call $thread_spawn (i32.const 0))
+  )
+)
+
+(assert_return (invoke "spawn") (i32.const -1))
+
+(assert_unlinkable
+  (module
+    (import "wasi" "thread-spawn" (func (param i64) (result i32)))
+    (import "env" "memory" (memory 1 1 shared))
+  )
+  "incompatible function import type"
+)
@@ -0,0 +1,75 @@
+;; Waiters of the same address are woken in the order they started
+;; waiting, and notify returns the number of woken waiters.
+(module
+  (import "wasi" "thread-spawn" (func $thread_spawn (param i32) (result i32)))
+  (import "env" "memory" (memory 1 1 shared))
+
+  ;; Address 0: the threads wait on this address
+  ;; Address 4: number of threads which are about to wait
+  ;; Address 8: number of woken threads
+  ;; Address 12: next free entry of the log
+  ;; Address 16: the main thread sleeps on this address
+  ;; Address 32: the start arguments of the threads in the order they are woken
+  (func (export "wasi_thread_start") (param $tid i32) (param $arg i32)
+    (drop (i32.atomic.rmw.add (i32.const 4) (i32.const 1)))
+    (drop (memory.atomic.notify (i32.const 4) (i32.const 1)))
+    (drop (memory.atomic.wait32 (i32.const 0) (i32.const 0) (i64.const -1)))
+    (i32.atomic.store
+      (i32.add (i32.const 32) (i32.shl (i32.atomic.rmw.add (i32.const 12) (i32.const 1)) (i32.const 2)))
+      (local.get $arg))
+    (drop (i32.atomic.rmw.add (i32.const 8) (i32.const 1)))
+    (drop (memory.atomic.notify (i32.const 8) (i32.const 1)))
+  )
+
+  ;; Waits until the counter at $addr reaches $value.
+  (func $wait_for (param $addr i32) (param $value i32)
+    (local $current i32)
+    (loop $retry
+      (local.set $current (i32.atomic.load (local.get $addr)))
+      (if (i32.lt_u (local.get $current) (local.get $value))
+        (then
+          (drop (memory.atomic.wait32 (local.get $addr) (local.get $current) (i64.const -1)))
+          (br $retry)))
+    )
+  )
+
+  (func (export "run") (result i32)
+    (local $i i32)
+    ;; Start the waiters one after the other.
+    (loop $spawn
+      (local.set $i (i32.add (local.get $i) (i32.const 1)))
+      (if (i32.le_s (call $thread_spawn (local.get $i)) (i32.const 0))
+        (then (return (i32.const -1))))
+      (call $wait_for (i32.const 4) (local.get $i))
+      ;; Gives the thread time to block. Nothing notifies
+      ;; address 16, so the wait times out after 100ms.
+      (if (i32.ne (memory.atomic.wait32 (i32.const 16) (i32.const 0) (i64.const 100000000)) (i32.const 2))
+        (then (return (i32.const -2))))
+      (br_if $spawn (i32.lt_u (local.get $i) (i32.const 3)))
+    )
+
+    ;; Each notify wakes the thread which waits the longest.
+    (if (i32.ne (memory.atomic.notify (i32.const 0) (i32.const 1)) (i32.const 1))
+      (then (return (i32.const -3))))
+    (call $wait_for (i32.const 8) (i32.const 1))
+    (if (i32.ne (memory.atomic.notify (i32.const 0) (i32.const 1)) (i32.const 1))
+      (then (return (i32.const -3))))
+    (call $wait_for (i32.const 8) (i32.const 2))
+
+    ;; Only one thread is left, and then none.
+    (if (i32.ne (memory.atomic.notify (i32.const 0) (i32.const 5)) (i32.const 1))
+      (then (return (i32.const -4))))
+    (call $wait_for (i32.const 8) (i32.const 3))
+    (if (i32.ne (memory.atomic.notify (i32.const 0) (i32.const 5)) (i32.const 0))
+      (then (return (i32.const -5))))
+
+    ;; The order of the woken threads as decimal digits.
+    (i32.add
+      (i32.add
+        (i32.mul (i32.atomic.load (i32.const 32)) (i32.const 100))
+        (i32.mul (i32.atomic.load (i32.const 36)) (i32.const 10)))
+      (i32.atomic.load (i32.const 40)))
+  )
+)
+
+(assert_return (invoke "run") (i32.const 123))
@@ -0,0 +1,93 @@
+(module
+  (type $t0 (sub (func (result i32))))
+  (rec (type $t1 (sub $t0 (func (result i32)))) (type $s1 (struct)))
+  (rec (type $a (func (param i32) (result i32))) (type $b (func (param i64) (result i32))))
+  (type $t2 (func (param i32) (result i32)))
+
+  (func $f0 (type $t0) (i32.const 10))
+  (func $f1 (type $t1) (i32.const 11))
+  (func $fa (type $a) (i32.add (local.get 0) (i32.const 100)))
+  (func $f2 (type $t2) (i32.add (local.get 0) (i32.const 200)))
+
+  (table funcref (elem $f0 $f1 $fa $f2))
+
+  (func (export "call_t0") (param i32) (result i32)
+    (call_indirect (type $t0) (local.get 0)))
+  (func (export "call_t1") (param i32) (result i32)
+    (call_indirect (type $t1) (local.get 0)))
+  (func (export "call_a") (param i32) (result i32)
+    (call_indirect (type $a) (i32.const 1) (local.get 0)))
+  (func (export "call_b") (param i32) (result i32)
+    (call_indirect (type $b) (i64.const 1) (local.get 0)))
+  (func (export "call_t2") (param i32) (result i32)
+    (call_indirect (type $t2) (i32.const 2) (local.get 0)))
+  (func (export "call_ref_t0") (result i32)
+    (call_ref $t0 (ref.func $f1)))
+)
+
+(assert_return (invoke "call_t0" (i32.const 0)) (i32.const 10))
+(assert_return (invoke "call_t0" (i32.const 1)) (i32.const 11))
+(assert_trap (invoke "call_t1" (i32.const 0)) "indirect call type mismatch")
+(assert_return (invoke "call_t1" (i32.const 1)) (i32.const 11))
+
+;; Types in the same recursion group are different types.
+(assert_return (invoke "call_a" (i32.const 2)) (i32.const 101))
+(assert_trap (invoke "call_b" (i32.const 2)) "indirect call type mismatch")
+
+;; A type in a recursion group differs from the same type outside of it.
+(assert_trap (invoke "call_a" (i32.const 3)) "indirect call type mismatch")
+(assert_trap (invoke "call_t2" (i32.const 2)) "indirect call type mismatch")
+(assert_return (invoke "call_t2" (i32.const 3)) (i32.const 202))
+
+(assert_return (invoke "call_ref_t0") (i32.const 11))
+
+;; Type ids of table elements follow table updates.
+(module
+  (type $r (func (result i32)))
+  (type $p (func (param i32) (result i32)))
+
+  (func $one (type $r) (i32.const 1))
+  (func $two (type $r) (i32.const 2))
+  (func $inc (type $p) (i32.add (local.get 0) (i32.const 1)))
+
+  (table $t 2 funcref)
+  (elem (table $t) (i32.const 0) func $one $inc)
+  (elem declare func $two)
+
+  (func (export "call_r") (param i32) (result i32)
+    (call_indirect $t (type $r) (local.get 0)))
+  (func (export "set") (param i32 i32)
+    (table.set $t (local.get 0) (table.get $t (local.get 1))))
+  (func (export "set_null") (param i32)
+    (table.set $t (local.get 0) (ref.null func)))
+  (func (export "set_two") (param i32)
+    (table.set $t (local.get 0) (ref.func $two)))
+  (func (export "copy") (param i32 i32 i32)
+    (table.copy $t $t (local.get 0) (local.get 1) (local.get 2)))
+  (func (export "fill_two") (param i32 i32)
+    (table.fill $t (local.get 0) (ref.func $two) (local.get 1)))
+  (func (export "grow") (param i32) (result i32)
+    (table.grow $t (ref.func $inc) (local.get 0)))
+)
+
+(assert_return (invoke "call_r" (i32.const 0)) (i32.const 1))
+(assert_trap (invoke "call_r" (i32.const 1)) "indirect call type mismatch")
+(assert_trap (invoke "call_r" (i32.const 2)) "undefined element")
+
+(invoke "set_two" (i32.const 1))
+(assert_return (invoke "call_r" (i32.const 1)) (i32.const 2))
+(invoke "set_null" (i32.const 1))
+(assert_trap (invoke "call_r" (i32.const 1)) "uninitialized element")
+
+(assert_return (invoke "grow" (i32.const 2)) (i32.const 2))
+(assert_trap (invoke "call_r" (i32.const 3)) "indirect call type mismatch")
+(invoke "set" (i32.const 1) (i32.const 3))
+(assert_trap (invoke "call_r" (i32.const 1)) "indirect call type mismatch")
+
+(invoke "copy" (i32.const 2) (i32.const 0) (i32.const 2))
+(assert_return (invoke "call_r" (i32.const 2)) (i32.const 1))
+(assert_trap (invoke "call_r" (i32.const 3)) "indirect call type mismatch")
+
+(invoke "fill_two" (i32.const 1) (i32.const 3))
+(assert_return (invoke "call_r" (i32.const 1)) (i32.const 2))
+(assert_return (invoke "call_r" (i32.const 3)) (i32.const 2))
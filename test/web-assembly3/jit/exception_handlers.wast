@@ -0,0 +1,88 @@
+(module
+  (tag $e0 (param i32))
+  (tag $e1 (param i32))
+  (type $t (func (param i32)))
+  (table funcref (elem $throw0 $throw1))
+
+  (func $throw0 (param i32) (throw $e0 (local.get 0)))
+  (func $throw1 (param i32) (throw $e1 (local.get 0)))
+
+  ;; Propagates the exception through a frame without handlers.
+  (func $pass (param i32) (param i32)
+    (call_indirect (type $t) (local.get 0) (local.get 1))
+  )
+
+  (func $deep (param i32) (param i32) (param $depth i32)
+    (if (i32.eqz (local.get $depth))
+      (then (call $pass (local.get 0) (local.get 1)))
+      (else (call $deep (local.get 0) (local.get 1) (i32.sub (local.get $depth) (i32.const 1)))))
+  )
+
+  ;; The inner handler only catches $e1.
+  (func (export "nested") (param i32) (param i32) (result i32)
+    (block $outer (result i32)
+      (block $inner (result i32)
+        (try_table (catch $e0 $outer)
+          (try_table (catch $e1 $inner)
+            (call $deep (local.get 0) (local.get 1) (i32.const 10))
+          )
+        )
+        (i32.const -1)
+        (return)
+      )
+      (i32.const 100)
+      (i32.add)
+      (return)
+    )
+    (i32.const 200)
+    (i32.add)
+  )
+
+  ;; The exception is thrown after the inner try blocks, but inside the outer one.
+  (func (export "after-inner") (param i32) (result i32)
+    (block $outer (result i32)
+      (try_table (catch $e0 $outer)
+        (block $b1
+          (try_table (catch_all $b1)
+            (nop)
+          )
+        )
+        (block $b2 (result i32)
+          (try_table (catch $e1 $b2)
+            (nop)
+          )
+          (i32.const 0)
+        )
+        (drop)
+        (call $throw0 (local.get 0))
+      )
+      (i32.const -1)
+    )
+  )
+
+  (func (export "uncaught") (param i32)
+    (block $b (result i32)
+      (try_table (catch $e1 $b)
+        (call $deep (i32.const 0) (local.get 0) (i32.const 3))
+      )
+      (return)
+    )
+    (drop)
+  )
+
+  ;; Traps are not caught by catch_all.
+  (func (export "trap")
+    (block $b
+      (try_table (catch_all $b)
+        (call_indirect (type $t) (i32.const 0) (i32.const 5))
+      )
+    )
+  )
+)
+
+(assert_return (invoke "nested" (i32.const 7) (i32.const 0)) (i32.const 207))
+(assert_return (invoke "nested" (i32.const 7) (i32.const 1)) (i32.const 107))
+(assert_return (invoke "after-inner" (i32.const 3)) (i32.const 3))
+(assert_return (invoke "uncaught" (i32.const 1)))
+(assert_exception (invoke "uncaught" (i32.const 0)))
+(assert_trap (invoke "trap") "undefined element")
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string_view>
 
 #include "wabt/binary.h"
@@ -51,6 +52,12 @@ struct ReadBinaryOptions {
   bool stop_on_first_error = true;
   bool fail_on_custom_section_error = true;
   bool skip_function_bodies = false;
+  // Set when the binary is streamed. Called before each section and
+  // function body is read, and blocks until the first `end` bytes of
+  // the binary are available. Returns false if the stream ended. The
+  // binary might be moved while it grows, so `data` is updated to its
+  // current address.
+  std::function<bool(Offset end, const uint8_t** data)> wait_for_data;
 };
 
 // TODO: Move both TypeMut and SupertypesInfo somewhere else?
@@ -689,6 +696,16 @@ Result ReadBinary(ByteSpan data,
                   BinaryReaderDelegate* reader,
                   const ReadBinaryOptions& options);
 
+// Reads the function body starting at offset, when the
+// module containing the body is already read by ReadBinary.
+Result ReadBinaryFunctionBody(ByteSpan data,
+                              Offset offset,
+                              Offset size,
+                              Index func_index,
+                              Index data_count,
+                              BinaryReaderDelegate* delegate,
+                              const ReadBinaryOptions& options);
+
 Result ReadBinaryComponent(ByteSpan data,
                            ComponentBinaryReaderDelegate* component_delegate,
                            const ReadBinaryOptions& options);
@@ -35,6 +35,9 @@ public:
         : m_shouldContinueToGenerateByteCode(true)
         , m_resumeGenerateByteCodeAfterNBlockEnd(0)
         , m_skipValidationUntil(0)
+        , m_skipFunctionBodies(false)
+        , m_validateFunctionBodiesOnly(false)
+        , m_isStreaming(false)
     {
     }
     virtual ~WASMBinaryReaderDelegate() { }
@@ -238,6 +241,35 @@ public:
         return m_skipValidationUntil;
     }
 
+    // Function bodies are neither read nor validated, only
+    // BeginFunctionBody and EndFunctionBody are called.
+    bool skipFunctionBodies() const
+    {
+        return m_skipFunctionBodies;
+    }
+
+    // Function bodies are validated, but only BeginFunctionBody
+    // and EndFunctionBody are called.
+    bool validateFunctionBodiesOnly() const
+    {
+        return m_validateFunctionBodiesOnly;
+    }
+
+    // The binary is streamed, and waitForData is called before
+    // each section and function body is read.
+    bool isStreaming() const
+    {
+        return m_isStreaming;
+    }
+
+    // Blocks until the first end bytes of the binary are available.
+    // Returns false if the stream ended before. The data is updated
+    // to the current address of the binary.
+    virtual bool waitForData(size_t end, const uint8_t** data)
+    {
+        return true;
+    }
+
     const std::string& WalrusParseError()
     {
         return m_walrusParseError;
@@ -248,6 +280,9 @@ protected:
     bool m_shouldContinueToGenerateByteCode;
     size_t m_resumeGenerateByteCodeAfterNBlockEnd;
     size_t m_skipValidationUntil;
+    bool m_skipFunctionBodies;
+    bool m_validateFunctionBodiesOnly;
+    bool m_isStreaming;
 };
 
 class ComponentBinaryReaderDelegateWalrus;
@@ -401,6 +436,8 @@ enum FeatureFlagValue : uint32_t {
 };
 
 std::string ReadWasmBinary(const std::string& filename, const uint8_t *data, size_t size, WASMBinaryReaderDelegate* delegate, const uint32_t featureFlags);
+// Reads a function body of a binary, which is already validated by ReadWasmBinary.
+std::string ReadWasmFunctionBody(const uint8_t *data, size_t size, size_t offset, size_t bodySize, Index funcIndex, Index dataCount, WASMBinaryReaderDelegate* delegate, const uint32_t featureFlags);
 std::string ReadWasmComponentBinary(const uint8_t *data, size_t size, WASMComponentBinaryReaderDelegate* delegate);
 
 }  // namespace wabt
@@ -78,6 +78,9 @@ namespace wabt {
 
 namespace {
 
+// Maximum size of an encoded u32 LEB128 value.
+const size_t kMaxU32Leb128Size = 5;
+
 class BinaryReader {
  public:
   struct ReadModuleOptions {
@@ -90,6 +93,10 @@ class BinaryReader {
                         const ReadBinaryOptions& options);
 
   Result ReadModule(const ReadModuleOptions& options);
+  Result ReadFunctionBodyAt(Offset offset,
+                            Offset size,
+                            Index func_index,
+                            Index data_count);
 
  private:
   template <typename T, T BinaryReader::*member>
@@ -107,6 +114,7 @@ class BinaryReader {
   };
 
   void WABT_PRINTF_FORMAT(2, 3) PrintError(const char* format, ...);
+  Result WaitForData(Offset end, const char* desc);
   Result ReadOpcode(Opcode* out_value, const char* desc);
   template <typename T>
   Result ReadT(T* out_value, const char* type_name, const char* desc);
@@ -607,6 +615,20 @@ Result BinaryReader::CallbackMemLocation(const Address* alignment_log2,
   return Result::Ok;
 }
 
+Result BinaryReader::WaitForData(Offset end, const char* desc) {
+  if (options_.wait_for_data) {
+    const uint8_t* data = state_.data.data();
+    bool available = options_.wait_for_data(std::min(end, read_end_), &data);
+    state_.data = ByteSpan(data, state_.data.size());
+
+    if (!available) {
+      PrintError("unable to read %s: unexpected end of stream", desc);
+      return Result::Error;
+    }
+  }
+  return Result::Ok;
+}
+
 Result BinaryReader::ReadCount(Index* count, const char* desc) {
   CHECK_RESULT(ReadIndex(count, desc));
 
@@ -3356,6 +3378,8 @@ Result BinaryReader::ReadElemSection(Offset section_size) {
 
 Result BinaryReader::ReadCodeSection(Offset section_size) {
   CALLBACK(BeginCodeSection, section_size);
+  CHECK_RESULT(
+      WaitForData(state_.offset + kMaxU32Leb128Size, "function body count"));
   CHECK_RESULT(ReadCount(&num_function_bodies_, "function body count"));
   ERROR_UNLESS(num_function_signatures_ == num_function_bodies_,
                "function signature count != function body count");
@@ -3365,11 +3389,14 @@ Result BinaryReader::ReadCodeSection(Offset section_size) {
     Offset func_offset = state_.offset;
     state_.offset = func_offset;
     uint32_t body_size;
+    CHECK_RESULT(
+        WaitForData(state_.offset + kMaxU32Leb128Size, "function body size"));
     CHECK_RESULT(ReadU32Leb128(&body_size, "function body size"));
     Offset body_start_offset = state_.offset;
     Offset end_offset = body_start_offset + body_size;
     ERROR_UNLESS(end_offset >= body_start_offset && end_offset <= read_end_,
                  "invalid function body size: extends past end");
+    CHECK_RESULT(WaitForData(end_offset, "function body"));
     CALLBACK(BeginFunctionBody, func_index, body_size);
 
     if (options_.skip_function_bodies) {
@@ -3436,6 +3463,8 @@ Result BinaryReader::ReadSections(const ReadSectionsOptions& options) {
   for (; state_.offset < state_.data.size(); ++section_index) {
     uint8_t section_code;
     Offset section_size;
+    CHECK_RESULT(
+        WaitForData(state_.offset + 1 + kMaxU32Leb128Size, "section header"));
     CHECK_RESULT(ReadU8(&section_code, "section code"));
     CHECK_RESULT(ReadOffset(&section_size, "section size"));
     ERROR_UNLESS(section_size <= state_.data.size() - state_.offset,
@@ -3469,6 +3498,11 @@ Result BinaryReader::ReadSections(const ReadSectionsOptions& options) {
     ERROR_UNLESS(read_end_ <= state_.data.size(),
                  "invalid section size: extends past end");
 
+    // Function bodies are parsed as soon as they are available.
+    if (section_code != static_cast<uint8_t>(BinarySection::Code)) {
+      CHECK_RESULT(WaitForData(read_end_, "section"));
+    }
+
     ERROR_UNLESS(
         last_known_section_ == BinarySection::Invalid ||
             section == BinarySection::Custom ||
@@ -4489,8 +4523,24 @@ Result BinaryReader::ReadComponent() {
   return Result::Ok;
 }
 
+Result BinaryReader::ReadFunctionBodyAt(Offset offset,
+                                        Offset size,
+                                        Index func_index,
+                                        Index data_count) {
+  ERROR_UNLESS(offset <= read_end_ && size <= read_end_ - offset,
+               "invalid function body size: extends past end");
+  Offset end_offset = offset + size;
+  state_.offset = offset;
+  data_count_ = data_count;
+  CALLBACK(BeginFunctionBody, func_index, size);
+  CHECK_RESULT(ReadFunctionBody(end_offset));
+  CALLBACK(EndFunctionBody, func_index);
+  return Result::Ok;
+}
+
 Result BinaryReader::ReadModule(const ReadModuleOptions& options) {
   uint32_t magic = 0;
+  CHECK_RESULT(WaitForData(8, "module header"));
   CHECK_RESULT(ReadU32(&magic, "magic"));
   ERROR_UNLESS(magic == WABT_BINARY_MAGIC, "bad magic value");
 
@@ -4552,6 +4602,17 @@ Result ReadBinary(ByteSpan data,
       BinaryReader::ReadModuleOptions{options.stop_on_first_error});
 }
 
+Result ReadBinaryFunctionBody(ByteSpan data,
+                              Offset offset,
+                              Offset size,
+                              Index func_index,
+                              Index data_count,
+                              BinaryReaderDelegate* delegate,
+                              const ReadBinaryOptions& options) {
+  BinaryReader reader(data, delegate, nullptr, options);
+  return reader.ReadFunctionBodyAt(offset, size, func_index, data_count);
+}
+
 Result ReadBinaryComponent(ByteSpan data,
                            ComponentBinaryReaderDelegate* delegate,
                            const ReadBinaryOptions& options) {
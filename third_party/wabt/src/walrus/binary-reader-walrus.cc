@@ -439,23 +439,39 @@ public:
         return Result::Ok;
     }
     Result BeginFunctionBody(Index index, Offset size) override {
+        if (m_externalDelegate->skipFunctionBodies()) {
+            m_externalDelegate->BeginFunctionBody(index, size);
+            return CheckParseError();
+        }
         m_labelStack.clear();
         CHECK_RESULT(m_validator.BeginFunctionBody(GetLocation(), index));
         PushLabel(LabelKind::Try);
         m_externalDelegate->BeginFunctionBody(index, size);
+        if (m_externalDelegate->validateFunctionBodiesOnly()) {
+            m_externalDelegate->setShouldContinueToGenerateByteCode(false);
+        }
         return Result::Ok;
     }
     Result OnLocalDeclCount(Index count) override {
+        if (m_externalDelegate->validateFunctionBodiesOnly()) {
+            return Result::Ok;
+        }
         m_externalDelegate->OnLocalDeclCount(count);
         return CheckParseError();
     }
     Result OnLocalDecl(Index decl_index, Index count, Type type) override {
         CHECK_RESULT(m_validator.OnLocalDecl(GetLocation(), count, type));
+        if (m_externalDelegate->validateFunctionBodiesOnly()) {
+            return Result::Ok;
+        }
         m_externalDelegate->OnLocalDecl(decl_index, count, type);
         return CheckParseError();
     }
 
     Result OnStartReadInstructions(Offset start, Offset end) override {
+        if (m_externalDelegate->validateFunctionBodiesOnly()) {
+            return Result::Ok;
+        }
         m_externalDelegate->OnStartReadInstructions(start, end);
         return Result::Ok;
     }
@@ -471,7 +487,7 @@ public:
     }
 
     bool NeedsPreprocess() override {
-        return true;
+        return !m_externalDelegate->validateFunctionBodiesOnly();
     }
 
     /* Function expressions; called between BeginFunctionBody and
@@ -908,6 +924,7 @@ public:
     Result OnNopExpr() override {
         CHECK_RESULT(m_validator.OnNop(GetLocation()));
 #if !defined(NDEBUG)
+        SHOULD_GENERATE_BYTECODE;
         m_externalDelegate->OnNopExpr();
 #endif /* !NDEBUG */
         return Result::Ok;
@@ -1026,10 +1043,17 @@ public:
         return Result::Ok;
     }
     Result EndFunctionBody(Index index) override {
+        if (m_externalDelegate->skipFunctionBodies()) {
+            m_externalDelegate->EndFunctionBody(index);
+            return CheckParseError();
+        }
         Index drop_count, keep_count;
         CHECK_RESULT(GetReturnDropKeepCount(&drop_count, &keep_count));
         CHECK_RESULT(m_validator.EndFunctionBody(GetLocation()));
         EXECUTE_VALIDATOR(PopLabel());
+        if (m_externalDelegate->validateFunctionBodiesOnly()) {
+            m_externalDelegate->setShouldContinueToGenerateByteCode(true);
+        }
         m_externalDelegate->EndFunctionBody(index);
         return CheckParseError();
     }
@@ -1623,6 +1647,10 @@ std::string ReadWasmBinary(const std::string &filename, const uint8_t *data, siz
     const bool kStopOnFirstError = true;
     const bool kFailOnCustomSectionError = true;
     ReadBinaryOptions options(getFeatures(featureFlags), nullptr, kReadDebugNames, kStopOnFirstError, kFailOnCustomSectionError);
+    options.skip_function_bodies = delegate->skipFunctionBodies();
+    if (delegate->isStreaming()) {
+        options.wait_for_data = [delegate](Offset end, const uint8_t** data) { return delegate->waitForData(end, data); };
+    }
     BinaryReaderDelegateWalrus binaryReaderDelegateWalrus(delegate, filename, featureFlags);
     Result result = ReadBinary(ByteSpan(data, size), &binaryReaderDelegateWalrus, options);
 
@@ -1637,6 +1665,25 @@ std::string ReadWasmBinary(const std::string &filename, const uint8_t *data, siz
     return std::string();
 }
 
+std::string ReadWasmFunctionBody(const uint8_t *data, size_t size, size_t offset, size_t bodySize, Index funcIndex, Index dataCount, WASMBinaryReaderDelegate* delegate, const uint32_t featureFlags) {
+    const bool kReadDebugNames = false;
+    const bool kStopOnFirstError = true;
+    const bool kFailOnCustomSectionError = true;
+    ReadBinaryOptions options(getFeatures(featureFlags), nullptr, kReadDebugNames, kStopOnFirstError, kFailOnCustomSectionError);
+    BinaryReaderDelegateWalrus binaryReaderDelegateWalrus(delegate, std::string(), featureFlags);
+    Result result = ReadBinaryFunctionBody(ByteSpan(data, size), offset, bodySize, funcIndex, dataCount, &binaryReaderDelegateWalrus, options);
+
+    if (WABT_UNLIKELY(binaryReaderDelegateWalrus.m_errors.size())) {
+        return std::move(binaryReaderDelegateWalrus.m_errors.begin()->message);
+    }
+
+    if (WABT_UNLIKELY(result != ::wabt::Result::Ok)) {
+        return std::string("read wasm error");
+    }
+
+    return std::string();
+}
+
 #undef CHECK_RESULT
 #define CHECK_RESULT(expr)                                           \
   do {                                                               \
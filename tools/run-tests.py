@@ -22,12 +22,13 @@ import sys
 import time
 import re
 import fnmatch
+import tempfile
 
 from argparse import ArgumentParser
 from difflib import unified_diff
 from glob import glob
 from os.path import abspath, basename, dirname, join, relpath
-from shutil import copy
+from shutil import copy, rmtree
 from subprocess import PIPE, Popen, run, CalledProcessError
 
 
@@ -48,6 +49,16 @@ DEFAULT_RUNNERS = []
 JIT_EXCLUDE_FILES = []
 jit = False
 jit_no_reg_alloc = False
+jit_guard_pages = False
+jit_no_inline = False
+jit_tiering = False
+jit_threads = None
+instance_snapshot = False
+lazy_compile = False
+stream_compile = False
+parser_threads = None
+memory_pool = None
+reserve_memory_maximum = False
 web_assembly3 = False
 
 
@@ -63,7 +74,7 @@ class runner(object):
             DEFAULT_RUNNERS.append(self.suite)
         return fn
 
-def _run_wast_tests(engine, files, is_fail, args=None):
+def _run_wast_tests(engine, files, is_fail, args=None, options=None):
     fails = 0
     for file in files:
         if jit or jit_no_reg_alloc:
@@ -73,7 +84,18 @@ def _run_wast_tests(engine, files, is_fail, args=None):
         subprocess_args = qemu + [engine, "--mapdirs", "./test/wasi/var", "/var"]
         if jit or jit_no_reg_alloc: subprocess_args.append("--jit")
         if jit_no_reg_alloc: subprocess_args.append("--jit-no-reg-alloc")
+        if jit_guard_pages: subprocess_args.append("--jit-guard-pages")
+        if jit_no_inline: subprocess_args.append("--jit-no-inline")
+        if jit_tiering: subprocess_args.append("--jit-tiering")
+        if jit_threads is not None: subprocess_args += ["--jit-threads", str(jit_threads)]
+        if instance_snapshot: subprocess_args.append("--instance-snapshot")
+        if lazy_compile: subprocess_args.append("--lazy-compile")
+        if stream_compile: subprocess_args.append("--stream-compile")
+        if parser_threads is not None: subprocess_args += ["--parser-threads", str(parser_threads)]
+        if memory_pool is not None: subprocess_args += ["--memory-pool", str(memory_pool)]
+        if reserve_memory_maximum: subprocess_args.append("--reserve-memory-maximum")
         if web_assembly3: subprocess_args.append("--enable-web-assembly3")
+        if options: subprocess_args.extend(options)
         if args: subprocess_args.append("--args")
         subprocess_args.append(file)
         if args: subprocess_args.extend(args)
@@ -242,6 +264,133 @@ def run_extended_tests(engine):
         raise Exception("regression tests failed")
 
 
+def _truncate_cache_file(data):
+    return data[:len(data) // 2]
+
+
+def _corrupt_cache_file(data):
+    return data[:-1] + bytes([data[-1] ^ 0xff])
+
+
+def _change_cache_build_id(data):
+    # The build id follows the magic, version, opcode count and pointer size.
+    return data[:16] + bytes([data[16] ^ 0xff]) + data[17:]
+
+
+@runner('module-cache', default=True)
+def run_module_cache_tests(engine):
+    TEST_DIR = join(PROJECT_SOURCE_DIR, 'test', 'cache')
+
+    print('Running module cache tests:')
+    if os.name == 'nt':
+        # The module cache is only supported on POSIX systems.
+        print('%sSKIP: module cache tests%s' % (COLOR_YELLOW, COLOR_RESET))
+        return
+
+    files = glob(join(TEST_DIR, '*.wast'))
+    # Created with 0700 permissions, so the engine accepts it as a cache directory.
+    cache_dir = tempfile.mkdtemp()
+    options = ['--cache-dir', cache_dir]
+
+    # Each step modifies the cached files, executes the tests again and
+    # checks whether the files were loaded or replaced by newly parsed ones.
+    # The last step checks that the replaced files can be loaded.
+    steps = [
+        ('cache hit', None),
+        ('truncated cache file', _truncate_cache_file),
+        ('corrupted cache file', _corrupt_cache_file),
+        ('build id mismatch', _change_cache_build_id),
+        ('cache hit after replace', None),
+    ]
+
+    try:
+        fail_total = _run_wast_tests(engine, files, False, options=options)
+        cached = {}
+        for name in os.listdir(cache_dir):
+            with open(join(cache_dir, name), 'rb') as f:
+                cached[name] = f.read()
+
+        if not cached:
+            print('%sFAIL: no module is stored in the cache%s' % (COLOR_RED, COLOR_RESET))
+            fail_total += 1
+
+        for step, modify in steps:
+            inodes = {}
+            for name, data in cached.items():
+                path = join(cache_dir, name)
+                if modify:
+                    with open(path, 'wb') as f:
+                        f.write(modify(data))
+                inodes[name] = os.stat(path).st_ino
+
+            fails = _run_wast_tests(engine, files, False, options=options)
+            for name, data in cached.items():
+                path = join(cache_dir, name)
+                with open(path, 'rb') as f:
+                    cached[name] = f.read()
+                # Rejected files are replaced by renaming a new file over them. The
+                # content of the new file is not compared, since the byte code
+                # contains addresses which differ between runs.
+                replaced = os.stat(path).st_ino != inodes[name]
+                if len(cached[name]) != len(data) or replaced != (modify is not None):
+                    print('%sFAIL: %s: %s%s' % (COLOR_RED, step, name, COLOR_RESET))
+                    fails += 1
+
+            if fails == 0:
+                print('%sOK: %s%s' % (COLOR_GREEN, step, COLOR_RESET))
+            fail_total += fails
+    finally:
+        rmtree(cache_dir)
+
+    tests_total = len(files) * (len(steps) + 1) + len(steps)
+    print('TOTAL: %d' % (tests_total))
+    print('%sPASS : %d%s' % (COLOR_GREEN, tests_total - fail_total, COLOR_RESET))
+    print('%sFAIL : %d%s' % (COLOR_RED, fail_total, COLOR_RESET))
+
+    if fail_total > 0:
+        raise Exception("module cache tests failed")
+
+
+
+@runner('memory-pool', default=True)
+def run_memory_pool_tests(engine):
+    TEST_DIR = join(PROJECT_SOURCE_DIR, 'test', 'memory-pool')
+
+    print('Running memory pool tests:')
+    if os.name == 'nt':
+        # Memory pools are only supported on POSIX systems.
+        print('%sSKIP: memory pool tests%s' % (COLOR_YELLOW, COLOR_RESET))
+        return
+
+    # The tests create more memories than the number of slots.
+    files = glob(join(TEST_DIR, '*.wast'))
+    stats_pattern = re.compile(r'Memory pool: 2 slots, 0 in use, high water mark 2, (\d+) allocations, \d+ reuses, (\d+) misses')
+    fail_total = 0
+    for file in files:
+        subprocess_args = qemu + [engine, "--memory-pool", "2", "--memory-pool-stats"]
+        if jit: subprocess_args.append("--jit")
+        subprocess_args.append(file)
+
+        proc = Popen(subprocess_args, stdout=PIPE, stderr=PIPE)
+        out, _ = proc.communicate()
+        out = out.decode('utf-8')
+        stats = stats_pattern.search(out)
+
+        if proc.returncode == 0 and stats and int(stats.group(1)) == 2 and int(stats.group(2)) > 0:
+            print('%sOK: %s%s' % (COLOR_GREEN, file, COLOR_RESET))
+        else:
+            print('%sFAIL(%d): %s%s' % (COLOR_RED, proc.returncode, file, COLOR_RESET))
+            print(out)
+            fail_total += 1
+
+    tests_total = len(files)
+    print('TOTAL: %d' % (tests_total))
+    print('%sPASS : %d%s' % (COLOR_GREEN, tests_total - fail_total, COLOR_RESET))
+    print('%sFAIL : %d%s' % (COLOR_RED, fail_total, COLOR_RESET))
+
+    if fail_total > 0:
+        raise Exception("memory pool tests failed")
+
 def main():
     parser = ArgumentParser(description='Walrus Test Suite Runner')
     parser.add_argument('--engine', metavar='PATH', default=DEFAULT_WALRUS,
@@ -251,9 +400,47 @@ def main():
                         help='test suite to run (%s; default: %s)' % (', '.join(sorted(RUNNERS.keys())), ' '.join(sorted(DEFAULT_RUNNERS))))
     parser.add_argument('--jit', action='store_true', help='test with JIT')
     parser.add_argument('--jit-no-reg-alloc', action='store_true', help='test with JIT without register allocation')
+    parser.add_argument('--jit-guard-pages', action='store_true', help='test with JIT using guard pages for memory accesses')
+    parser.add_argument('--jit-no-inline', action='store_true', help='test with JIT without inlining small functions')
+    parser.add_argument('--jit-tiering', action='store_true', help='test with JIT compiling hot functions in the background')
+    parser.add_argument('--jit-threads', type=int, metavar='N', help='test with JIT compiling modules using N threads')
+    parser.add_argument('--instance-snapshot', action='store_true', help='test with instances created from snapshots')
+    parser.add_argument('--lazy-compile', action='store_true', help='test with byte code generated on the first call of functions')
+    parser.add_argument('--stream-compile', action='store_true', help='test with modules parsed while their binary is appended in chunks')
+    parser.add_argument('--parser-threads', type=int, metavar='N', help='test with byte code of modules generated using N threads')
+    parser.add_argument('--memory-pool', type=int, metavar='N', help='test with linear memories allocated from a pool of N slots')
+    parser.add_argument('--reserve-memory-maximum', action='store_true', help='test with address space reserved for the maximum memory sizes')
     args = parser.parse_args()
     global jit
-    jit = args.jit
+    jit = args.jit or args.jit_guard_pages or args.jit_no_inline or args.jit_tiering or args.jit_threads is not None
+
+    global jit_guard_pages
+    jit_guard_pages = args.jit_guard_pages
+
+    global jit_no_inline
+    jit_no_inline = args.jit_no_inline
+
+    global jit_tiering
+    jit_tiering = args.jit_tiering
+
+    global jit_threads
+    jit_threads = args.jit_threads
+
+    global instance_snapshot
+    instance_snapshot = args.instance_snapshot
+
+    global lazy_compile
+    lazy_compile = args.lazy_compile
+    global stream_compile
+    stream_compile = args.stream_compile
+    global parser_threads
+    parser_threads = args.parser_threads
+
+    global memory_pool
+    memory_pool = args.memory_pool
+
+    global reserve_memory_maximum
+    reserve_memory_maximum = args.reserve_memory_maximum
 
     global jit_no_reg_alloc
     jit_no_reg_alloc = args.jit_no_reg_alloc